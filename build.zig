@@ -103,6 +103,16 @@ pub fn build(b: *std.Build) !void {
     };
     options.addOption([]const u8, "git_commit", git_commit);
 
+    const build_options_mod = options.createModule();
+    const imports: []const std.Build.Module.Import = &.{
+        .{ .name = "clap", .module = clap_dep.module("clap") },
+        .{ .name = "vaxis", .module = vaxis_dep.module("vaxis") },
+        .{ .name = "ansi_term", .module = ansi_term_dep.module("ansi_term") },
+        .{ .name = "toml", .module = toml_dep.module("toml") },
+        .{ .name = "zeit", .module = zeit_dep.module("zeit") },
+        .{ .name = "build_options", .module = build_options_mod },
+    };
+
     // Define the main executable
     const exe = b.addExecutable(.{
         .name = exe_name,
@@ -111,14 +121,7 @@ pub fn build(b: *std.Build) !void {
             .target = target,
             .optimize = optimize,
             // List of external dependencies available for import
-            .imports = &.{
-                .{ .name = "clap", .module = clap_dep.module("clap") },
-                .{ .name = "vaxis", .module = vaxis_dep.module("vaxis") },
-                .{ .name = "ansi_term", .module = ansi_term_dep.module("ansi_term") },
-                .{ .name = "toml", .module = toml_dep.module("toml") },
-                .{ .name = "zeit", .module = zeit_dep.module("zeit") },
-                .{ .name = "build_options", .module = options.createModule() },
-            },
+            .imports = imports,
         }),
     });
 
@@ -126,38 +129,7 @@ pub fn build(b: *std.Build) !void {
         exe.root_module.strip = s;
     }
 
-    // Add mruby header file path
-    exe.addIncludePath(.{ .cwd_relative = b.fmt("{s}/include", .{final_mruby_path}) });
-
-    // Link mruby static library directly (no need to add library path since we specify full path)
-    exe.addObjectFile(.{ .cwd_relative = b.fmt("{s}/lib/libmruby.a", .{final_mruby_path}) });
-    exe.linkLibC();
-
-    // For Linux cross-compilation, provide linker symbols that mruby expects
-    if (target.result.os.tag == .linux) {
-        exe.root_module.link_libc = true;
-        exe.addAssemblyFile(b.path("src/linux_linker_shims.s"));
-        // aarch64-gnu only: provide sigsetjmp symbol for OpenSSL armcap.c
-        // musl provides sigsetjmp natively, so only needed for gnu
-        if (target.result.cpu.arch == .aarch64 and target.result.abi == .gnu) {
-            exe.addAssemblyFile(b.path("src/linux_aarch64_shims.S"));
-        }
-    }
-
-    // Platform-specific configuration
-    if (target.result.os.tag == .macos) {
-        // macOS: Link Foundation framework for AppleScript support
-        exe.linkFramework("Foundation");
-        // Add Objective-C bridge file for runtime calls
-        // Note: .m files are compiled as Objective-C
-        exe.addCSourceFile(.{ .file = b.path("src/applescript_bridge.m"), .flags = &.{"-fobjc-arc"} });
-        // Add CFPreferences C wrapper
-        exe.addCSourceFile(.{ .file = b.path("src/cfprefs_wrapper.c"), .flags = &.{} });
-    }
-
-    // Add mruby helpers for array handling
-    exe.addCSourceFile(.{ .file = b.path("src/mruby_helpers.c"), .flags = &.{} });
-    configureLibGit2(exe, b, final_libgit2_path, target.result.os.tag);
+    configureRuntime(exe, b, final_mruby_path, final_libgit2_path, target.result);
 
     // This declares intent for the executable to be installed into the
     // install prefix when running `zig build` (i.e. when executing the default
@@ -204,6 +176,26 @@ pub fn build(b: *std.Build) !void {
     const test_step = b.step("test", "Run tests");
     test_step.dependOn(&run_exe_tests.step);
 
+    // Benchmarks always build optimized so numbers are comparable across runs
+    const bench_exe = b.addExecutable(.{
+        .name = "hola-bench",
+        .root_module = b.createModule(.{
+            .root_source_file = b.path("src/bench.zig"),
+            .target = target,
+            .optimize = .ReleaseFast,
+            .imports = imports,
+        }),
+    });
+    configureRuntime(bench_exe, b, final_mruby_path, final_libgit2_path, target.result);
+
+    // `zig build bench -- --filter sse` runs a subset; results are JSON lines
+    const run_bench = b.addRunArtifact(bench_exe);
+    if (b.args) |args| {
+        run_bench.addArgs(args);
+    }
+    const bench_step = b.step("bench", "Run benchmarks (JSON lines on stdout)");
+    bench_step.dependOn(&run_bench.step);
+
     // Just like flags, top level steps are also listed in the `--help` menu.
     //
     // The Zig build system is entirely implemented in userland, which means
@@ -217,6 +209,45 @@ pub fn build(b: *std.Build) !void {
     // and reading its source code will allow you to master it.
 }
 
+/// Link mruby, libgit2/libcurl and the platform glue shared by every artifact
+/// that embeds the provisioning runtime (main executable and benchmarks)
+fn configureRuntime(step: *std.Build.Step.Compile, b: *std.Build, mruby_path: []const u8, libgit2_path: []const u8, target: std.Target) void {
+    // Add mruby header file path
+    step.addIncludePath(.{ .cwd_relative = b.fmt("{s}/include", .{mruby_path}) });
+
+    // Link mruby static library directly (no need to add library path since we specify full path)
+    step.addObjectFile(.{ .cwd_relative = b.fmt("{s}/lib/libmruby.a", .{mruby_path}) });
+    step.linkLibC();
+
+    // For Linux cross-compilation, provide linker symbols that mruby expects
+    if (target.os.tag == .linux) {
+        step.root_module.link_libc = true;
+        step.addAssemblyFile(b.path("src/linux_linker_shims.s"));
+        // aarch64-gnu only: provide sigsetjmp symbol for OpenSSL armcap.c
+        // musl provides sigsetjmp natively, so only needed for gnu
+        if (target.cpu.arch == .aarch64 and target.abi == .gnu) {
+            step.addAssemblyFile(b.path("src/linux_aarch64_shims.S"));
+        }
+    }
+
+    // Platform-specific configuration
+    if (target.os.tag == .macos) {
+        // macOS: Link Foundation framework for AppleScript support
+        step.linkFramework("Foundation");
+        // Add Objective-C bridge file for runtime calls
+        // Note: .m files are compiled as Objective-C
+        step.addCSourceFile(.{ .file = b.path("src/applescript_bridge.m"), .flags = &.{"-fobjc-arc"} });
+        // Add CFPreferences C wrapper
+        step.addCSourceFile(.{ .file = b.path("src/cfprefs_wrapper.c"), .flags = &.{} });
+    }
+
+    // Add mruby helpers for array handling
+    step.addCSourceFile(.{ .file = b.path("src/mruby_helpers.c"), .flags = &.{} });
+    // Native OpenStruct
+    step.addCSourceFile(.{ .file = b.path("src/mruby_open_struct.c"), .flags = &.{} });
+    configureLibGit2(step, b, libgit2_path, target.os.tag);
+}
+
 fn configureLibGit2(step: *std.Build.Step.Compile, b: *std.Build, libgit2_path: []const u8, os_tag: std.Target.Os.Tag) void {
     // All platforms use hola_deps package with unified structure
     step.addIncludePath(.{ .cwd_relative = b.fmt("{s}/include", .{libgit2_path}) });
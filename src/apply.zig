@@ -80,8 +80,8 @@ const MacosBootstrap = struct {
         try installHomebrew(allocator, display);
     }
 
-    pub fn installPackagesParallel(allocator: std.mem.Allocator, config_root: []const u8) !void {
-        try installPackagesParallelImpl(allocator, config_root);
+    pub fn installPackagesParallel(allocator: std.mem.Allocator, config_root: []const u8, sink: ?modern_display.ModernProvisionDisplay.InfoSink) !void {
+        try installPackagesParallelImpl(allocator, config_root, sink);
     }
 };
 
@@ -91,13 +91,15 @@ const AptBootstrap = if (is_linux) struct {
         try display.showInfo("Using apt for package management (no separate foundation step)");
     }
 
-    pub fn installPackagesParallel(allocator: std.mem.Allocator, config_root: []const u8) !void {
+    pub fn installPackagesParallel(allocator: std.mem.Allocator, config_root: []const u8, sink: ?modern_display.ModernProvisionDisplay.InfoSink) !void {
         // For apt we run installs sequentially: apt first, then mise.
         var apt_display = try modern_display.ModernProvisionDisplay.init(allocator, false);
         defer apt_display.deinit();
+        apt_display.info_sink = sink;
 
         var mise_display = try modern_display.ModernProvisionDisplay.init(allocator, false);
         defer mise_display.deinit();
+        mise_display.info_sink = sink;
 
         // Detect apt (apt-get preferred) at the platform layer so we can extend
         // this later for yum/dnf/pacman, etc.
@@ -122,7 +124,9 @@ else
     MacosBootstrap;
 
 /// Trait-style runner: any Impl that provides installFoundation / installPackagesParallel
-/// can be used here (MacosBootstrap, AptBootstrap, or a test stub).
+/// can be used here (MacosBootstrap, AptBootstrap, or a test stub). A non-null
+/// sink receives the package phase's messages instead of the terminal, and
+/// installer output goes to the log only.
 fn runWithBootstrap(comptime Impl: type, allocator: std.mem.Allocator, opts: ApplyOptions) !void {
     // Compile-time "trait" check: Impl must expose the expected functions.
     comptime {
@@ -151,10 +155,6 @@ fn runWithBootstrap(comptime Impl: type, allocator: std.mem.Allocator, opts: App
     // Phase 2: Platform foundation (macOS: Homebrew, Linux: apt)
     try Impl.installFoundation(allocator, &display);
 
-    // Phase 3: Platform packages (macOS: brew bundle + mise, Linux: apt + mise)
-    try Impl.installPackagesParallel(allocator, opts.config_root);
-
-    // Phase 4: Provision
     // Search for provision.rb in multiple locations (first match wins):
     // 1. config_root/.config/hola/provision.rb
     // 2. ~/.dotfiles/.config/hola/provision.rb
@@ -166,33 +166,59 @@ fn runWithBootstrap(comptime Impl: type, allocator: std.mem.Allocator, opts: App
 
     const resources_roots = [_][]const u8{ opts.config_root, dotfiles_root, home };
     const resources_path = try findFirstExistingJoinedPath(allocator, &resources_roots, ".config/hola/provision.rb");
-
-    // Check if provision.rb exists
-    const script_path = resources_path orelse {
-        const msg = try std.fmt.allocPrint(
-            allocator,
-            "No provision.rb found (searched in {s}/.config/hola, ~/.dotfiles/.config/hola, $HOME/.config/hola), skipping provision",
-            .{opts.config_root},
-        );
-        defer allocator.free(msg);
-        try display.showInfo(msg);
-        return;
-    };
-    defer allocator.free(script_path);
-
-    // Skip provision in dry-run mode
-    if (opts.dry_run) {
-        const msg = try std.fmt.allocPrint(allocator, "Skipping provision (dry-run mode)", .{});
+    defer if (resources_path) |path| allocator.free(path);
+
+    // Without a provision phase to overlap with, packages run in the foreground
+    const script_path = if (opts.dry_run) null else resources_path;
+    if (script_path == null) {
+        // Phase 3: Platform packages (macOS: brew bundle + mise, Linux: apt + mise)
+        try Impl.installPackagesParallel(allocator, opts.config_root, null);
+
+        const msg = if (resources_path == null)
+            try std.fmt.allocPrint(
+                allocator,
+                "No provision.rb found (searched in {s}/.config/hola, ~/.dotfiles/.config/hola, $HOME/.config/hola), skipping provision",
+                .{opts.config_root},
+            )
+        else
+            try std.fmt.allocPrint(allocator, "Skipping provision (dry-run mode)", .{});
         defer allocator.free(msg);
         try display.showInfo(msg);
         return;
     }
 
+    // Phase 3 (packages) and Phase 4 (provision) run concurrently. The
+    // provision script is evaluated and its downloads started right away;
+    // provision.run() only holds back resources that may use installed
+    // tools until the package phase signals the gate. The package phase
+    // reports through the gate, which provision shows as a display line.
+    var package_gate = provision.PackageGate{};
+    const PackagePhase = struct {
+        fn run(alloc: std.mem.Allocator, config_root: []const u8, gate: *provision.PackageGate) void {
+            Impl.installPackagesParallel(alloc, config_root, gate.infoSink()) catch |err| {
+                logger.err("Package installation failed: {}", .{err});
+                gate.setStatus(@errorName(err));
+                gate.finish(false);
+                return;
+            };
+            gate.finish(true);
+        }
+    };
+    const package_thread = try std.Thread.spawn(.{}, PackagePhase.run, .{ allocator, opts.config_root, &package_gate });
+    var package_thread_joined = false;
+    defer if (!package_thread_joined) package_thread.join();
+
     std.debug.print("\n", .{});
-    // provision.run() will use its own ModernProvisionDisplay with spinner and will show section
-    var prov_result = try provision.run(allocator, .{ .script_path = script_path });
+    var prov_result = try provision.run(allocator, .{
+        .script_path = script_path.?,
+        .package_gate = &package_gate,
+    });
     defer prov_result.deinit(allocator);
 
+    package_thread.join();
+    package_thread_joined = true;
+    if (package_gate.hasFailed()) return error.PackageInstallFailed;
+
     // Show log file location
     if (logger.getLogPath()) |log_file| {
         std.debug.print("\n\x1b[90mLog file: {s}\x1b[0m\n", .{log_file});
@@ -293,15 +319,17 @@ fn findBrewAfterInstall(allocator: std.mem.Allocator) ![]const u8 {
     return brew.findBrew(allocator);
 }
 /// Step 3: Install packages in parallel (brew bundle + mise) on macOS
-fn installPackagesParallelImpl(allocator: std.mem.Allocator, config_root: []const u8) !void {
+fn installPackagesParallelImpl(allocator: std.mem.Allocator, config_root: []const u8, sink: ?modern_display.ModernProvisionDisplay.InfoSink) !void {
     // Note: Section display is handled in child functions to avoid thread safety issues
 
     // Create separate display instances for each thread to avoid thread safety issues
     var brew_display = try modern_display.ModernProvisionDisplay.init(allocator, false);
     defer brew_display.deinit();
+    brew_display.info_sink = sink;
 
     var mise_display = try modern_display.ModernProvisionDisplay.init(allocator, false);
     defer mise_display.deinit();
+    mise_display.info_sink = sink;
 
     // Spawn threads for parallel execution
     var brew_thread = try std.Thread.spawn(.{}, installBrewPackages, .{ allocator, config_root, &brew_display });
@@ -353,7 +381,8 @@ fn installBrewPackages(allocator: std.mem.Allocator, _: []const u8, display: *mo
     // Add --force to handle conflicting versions
     try args_list.append(allocator, "--force");
 
-    command_runner.executeCommandWithLogging(allocator, args_list.items, null) catch |err| {
+    const output: command_runner.Output = if (display.info_sink == null) .terminal else .log_only;
+    command_runner.executeCommand(allocator, args_list.items, null, output) catch |err| {
         const warning_msg = try std.fmt.allocPrint(
             allocator,
             "Warning: Some Homebrew packages failed to install (error: {}). Continuing...",
@@ -367,11 +396,13 @@ fn installBrewPackages(allocator: std.mem.Allocator, _: []const u8, display: *mo
 
 /// Install mise and mise tools
 fn installMiseTools(allocator: std.mem.Allocator, config_root: []const u8, display: *modern_display.ModernProvisionDisplay) !void {
+    const output: command_runner.Output = if (display.info_sink == null) .terminal else .log_only;
+
     // Step 1: Install mise if not installed
     const mise_path = findMise(allocator) catch |err| switch (err) {
         error.MiseNotFound => blk: {
             try display.showInfo("Installing mise...");
-            try installMise(allocator);
+            try installMise(allocator, output);
             // Verify installation - if it fails, return error
             break :blk findMise(allocator) catch return error.MiseInstallFailed;
         },
@@ -459,11 +490,11 @@ fn installMiseTools(allocator: std.mem.Allocator, config_root: []const u8, displ
 
     // Step 1: Trust the mise.toml file first
     var trust_args = [_][]const u8{ mise_path, "trust", "--quiet" };
-    try command_runner.executeCommandWithLogging(allocator, &trust_args, toml_dir);
+    try command_runner.executeCommand(allocator, &trust_args, toml_dir, output);
 
     // Step 2: Run mise install (in the directory containing mise.toml)
     var install_args = [_][]const u8{ mise_path, "install" };
-    try command_runner.executeCommandWithLogging(allocator, &install_args, toml_dir);
+    try command_runner.executeCommand(allocator, &install_args, toml_dir, output);
 }
 
 /// Find mise executable
@@ -506,9 +537,17 @@ fn findMise(allocator: std.mem.Allocator) ![]const u8 {
 }
 
 /// Install mise using official installer
-fn installMise(allocator: std.mem.Allocator) !void {
+fn installMise(allocator: std.mem.Allocator, output: command_runner.Output) !void {
     // Use official mise installer
     const install_script = "curl https://mise.run | sh";
+    if (output == .log_only) {
+        command_runner.executeCommand(allocator, &.{ "/bin/bash", "-c", install_script }, null, .log_only) catch |err| switch (err) {
+            error.CommandFailed => return error.MiseInstallFailed,
+            else => return err,
+        };
+        return;
+    }
+
     var proc = std.process.Child.init(&[_][]const u8{ "/bin/bash", "-c", install_script }, allocator);
     proc.stdout_behavior = .Inherit;
     proc.stderr_behavior = .Inherit;
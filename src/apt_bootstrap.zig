@@ -60,10 +60,13 @@ pub fn installPackages(
         return;
     }
 
+    // Under a live provision display the output goes to the log only
+    const output: command_runner.Output = if (display.info_sink == null) .terminal else .log_only;
+
     // apt-get / apt update
     try display.showInfo("Running: sudo apt update");
     var update_args = [_][]const u8{ "sudo", apt_path, "update" };
-    try command_runner.executeCommandWithLogging(allocator, &update_args, null);
+    try command_runner.executeCommand(allocator, &update_args, null, output);
 
     // apt-get / apt install -y <packages...>
     try display.showInfo("Installing apt packages...");
@@ -79,7 +82,7 @@ pub fn installPackages(
         try args_list.append(allocator, pkg);
     }
 
-    command_runner.executeCommandWithLogging(allocator, args_list.items, null) catch |err| {
+    command_runner.executeCommand(allocator, args_list.items, null, output) catch |err| {
         const warning_msg = try std.fmt.allocPrint(
             allocator,
             "Warning: Some apt packages failed to install (error: {}). Continuing...",
@@ -8,34 +8,48 @@ pub fn setAllocator(allocator: std.mem.Allocator) void {
     global_allocator = allocator;
 }
 
-/// mruby binding: Base64.encode(str) - encode string to Base64
-pub fn zig_base64_encode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
-    const allocator = global_allocator orelse return mruby.mrb_nil_value();
+// Outputs up to this size are built on the stack; Base64 calls in script
+// loops are mostly short tokens and headers
+const stack_bytes = 4096;
 
+const Codec = enum { standard, url_safe };
+
+fn encode(mrb: *mruby.mrb_state, comptime codec: Codec) mruby.mrb_value {
+    const encoder = switch (codec) {
+        .standard => std.base64.standard.Encoder,
+        .url_safe => std.base64.url_safe_no_pad.Encoder,
+    };
+
+    // The optional second argument is urlsafe_encode64's `padding:`
+    // keyword, which is not supported (output is never padded)
     var str_ptr: [*c]const u8 = null;
     var str_len: mruby.mrb_int = 0;
-    _ = mruby.mrb_get_args(mrb, "s", &str_ptr, &str_len);
+    var options: mruby.mrb_value = mruby.mrb_nil_value();
+    _ = mruby.mrb_get_args(mrb, "s|o", &str_ptr, &str_len, &options);
 
     if (str_ptr == null or str_len < 0) {
         return mruby.mrb_nil_value();
     }
 
     const input = str_ptr[0..@intCast(str_len)];
+    const encoded_len = encoder.calcSize(input.len);
 
-    // Calculate output size
-    const encoded_len = std.base64.standard.Encoder.calcSize(input.len);
-    const encoded = allocator.alloc(u8, encoded_len) catch return mruby.mrb_nil_value();
-    defer allocator.free(encoded);
-
-    // Encode
-    const result = std.base64.standard.Encoder.encode(encoded, input);
+    var stack_buf: [stack_bytes]u8 = undefined;
+    const heap_buf = if (encoded_len > stack_buf.len)
+        (global_allocator orelse return mruby.mrb_nil_value()).alloc(u8, encoded_len) catch return mruby.mrb_nil_value()
+    else
+        null;
+    defer if (heap_buf) |buf| global_allocator.?.free(buf);
 
+    const result = encoder.encode(if (heap_buf) |buf| buf else stack_buf[0..encoded_len], input);
     return mruby.mrb_str_new(mrb, result.ptr, @intCast(result.len));
 }
 
-/// mruby binding: Base64.decode(str) - decode Base64 string
-pub fn zig_base64_decode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
-    const allocator = global_allocator orelse return mruby.mrb_nil_value();
+fn decode(mrb: *mruby.mrb_state, comptime codec: Codec) mruby.mrb_value {
+    const decoder = switch (codec) {
+        .standard => std.base64.standard.Decoder,
+        .url_safe => std.base64.url_safe_no_pad.Decoder,
+    };
 
     var str_ptr: [*c]const u8 = null;
     var str_len: mruby.mrb_int = 0;
@@ -46,86 +60,65 @@ pub fn zig_base64_decode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c)
     }
 
     const input = str_ptr[0..@intCast(str_len)];
+    const decoded_len = decoder.calcSizeForSlice(input) catch return mruby.mrb_nil_value();
 
-    // Calculate output size
-    const decoded_len = std.base64.standard.Decoder.calcSizeForSlice(input) catch return mruby.mrb_nil_value();
-    const decoded = allocator.alloc(u8, decoded_len) catch return mruby.mrb_nil_value();
-    defer allocator.free(decoded);
-
-    // Decode
-    std.base64.standard.Decoder.decode(decoded, input) catch return mruby.mrb_nil_value();
+    var stack_buf: [stack_bytes]u8 = undefined;
+    const heap_buf = if (decoded_len > stack_buf.len)
+        (global_allocator orelse return mruby.mrb_nil_value()).alloc(u8, decoded_len) catch return mruby.mrb_nil_value()
+    else
+        null;
+    defer if (heap_buf) |buf| global_allocator.?.free(buf);
 
+    const decoded = if (heap_buf) |buf| buf else stack_buf[0..decoded_len];
+    decoder.decode(decoded, input) catch return mruby.mrb_nil_value();
     return mruby.mrb_str_new(mrb, decoded.ptr, @intCast(decoded.len));
 }
 
-/// mruby binding: Base64.urlsafe_encode(str) - encode string to URL-safe Base64
-pub fn zig_base64_urlsafe_encode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
-    const allocator = global_allocator orelse return mruby.mrb_nil_value();
-
-    var str_ptr: [*c]const u8 = null;
-    var str_len: mruby.mrb_int = 0;
-    _ = mruby.mrb_get_args(mrb, "s", &str_ptr, &str_len);
-
-    if (str_ptr == null or str_len < 0) {
-        return mruby.mrb_nil_value();
-    }
-
-    const input = str_ptr[0..@intCast(str_len)];
-
-    // Calculate output size
-    const encoded_len = std.base64.url_safe_no_pad.Encoder.calcSize(input.len);
-    const encoded = allocator.alloc(u8, encoded_len) catch return mruby.mrb_nil_value();
-    defer allocator.free(encoded);
-
-    // Encode
-    const result = std.base64.url_safe_no_pad.Encoder.encode(encoded, input);
-
-    return mruby.mrb_str_new(mrb, result.ptr, @intCast(result.len));
+/// mruby binding: Base64.encode64(str) / strict_encode64(str)
+fn base64_encode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    return encode(mrb, .standard);
 }
 
-/// mruby binding: Base64.urlsafe_decode(str) - decode URL-safe Base64 string
-pub fn zig_base64_urlsafe_decode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
-    const allocator = global_allocator orelse return mruby.mrb_nil_value();
-
-    var str_ptr: [*c]const u8 = null;
-    var str_len: mruby.mrb_int = 0;
-    _ = mruby.mrb_get_args(mrb, "s", &str_ptr, &str_len);
-
-    if (str_ptr == null or str_len < 0) {
-        return mruby.mrb_nil_value();
-    }
-
-    const input = str_ptr[0..@intCast(str_len)];
-
-    // Calculate output size
-    const decoded_len = std.base64.url_safe_no_pad.Decoder.calcSizeForSlice(input) catch return mruby.mrb_nil_value();
-    const decoded = allocator.alloc(u8, decoded_len) catch return mruby.mrb_nil_value();
-    defer allocator.free(decoded);
+/// mruby binding: Base64.decode64(str) / strict_decode64(str)
+fn base64_decode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    return decode(mrb, .standard);
+}
 
-    // Decode
-    std.base64.url_safe_no_pad.Decoder.decode(decoded, input) catch return mruby.mrb_nil_value();
+/// mruby binding: Base64.urlsafe_encode64(str) - URL-safe, unpadded
+fn base64_urlsafe_encode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    return encode(mrb, .url_safe);
+}
 
-    return mruby.mrb_str_new(mrb, decoded.ptr, @intCast(decoded.len));
+/// mruby binding: Base64.urlsafe_decode64(str)
+fn base64_urlsafe_decode(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    return decode(mrb, .url_safe);
 }
 
-pub const ruby_prelude = @embedFile("ruby_prelude/base64.rb");
+/// Define the Base64 module with the codec bound directly to its methods,
+/// so calls in script loops skip a Ruby-level wrapper
+pub fn setupBase64Module(mrb: *mruby.mrb_state) void {
+    const module = mruby.mrb_define_module(mrb, "Base64");
+    const methods = [_]struct { name: [*:0]const u8, func: mruby.mrb_func_t, args: mruby.mrb_aspec }{
+        .{ .name = "encode64", .func = base64_encode, .args = mruby.MRB_ARGS_REQ(1) },
+        .{ .name = "strict_encode64", .func = base64_encode, .args = mruby.MRB_ARGS_REQ(1) },
+        .{ .name = "decode64", .func = base64_decode, .args = mruby.MRB_ARGS_REQ(1) },
+        .{ .name = "strict_decode64", .func = base64_decode, .args = mruby.MRB_ARGS_REQ(1) },
+        .{ .name = "urlsafe_encode64", .func = base64_urlsafe_encode, .args = mruby.MRB_ARGS_REQ(1) | mruby.MRB_ARGS_OPT(1) },
+        .{ .name = "urlsafe_decode64", .func = base64_urlsafe_decode, .args = mruby.MRB_ARGS_REQ(1) },
+    };
+    for (methods) |method| mruby.mrb_define_module_function(mrb, module, method.name, method.func, method.args);
+}
 
 // MRuby module registration interface
 const mruby_module = @import("mruby_module.zig");
 
-const base64_functions = [_]mruby_module.ModuleFunction{
-    .{ .name = "base64_encode", .func = zig_base64_encode, .args = mruby.MRB_ARGS_REQ(1) },
-    .{ .name = "base64_decode", .func = zig_base64_decode, .args = mruby.MRB_ARGS_REQ(1) },
-    .{ .name = "base64_urlsafe_encode", .func = zig_base64_urlsafe_encode, .args = mruby.MRB_ARGS_REQ(1) },
-    .{ .name = "base64_urlsafe_decode", .func = zig_base64_urlsafe_decode, .args = mruby.MRB_ARGS_REQ(1) },
-};
-
 fn getFunctions() []const mruby_module.ModuleFunction {
-    return &base64_functions;
+    // Base64 methods are registered via setupBase64Module, not as ZigBackend functions
+    return &[_]mruby_module.ModuleFunction{};
 }
 
 fn getPrelude() []const u8 {
-    return ruby_prelude;
+    return "";
 }
 
 pub const mruby_module_def = mruby_module.MRubyModule{
@@ -1,5 +1,6 @@
 const std = @import("std");
 const mruby = @import("mruby.zig");
+const dir_cache = @import("dir_cache.zig");
 pub const notification = @import("notification.zig");
 const builtin = @import("builtin");
 
@@ -67,6 +68,38 @@ pub fn recordProvisionException(mrb: *mruby.mrb_state, exc: mruby.mrb_value, pre
     provision_error_detail_len = written.len;
 }
 
+// --- Per-resource stats ------------------------------------------------------
+// The apply loop resets these before each resource and takes them after it.
+// They are process-wide atomics rather than thread-locals because resources
+// hand work to AsyncExecutor threads; provision applies one resource at a
+// time, so nothing else accumulates into them meanwhile.
+var stat_guard_ns = std.atomic.Value(u64).init(0);
+var stat_subprocesses = std.atomic.Value(u32).init(0);
+
+pub const ApplyCounters = struct {
+    guard_ns: u64 = 0,
+    subprocesses: u32 = 0,
+};
+
+pub fn resetApplyCounters() void {
+    stat_guard_ns.store(0, .monotonic);
+    stat_subprocesses.store(0, .monotonic);
+}
+
+pub fn takeApplyCounters() ApplyCounters {
+    return .{
+        .guard_ns = stat_guard_ns.swap(0, .monotonic),
+        .subprocesses = stat_subprocesses.swap(0, .monotonic),
+    };
+}
+
+/// Count a child process spawned on behalf of the current resource
+pub fn noteSubprocess() void {
+    _ = stat_subprocesses.fetchAdd(1, .monotonic);
+    // The child may remove directories the cache still lists
+    dir_cache.reset();
+}
+
 /// Result of applying a resource
 pub const ApplyResult = struct {
     was_updated: bool,
@@ -130,10 +163,24 @@ pub const CommonProps = struct {
         self.subscriptions.deinit(allocator);
     }
 
+    /// Whether any only_if/not_if guard is set (block or command)
+    pub fn hasGuards(self: CommonProps) bool {
+        return self.only_if_block != null or self.only_if_command != null or
+            self.not_if_block != null or self.not_if_command != null;
+    }
+
     /// Evaluate guards (only_if/not_if) to determine if resource should run
     /// Returns the reason if skipped, null if should run
     /// Optionally runs guard commands as specified user/group
     pub fn shouldRun(self: CommonProps, user: ?[]const u8, group: ?[]const u8) !?[]const u8 {
+        if (self.mrb_state == null or !self.hasGuards()) return null;
+
+        const start = std.time.nanoTimestamp();
+        defer _ = stat_guard_ns.fetchAdd(@intCast(@max(std.time.nanoTimestamp() - start, 0)), .monotonic);
+        return self.evaluateGuards(user, group);
+    }
+
+    fn evaluateGuards(self: CommonProps, user: ?[]const u8, group: ?[]const u8) !?[]const u8 {
         const mrb = self.mrb_state orelse return null;
 
         // Evaluate only_if (must be true to run)
@@ -250,6 +297,7 @@ pub const CommonProps = struct {
             }
         }
 
+        noteSubprocess();
         try child.spawn();
         // A pre-exec failure makes the forked child _exit(); reap it so the
         // error path doesn't leave a zombie. stdio is .Ignore, so there are no
@@ -385,8 +433,7 @@ pub fn fillCommonFromRuby(
 
         if (is_string) {
             // String guard - execute as shell command
-            const cmd_cstr = mruby.mrb_str_to_cstr(mrb, only_if_val);
-            const cmd_str = std.mem.span(cmd_cstr);
+            const cmd_str = mruby.borrowStr(mrb, only_if_val);
             logger.debug("only_if command: {s}", .{cmd_str});
             common.only_if_command = allocator.dupe(u8, cmd_str) catch |err| blk: {
                 logger.warn("Failed to allocate memory for only_if command: {}", .{err});
@@ -406,8 +453,7 @@ pub fn fillCommonFromRuby(
 
         if (is_string) {
             // String guard - execute as shell command
-            const cmd_cstr = mruby.mrb_str_to_cstr(mrb, not_if_val);
-            const cmd_str = std.mem.span(cmd_cstr);
+            const cmd_str = mruby.borrowStr(mrb, not_if_val);
             common.not_if_command = allocator.dupe(u8, cmd_str) catch |err| blk: {
                 logger.warn("Failed to allocate memory for not_if command: {}", .{err});
                 logger.warn("Guard 'not_if' will be ignored - this may cause unexpected resource execution!", .{});
@@ -419,100 +465,87 @@ pub fn fillCommonFromRuby(
         }
     }
 
-    // Parse notifications array if provided: each item is [target, action, timing]
+    // Parse notifications and subscriptions: each item is [target, action, timing]
     if (mruby.mrb_test(notifications_val)) {
-        const arr_len = mruby.mrb_ary_len(mrb, notifications_val);
-        var i: mruby.mrb_int = 0;
-        while (i < arr_len) : (i += 1) {
-            const notif_arr = mruby.mrb_ary_ref(mrb, notifications_val, i);
-
-            const target_val = mruby.mrb_ary_ref(mrb, notif_arr, 0);
-            const action_val_n = mruby.mrb_ary_ref(mrb, notif_arr, 1);
-            const timing_val = mruby.mrb_ary_ref(mrb, notif_arr, 2);
-
-            const target_cstr = mruby.mrb_str_to_cstr(mrb, target_val);
-            const action_cstr_n = mruby.mrb_str_to_cstr(mrb, action_val_n);
-            const timing_cstr = mruby.mrb_str_to_cstr(mrb, timing_val);
-
-            const target = allocator.dupe(u8, std.mem.span(target_cstr)) catch |err| {
-                logger.warn("Failed to allocate notification target: {}", .{err});
-                continue;
-            };
-            const action_name = allocator.dupe(u8, std.mem.span(action_cstr_n)) catch |err| {
-                allocator.free(target);
-                logger.warn("Failed to allocate notification action: {}", .{err});
-                continue;
-            };
-            const timing_str = std.mem.span(timing_cstr);
-
-            const timing: notification.Timing = if (std.mem.eql(u8, timing_str, "immediate"))
-                .immediate
-            else
-                .delayed;
-
-            const notif = notification.Notification{
-                .target_resource_id = target,
-                .action = .{ .action_name = action_name },
-                .timing = timing,
-            };
-
-            common.notifications.append(allocator, notif) catch |err| {
-                logger.warn("Failed to append notification: {}", .{err});
-                allocator.free(target);
-                allocator.free(action_name);
-                continue;
-            };
-        }
+        appendNotificationsFromRuby(&common.notifications, mrb, notifications_val, "notification", allocator);
     }
-
-    // Parse subscriptions array if provided: each item is [target, action, timing]
     if (mruby.mrb_test(subscriptions_val)) {
-        const arr_len = mruby.mrb_ary_len(mrb, subscriptions_val);
-        var i: mruby.mrb_int = 0;
-        while (i < arr_len) : (i += 1) {
-            const sub_arr = mruby.mrb_ary_ref(mrb, subscriptions_val, i);
-
-            const target_val = mruby.mrb_ary_ref(mrb, sub_arr, 0);
-            const action_val_s = mruby.mrb_ary_ref(mrb, sub_arr, 1);
-            const timing_val = mruby.mrb_ary_ref(mrb, sub_arr, 2);
-
-            const target_cstr = mruby.mrb_str_to_cstr(mrb, target_val);
-            const action_cstr_s = mruby.mrb_str_to_cstr(mrb, action_val_s);
-            const timing_cstr = mruby.mrb_str_to_cstr(mrb, timing_val);
-
-            const target = allocator.dupe(u8, std.mem.span(target_cstr)) catch |err| {
-                logger.warn("Failed to allocate subscription target: {}", .{err});
-                continue;
-            };
-            const action_name = allocator.dupe(u8, std.mem.span(action_cstr_s)) catch |err| {
-                allocator.free(target);
-                logger.warn("Failed to allocate subscription action: {}", .{err});
-                continue;
-            };
-            const timing_str = std.mem.span(timing_cstr);
-
-            const timing: notification.Timing = if (std.mem.eql(u8, timing_str, "immediate"))
-                .immediate
-            else
-                .delayed;
+        appendNotificationsFromRuby(&common.subscriptions, mrb, subscriptions_val, "subscription", allocator);
+    }
 
-            const sub = notification.Notification{
-                .target_resource_id = target,
-                .action = .{ .action_name = action_name },
-                .timing = timing,
-            };
+    // Prevent GC from collecting guard blocks
+    common.protectBlocks();
+}
 
-            common.subscriptions.append(allocator, sub) catch |err| {
-                logger.warn("Failed to append subscription: {}", .{err});
-                allocator.free(target);
-                allocator.free(action_name);
-                continue;
-            };
+/// Join an environment attribute `[[key, value], ...]` into the
+/// "KEY=VALUE\0KEY2=VALUE2\0" form resources store. Null when empty;
+/// caller owns the result.
+pub fn environmentFromRuby(allocator: std.mem.Allocator, mrb: *mruby.mrb_state, environment_val: mruby.mrb_value) !?[]const u8 {
+    const pairs = try mruby.aryRowViews(2, allocator, mrb, environment_val);
+    defer allocator.free(pairs);
+
+    var size: usize = 0;
+    for (pairs) |pair| {
+        if (pair[0].ptr == null or pair[1].ptr == null) continue;
+        size += pair[0].len + pair[1].len + 2;
+    }
+    if (size == 0) return null;
+
+    const env = try allocator.alloc(u8, size);
+    var pos: usize = 0;
+    for (pairs) |pair| {
+        if (pair[0].ptr == null or pair[1].ptr == null) continue;
+        for ([_][]const u8{ pair[0].slice(), "=", pair[1].slice(), "\x00" }) |part| {
+            @memcpy(env[pos..][0..part.len], part);
+            pos += part.len;
         }
     }
+    return env;
+}
 
-    // Prevent GC from collecting guard blocks
-    common.protectBlocks();
+/// Parse `[[target, action, timing], ...]` in one bulk read and append the
+/// entries to `list`. Entries that fail to allocate are logged and skipped.
+fn appendNotificationsFromRuby(
+    list: *std.ArrayList(notification.Notification),
+    mrb: *mruby.mrb_state,
+    array_val: mruby.mrb_value,
+    comptime kind: []const u8,
+    allocator: std.mem.Allocator,
+) void {
+    const logger = @import("logger.zig");
+    const rows = mruby.aryRowViews(3, allocator, mrb, array_val) catch |err| {
+        logger.warn("Failed to read " ++ kind ++ "s: {}", .{err});
+        return;
+    };
+    defer allocator.free(rows);
+    list.ensureUnusedCapacity(allocator, rows.len) catch {};
+
+    for (rows) |row| {
+        const target = allocator.dupe(u8, row[0].slice()) catch |err| {
+            logger.warn("Failed to allocate " ++ kind ++ " target: {}", .{err});
+            continue;
+        };
+        const action_name = allocator.dupe(u8, row[1].slice()) catch |err| {
+            allocator.free(target);
+            logger.warn("Failed to allocate " ++ kind ++ " action: {}", .{err});
+            continue;
+        };
+        const timing: notification.Timing = if (std.mem.eql(u8, row[2].slice(), "immediate"))
+            .immediate
+        else
+            .delayed;
+
+        list.append(allocator, .{
+            .target_resource_id = target,
+            .action = .{ .action_name = action_name },
+            .timing = timing,
+        }) catch |err| {
+            logger.warn("Failed to append " ++ kind ++ ": {}", .{err});
+            allocator.free(target);
+            allocator.free(action_name);
+            continue;
+        };
+    }
 }
 
 /// File system attributes that can be managed
@@ -685,22 +718,7 @@ pub fn ensureParentDir(path: []const u8) !void {
 }
 
 /// Ensure the provided path exists as a directory (creates parents as needed).
+/// Directories already seen this run are not checked again (dir_cache).
 pub fn ensurePath(path: []const u8) !void {
-    if (std.fs.path.isAbsolute(path)) {
-        std.fs.makeDirAbsolute(path) catch |err| switch (err) {
-            error.PathAlreadyExists => {},
-            error.FileNotFound => {
-                if (std.fs.path.dirname(path)) |parent| {
-                    if (parent.len == 0) return err;
-                    try ensurePath(parent);
-                    try std.fs.makeDirAbsolute(path);
-                } else {
-                    return err;
-                }
-            },
-            else => return err,
-        };
-    } else {
-        try std.fs.cwd().makePath(path);
-    }
+    try dir_cache.ensure(path);
 }
@@ -0,0 +1,838 @@
+//! Benchmark suite for the hot paths provisioning depends on.
+//!
+//! Run with `zig build bench` (always ReleaseFast). Each benchmark prints one
+//! JSON object per line on stdout, so results can be appended to a file and
+//! compared across commits:
+//!
+//!   {"name":"sse.parse","kind":"micro","iterations":512,"ns_per_op":81234,...}
+//!
+//! Inputs are generated from a fixed seed and fixtures live in a scratch
+//! directory that is removed afterwards. Flags:
+//!   --filter <substring>  only run benchmarks whose name contains it
+//!   --quick               shorter time budget, skip the 10k-resource run
+//!
+//! Load testing with synthetic workloads (see bench/workload.zig):
+//!   hola-bench gen  --resources N [--seed S] [--mix files:40,...] [--out DIR]
+//!   hola-bench load --resources N [--runs R] [--seed S] [--mix ...] [--out DIR] [--keep]
+//! `gen` writes provision.rb plus fixtures and prints the script path;
+//! `load` runs provision.run on a fresh workload and prints one JSON record
+//! per run with phase timings, peak RSS and allocation counts. Without
+//! --out, `load` works in a scratch directory removed afterwards unless
+//! --keep is given; a directory named with --out is never removed.
+
+const std = @import("std");
+const builtin = @import("builtin");
+pub const build_options = @import("build_options");
+const logger = @import("logger.zig");
+const mruby = @import("mruby.zig");
+const glob = @import("glob.zig");
+const sse = @import("sse.zig");
+const http = @import("http.zig");
+const base = @import("base_resource.zig");
+const provision = @import("provision.zig");
+const template = @import("resources/template.zig");
+const base64 = @import("base64.zig");
+const time_ext = @import("time_ext.zig");
+const extract = @import("resources/extract.zig");
+const workload = @import("bench/workload.zig");
+const load = @import("bench/load.zig");
+
+/// Seed for every generated input ("hola")
+const seed: u64 = 0x686f6c61;
+
+const Kind = enum { micro, macro };
+
+/// One line of benchmark output
+const Result = struct {
+    name: []const u8,
+    kind: Kind,
+    iterations: u64,
+    /// Mean for micro benchmarks, median run for macro benchmarks
+    ns_per_op: u64,
+    min_ns: u64,
+    bytes_per_op: u64,
+    bytes_per_sec: u64,
+};
+
+const Suite = struct {
+    allocator: std.mem.Allocator,
+    filter: ?[]const u8 = null,
+    quick: bool = false,
+    root: []const u8,
+    out: *std.Io.Writer,
+
+    fn enabled(self: *const Suite, name: []const u8) bool {
+        const filter = self.filter orelse return true;
+        return std.mem.indexOf(u8, name, filter) != null;
+    }
+
+    fn budgetNs(self: *const Suite) u64 {
+        return if (self.quick) 100 * std.time.ns_per_ms else std.time.ns_per_s;
+    }
+
+    fn path(self: *const Suite, name: []const u8) ![]u8 {
+        return std.fs.path.join(self.allocator, &.{ self.root, name });
+    }
+
+    fn report(self: *Suite, result: Result) !void {
+        try self.out.print("{f}\n", .{std.json.fmt(result, .{})});
+        try self.out.flush();
+    }
+
+    /// Run `func(ctx)` repeatedly until the time budget is spent and report
+    /// the mean. One untimed warmup call primes caches and allocators.
+    fn micro(self: *Suite, name: []const u8, bytes_per_op: u64, ctx: anytype, comptime func: anytype) !void {
+        if (!self.enabled(name)) return;
+
+        try func(ctx);
+
+        var iterations: u64 = 0;
+        var min_ns: u64 = std.math.maxInt(u64);
+        var timer = try std.time.Timer.start();
+        const budget = self.budgetNs();
+        while (timer.read() < budget or iterations < 3) {
+            const start = timer.read();
+            try func(ctx);
+            min_ns = @min(min_ns, timer.read() - start);
+            iterations += 1;
+        }
+
+        try self.report(summarize(name, .micro, iterations, timer.read() / iterations, min_ns, bytes_per_op));
+    }
+
+    /// Run `func(ctx)` a fixed number of times; `func` returns the measured
+    /// nanoseconds so it can exclude its own setup. Reports the median.
+    fn macro(self: *Suite, name: []const u8, runs: usize, bytes_per_op: u64, ctx: anytype, comptime func: anytype) !void {
+        if (!self.enabled(name)) return;
+
+        const samples = try self.allocator.alloc(u64, runs);
+        defer self.allocator.free(samples);
+        for (samples) |*sample| sample.* = try func(ctx);
+
+        std.mem.sort(u64, samples, {}, std.sort.asc(u64));
+        try self.report(summarize(name, .macro, runs, samples[runs / 2], samples[0], bytes_per_op));
+    }
+};
+
+fn summarize(name: []const u8, kind: Kind, iterations: u64, ns_per_op: u64, min_ns: u64, bytes_per_op: u64) Result {
+    const bytes_per_sec = if (ns_per_op == 0) 0 else bytes_per_op * std.time.ns_per_s / ns_per_op;
+    return .{
+        .name = name,
+        .kind = kind,
+        .iterations = iterations,
+        .ns_per_op = ns_per_op,
+        .min_ns = min_ns,
+        .bytes_per_op = bytes_per_op,
+        .bytes_per_sec = bytes_per_sec,
+    };
+}
+
+pub fn main() !void {
+    var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+    defer _ = gpa.deinit();
+    const allocator = gpa.allocator();
+
+    const args = try std.process.argsAlloc(allocator);
+    defer std.process.argsFree(allocator, args);
+
+    var stdout_buf: [4096]u8 = undefined;
+    var stdout_writer = std.fs.File.stdout().writer(&stdout_buf);
+
+    if (args.len > 1 and (std.mem.eql(u8, args[1], "gen") or std.mem.eql(u8, args[1], "load"))) {
+        return runWorkloadCommand(allocator, &stdout_writer.interface, args[1], args[2..]);
+    }
+
+    const root = try scratchDir(allocator, "hola-bench");
+    defer allocator.free(root);
+    try std.fs.cwd().makePath(root);
+    defer std.fs.deleteTreeAbsolute(root) catch {};
+
+    var suite = Suite{ .allocator = allocator, .root = root, .out = &stdout_writer.interface };
+    var i: usize = 1;
+    while (i < args.len) : (i += 1) {
+        if (std.mem.eql(u8, args[i], "--quick")) {
+            suite.quick = true;
+        } else if (std.mem.eql(u8, args[i], "--filter") and i + 1 < args.len) {
+            i += 1;
+            suite.filter = args[i];
+        } else {
+            return usage();
+        }
+    }
+
+    // Keep benchmark logging out of the user's log directory
+    const log_dir = try suite.path("logs");
+    defer allocator.free(log_dir);
+    logger.initGlobal(allocator, log_dir) catch {};
+    defer logger.deinitGlobal();
+
+    try suite.out.print("{f}\n", .{std.json.fmt(.{
+        .suite = "hola",
+        .version = build_options.version,
+        .git_commit = build_options.git_commit,
+        .os = @tagName(builtin.os.tag),
+        .arch = @tagName(builtin.cpu.arch),
+        .quick = suite.quick,
+    }, .{})});
+    try suite.out.flush();
+
+    try benchTemplates(&suite);
+    try benchFileCompare(&suite);
+    try benchGlob(&suite);
+    try benchJson(&suite);
+    try benchRubyHelpers(&suite);
+    try benchSse(&suite);
+    try benchDownloads(&suite);
+    try benchExtract(&suite);
+    try benchProvision(&suite);
+    try benchTree(&suite);
+}
+
+fn scratchDir(allocator: std.mem.Allocator, prefix: []const u8) ![]u8 {
+    const tmp_base = std.posix.getenv("TMPDIR") orelse "/tmp";
+    return std.fmt.allocPrint(allocator, "{s}/{s}-{d}", .{ tmp_base, prefix, std.time.milliTimestamp() });
+}
+
+/// `gen` and `load` subcommands
+fn runWorkloadCommand(allocator: std.mem.Allocator, out: *std.Io.Writer, command: []const u8, args: []const []const u8) !void {
+    var resources: usize = 1_000;
+    var runs: usize = 3;
+    var seed_value: u64 = seed;
+    var mix = workload.Mix{};
+    var out_dir: ?[]const u8 = null;
+    var keep = false;
+
+    var i: usize = 0;
+    while (i < args.len) : (i += 1) {
+        const arg = args[i];
+        if (std.mem.eql(u8, arg, "--keep")) {
+            keep = true;
+            continue;
+        }
+        if (i + 1 >= args.len) return usage();
+        const value = args[i + 1];
+        i += 1;
+
+        if (std.mem.eql(u8, arg, "--resources")) {
+            resources = std.fmt.parseInt(usize, value, 10) catch return usage();
+        } else if (std.mem.eql(u8, arg, "--runs")) {
+            runs = std.fmt.parseInt(usize, value, 10) catch return usage();
+        } else if (std.mem.eql(u8, arg, "--seed")) {
+            seed_value = std.fmt.parseInt(u64, value, 0) catch return usage();
+        } else if (std.mem.eql(u8, arg, "--mix")) {
+            mix = workload.parseMix(value) catch return usage();
+        } else if (std.mem.eql(u8, arg, "--out")) {
+            out_dir = value;
+        } else {
+            return usage();
+        }
+    }
+
+    const requested = if (out_dir) |dir| try allocator.dupe(u8, dir) else try scratchDir(allocator, "hola-workload");
+    defer allocator.free(requested);
+    try std.fs.cwd().makePath(requested);
+    // The generator and the provision run use *Absolute calls; --out (and
+    // TMPDIR) may be relative
+    const root = try std.fs.cwd().realpathAlloc(allocator, requested);
+    defer allocator.free(root);
+
+    if (std.mem.eql(u8, command, "gen")) {
+        const generated = try workload.generate(allocator, root, .{ .resources = resources, .mix = mix, .seed = seed_value });
+        defer generated.deinit(allocator);
+        try out.print("{s}\n", .{generated.script_path});
+        try out.flush();
+        return;
+    }
+
+    // Only a scratch directory this command created is removed; --out
+    // names the user's directory, which is left in place
+    defer if (out_dir == null and !keep) std.fs.deleteTreeAbsolute(root) catch {};
+
+    // Keep load-test logging out of the user's log directory
+    const log_dir = try std.fs.path.join(allocator, &.{ root, "logs" });
+    defer allocator.free(log_dir);
+    logger.initGlobal(allocator, log_dir) catch {};
+    defer logger.deinitGlobal();
+
+    try load.run(allocator, out, root, .{ .resources = resources, .runs = runs, .mix = mix, .seed = seed_value });
+}
+
+fn usage() error{InvalidArgument} {
+    std.debug.print(
+        \\usage: hola-bench [--quick] [--filter <substring>]
+        \\       hola-bench gen  --resources N [--seed S] [--mix files:40,templates:20,links:15,executes:10,notify:15] [--out DIR]
+        \\       hola-bench load --resources N [--runs R] [--seed S] [--mix ...] [--out DIR] [--keep]
+        \\
+    , .{});
+    return error.InvalidArgument;
+}
+
+// ---------------------------------------------------------------------------
+// Micro benchmarks
+// ---------------------------------------------------------------------------
+
+fn benchTemplates(suite: *Suite) !void {
+    const allocator = suite.allocator;
+
+    var content = std.ArrayList(u8).empty;
+    defer content.deinit(allocator);
+    for (0..200) |line| {
+        try content.writer(allocator).print("server_{d}: <%= host %>:<%= port %> # plain text padding\n", .{line});
+    }
+
+    const variables = [_]template.Resource.Variable{
+        .{ .name = "host", .value = "localhost", .var_type = "string" },
+        .{ .name = "port", .value = "8080", .var_type = "integer" },
+    };
+
+    const Simple = struct {
+        fn run(input: []const u8) !void {
+            const rendered = try template.Resource.renderTemplateSimple(input, &variables);
+            std.heap.c_allocator.free(rendered);
+        }
+    };
+    try suite.micro("template.render.simple", content.items.len, content.items, Simple.run);
+
+    if (!suite.enabled("template.render.mruby")) return;
+
+    var mrb = try mruby.State.init();
+    defer mrb.deinit();
+
+    var res = template.Resource{
+        .path = "",
+        .source = "",
+        .attrs = .{},
+        .variables = .empty,
+        .action = .create,
+        .common = base.CommonProps.init(allocator),
+    };
+    defer res.common.deinit(allocator);
+    res.common.mrb_state = mrb.mrb;
+
+    const Mruby = struct {
+        resource: *const template.Resource,
+        input: []const u8,
+
+        fn run(self: @This()) !void {
+            const rendered = try self.resource.renderTemplate(self.input, &variables);
+            std.heap.c_allocator.free(rendered);
+        }
+    };
+    try suite.micro("template.render.mruby", content.items.len, Mruby{ .resource = &res, .input = content.items }, Mruby.run);
+}
+
+fn benchFileCompare(suite: *Suite) !void {
+    if (!suite.enabled("file.compare")) return;
+    const allocator = suite.allocator;
+
+    // Same read-and-compare resources use to decide whether a file is up to date
+    const size = 1024 * 1024;
+    const data = try allocator.alloc(u8, size);
+    defer allocator.free(data);
+    var prng = std.Random.DefaultPrng.init(seed);
+    prng.random().bytes(data);
+
+    const file_path = try suite.path("compare.bin");
+    defer allocator.free(file_path);
+    try std.fs.cwd().writeFile(.{ .sub_path = file_path, .data = data });
+
+    const Compare = struct {
+        path: []const u8,
+        expected: []const u8,
+
+        fn run(self: @This()) !void {
+            const existing = try std.fs.cwd().readFileAlloc(std.heap.c_allocator, self.path, std.math.maxInt(usize));
+            defer std.heap.c_allocator.free(existing);
+            if (!std.mem.eql(u8, existing, self.expected)) return error.ContentMismatch;
+        }
+    };
+    try suite.micro("file.compare/1MiB", size, Compare{ .path = file_path, .expected = data }, Compare.run);
+}
+
+fn benchGlob(suite: *Suite) !void {
+    if (!suite.enabled("glob.match")) return;
+    const allocator = suite.allocator;
+
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
+    const aa = arena.allocator();
+
+    const dirs = [_][]const u8{ "src", "lib", "bin", "share/doc", "include/hola", "vendor/pkg" };
+    const exts = [_][]const u8{ "zig", "rb", "txt", "h", "tar.gz", "json" };
+    var prng = std.Random.DefaultPrng.init(seed);
+    const random = prng.random();
+
+    const paths = try aa.alloc([]const u8, 1024);
+    for (paths, 0..) |*p, idx| {
+        p.* = try std.fmt.allocPrint(aa, "{s}/file_{d}.{s}", .{
+            dirs[random.uintLessThan(usize, dirs.len)],
+            idx,
+            exts[random.uintLessThan(usize, exts.len)],
+        });
+    }
+
+    const Glob = struct {
+        paths: []const []const u8,
+
+        const patterns = [_][]const u8{ "*.zig", "src/*.zig", "**/*.rb", "share/**", "*/file_1??.txt", "include/[a-h]*/*.h", "vendor/*/file_[!0]*", "**" };
+
+        fn run(self: @This()) !void {
+            var matches: usize = 0;
+            for (patterns) |pattern| {
+                for (self.paths) |p| {
+                    if (glob.match(pattern, p)) matches += 1;
+                }
+            }
+            std.mem.doNotOptimizeAway(matches);
+        }
+    };
+    try suite.micro("glob.match/1024x8", 0, Glob{ .paths = paths }, Glob.run);
+}
+
+fn benchJson(suite: *Suite) !void {
+    if (!suite.enabled("json")) return;
+    const allocator = suite.allocator;
+
+    var doc = std.ArrayList(u8).empty;
+    defer doc.deinit(allocator);
+    const w = doc.writer(allocator);
+    try w.writeByte('[');
+    for (0..1000) |idx| {
+        if (idx > 0) try w.writeByte(',');
+        try w.print("{{\"id\":{d},\"name\":\"node-{d}\",\"tags\":[\"web\",\"db\"],\"enabled\":{},\"weight\":{d}.5}}", .{ idx, idx, idx % 2 == 0, idx % 10 });
+    }
+    try w.writeByte(']');
+
+    const Decode = struct {
+        fn run(input: []const u8) !void {
+            const parsed = try std.json.parseFromSlice(std.json.Value, std.heap.c_allocator, input, .{});
+            parsed.deinit();
+        }
+    };
+    try suite.micro("json.decode", doc.items.len, doc.items, Decode.run);
+
+    const parsed = try std.json.parseFromSlice(std.json.Value, allocator, doc.items, .{});
+    defer parsed.deinit();
+
+    const Encode = struct {
+        fn run(value: std.json.Value) !void {
+            const encoded = try std.fmt.allocPrint(std.heap.c_allocator, "{f}", .{std.json.fmt(value, .{})});
+            std.heap.c_allocator.free(encoded);
+        }
+    };
+    try suite.micro("json.encode", doc.items.len, parsed.value, Encode.run);
+}
+
+/// Per-call cost of the native helpers scripts use inside loops. Each op is
+/// 1000 calls from Ruby, so ns_per_op / 1000 is the cost of one access.
+fn benchRubyHelpers(suite: *Suite) !void {
+    if (!suite.enabled("ruby.")) return;
+
+    var mrb = try mruby.State.init();
+    defer mrb.deinit();
+    const mrb_ptr = mrb.mrb orelse return error.MRubyNotInitialized;
+
+    base64.setAllocator(suite.allocator);
+    base64.setupBase64Module(mrb_ptr);
+    mruby.zig_mrb_define_open_struct(mrb_ptr);
+    time_ext.setupTimeExtensions(mrb_ptr);
+
+    try mrb.evalString(
+        \\$node = OpenStruct.new({
+        \\  "platform" => { "family" => "debian", "version" => "12" },
+        \\  "network" => { "interfaces" => (0...256).map { |i| { "name" => "eth#{i}", "mtu" => 1500 } } },
+        \\})
+    );
+
+    const Loop = struct {
+        mrb: *mruby.mrb_state,
+        proc: mruby.mrb_value,
+
+        fn init(state: *mruby.mrb_state, code: [:0]const u8) !@This() {
+            const proc = mruby.mrb_load_string(state, code.ptr);
+            if (mruby.mrb_test(mruby.mrb_get_exception(state))) {
+                mruby.mrb_print_error(state);
+                return error.MRubyException;
+            }
+            mruby.mrb_gc_register(state, proc);
+            return .{ .mrb = state, .proc = proc };
+        }
+
+        fn deinit(self: @This()) void {
+            mruby.mrb_gc_unregister(self.mrb, self.proc);
+        }
+
+        fn run(self: @This()) !void {
+            _ = mruby.mrb_funcall_argv(self.mrb, self.proc, mruby.mrb_intern_cstr(self.mrb, "call"), 0, null);
+            if (mruby.mrb_test(mruby.mrb_get_exception(self.mrb))) return error.MRubyException;
+        }
+    };
+
+    const cases = [_]struct { name: []const u8, code: [:0]const u8 }{
+        .{ .name = "ruby.open_struct.read/1000", .code = "lambda { 1000.times { $node.platform.family } }" },
+        .{ .name = "ruby.open_struct.nested/1000", .code = "lambda { ifs = $node.network.interfaces; 1000.times { |i| ifs[i % 256].name } }" },
+        .{ .name = "ruby.time_parse/1000", .code = "lambda { 1000.times { Time.parse('2026-05-09T16:41:20.123+08:00') } }" },
+        .{ .name = "ruby.base64/1000", .code = "lambda { s = 'x' * 48; 1000.times { Base64.decode64(Base64.encode64(s)) } }" },
+    };
+    for (cases) |case| {
+        if (!suite.enabled(case.name)) continue;
+        const loop = try Loop.init(mrb_ptr, case.code);
+        defer loop.deinit();
+        try suite.micro(case.name, 0, loop, Loop.run);
+    }
+}
+
+fn benchSse(suite: *Suite) !void {
+    const allocator = suite.allocator;
+
+    if (suite.enabled("sse.parse")) {
+        var stream = std.ArrayList(u8).empty;
+        defer stream.deinit(allocator);
+        for (0..1000) |idx| {
+            try stream.writer(allocator).print(
+                "id: {d}\nevent: job\ndata: {{\"job_id\":{d},\"params\":{{\"role\":\"web\"}}}}\n: keepalive\n\n",
+                .{ idx, idx },
+            );
+        }
+        try suite.micro("sse.parse", stream.items.len, SseReplay{ .input = stream.items, .chunk = 4096, .events = 1000 }, SseReplay.run);
+    }
+
+    // Burst replay after a reconnect: several MiB of queued events, mixed
+    // payload sizes and some multi-line data, read in large socket chunks
+    if (suite.enabled("sse.replay")) {
+        var prng = std.Random.DefaultPrng.init(seed);
+        const random = prng.random();
+        var stream = std.ArrayList(u8).empty;
+        defer stream.deinit(allocator);
+
+        const filler = "x" ** 2048;
+        const events = 8_000;
+        for (0..events) |idx| {
+            const payload = filler[0..random.intRangeAtMost(usize, 16, filler.len)];
+            try stream.writer(allocator).print("id: {d}\r\nevent: job\r\ndata: {{\"job_id\":{d},\"blob\":\"{s}\"}}\r\n", .{ idx, idx, payload });
+            if (idx % 10 == 0) try stream.appendSlice(allocator, "data: {\"trailer\":true}\r\n");
+            try stream.appendSlice(allocator, "\r\n");
+        }
+        try suite.micro("sse.replay", stream.items.len, SseReplay{ .input = stream.items, .chunk = 64 * 1024, .events = events }, SseReplay.run);
+    }
+}
+
+const SseReplay = struct {
+    input: []const u8,
+    chunk: usize,
+    events: usize,
+
+    fn run(self: SseReplay) !void {
+        var parser = sse.Parser.init(std.heap.c_allocator);
+        defer parser.deinit();
+
+        // Feed in socket-sized chunks, draining events as a reader would
+        var events: usize = 0;
+        var offset: usize = 0;
+        while (offset < self.input.len) {
+            const end = @min(offset + self.chunk, self.input.len);
+            try parser.feed(self.input[offset..end]);
+            offset = end;
+            while (parser.next()) |event| {
+                std.mem.doNotOptimizeAway(event.data.?.len);
+                events += 1;
+            }
+        }
+        if (events != self.events) return error.UnexpectedEventCount;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Macro benchmarks
+// ---------------------------------------------------------------------------
+
+/// Minimal HTTP/1.1 server on 127.0.0.1 that answers every GET with the same
+/// body and closes the connection.
+const LocalServer = struct {
+    server: std.net.Server,
+    accept_thread: std.Thread,
+    body: []const u8,
+    stopping: std.atomic.Value(bool) = .init(false),
+
+    fn start(self: *LocalServer, body: []const u8) !void {
+        const address = try std.net.Address.parseIp4("127.0.0.1", 0);
+        self.* = .{ .server = try address.listen(.{ .reuse_address = true }), .accept_thread = undefined, .body = body };
+        self.accept_thread = try std.Thread.spawn(.{}, acceptLoop, .{self});
+    }
+
+    fn url(self: *LocalServer, buf: []u8, name: []const u8) ![]const u8 {
+        return std.fmt.bufPrint(buf, "http://127.0.0.1:{d}/{s}", .{ self.server.listen_address.getPort(), name });
+    }
+
+    fn stop(self: *LocalServer) void {
+        self.stopping.store(true, .release);
+        if (std.net.tcpConnectToAddress(self.server.listen_address)) |wake| wake.close() else |_| {}
+        self.accept_thread.join();
+        self.server.deinit();
+    }
+
+    fn acceptLoop(self: *LocalServer) void {
+        while (true) {
+            const conn = self.server.accept() catch return;
+            if (self.stopping.load(.acquire)) {
+                conn.stream.close();
+                return;
+            }
+            const thread = std.Thread.spawn(.{}, serve, .{ self, conn.stream }) catch {
+                conn.stream.close();
+                continue;
+            };
+            thread.detach();
+        }
+    }
+
+    fn serve(self: *LocalServer, stream: std.net.Stream) void {
+        defer stream.close();
+
+        var buf: [8 * 1024]u8 = undefined;
+        var len: usize = 0;
+        while (std.mem.indexOf(u8, buf[0..len], "\r\n\r\n") == null) {
+            if (len == buf.len) return;
+            const n = std.posix.read(stream.handle, buf[len..]) catch return;
+            if (n == 0) return;
+            len += n;
+        }
+
+        var head_buf: [160]u8 = undefined;
+        const head = std.fmt.bufPrint(&head_buf, "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: {d}\r\nConnection: close\r\n\r\n", .{self.body.len}) catch return;
+        stream.writeAll(head) catch return;
+        stream.writeAll(self.body) catch return;
+    }
+};
+
+fn benchDownloads(suite: *Suite) !void {
+    const name = "download.manager/16x1MiB";
+    if (!suite.enabled(name)) return;
+    const allocator = suite.allocator;
+
+    const body = try allocator.alloc(u8, 1024 * 1024);
+    defer allocator.free(body);
+    var prng = std.Random.DefaultPrng.init(seed);
+    prng.random().bytes(body);
+
+    var server: LocalServer = undefined;
+    try server.start(body);
+    defer server.stop();
+
+    const dir = try suite.path("downloads");
+    defer allocator.free(dir);
+    try std.fs.cwd().makePath(dir);
+
+    const Download = struct {
+        suite: *Suite,
+        server: *LocalServer,
+        dir: []const u8,
+        const task_count = 16;
+
+        fn run(self: @This()) !u64 {
+            const alloc = self.suite.allocator;
+            var mgr = try http.download.Manager.init(alloc, .{ .max_concurrent = 5 });
+            defer mgr.deinit();
+
+            for (0..task_count) |idx| {
+                var name_buf: [32]u8 = undefined;
+                const file_name = try std.fmt.bufPrint(&name_buf, "blob-{d}.bin", .{idx});
+                var url_buf: [96]u8 = undefined;
+                const url = try self.server.url(&url_buf, file_name);
+                const dest = try std.fs.path.join(alloc, &.{ self.dir, file_name });
+                defer alloc.free(dest);
+                try mgr.addTask(try http.download.Task.init(alloc, file_name, url, file_name, dest, dest));
+            }
+
+            var timer = try std.time.Timer.start();
+            try mgr.processAll();
+            const elapsed = timer.read();
+
+            if (mgr.getStats().failed > 0) return error.DownloadFailed;
+            return elapsed;
+        }
+    };
+    try suite.macro(name, if (suite.quick) 1 else 5, Download.task_count * body.len, Download{ .suite = suite, .server = &server, .dir = dir }, Download.run);
+}
+
+fn benchExtract(suite: *Suite) !void {
+    if (!suite.enabled("extract")) return;
+    const allocator = suite.allocator;
+
+    // 256 files of 16 KiB each with mildly compressible content
+    const tree = try suite.path("extract-src");
+    defer allocator.free(tree);
+    try std.fs.cwd().makePath(tree);
+    {
+        var dir = try std.fs.cwd().openDir(tree, .{});
+        defer dir.close();
+        var prng = std.Random.DefaultPrng.init(seed);
+        var data: [16 * 1024]u8 = undefined;
+        for (0..256) |idx| {
+            for (&data) |*byte| byte.* = 'a' + prng.random().uintLessThan(u8, 16);
+            var name_buf: [32]u8 = undefined;
+            try dir.writeFile(.{ .sub_path = try std.fmt.bufPrint(&name_buf, "file-{d}.txt", .{idx}), .data = &data });
+        }
+    }
+
+    // std has no tar/xz writers, so fixtures are built with the system tar
+    const formats = [_]struct { name: []const u8, file: []const u8, flags: []const u8 }{
+        .{ .name = "extract.tar", .file = "fixture.tar", .flags = "-cf" },
+        .{ .name = "extract.tar_gz", .file = "fixture.tar.gz", .flags = "-czf" },
+        .{ .name = "extract.tar_xz", .file = "fixture.tar.xz", .flags = "-cJf" },
+    };
+
+    const Extract = struct {
+        archive: []const u8,
+        destination: []const u8,
+
+        fn run(self: @This()) !u64 {
+            std.fs.deleteTreeAbsolute(self.destination) catch {};
+
+            var res = extract.Resource{
+                .path = self.archive,
+                .destination = self.destination,
+                .file_mappings = &.{},
+                .strip_components = 0,
+                .attrs = .{},
+                .action = .extract,
+                .common = base.CommonProps.init(std.heap.c_allocator),
+            };
+            defer res.common.deinit(std.heap.c_allocator);
+
+            var timer = try std.time.Timer.start();
+            const result = try res.apply();
+            const elapsed = timer.read();
+            if (result.output) |o| std.heap.c_allocator.free(o);
+            return elapsed;
+        }
+    };
+
+    for (formats) |format| {
+        if (!suite.enabled(format.name)) continue;
+
+        const archive = try suite.path(format.file);
+        defer allocator.free(archive);
+        const tar = std.process.Child.run(.{
+            .allocator = allocator,
+            .argv = &.{ "tar", format.flags, archive, "-C", tree, "." },
+        }) catch |err| {
+            std.debug.print("skipping {s}: tar unavailable ({})\n", .{ format.name, err });
+            continue;
+        };
+        allocator.free(tar.stdout);
+        allocator.free(tar.stderr);
+        if (tar.term != .Exited or tar.term.Exited != 0) {
+            std.debug.print("skipping {s}: tar {s} failed\n", .{ format.name, format.flags });
+            continue;
+        }
+
+        const stat = try std.fs.cwd().statFile(archive);
+        const destination = try suite.path("extract-dst");
+        defer allocator.free(destination);
+
+        try suite.macro(format.name, if (suite.quick) 1 else 5, stat.size, Extract{ .archive = archive, .destination = destination }, Extract.run);
+    }
+}
+
+/// One timed provision.run of `script`
+const Provision = struct {
+    suite: *Suite,
+    script: []const u8,
+    root: []const u8,
+    /// Remove the managed tree before each run (converge) or keep it (no-op)
+    fresh: bool,
+
+    fn run(self: @This()) !u64 {
+        if (self.fresh) std.fs.deleteTreeAbsolute(self.root) catch {};
+
+        var timer = try std.time.Timer.start();
+        var result = try provision.run(self.suite.allocator, .{ .script_path = self.script, .use_pretty_output = false });
+        const elapsed = timer.read();
+        defer result.deinit(self.suite.allocator);
+
+        if (result.failed_count > 0) return error.ProvisionFailed;
+        return elapsed;
+    }
+};
+
+fn benchProvision(suite: *Suite) !void {
+    const allocator = suite.allocator;
+
+    const sizes = [_]struct { count: usize, label: []const u8 }{
+        .{ .count = 1_000, .label = "1k" },
+        .{ .count = 10_000, .label = "10k" },
+    };
+
+    for (sizes) |size| {
+        if (suite.quick and size.count > 1_000) continue;
+
+        var converge_buf: [64]u8 = undefined;
+        const converge_name = try std.fmt.bufPrint(&converge_buf, "provision.run/{s}/converge", .{size.label});
+        var noop_buf: [64]u8 = undefined;
+        const noop_name = try std.fmt.bufPrint(&noop_buf, "provision.run/{s}/noop", .{size.label});
+        if (!suite.enabled(converge_name) and !suite.enabled(noop_name)) continue;
+
+        var dir_buf: [64]u8 = undefined;
+        const workload_root = try suite.path(try std.fmt.bufPrint(&dir_buf, "workload-{s}", .{size.label}));
+        defer allocator.free(workload_root);
+
+        const generated = try workload.generate(allocator, workload_root, .{ .resources = size.count, .seed = seed });
+        defer generated.deinit(allocator);
+        const script = generated.script_path;
+        const root = generated.managed_root;
+
+        const runs: usize = if (suite.quick) 1 else 3;
+        const converge = Provision{ .suite = suite, .script = script, .root = root, .fresh = true };
+        try suite.macro(converge_name, runs, 0, converge, Provision.run);
+
+        // The no-op run measures a fully converged tree
+        if (!suite.enabled(converge_name)) _ = try Provision.run(converge);
+        try suite.macro(noop_name, runs, 0, Provision{ .suite = suite, .script = script, .root = root, .fresh = false }, Provision.run);
+    }
+}
+
+/// Deep trees: nested directories with files under each leaf, ~50k paths
+/// (5k with --quick). Stresses parent-directory creation and lookups.
+fn benchTree(suite: *Suite) !void {
+    const allocator = suite.allocator;
+
+    const converge_name = "provision.tree/converge";
+    const noop_name = "provision.tree/noop";
+    if (!suite.enabled(converge_name) and !suite.enabled(noop_name)) return;
+
+    const root = try suite.path("tree");
+    defer allocator.free(root);
+    const script = try suite.path("tree.rb");
+    defer allocator.free(script);
+
+    // 50 x 20 leaf directories three levels down, 48 files in each
+    const top: usize = if (suite.quick) 5 else 50;
+    var script_buf: [1024]u8 = undefined;
+    const code = try std.fmt.bufPrint(&script_buf,
+        \\root = "{s}"
+        \\{d}.times do |a|
+        \\  20.times do |b|
+        \\    leaf = "#{{root}}/a#{{a}}/b#{{b}}/c"
+        \\    directory leaf do
+        \\      recursive true
+        \\      mode "0755"
+        \\    end
+        \\    48.times do |f|
+        \\      file "#{{leaf}}/f#{{f}}.conf" do
+        \\        content "value = #{{f}}\n"
+        \\      end
+        \\    end
+        \\  end
+        \\end
+        \\
+    , .{ root, top });
+    try std.fs.cwd().writeFile(.{ .sub_path = script, .data = code });
+
+    const runs: usize = if (suite.quick) 1 else 3;
+    const converge = Provision{ .suite = suite, .script = script, .root = root, .fresh = true };
+    try suite.macro(converge_name, runs, 0, converge, Provision.run);
+
+    if (!suite.enabled(converge_name)) _ = try Provision.run(converge);
+    try suite.macro(noop_name, runs, 0, Provision{ .suite = suite, .script = script, .root = root, .fresh = false }, Provision.run);
+}
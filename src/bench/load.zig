@@ -0,0 +1,88 @@
+//! Load-test harness: runs `provision.run` against generated workloads and
+//! records per-phase timings, peak RSS and allocation counts.
+//!
+//! Allocation counts cover the allocator handed to `provision.run`; resources
+//! that allocate through `std.heap.c_allocator` directly are not included.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const provision = @import("../provision.zig");
+const workload = @import("workload.zig");
+const CountingAllocator = @import("../counting_allocator.zig").CountingAllocator;
+
+/// Peak resident set size of this process in bytes
+pub fn peakRssBytes() u64 {
+    const usage = std.posix.getrusage(std.posix.rusage.SELF);
+    const maxrss: u64 = @intCast(@max(usage.maxrss, 0));
+    // Linux reports kilobytes, macOS bytes
+    return if (builtin.os.tag == .macos) maxrss else maxrss * 1024;
+}
+
+pub const Options = struct {
+    resources: usize,
+    runs: usize = 3,
+    mix: workload.Mix = .{},
+    seed: u64 = 0x686f6c61,
+};
+
+/// One JSON line per run
+const Record = struct {
+    name: []const u8 = "provision.load",
+    resources: usize,
+    run: usize,
+    /// "converge" for the first run on an empty tree, "noop" afterwards
+    mode: []const u8,
+    total_ns: u64,
+    phases: provision.PhaseTimings,
+    updated: usize,
+    skipped: usize,
+    failed: usize,
+    allocations: u64,
+    frees: u64,
+    bytes_allocated: u64,
+    peak_live_bytes: u64,
+    peak_rss_bytes: u64,
+};
+
+/// Generate a workload under `root` and run it `opts.runs` times, writing
+/// one JSON record per run to `out`
+pub fn run(allocator: std.mem.Allocator, out: *std.Io.Writer, root: []const u8, opts: Options) !void {
+    const generated = try workload.generate(allocator, root, .{
+        .resources = opts.resources,
+        .mix = opts.mix,
+        .seed = opts.seed,
+    });
+    defer generated.deinit(allocator);
+
+    for (0..opts.runs) |idx| {
+        var counting = CountingAllocator.init(allocator);
+        var timings = provision.PhaseTimings{};
+
+        var timer = try std.time.Timer.start();
+        var result = try provision.run(counting.allocator(), .{
+            .script_path = generated.script_path,
+            .use_pretty_output = false,
+            .phase_timings = &timings,
+        });
+        const total_ns = timer.read();
+        const record = Record{
+            .resources = opts.resources,
+            .run = idx,
+            .mode = if (idx == 0) "converge" else "noop",
+            .total_ns = total_ns,
+            .phases = timings,
+            .updated = result.updated_count,
+            .skipped = result.skipped_count,
+            .failed = result.failed_count,
+            .allocations = counting.allocations.load(.monotonic),
+            .frees = counting.frees.load(.monotonic),
+            .bytes_allocated = counting.bytes_allocated.load(.monotonic),
+            .peak_live_bytes = counting.peak_live_bytes.load(.monotonic),
+            .peak_rss_bytes = peakRssBytes(),
+        };
+        result.deinit(counting.allocator());
+
+        try out.print("{f}\n", .{std.json.fmt(record, .{})});
+        try out.flush();
+    }
+}
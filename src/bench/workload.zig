@@ -0,0 +1,233 @@
+//! Synthetic provision workloads for load testing.
+//!
+//! `generate` writes a provision.rb with a seeded, realistic mix of
+//! resources plus the fixture tree it references (template sources, link
+//! targets) under one root directory:
+//!
+//!   <root>/provision.rb
+//!   <root>/fixtures/templates/*.erb
+//!   <root>/fixtures/targets/*
+//!   <root>/managed/...            (created by provisioning)
+//!
+//! Resources are grouped 50 to a directory. Each group starts with its
+//! `directory` resource and, when notifications are enabled, an `execute`
+//! with `action :nothing` that the group's notifying files trigger.
+
+const std = @import("std");
+
+/// Relative weights for each resource kind
+pub const Mix = struct {
+    files: u32 = 40,
+    templates: u32 = 20,
+    links: u32 = 15,
+    guarded_executes: u32 = 10,
+    notifying_files: u32 = 15,
+
+    fn total(self: Mix) u32 {
+        return self.files + self.templates + self.links + self.guarded_executes + self.notifying_files;
+    }
+};
+
+/// Parse "files:40,templates:20,links:15,executes:10,notify:15"; kinds not
+/// listed keep their default weight
+pub fn parseMix(text: []const u8) !Mix {
+    var mix = Mix{};
+    var it = std.mem.tokenizeScalar(u8, text, ',');
+    while (it.next()) |entry| {
+        const colon = std.mem.indexOfScalar(u8, entry, ':') orelse return error.InvalidMix;
+        const key = std.mem.trim(u8, entry[0..colon], " ");
+        const weight = std.fmt.parseInt(u32, std.mem.trim(u8, entry[colon + 1 ..], " "), 10) catch return error.InvalidMix;
+
+        if (std.mem.eql(u8, key, "files")) {
+            mix.files = weight;
+        } else if (std.mem.eql(u8, key, "templates")) {
+            mix.templates = weight;
+        } else if (std.mem.eql(u8, key, "links")) {
+            mix.links = weight;
+        } else if (std.mem.eql(u8, key, "executes")) {
+            mix.guarded_executes = weight;
+        } else if (std.mem.eql(u8, key, "notify")) {
+            mix.notifying_files = weight;
+        } else {
+            return error.InvalidMix;
+        }
+    }
+    if (mix.total() == 0) return error.InvalidMix;
+    return mix;
+}
+
+pub const Spec = struct {
+    resources: usize,
+    mix: Mix = .{},
+    seed: u64 = 0x686f6c61,
+    /// Number of distinct template sources and link targets
+    fixture_pool: usize = 16,
+};
+
+pub const group_size = 50;
+
+const Kind = enum { file, template, link, guarded_execute, notifying_file };
+
+fn pick(random: std.Random, mix: Mix) Kind {
+    var roll = random.uintLessThan(u32, mix.total());
+    const weights = [_]struct { kind: Kind, weight: u32 }{
+        .{ .kind = .file, .weight = mix.files },
+        .{ .kind = .template, .weight = mix.templates },
+        .{ .kind = .link, .weight = mix.links },
+        .{ .kind = .guarded_execute, .weight = mix.guarded_executes },
+        .{ .kind = .notifying_file, .weight = mix.notifying_files },
+    };
+    for (weights) |entry| {
+        if (roll < entry.weight) return entry.kind;
+        roll -= entry.weight;
+    }
+    return .file;
+}
+
+/// Paths of a generated workload. Caller owns the strings (see `deinit`).
+pub const Workload = struct {
+    script_path: []u8,
+    managed_root: []u8,
+
+    pub fn deinit(self: Workload, allocator: std.mem.Allocator) void {
+        allocator.free(self.script_path);
+        allocator.free(self.managed_root);
+    }
+};
+
+/// Write the fixtures and provision.rb for `spec` under `root`
+pub fn generate(allocator: std.mem.Allocator, root: []const u8, spec: Spec) !Workload {
+    if (spec.mix.total() == 0) return error.EmptyMix;
+
+    const templates_dir = try std.fs.path.join(allocator, &.{ root, "fixtures", "templates" });
+    defer allocator.free(templates_dir);
+    const targets_dir = try std.fs.path.join(allocator, &.{ root, "fixtures", "targets" });
+    defer allocator.free(targets_dir);
+    try std.fs.cwd().makePath(templates_dir);
+    try std.fs.cwd().makePath(targets_dir);
+
+    try writeFixtures(templates_dir, targets_dir, spec.fixture_pool);
+
+    const managed_root = try std.fs.path.join(allocator, &.{ root, "managed" });
+    errdefer allocator.free(managed_root);
+    const script_path = try std.fs.path.join(allocator, &.{ root, "provision.rb" });
+    errdefer allocator.free(script_path);
+
+    var script = std.ArrayList(u8).empty;
+    defer script.deinit(allocator);
+    try writeScript(script.writer(allocator), spec, managed_root, templates_dir, targets_dir);
+    try std.fs.cwd().writeFile(.{ .sub_path = script_path, .data = script.items });
+
+    return .{ .script_path = script_path, .managed_root = managed_root };
+}
+
+fn writeFixtures(templates_dir: []const u8, targets_dir: []const u8, pool: usize) !void {
+    var templates = try std.fs.cwd().openDir(templates_dir, .{});
+    defer templates.close();
+    var targets = try std.fs.cwd().openDir(targets_dir, .{});
+    defer targets.close();
+
+    var name_buf: [64]u8 = undefined;
+    var body_buf: [512]u8 = undefined;
+    for (0..pool) |k| {
+        const body = try std.fmt.bufPrint(&body_buf,
+            \\# template {d}
+            \\service: <%= name %>
+            \\listen: 0.0.0.0:<%= port %>
+            \\workers: <% if port > 8100 %>4<% else %>2<% end %>
+            \\
+        , .{k});
+        try templates.writeFile(.{ .sub_path = try std.fmt.bufPrint(&name_buf, "t{d}.erb", .{k}), .data = body });
+        try targets.writeFile(.{ .sub_path = try std.fmt.bufPrint(&name_buf, "target-{d}", .{k}), .data = "link target\n" });
+    }
+}
+
+/// Emit the provision script; separated from `generate` so it can be tested
+/// without touching the filesystem
+pub fn writeScript(w: anytype, spec: Spec, managed_root: []const u8, templates_dir: []const u8, targets_dir: []const u8) !void {
+    var prng = std.Random.DefaultPrng.init(spec.seed);
+    const random = prng.random();
+    const notifications = spec.mix.notifying_files > 0;
+
+    try w.print("# Generated workload: {d} resources, seed {d}\n", .{ spec.resources, spec.seed });
+
+    var i: usize = 0;
+    while (i < spec.resources) : (i += 1) {
+        const group = i / group_size;
+        const slot = i % group_size;
+        const pool_index = random.uintLessThan(usize, @max(spec.fixture_pool, 1));
+
+        if (slot == 0) {
+            try w.print("\ndirectory \"{s}/g{d}\" do\n  recursive true\nend\n", .{ managed_root, group });
+            continue;
+        }
+        if (slot == 1 and notifications) {
+            try w.print("execute \"reload-g{d}\" do\n  command \"true\"\n  action :nothing\nend\n", .{group});
+            continue;
+        }
+
+        switch (pick(random, spec.mix)) {
+            .file => try w.print(
+                "file \"{s}/g{d}/f{d}.conf\" do\n  content \"setting_{d} = {d}\\n\"\n  mode \"0644\"\nend\n",
+                .{ managed_root, group, i, i, random.int(u16) },
+            ),
+            .template => try w.print(
+                "template \"{s}/g{d}/t{d}.yml\" do\n  source \"{s}/t{d}.erb\"\n  variables({{ name: \"svc-{d}\", port: {d} }})\nend\n",
+                .{ managed_root, group, i, templates_dir, pool_index, i, 8000 + random.uintLessThan(u16, 200) },
+            ),
+            .link => try w.print(
+                "link \"{s}/g{d}/l{d}\" do\n  to \"{s}/target-{d}\"\nend\n",
+                .{ managed_root, group, i, targets_dir, pool_index },
+            ),
+            .guarded_execute => try w.print(
+                "execute \"stamp-{d}\" do\n  command \"touch {s}/g{d}/e{d}.stamp\"\n  not_if \"test -f {s}/g{d}/e{d}.stamp\"\nend\n",
+                .{ i, managed_root, group, i, managed_root, group, i },
+            ),
+            .notifying_file => try w.print(
+                "file \"{s}/g{d}/n{d}.conf\" do\n  content \"notify_{d}\\n\"\n  notifies :run, \"execute[reload-g{d}]\", :delayed\nend\n",
+                .{ managed_root, group, i, i, group },
+            ),
+        }
+    }
+}
+
+test "writeScript is deterministic and honours the resource count" {
+    const allocator = std.testing.allocator;
+    const spec = Spec{ .resources = 120 };
+
+    var first = std.ArrayList(u8).empty;
+    defer first.deinit(allocator);
+    try writeScript(first.writer(allocator), spec, "/m", "/t", "/l");
+
+    var second = std.ArrayList(u8).empty;
+    defer second.deinit(allocator);
+    try writeScript(second.writer(allocator), spec, "/m", "/t", "/l");
+
+    try std.testing.expectEqualStrings(first.items, second.items);
+
+    // Every resource block ends with a line containing only "end"
+    const blocks = std.mem.count(u8, first.items, "\nend\n");
+    try std.testing.expectEqual(@as(usize, 120), blocks);
+    try std.testing.expectEqual(@as(usize, 3), std.mem.count(u8, first.items, "directory \"/m/g"));
+}
+
+test "parseMix overrides listed weights" {
+    const mix = try parseMix("files:1, executes:0");
+    try std.testing.expectEqual(@as(u32, 1), mix.files);
+    try std.testing.expectEqual(@as(u32, 0), mix.guarded_executes);
+    try std.testing.expectEqual((Mix{}).templates, mix.templates);
+    try std.testing.expectError(error.InvalidMix, parseMix("widgets:3"));
+    try std.testing.expectError(error.InvalidMix, parseMix("files"));
+}
+
+test "notifying files target their group's execute" {
+    const allocator = std.testing.allocator;
+    const spec = Spec{ .resources = 60, .mix = .{ .files = 0, .templates = 0, .links = 0, .guarded_executes = 0, .notifying_files = 1 } };
+
+    var out = std.ArrayList(u8).empty;
+    defer out.deinit(allocator);
+    try writeScript(out.writer(allocator), spec, "/m", "/t", "/l");
+
+    try std.testing.expect(std.mem.indexOf(u8, out.items, "execute \"reload-g1\"") != null);
+    try std.testing.expect(std.mem.indexOf(u8, out.items, "notifies :run, \"execute[reload-g1]\", :delayed") != null);
+}
@@ -0,0 +1,374 @@
+//! Checkpoint journal for resuming failed provision runs.
+//!
+//! While `hola provision` applies resources it appends one line per
+//! successfully applied resource to a journal under the state dir:
+//!
+//!   <state>/checkpoints/<hash of script path or URL>.journal
+//!
+//!   hola-checkpoint 1
+//!   script <hash of script contents>
+//!   params <hash of data_bag and secrets_bag>
+//!   <index> <fingerprint> <notified 0|1> <action>
+//!   ...
+//!
+//! The journal is deleted when a run completes. After a failure,
+//! `--resume` skips the longest prefix of resources whose index and
+//! fingerprint match the journal, provided the script and params hashes are
+//! unchanged. Resources that triggered notifications are flagged so their
+//! notifications are queued again, since the failed run never processed
+//! them.
+
+const std = @import("std");
+const resources = @import("resources.zig");
+const base = @import("base_resource.zig");
+const xdg = @import("xdg.zig");
+const logger = @import("logger.zig");
+const mruby = @import("mruby.zig");
+
+const header_line = "hola-checkpoint 1";
+
+pub const Entry = struct {
+    index: usize,
+    fingerprint: u64,
+    notified: bool,
+    action: []const u8,
+};
+
+pub const Journal = struct {
+    allocator: std.mem.Allocator,
+    path: []u8,
+    file: ?std.fs.File = null,
+    // Entries from the previous run; only the contiguous prefix from index 0
+    previous: std.ArrayList(Entry) = .empty,
+    // Backing storage for the action names in `previous`
+    previous_text: ?[]u8 = null,
+    resuming: bool = false,
+
+    /// Open the journal for `key` (the script path or URL as given by the
+    /// user). When `resume` is set and the journal on disk was written for the
+    /// same script and params, its entries become available to `resumed`.
+    /// The file is then rewritten for this run.
+    pub fn open(allocator: std.mem.Allocator, key: []const u8, script_hash: u64, params_hash: u64, resume_run: bool) !Journal {
+        const path = try journalPath(allocator, key);
+        var journal = Journal{ .allocator = allocator, .path = path };
+        errdefer journal.deinit();
+
+        if (resume_run) {
+            if (std.fs.cwd().readFileAlloc(allocator, path, 16 * 1024 * 1024)) |text| {
+                journal.previous_text = text;
+                if (try parse(allocator, text, script_hash, params_hash, &journal.previous)) {
+                    journal.resuming = journal.previous.items.len > 0;
+                } else {
+                    journal.previous.clearRetainingCapacity();
+                }
+            } else |err| switch (err) {
+                error.FileNotFound => {},
+                else => logger.warn("checkpoint: cannot read {s}: {}", .{ path, err }),
+            }
+        }
+
+        if (std.fs.path.dirname(path)) |dir| try std.fs.cwd().makePath(dir);
+        const file = try std.fs.cwd().createFile(path, .{ .truncate = true, .mode = 0o600 });
+        journal.file = file;
+
+        var buf: [128]u8 = undefined;
+        const header = try std.fmt.bufPrint(&buf, "{s}\nscript {x:0>16}\nparams {x:0>16}\n", .{ header_line, script_hash, params_hash });
+        try file.writeAll(header);
+
+        return journal;
+    }
+
+    pub fn deinit(self: *Journal) void {
+        if (self.file) |f| f.close();
+        self.previous.deinit(self.allocator);
+        if (self.previous_text) |text| self.allocator.free(text);
+        self.allocator.free(self.path);
+    }
+
+    /// Number of resources the previous run recorded (0 unless resuming)
+    pub fn resumableCount(self: *const Journal) usize {
+        return if (self.resuming) self.previous.items.len else 0;
+    }
+
+    /// If resource `index` converged in the previous run with the same
+    /// fingerprint, return its entry. The first miss ends resumption, so only
+    /// a prefix of the run is ever skipped.
+    pub fn resumed(self: *Journal, index: usize, fingerprint: u64) ?Entry {
+        if (!self.resuming) return null;
+        if (index < self.previous.items.len and self.previous.items[index].fingerprint == fingerprint) {
+            return self.previous.items[index];
+        }
+        self.resuming = false;
+        return null;
+    }
+
+    /// Fingerprint `res` for `resumed` and `record`, taken before the
+    /// resource runs (apply sets transient batch/prefetch fields). Skipped
+    /// when the journal can neither be matched nor written.
+    pub fn fingerprint(self: *const Journal, res: *const resources.ResourceWithMetadata) u64 {
+        if (!self.resuming and self.file == null) return 0;
+        return resourceFingerprint(res);
+    }
+
+    /// Append a successfully applied resource. Best effort: a journal that
+    /// cannot be written only costs a full run next time.
+    pub fn record(self: *Journal, index: usize, fingerprint: u64, notified: bool, action: []const u8) void {
+        const file = self.file orelse return;
+        var buf: [256]u8 = undefined;
+        const line = std.fmt.bufPrint(&buf, "{d} {x:0>16} {d} {s}\n", .{
+            index,
+            fingerprint,
+            @intFromBool(notified),
+            if (action.len > 0 and action.len <= 64) action else "-",
+        }) catch return;
+        file.writeAll(line) catch |err| {
+            logger.warn("checkpoint: cannot write {s}: {}", .{ self.path, err });
+            file.close();
+            self.file = null;
+        };
+    }
+
+    /// The run finished; nothing is left to resume
+    pub fn complete(self: *Journal) void {
+        if (self.file) |f| f.close();
+        self.file = null;
+        std.fs.cwd().deleteFile(self.path) catch {};
+    }
+};
+
+fn journalPath(allocator: std.mem.Allocator, key: []const u8) ![]u8 {
+    const state_home = try xdg.XDG.init(allocator).getStateHome();
+    defer allocator.free(state_home);
+
+    var name_buf: [32]u8 = undefined;
+    const name = try std.fmt.bufPrint(&name_buf, "{x:0>16}.journal", .{std.hash.Wyhash.hash(0, key)});
+    return std.fs.path.join(allocator, &.{ state_home, "checkpoints", name });
+}
+
+/// Parse journal text into `entries`. Returns false when the header does not
+/// match the current inputs. A truncated last line (crash mid-write) and
+/// anything after a gap in the indices are ignored.
+fn parse(allocator: std.mem.Allocator, text: []const u8, script_hash: u64, params_hash: u64, entries: *std.ArrayList(Entry)) !bool {
+    var lines = std.mem.splitScalar(u8, text, '\n');
+    if (!std.mem.eql(u8, lines.next() orelse return false, header_line)) return false;
+    if (parseHashLine(lines.next() orelse return false, "script ") != script_hash) return false;
+    if (parseHashLine(lines.next() orelse return false, "params ") != params_hash) return false;
+
+    while (lines.next()) |line| {
+        // Only complete lines count; the final element after the last '\n' is
+        // empty unless the write was cut short
+        if (lines.peek() == null) break;
+
+        var fields = std.mem.tokenizeScalar(u8, line, ' ');
+        const index = std.fmt.parseInt(usize, fields.next() orelse break, 10) catch break;
+        const fingerprint = std.fmt.parseInt(u64, fields.next() orelse break, 16) catch break;
+        const notified = fields.next() orelse break;
+        const action = fields.next() orelse break;
+        if (index != entries.items.len) break;
+
+        try entries.append(allocator, .{
+            .index = index,
+            .fingerprint = fingerprint,
+            .notified = std.mem.eql(u8, notified, "1"),
+            .action = action,
+        });
+    }
+    return true;
+}
+
+fn parseHashLine(line: []const u8, prefix: []const u8) ?u64 {
+    if (!std.mem.startsWith(u8, line, prefix)) return null;
+    return std.fmt.parseInt(u64, line[prefix.len..], 16) catch null;
+}
+
+/// Hash of the script contents
+pub fn hashScript(allocator: std.mem.Allocator, script_path: []const u8) !u64 {
+    const content = try std.fs.cwd().readFileAlloc(allocator, script_path, 64 * 1024 * 1024);
+    defer allocator.free(content);
+    return std.hash.Wyhash.hash(0, content);
+}
+
+/// Hash of the data_bag and secrets_bag JSON handed to the run
+pub fn hashParams(params_json: ?[]const u8, secrets_json: ?[]const u8) u64 {
+    var hasher = std.hash.Wyhash.init(0);
+    hashValue(&hasher, params_json);
+    hashValue(&hasher, secrets_json);
+    return hasher.final();
+}
+
+/// Fingerprint of a resource's identity and properties
+///
+/// Covers scalar, string and enum properties of the resource payload,
+/// recursively, plus the identity of the local file the resource reads (a
+/// template's .erb, an aws_kms source, an extract archive), so fixing that
+/// file between runs re-runs the resource. The file is keyed on inode, size
+/// and mtime from one stat; its contents are never read.
+///
+/// Pointers, Ruby values, hash maps and the guard/notification props are not
+/// followed: guards are re-evaluated whenever a resource runs, and a
+/// resource skipped on resume never runs. A payload that binds Ruby values
+/// adds them itself through a `fingerprintValues` method (templates do).
+pub fn resourceFingerprint(res: *const resources.ResourceWithMetadata) u64 {
+    var hasher = std.hash.Wyhash.init(0);
+    hasher.update(res.id.type_name);
+    hasher.update("[");
+    hasher.update(res.id.name);
+    hasher.update("]");
+    switch (res.resource) {
+        inline else => |payload, tag| {
+            hasher.update(@tagName(tag));
+            hashValue(&hasher, payload);
+            if (@hasDecl(@TypeOf(payload), "fingerprintValues")) payload.fingerprintValues(&hasher);
+        },
+    }
+    if (res.resource.localInput()) |path| hashFile(&hasher, path);
+    return hasher.final();
+}
+
+/// Hash a file's inode, size and mtime; a missing file hashes as a marker,
+/// so it never matches a journal entry written while it existed
+fn hashFile(hasher: *std.hash.Wyhash, path: []const u8) void {
+    const stat = std.fs.cwd().statFile(path) catch {
+        hasher.update("\x00missing");
+        return;
+    };
+    hasher.update(std.mem.asBytes(&stat.inode));
+    hasher.update(std.mem.asBytes(&stat.size));
+    hasher.update(std.mem.asBytes(&stat.mtime));
+}
+
+fn hashValue(hasher: *std.hash.Wyhash, value: anytype) void {
+    const T = @TypeOf(value);
+    switch (@typeInfo(T)) {
+        .bool => hasher.update(if (value) "1" else "0"),
+        .int, .float => hasher.update(std.mem.asBytes(&value)),
+        .@"enum" => {
+            const tag = @intFromEnum(value);
+            hasher.update(std.mem.asBytes(&tag));
+        },
+        .optional => if (value) |inner| {
+            hasher.update("1");
+            hashValue(hasher, inner);
+        } else hasher.update("0"),
+        .array => |info| if (info.child == u8) {
+            hasher.update(&value);
+        } else for (value) |item| hashValue(hasher, item),
+        .pointer => |info| if (info.size == .slice) {
+            if (info.child == u8) {
+                hasher.update(std.mem.asBytes(&value.len));
+                hasher.update(value);
+            } else {
+                hasher.update(std.mem.asBytes(&value.len));
+                for (value) |item| hashValue(hasher, item);
+            }
+        },
+        .@"struct" => |info| {
+            // Ruby values are heap references that differ on every run
+            if (T == base.CommonProps or T == mruby.mrb_value) return;
+            // Unmanaged array lists: contents only, capacity is incidental
+            if (@hasField(T, "items") and @hasField(T, "capacity")) return hashValue(hasher, value.items);
+            inline for (info.fields) |field| {
+                if (!field.is_comptime) hashValue(hasher, @field(value, field.name));
+            }
+        },
+        .@"union" => |info| if (info.tag_type != null) {
+            switch (value) {
+                inline else => |payload, tag| {
+                    hasher.update(@tagName(tag));
+                    hashValue(hasher, payload);
+                },
+            }
+        },
+        else => {},
+    }
+}
+
+test "parse keeps the contiguous prefix for matching inputs" {
+    const allocator = std.testing.allocator;
+    const text =
+        \\hola-checkpoint 1
+        \\script 00000000000000aa
+        \\params 00000000000000bb
+        \\0 0000000000000001 0 create
+        \\1 0000000000000002 1 run
+        \\3 0000000000000004 0 create
+        \\
+    ;
+
+    var entries = std.ArrayList(Entry).empty;
+    defer entries.deinit(allocator);
+
+    try std.testing.expect(try parse(allocator, text, 0xaa, 0xbb, &entries));
+    try std.testing.expectEqual(@as(usize, 2), entries.items.len);
+    try std.testing.expect(entries.items[1].notified);
+    try std.testing.expectEqualStrings("run", entries.items[1].action);
+
+    entries.clearRetainingCapacity();
+    try std.testing.expect(!try parse(allocator, text, 0xaa, 0xcc, &entries));
+}
+
+test "parse ignores a truncated last line" {
+    const allocator = std.testing.allocator;
+    const text = "hola-checkpoint 1\nscript 0000000000000001\nparams 0000000000000002\n0 0000000000000009 0 create\n1 00000";
+
+    var entries = std.ArrayList(Entry).empty;
+    defer entries.deinit(allocator);
+
+    try std.testing.expect(try parse(allocator, text, 1, 2, &entries));
+    try std.testing.expectEqual(@as(usize, 1), entries.items.len);
+}
+
+test "hashValue ignores array list capacity" {
+    const allocator = std.testing.allocator;
+    const Props = struct {
+        path: []const u8,
+        mode: ?u32,
+        tags: std.ArrayList([]const u8),
+    };
+
+    var a = Props{ .path = "/etc/x", .mode = 0o644, .tags = .empty };
+    defer a.tags.deinit(allocator);
+    var b = Props{ .path = "/etc/x", .mode = 0o644, .tags = .empty };
+    defer b.tags.deinit(allocator);
+    try a.tags.append(allocator, "web");
+    try b.tags.ensureTotalCapacity(allocator, 32);
+    try b.tags.append(allocator, "web");
+
+    var ha = std.hash.Wyhash.init(0);
+    hashValue(&ha, a);
+    var hb = std.hash.Wyhash.init(0);
+    hashValue(&hb, b);
+    try std.testing.expectEqual(ha.final(), hb.final());
+
+    b.mode = 0o600;
+    var hc = std.hash.Wyhash.init(0);
+    hashValue(&hc, b);
+    try std.testing.expect(ha.final() != hc.final());
+}
+
+test "hashFile follows file changes" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(root);
+    const path = try std.fs.path.join(std.testing.allocator, &.{ root, "app.conf.erb" });
+    defer std.testing.allocator.free(path);
+
+    const digest = struct {
+        fn of(file_path: []const u8) u64 {
+            var hasher = std.hash.Wyhash.init(0);
+            hashFile(&hasher, file_path);
+            return hasher.final();
+        }
+    }.of;
+
+    const missing = digest(path);
+    try tmp.dir.writeFile(.{ .sub_path = "app.conf.erb", .data = "port <%= @port %>\n" });
+    const broken = digest(path);
+    try tmp.dir.writeFile(.{ .sub_path = "app.conf.erb", .data = "port <%= port %>\n" });
+    const fixed = digest(path);
+
+    try std.testing.expect(missing != broken);
+    try std.testing.expect(broken != fixed);
+    try std.testing.expectEqual(fixed, digest(path));
+}
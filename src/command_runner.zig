@@ -1,6 +1,28 @@
 const std = @import("std");
 const logger = @import("logger.zig");
 
+/// Where a command's output goes
+pub const Output = enum {
+    /// Echo the command and stream its output to the terminal
+    terminal,
+    /// Record command and output in the log only, for installers running
+    /// while a progress display owns the terminal
+    log_only,
+};
+
+/// Run a command with the given output handling and log it
+pub fn executeCommand(
+    allocator: std.mem.Allocator,
+    args: []const []const u8,
+    cwd: ?[]const u8,
+    output: Output,
+) !void {
+    switch (output) {
+        .terminal => return executeCommandWithLogging(allocator, args, cwd),
+        .log_only => return executeCommandLogOnly(allocator, args, cwd),
+    }
+}
+
 /// Execute a command with real-time output and log it via logger.logCommand.
 ///
 /// - `args`: full argv vector (program + arguments)
@@ -50,3 +72,36 @@ pub fn executeCommandWithLogging(
         else => return error.CommandFailed,
     }
 }
+
+fn executeCommandLogOnly(
+    allocator: std.mem.Allocator,
+    args: []const []const u8,
+    cwd: ?[]const u8,
+) !void {
+    const cmd_str = try std.mem.join(allocator, " ", args);
+    defer allocator.free(cmd_str);
+
+    const result = try std.process.Child.run(.{
+        .allocator = allocator,
+        .argv = args,
+        .cwd = cwd,
+        // Package managers are chatty; keep all of it for the log
+        .max_output_bytes = 64 * 1024 * 1024,
+    });
+    defer allocator.free(result.stdout);
+    defer allocator.free(result.stderr);
+
+    const exit_code: ?i32 = switch (result.term) {
+        .Exited => |code| code,
+        else => null,
+    };
+
+    logger.logCommand(cmd_str, result.stdout, result.stderr, exit_code);
+
+    switch (result.term) {
+        .Exited => |code| {
+            if (code != 0) return error.CommandFailed;
+        },
+        else => return error.CommandFailed,
+    }
+}
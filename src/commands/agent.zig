@@ -5,6 +5,7 @@ const provision_cmd = @import("provision.zig");
 const provision = @import("../provision.zig");
 const base_resource = @import("../base_resource.zig");
 const node_info = @import("../node_info.zig");
+const xdg = @import("../xdg.zig");
 
 const params = clap.parseParamsComptime(
     \\-h, --help                 Show help for agent
@@ -56,6 +57,8 @@ fn originMatches(url_a: []const u8, url_b: []const u8) bool {
 
 const INITIAL_BACKOFF_MS: u64 = 1000;
 const MAX_BACKOFF_MS: u64 = 30_000;
+/// Longest event ID the agent stores and sends back
+const MAX_EVENT_ID_LEN: usize = 256;
 const DEFAULT_WATCH_INTERVAL: u32 = 10;
 const AGENT_CALLBACK_TIMEOUT_S: u32 = 60;
 const AGENT_POLL_TIMEOUT_S: u32 = 60;
@@ -192,7 +195,7 @@ fn handleTaskJson(allocator: std.mem.Allocator, data: []const u8, default_callba
     var prov_result = provision_cmd.runScript(allocator, url, false, params_json, secrets_json, .{
         .cert = if (use_tls_for_download) tls_auth.cert else null,
         .key = if (use_tls_for_download) tls_auth.key else null,
-    }) catch |err| {
+    }, .{}) catch |err| {
         std.debug.print("[agent] provision failed: {}\n", .{err});
         if (callback_url) |cb| {
             sendCallback(allocator, cb, data, "error", @errorName(err), base_resource.getProvisionErrorDetail(), null, endpoint, tls_auth);
@@ -259,6 +262,7 @@ fn buildCallbackBody(allocator: std.mem.Allocator, event_data: []const u8, statu
             if (rr.output) |o| {
                 try res_obj.put("output", .{ .string = o });
             }
+            try res_obj.put("stats", try buildStatsJson(aa, rr.stats));
             try resources_arr.append(.{ .object = res_obj });
         }
         try result.put("resources", .{ .array = resources_arr });
@@ -278,6 +282,18 @@ fn buildCallbackBody(allocator: std.mem.Allocator, event_data: []const u8, statu
     return try allocator.dupe(u8, body);
 }
 
+fn buildStatsJson(allocator: std.mem.Allocator, stats: provision.ResourceStats) !std.json.Value {
+    var obj = std.json.ObjectMap.init(allocator);
+    try obj.put("wall_ns", .{ .integer = @intCast(stats.wall_ns) });
+    try obj.put("guard_ns", .{ .integer = @intCast(stats.guard_ns) });
+    try obj.put("subprocesses", .{ .integer = stats.subprocesses });
+    if (stats.bytes_read) |n| try obj.put("bytes_read", .{ .integer = @intCast(n) });
+    if (stats.bytes_written) |n| try obj.put("bytes_written", .{ .integer = @intCast(n) });
+    try obj.put("allocations", .{ .integer = @intCast(stats.allocations) });
+    try obj.put("allocated_bytes", .{ .integer = @intCast(stats.allocated_bytes) });
+    return .{ .object = obj };
+}
+
 fn cloneJsonValue(allocator: std.mem.Allocator, value: std.json.Value) !std.json.Value {
     return switch (value) {
         .null => .null,
@@ -371,25 +387,145 @@ fn runSseMode(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []c
     const display_endpoint = http.maskUrlPassword(ws_endpoint, &endpoint_buf);
     std.debug.print("[agent] node={s}, connecting to {s}\n", .{ node_name, display_endpoint });
 
+    var resume_state = ResumeState.load(allocator, endpoint, node_name);
+    defer resume_state.deinit();
+    if (resume_state.last_id) |id| std.debug.print("[agent] resuming after event {s}\n", .{id});
+
+    var prng = std.Random.DefaultPrng.init(std.crypto.random.int(u64));
+    const random = prng.random();
+
     var backoff_ms: u64 = INITIAL_BACKOFF_MS;
     while (true) {
-        wsConnect(allocator, ws_endpoint, node_name, default_callback, tls_auth) catch {
-            std.debug.print("[agent] reconnecting in {d}ms...\n", .{backoff_ms});
-            std.Thread.sleep(backoff_ms * std.time.ns_per_ms);
+        wsConnect(allocator, ws_endpoint, node_name, default_callback, tls_auth, &resume_state) catch {
+            const delay_ms = jitteredDelay(backoff_ms, random);
+            std.debug.print("[agent] reconnecting in {d}ms...\n", .{delay_ms});
+            std.Thread.sleep(delay_ms * std.time.ns_per_ms);
             backoff_ms = @min(backoff_ms * 2, MAX_BACKOFF_MS);
             continue;
         };
 
         backoff_ms = INITIAL_BACKOFF_MS;
-        std.debug.print("[agent] connection closed, reconnecting...\n", .{});
+        // A control-plane restart closes every agent's connection at once;
+        // spread the reconnects over the first backoff interval
+        const delay_ms = random.uintLessThan(u64, INITIAL_BACKOFF_MS);
+        std.debug.print("[agent] connection closed, reconnecting in {d}ms...\n", .{delay_ms});
+        std.Thread.sleep(delay_ms * std.time.ns_per_ms);
     }
 }
 
+/// Delay before the next reconnect attempt: half the current backoff plus a
+/// random share of the other half, so agents that lost the connection
+/// together do not retry in lockstep
+fn jitteredDelay(backoff_ms: u64, random: std.Random) u64 {
+    const half = backoff_ms / 2;
+    return half + random.uintAtMost(u64, backoff_ms - half);
+}
+
+/// The last event ID the agent finished processing. Sent as Last-Event-ID
+/// when connecting so the server can resume after it instead of replaying a
+/// snapshot, and kept under the state dir to survive agent restarts:
+///
+///   <state>/agent/<hash of endpoint and node name>.last-event-id
+///
+/// Persistence is best effort; without it the server falls back to a
+/// snapshot.
+const ResumeState = struct {
+    allocator: std.mem.Allocator,
+    path: ?[]u8 = null,
+    last_id: ?[]u8 = null,
+
+    fn load(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []const u8) ResumeState {
+        var state = ResumeState{ .allocator = allocator };
+        state.path = statePath(allocator, endpoint, node_name) catch |err| {
+            std.debug.print("[agent] cannot locate state dir, event IDs won't persist: {}\n", .{err});
+            return state;
+        };
+
+        const text = std.fs.cwd().readFileAlloc(allocator, state.path.?, MAX_EVENT_ID_LEN + 1) catch |err| {
+            if (err != error.FileNotFound) std.debug.print("[agent] cannot read {s}: {}\n", .{ state.path.?, err });
+            return state;
+        };
+        defer allocator.free(text);
+        const id = std.mem.trimEnd(u8, text, "\n");
+        if (validEventId(id)) state.last_id = allocator.dupe(u8, id) catch null;
+        return state;
+    }
+
+    fn deinit(self: *ResumeState) void {
+        if (self.last_id) |id| self.allocator.free(id);
+        if (self.path) |path| self.allocator.free(path);
+    }
+
+    /// Whether `id` is the event processed last (a replay after reconnect)
+    fn isProcessed(self: *const ResumeState, id: []const u8) bool {
+        const last = self.last_id orelse return false;
+        return std.mem.eql(u8, last, id);
+    }
+
+    /// Remember `id` as processed. The file is replaced with a rename so a
+    /// crash mid-write leaves the previous ID rather than a torn one.
+    fn record(self: *ResumeState, id: []const u8) void {
+        if (!validEventId(id)) return;
+        const copy = self.allocator.dupe(u8, id) catch return;
+        if (self.last_id) |old| self.allocator.free(old);
+        self.last_id = copy;
+
+        const path = self.path orelse return;
+        self.write(path, copy) catch |err| {
+            std.debug.print("[agent] cannot write {s}: {}\n", .{ path, err });
+        };
+    }
+
+    fn write(self: *ResumeState, path: []const u8, id: []const u8) !void {
+        if (std.fs.path.dirname(path)) |dir| try std.fs.cwd().makePath(dir);
+        const tmp_path = try std.fmt.allocPrint(self.allocator, "{s}.tmp", .{path});
+        defer self.allocator.free(tmp_path);
+
+        {
+            const file = try std.fs.cwd().createFile(tmp_path, .{ .truncate = true, .mode = 0o600 });
+            defer file.close();
+            try file.writeAll(id);
+            try file.writeAll("\n");
+        }
+        try std.fs.cwd().rename(tmp_path, path);
+    }
+
+    fn statePath(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []const u8) ![]u8 {
+        const state_home = try xdg.XDG.init(allocator).getStateHome();
+        defer allocator.free(state_home);
+
+        var hasher = std.hash.Wyhash.init(0);
+        hasher.update(endpoint);
+        hasher.update("\x00");
+        hasher.update(node_name);
+        var name_buf: [40]u8 = undefined;
+        const name = try std.fmt.bufPrint(&name_buf, "{x:0>16}.last-event-id", .{hasher.final()});
+        return std.fs.path.join(allocator, &.{ state_home, "agent", name });
+    }
+};
+
+/// IDs end up in a request header: no line breaks or NULs, and bounded
+fn validEventId(id: []const u8) bool {
+    return id.len > 0 and id.len <= MAX_EVENT_ID_LEN and std.mem.indexOfAny(u8, id, "\r\n\x00") == null;
+}
+
+/// The "id" of a WebSocket message (string or integer), formatted into `buf`
+fn messageEventId(obj: std.json.ObjectMap, buf: []u8) ?[]const u8 {
+    const value = obj.get("id") orelse return null;
+    const id = switch (value) {
+        .string => |str| str,
+        .integer => |int| std.fmt.bufPrint(buf, "{d}", .{int}) catch return null,
+        else => return null,
+    };
+    return if (validEventId(id)) id else null;
+}
+
 const WsContext = struct {
     allocator: std.mem.Allocator,
     default_callback: ?[]const u8,
     endpoint: []const u8,
     tls_auth: TlsClientAuth,
+    resume_state: *ResumeState,
     first_frame: bool = true,
 };
 
@@ -401,11 +537,11 @@ fn wsWriteCallback(ptr: [*]const u8, size: usize, nmemb: usize, userdata: *anyop
         std.debug.print("[agent] WebSocket connected, receiving frames\n", .{});
         ctx.first_frame = false;
     }
-    handleWsMessage(ctx.allocator, ptr[0..total], ctx.default_callback, ctx.endpoint, ctx.tls_auth);
+    handleWsMessage(ctx.allocator, ptr[0..total], ctx.default_callback, ctx.endpoint, ctx.tls_auth, ctx.resume_state);
     return total;
 }
 
-fn wsConnect(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []const u8, default_callback: ?[]const u8, tls_auth: TlsClientAuth) !void {
+fn wsConnect(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []const u8, default_callback: ?[]const u8, tls_auth: TlsClientAuth, resume_state: *ResumeState) !void {
     const curl = @import("../curl.zig");
     const handle = curl.curl_easy_init() orelse return error.ConnectionFailed;
     defer curl.curl_easy_cleanup(handle);
@@ -449,13 +585,20 @@ fn wsConnect(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []co
     const arch_header = try std.fmt.allocPrint(allocator, "X-Hola-Arch: {s}\x00", .{node_info.getCpuArch()});
     defer allocator.free(arch_header);
     headers = curl.curl_slist_append(headers, @ptrCast(arch_header.ptr));
+    // Let the server resume after the last event we processed
+    var resume_header: ?[]u8 = null;
+    defer if (resume_header) |h| allocator.free(h);
+    if (resume_state.last_id) |id| {
+        resume_header = try std.fmt.allocPrint(allocator, "Last-Event-ID: {s}\x00", .{id});
+        headers = curl.curl_slist_append(headers, @ptrCast(resume_header.?.ptr));
+    }
     if (headers) |h| {
         _ = curl.curl_easy_setopt(handle, .CURLOPT_HTTPHEADER, h);
     }
     defer if (headers) |h| curl.curl_slist_free_all(h);
 
     // Write callback receives WebSocket text frame payloads
-    var ctx = WsContext{ .allocator = allocator, .default_callback = default_callback, .endpoint = endpoint, .tls_auth = tls_auth };
+    var ctx = WsContext{ .allocator = allocator, .default_callback = default_callback, .endpoint = endpoint, .tls_auth = tls_auth, .resume_state = resume_state };
     _ = curl.curl_easy_setopt(handle, .CURLOPT_WRITEFUNCTION, @as(curl.WriteCallback, @ptrCast(&wsWriteCallback)));
     _ = curl.curl_easy_setopt(handle, .CURLOPT_WRITEDATA, @as(*anyopaque, @ptrCast(&ctx)));
 
@@ -468,8 +611,8 @@ fn wsConnect(allocator: std.mem.Allocator, endpoint: []const u8, node_name: []co
     }
 }
 
-fn handleWsMessage(allocator: std.mem.Allocator, msg: []const u8, default_callback: ?[]const u8, endpoint: []const u8, tls_auth: TlsClientAuth) void {
-    // Parse {"type": "task"|"snapshot-task", "data": {...}}
+fn handleWsMessage(allocator: std.mem.Allocator, msg: []const u8, default_callback: ?[]const u8, endpoint: []const u8, tls_auth: TlsClientAuth, resume_state: *ResumeState) void {
+    // Parse {"type": "task"|"snapshot-task", "id": ..., "data": {...}}
     const parsed = std.json.parseFromSlice(std.json.Value, allocator, msg, .{}) catch |err| {
         std.debug.print("[agent] failed to parse WS message: {}\n", .{err});
         return;
@@ -479,6 +622,15 @@ fn handleWsMessage(allocator: std.mem.Allocator, msg: []const u8, default_callba
     if (parsed.value != .object) return;
     const obj = parsed.value.object;
 
+    var id_buf: [32]u8 = undefined;
+    const event_id = messageEventId(obj, &id_buf);
+    if (event_id) |id| {
+        if (resume_state.isProcessed(id)) {
+            std.debug.print("[agent] event {s} already processed, skipping\n", .{id});
+            return;
+        }
+    }
+
     const msg_type = blk: {
         if (obj.get("type")) |v| {
             if (v == .string) break :blk v.string;
@@ -493,6 +645,8 @@ fn handleWsMessage(allocator: std.mem.Allocator, msg: []const u8, default_callba
             handleTaskJson(allocator, task_json, default_callback, endpoint, tls_auth);
         }
     }
+
+    if (event_id) |id| resume_state.record(id);
 }
 
 // -- Watch (polling) mode --
@@ -654,6 +808,10 @@ fn printHelp(reason: ?[]const u8) !void {
         \\  hola agent https://hub.example.com/nodes/mynode/events
         \\  hola agent --node-name web-01 https://hub.example.com/nodes/web-01/events
         \\
+        \\  Messages may carry an "id". The agent keeps the last one it processed
+        \\  under the state dir and sends it as Last-Event-ID when it reconnects,
+        \\  so the server can resume after it; a replay of that event is skipped.
+        \\
         \\Watch Mode:
         \\  hola agent --mode watch https://worker.example.com/pending
         \\  hola agent --mode watch --interval 30 --node-name db-01 https://worker.example.com/pending
@@ -678,6 +836,8 @@ test "buildCallbackBody with ProvisionResult" {
         .skipped = false,
         .skip_reason = null,
         .error_name = null,
+        .output = null,
+        .stats = .{ .wall_ns = 1_500_000, .subprocesses = 2, .bytes_written = 512 },
     });
 
     const type2 = try allocator.dupe(u8, "execute");
@@ -692,6 +852,7 @@ test "buildCallbackBody with ProvisionResult" {
         .skipped = true,
         .skip_reason = skip2,
         .error_name = null,
+        .output = null,
     });
 
     var prov_result = provision.ProvisionResult{
@@ -718,6 +879,9 @@ test "buildCallbackBody with ProvisionResult" {
     try std.testing.expect(std.mem.indexOf(u8, body, "\"failed\":0") != null);
     try std.testing.expect(std.mem.indexOf(u8, body, "\"duration_ms\":142") != null);
     try std.testing.expect(std.mem.indexOf(u8, body, "\"resources\":[") != null);
+    try std.testing.expect(std.mem.indexOf(u8, body, "\"wall_ns\":1500000") != null);
+    try std.testing.expect(std.mem.indexOf(u8, body, "\"subprocesses\":2") != null);
+    try std.testing.expect(std.mem.indexOf(u8, body, "\"bytes_written\":512") != null);
     try std.testing.expect(std.mem.indexOf(u8, body, "\"/tmp/config\"") != null);
     try std.testing.expect(std.mem.indexOf(u8, body, "\"skip_reason\":\"up to date\"") != null);
     // url, callback, and secrets should be removed
@@ -763,3 +927,49 @@ test "originMatches different host" {
 test "originMatches invalid url" {
     try std.testing.expect(!originMatches("not-a-url", "https://hub.example.com/x"));
 }
+
+test "jitteredDelay stays within the upper half of the backoff" {
+    var prng = std.Random.DefaultPrng.init(42);
+    const random = prng.random();
+    for (0..1000) |_| {
+        const delay = jitteredDelay(MAX_BACKOFF_MS, random);
+        try std.testing.expect(delay >= MAX_BACKOFF_MS / 2 and delay <= MAX_BACKOFF_MS);
+    }
+    try std.testing.expectEqual(@as(u64, 0), jitteredDelay(0, random));
+}
+
+test "messageEventId accepts strings and integers only" {
+    const parsed = try std.json.parseFromSlice(std.json.Value, std.testing.allocator,
+        \\[{"id":"evt-7"},{"id":42},{"id":"a\nb"},{"id":true},{}]
+    , .{});
+    defer parsed.deinit();
+    const items = parsed.value.array.items;
+
+    var buf: [32]u8 = undefined;
+    try std.testing.expectEqualStrings("evt-7", messageEventId(items[0].object, &buf).?);
+    try std.testing.expectEqualStrings("42", messageEventId(items[1].object, &buf).?);
+    try std.testing.expect(messageEventId(items[2].object, &buf) == null);
+    try std.testing.expect(messageEventId(items[3].object, &buf) == null);
+    try std.testing.expect(messageEventId(items[4].object, &buf) == null);
+}
+
+test "ResumeState persists the last processed event ID" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const dir = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir);
+
+    var state = ResumeState{ .allocator = allocator, .path = try std.fs.path.join(allocator, &.{ dir, "agent", "node.last-event-id" }) };
+    defer state.deinit();
+
+    state.record("evt-1");
+    state.record("evt-2");
+    state.record("bad\r\nX-Injected: 1");
+    try std.testing.expect(state.isProcessed("evt-2"));
+    try std.testing.expect(!state.isProcessed("evt-1"));
+
+    const text = try tmp.dir.readFileAlloc(allocator, "agent/node.last-event-id", 1024);
+    defer allocator.free(text);
+    try std.testing.expectEqualStrings("evt-2\n", text);
+}
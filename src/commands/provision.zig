@@ -2,6 +2,7 @@ const std = @import("std");
 const clap = @import("clap");
 const provision = @import("../provision.zig");
 const http = @import("../http.zig");
+const file_watcher = @import("../file_watcher.zig");
 
 const params = clap.parseParamsComptime(
     \\-h, --help            Show help for provision
@@ -12,6 +13,8 @@ const params = clap.parseParamsComptime(
     \\    --secrets-bag-url <URL>  Fetch secrets_bag JSON from URL
     \\    --client-cert <PATH>     Client certificate for mTLS
     \\    --client-key <PATH>      Client private key for mTLS
+    \\    --resume                 Skip resources a failed previous run already converged
+    \\    --watch                  Keep running and re-apply resources when their files change
     \\<path>                Path to provision file (.rb)
     \\
 );
@@ -34,6 +37,14 @@ const TlsClientAuth = struct {
 
 const PROVISION_FETCH_TIMEOUT_S: u32 = 300;
 
+/// Checkpoint journal and watch settings for a run
+pub const RunMode = struct {
+    checkpoint: bool = false, // Journal applied resources for --resume
+    resume_run: bool = false,
+    watch: bool = false,
+    watch_inputs: ?*std.ArrayList([]u8) = null, // Filled with the resources' input files (see provision.Options)
+};
+
 /// Fetch JSON content from a URL, using optional mTLS credentials.
 /// Returns the response body as an owned slice that the caller must free.
 fn fetchJsonFromUrl(allocator: std.mem.Allocator, url: []const u8, tls_auth: TlsClientAuth) ![]const u8 {
@@ -80,7 +91,7 @@ fn fetchJsonFromUrl(allocator: std.mem.Allocator, url: []const u8, tls_auth: Tls
     return allocator.dupe(u8, response.body) catch return error.FetchFailed;
 }
 
-pub fn runScript(allocator: std.mem.Allocator, script_path_or_url: []const u8, use_pretty_output: bool, params_json: ?[]const u8, secrets_json: ?[]const u8, tls_auth: TlsClientAuth) !provision.ProvisionResult {
+pub fn runScript(allocator: std.mem.Allocator, script_path_or_url: []const u8, use_pretty_output: bool, params_json: ?[]const u8, secrets_json: ?[]const u8, tls_auth: TlsClientAuth, mode: RunMode) !provision.ProvisionResult {
     const is_url = std.mem.startsWith(u8, script_path_or_url, "http://") or
         std.mem.startsWith(u8, script_path_or_url, "https://");
 
@@ -167,6 +178,12 @@ pub fn runScript(allocator: std.mem.Allocator, script_path_or_url: []const u8, u
         .use_pretty_output = use_pretty_output,
         .params_json = params_json,
         .secrets_json = secrets_json,
+        // Keyed by what the user passed: a downloaded script gets a new
+        // temp path every run
+        .checkpoint_key = if (mode.checkpoint) script_path_or_url else null,
+        .resume_run = mode.resume_run,
+        .watch = mode.watch,
+        .watch_inputs = mode.watch_inputs,
     });
 }
 
@@ -248,7 +265,20 @@ pub fn run(allocator: std.mem.Allocator, iter: *std.process.ArgIterator) !void {
     const effective_data_bag = fetched_data_bag orelse res.args.@"data-bag";
     const effective_secrets_bag = fetched_secrets_bag orelse res.args.@"secrets-bag";
 
-    var result = runScript(allocator, script_path_or_url, use_pretty_output, effective_data_bag, effective_secrets_bag, tls_auth) catch |err| {
+    const mode = RunMode{
+        .checkpoint = true,
+        .resume_run = res.args.@"resume" != 0,
+        .watch = res.args.watch != 0,
+    };
+    if (mode.watch) {
+        if (std.mem.startsWith(u8, script_path_or_url, "http://") or std.mem.startsWith(u8, script_path_or_url, "https://")) {
+            std.debug.print("Error: --watch needs a local provision file\n", .{});
+            return error.InvalidArguments;
+        }
+        return watchScript(allocator, script_path_or_url, use_pretty_output, effective_data_bag, effective_secrets_bag, tls_auth, mode);
+    }
+
+    var result = runScript(allocator, script_path_or_url, use_pretty_output, effective_data_bag, effective_secrets_bag, tls_auth, mode) catch |err| {
         if (err == error.MRubyException) {
             if (logger.getLogPath()) |log_path| {
                 std.debug.print("\nLog file: {s}\n", .{log_path});
@@ -264,6 +294,45 @@ pub fn run(allocator: std.mem.Allocator, iter: *std.process.ArgIterator) !void {
     defer result.deinit(allocator);
 }
 
+/// `--watch`: each run keeps watching resource inputs and returns when the
+/// script changes; a failed run waits for the script or one of its
+/// resources' input files to change before the next attempt
+fn watchScript(allocator: std.mem.Allocator, script_path: []const u8, use_pretty_output: bool, params_json: ?[]const u8, secrets_json: ?[]const u8, tls_auth: TlsClientAuth, mode: RunMode) !void {
+    var inputs = std.ArrayList([]u8).empty;
+    defer {
+        for (inputs.items) |input| allocator.free(input);
+        inputs.deinit(allocator);
+    }
+    var watch_mode = mode;
+    watch_mode.watch_inputs = &inputs;
+
+    while (true) {
+        for (inputs.items) |input| allocator.free(input);
+        inputs.clearRetainingCapacity();
+
+        if (runScript(allocator, script_path, use_pretty_output, params_json, secrets_json, tls_auth, watch_mode)) |result| {
+            var done = result;
+            done.deinit(allocator);
+            continue;
+        } else |err| {
+            if (err != error.MRubyException) std.debug.print("Provision failed: {}\n", .{err});
+        }
+
+        var watcher = try file_watcher.Watcher.init(allocator);
+        defer watcher.deinit();
+        _ = try watcher.add(script_path);
+        for (inputs.items) |input| {
+            _ = watcher.add(input) catch |err| {
+                std.debug.print("Cannot watch {s}: {}\n", .{ input, err });
+            };
+        }
+        std.debug.print("\x1b[36mWaiting for {s} or the files its resources read to change...\x1b[0m\n", .{script_path});
+        var changed = std.ArrayList([]const u8).empty;
+        defer changed.deinit(allocator);
+        try watcher.wait(&changed);
+    }
+}
+
 fn printHelp(reason: ?[]const u8) !void {
     const out = std.fs.File.stdout();
     if (reason) |msg| {
@@ -285,6 +354,11 @@ fn printHelp(reason: ?[]const u8) !void {
         \\      --secrets-bag-url URL  Fetch secrets_bag JSON from URL
         \\      --client-cert PATH     Client certificate for mTLS (PEM)
         \\      --client-key PATH      Client private key for mTLS (PEM)
+        \\      --resume               Skip resources a failed previous run already converged
+        \\                             (same script and data/secrets bags only)
+        \\      --watch                Stay running: re-apply templates and other resources
+        \\                             when their source files change, and re-run the whole
+        \\                             script when it changes
         \\
         \\Examples
         \\  # Local file
@@ -307,6 +381,12 @@ fn printHelp(reason: ?[]const u8) !void {
         \\  # With output mode
         \\  hola provision --output plain provision.rb
         \\
+        \\  # Retry a failed run from where it stopped
+        \\  hola provision --resume provision.rb
+        \\
+        \\  # Re-converge while editing templates or the script
+        \\  hola provision --watch provision.rb
+        \\
         \\Ruby DSL:
         \\  file \"/tmp/config\" do
         \\    content \"hello\\n\"
@@ -0,0 +1,86 @@
+//! Allocation counting shared by provision's per-resource stats and the
+//! load-test harness.
+
+const std = @import("std");
+
+/// Allocator wrapper that counts calls and live bytes. Atomic because
+/// download workers and async resources allocate from other threads.
+pub const CountingAllocator = struct {
+    parent: std.mem.Allocator,
+    allocations: std.atomic.Value(u64) = .init(0),
+    frees: std.atomic.Value(u64) = .init(0),
+    bytes_allocated: std.atomic.Value(u64) = .init(0),
+    live_bytes: std.atomic.Value(u64) = .init(0),
+    peak_live_bytes: std.atomic.Value(u64) = .init(0),
+
+    pub fn init(parent: std.mem.Allocator) CountingAllocator {
+        return .{ .parent = parent };
+    }
+
+    pub fn allocator(self: *CountingAllocator) std.mem.Allocator {
+        return .{ .ptr = self, .vtable = &vtable };
+    }
+
+    const vtable = std.mem.Allocator.VTable{
+        .alloc = alloc,
+        .resize = resize,
+        .remap = remap,
+        .free = free,
+    };
+
+    fn grow(self: *CountingAllocator, bytes: usize) void {
+        _ = self.bytes_allocated.fetchAdd(bytes, .monotonic);
+        const live = self.live_bytes.fetchAdd(bytes, .monotonic) + bytes;
+        _ = self.peak_live_bytes.fetchMax(live, .monotonic);
+    }
+
+    fn shrink(self: *CountingAllocator, bytes: usize) void {
+        _ = self.live_bytes.fetchSub(bytes, .monotonic);
+    }
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: std.mem.Alignment, ret_addr: usize) ?[*]u8 {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        const ptr = self.parent.rawAlloc(len, alignment, ret_addr) orelse return null;
+        _ = self.allocations.fetchAdd(1, .monotonic);
+        self.grow(len);
+        return ptr;
+    }
+
+    fn resize(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) bool {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        if (!self.parent.rawResize(memory, alignment, new_len, ret_addr)) return false;
+        if (new_len > memory.len) self.grow(new_len - memory.len) else self.shrink(memory.len - new_len);
+        return true;
+    }
+
+    fn remap(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) ?[*]u8 {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        const ptr = self.parent.rawRemap(memory, alignment, new_len, ret_addr) orelse return null;
+        if (new_len > memory.len) self.grow(new_len - memory.len) else self.shrink(memory.len - new_len);
+        return ptr;
+    }
+
+    fn free(ctx: *anyopaque, memory: []u8, alignment: std.mem.Alignment, ret_addr: usize) void {
+        const self: *CountingAllocator = @ptrCast(@alignCast(ctx));
+        self.parent.rawFree(memory, alignment, ret_addr);
+        _ = self.frees.fetchAdd(1, .monotonic);
+        self.shrink(memory.len);
+    }
+};
+
+test "CountingAllocator tracks allocations and live bytes" {
+    var counting = CountingAllocator.init(std.testing.allocator);
+    const a = counting.allocator();
+
+    const first = try a.alloc(u8, 100);
+    var second = try a.alloc(u8, 50);
+    try std.testing.expectEqual(@as(u64, 150), counting.live_bytes.load(.monotonic));
+
+    second = try a.realloc(second, 80);
+    a.free(first);
+    a.free(second);
+
+    try std.testing.expectEqual(@as(u64, 0), counting.live_bytes.load(.monotonic));
+    try std.testing.expect(counting.allocations.load(.monotonic) >= 2);
+    try std.testing.expect(counting.peak_live_bytes.load(.monotonic) >= 150);
+}
@@ -156,6 +156,7 @@ pub extern fn curl_global_init(flags: c_long) CURLcode;
 pub extern fn curl_global_cleanup() void;
 pub extern fn curl_easy_init() ?*CURL;
 pub extern fn curl_easy_cleanup(curl: *CURL) void;
+pub extern fn curl_easy_reset(curl: *CURL) void;
 pub extern fn curl_easy_setopt(curl: *CURL, option: CURLoption, ...) CURLcode;
 pub extern fn curl_easy_perform(curl: *CURL) CURLcode;
 pub extern fn curl_easy_getinfo(curl: *CURL, info: CURLINFO, ...) CURLcode;
@@ -0,0 +1,177 @@
+//! Run-scoped record of directories known to exist, so resources that need
+//! a parent directory (directory, file, template, link, ...) do not each
+//! walk and mkdir the whole path again.
+//!
+//! Only absolute paths are cached; relative ones go straight to makePath.
+//! Missing levels are opened or created with openat/mkdirat relative to the
+//! nearest known ancestor, and the fd of the last directory reached stays
+//! open, so a tree built depth-first costs one openat per new level and a
+//! parent that is already known costs a single stat.
+//!
+//! Entries go stale when something removes a directory mid-run. Deleting a
+//! directory resource and spawning a child process (base.noteSubprocess)
+//! clear the cache. A known directory that is gone anyway fails that stat,
+//! and a stale ancestor fails its openat; either makes `ensure` start over
+//! from the root rather than hand the caller a missing directory.
+
+const std = @import("std");
+const posix = std.posix;
+
+const allocator = std.heap.c_allocator;
+
+// Remote files create their parents from the download threads
+var mutex: std.Thread.Mutex = .{};
+var known: std.StringHashMapUnmanaged(void) = .empty;
+// Open fd of the directory `ensure` reached last, and its path (owned)
+var hot: ?struct { fd: posix.fd_t, path: []u8 } = null;
+
+/// Forget every directory; call when a run starts and ends, and whenever
+/// directories may have been removed
+pub fn reset() void {
+    mutex.lock();
+    defer mutex.unlock();
+    resetLocked();
+}
+
+fn resetLocked() void {
+    var it = known.keyIterator();
+    while (it.next()) |key| allocator.free(key.*);
+    known.clearAndFree(allocator);
+    if (hot) |h| {
+        posix.close(h.fd);
+        allocator.free(h.path);
+    }
+    hot = null;
+}
+
+/// Make sure `path` is a directory, creating missing parents (0o755 before
+/// the umask, like makePath). Symlinks along the way are followed.
+pub fn ensure(path: []const u8) !void {
+    const dir_path = trimTrailingSlashes(path);
+    if (!std.fs.path.isAbsolute(dir_path)) return std.fs.cwd().makePath(dir_path);
+
+    mutex.lock();
+    defer mutex.unlock();
+    if (known.contains(dir_path)) {
+        if (isDir(dir_path)) return;
+        resetLocked();
+        return ensureLocked(dir_path);
+    }
+
+    ensureLocked(dir_path) catch |err| switch (err) {
+        // A cached ancestor was removed behind our back; walk from the root
+        error.FileNotFound, error.NotDir => {
+            resetLocked();
+            try ensureLocked(dir_path);
+        },
+        else => return err,
+    };
+}
+
+/// Whether `path` was already seen as a directory during this run (it may
+/// have been removed since; `ensure` checks)
+pub fn contains(path: []const u8) bool {
+    mutex.lock();
+    defer mutex.unlock();
+    return known.contains(trimTrailingSlashes(path));
+}
+
+fn ensureLocked(path: []const u8) !void {
+    // Nearest known ancestor, else the root
+    var start = path;
+    while (std.fs.path.dirname(start)) |parent| {
+        start = parent;
+        if (known.contains(parent)) break;
+    }
+
+    var fd = if (hot != null and std.mem.eql(u8, hot.?.path, start)) blk: {
+        const h = hot.?;
+        allocator.free(h.path);
+        hot = null;
+        break :blk h.fd;
+    } else try openDirAt(posix.AT.FDCWD, start);
+    errdefer posix.close(fd);
+
+    const rest = path[start.len..];
+    var it = std.mem.tokenizeScalar(u8, rest, '/');
+    while (it.next()) |name| {
+        const child = openDirAt(fd, name) catch |err| switch (err) {
+            error.FileNotFound => blk: {
+                posix.mkdirat(fd, name, 0o755) catch |mkdir_err| switch (mkdir_err) {
+                    error.PathAlreadyExists => {},
+                    else => return mkdir_err,
+                };
+                break :blk try openDirAt(fd, name);
+            },
+            else => return err,
+        };
+        posix.close(fd);
+        fd = child;
+        remember(path[0 .. start.len + it.index]);
+    }
+
+    const hot_path = allocator.dupe(u8, path) catch {
+        posix.close(fd);
+        return;
+    };
+    hot = .{ .fd = fd, .path = hot_path };
+}
+
+fn remember(path: []const u8) void {
+    const key = allocator.dupe(u8, path) catch return;
+    known.put(allocator, key, {}) catch allocator.free(key);
+}
+
+fn isDir(path: []const u8) bool {
+    const st = posix.fstatat(posix.AT.FDCWD, path, 0) catch return false;
+    return posix.S.ISDIR(st.mode);
+}
+
+fn openDirAt(dir_fd: posix.fd_t, name: []const u8) !posix.fd_t {
+    return posix.openat(dir_fd, name, .{ .ACCMODE = .RDONLY, .DIRECTORY = true, .CLOEXEC = true }, 0);
+}
+
+fn trimTrailingSlashes(path: []const u8) []const u8 {
+    const trimmed = std.mem.trimEnd(u8, path, "/");
+    return if (trimmed.len == 0 and path.len > 0) path[0..1] else trimmed;
+}
+
+test "ensure creates each level once and recovers from removed ancestors" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(std.testing.allocator, ".");
+    defer std.testing.allocator.free(root);
+
+    reset();
+    defer reset();
+
+    const deep = try std.fs.path.join(std.testing.allocator, &.{ root, "a", "b", "c" });
+    defer std.testing.allocator.free(deep);
+    try ensure(deep);
+    try std.testing.expect(contains(deep));
+    try tmp.dir.access("a/b/c", .{});
+
+    // Siblings reuse the known parent
+    const sibling = try std.fs.path.join(std.testing.allocator, &.{ root, "a", "b", "d/" });
+    defer std.testing.allocator.free(sibling);
+    try ensure(sibling);
+    try tmp.dir.access("a/b/d", .{});
+
+    // A known directory removed outside the cache comes back
+    try tmp.dir.deleteTree("a/b/c");
+    try ensure(deep);
+    try tmp.dir.access("a/b/c", .{});
+
+    // Removed outside the cache: the stale entry for a/b must not stick
+    try tmp.dir.deleteTree("a");
+    const again = try std.fs.path.join(std.testing.allocator, &.{ root, "a", "b", "e" });
+    defer std.testing.allocator.free(again);
+    try ensure(again);
+    try tmp.dir.access("a/b/e", .{});
+
+    // A file in the way is an error, not a cached directory
+    try tmp.dir.writeFile(.{ .sub_path = "f", .data = "" });
+    const blocked = try std.fs.path.join(std.testing.allocator, &.{ root, "f", "g" });
+    defer std.testing.allocator.free(blocked);
+    try std.testing.expectError(error.NotDir, ensure(blocked));
+}
@@ -0,0 +1,178 @@
+//! Wait for changes to a set of files.
+//!
+//! On Linux this uses inotify on the parent directories, so editors that
+//! save by writing a new file and renaming it over the old one are seen as
+//! well. Other platforms poll modification times.
+
+const std = @import("std");
+const builtin = @import("builtin");
+const linux = std.os.linux;
+
+const use_inotify = builtin.os.tag == .linux;
+
+/// Quiet period after the first event, so a burst of saves (editor swap
+/// files, `git checkout`) is reported as one change set
+const DEBOUNCE_MS: i32 = 100;
+const POLL_INTERVAL_MS: u64 = 500;
+
+pub const Watcher = struct {
+    allocator: std.mem.Allocator,
+    // Resolved absolute path -> last seen mtime (polling backend only)
+    paths: std.StringArrayHashMapUnmanaged(i128) = .{},
+    // inotify backend: watch descriptor -> directory
+    inotify_fd: i32 = -1,
+    dirs: std.AutoHashMapUnmanaged(i32, []u8) = .{},
+
+    pub fn init(allocator: std.mem.Allocator) !Watcher {
+        var watcher = Watcher{ .allocator = allocator };
+        if (use_inotify) {
+            watcher.inotify_fd = try std.posix.inotify_init1(linux.IN.CLOEXEC | linux.IN.NONBLOCK);
+        }
+        return watcher;
+    }
+
+    pub fn deinit(self: *Watcher) void {
+        for (self.paths.keys()) |p| self.allocator.free(p);
+        self.paths.deinit(self.allocator);
+        var it = self.dirs.valueIterator();
+        while (it.next()) |dir| self.allocator.free(dir.*);
+        self.dirs.deinit(self.allocator);
+        if (self.inotify_fd >= 0) std.posix.close(self.inotify_fd);
+    }
+
+    pub fn count(self: *const Watcher) usize {
+        return self.paths.count();
+    }
+
+    /// Watch `path`. Returns the resolved absolute path; `wait` reports
+    /// changes with this same slice, which stays valid until `deinit`.
+    pub fn add(self: *Watcher, path: []const u8) ![]const u8 {
+        const resolved = try std.fs.path.resolve(self.allocator, &.{path});
+        const gop = self.paths.getOrPut(self.allocator, resolved) catch |err| {
+            self.allocator.free(resolved);
+            return err;
+        };
+        if (gop.found_existing) {
+            self.allocator.free(resolved);
+            return gop.key_ptr.*;
+        }
+        gop.value_ptr.* = mtime(resolved);
+
+        if (use_inotify) try self.watchDir(std.fs.path.dirname(resolved) orelse "/");
+        return resolved;
+    }
+
+    fn watchDir(self: *Watcher, dir: []const u8) !void {
+        const mask = linux.IN.CLOSE_WRITE | linux.IN.MOVED_TO | linux.IN.CREATE | linux.IN.DELETE;
+        const wd = try std.posix.inotify_add_watch(self.inotify_fd, dir, mask);
+        // Adding the same directory again returns the existing descriptor
+        if (self.dirs.contains(wd)) return;
+        const owned = try self.allocator.dupe(u8, dir);
+        errdefer self.allocator.free(owned);
+        try self.dirs.put(self.allocator, wd, owned);
+    }
+
+    /// Block until at least one watched file changes, then append every
+    /// changed path (as returned by `add`) to `changed`
+    pub fn wait(self: *Watcher, changed: *std.ArrayList([]const u8)) !void {
+        if (use_inotify) return self.waitInotify(changed);
+        return self.waitPoll(changed);
+    }
+
+    fn waitInotify(self: *Watcher, changed: *std.ArrayList([]const u8)) !void {
+        var fds = [_]std.posix.pollfd{.{ .fd = self.inotify_fd, .events = std.posix.POLL.IN, .revents = 0 }};
+        var timeout: i32 = -1; // block for the first event, then debounce
+        while (true) {
+            const ready = try std.posix.poll(&fds, timeout);
+            if (ready == 0) {
+                if (changed.items.len > 0) return;
+                timeout = -1;
+                continue;
+            }
+            try self.drainEvents(changed);
+            timeout = DEBOUNCE_MS;
+        }
+    }
+
+    fn drainEvents(self: *Watcher, changed: *std.ArrayList([]const u8)) !void {
+        var buf: [4096]u8 align(@alignOf(linux.inotify_event)) = undefined;
+        while (true) {
+            const n = std.posix.read(self.inotify_fd, &buf) catch |err| switch (err) {
+                error.WouldBlock => return,
+                else => return err,
+            };
+            if (n == 0) return;
+
+            var offset: usize = 0;
+            while (offset + @sizeOf(linux.inotify_event) <= n) {
+                const event: *const linux.inotify_event = @ptrCast(@alignCast(&buf[offset]));
+                offset += @sizeOf(linux.inotify_event) + event.len;
+
+                const dir = self.dirs.get(event.wd) orelse continue;
+                const name = event.getName() orelse continue;
+
+                var path_buf: [std.fs.max_path_bytes]u8 = undefined;
+                const sep = if (std.mem.endsWith(u8, dir, "/")) "" else "/";
+                const full = std.fmt.bufPrint(&path_buf, "{s}{s}{s}", .{ dir, sep, name }) catch continue;
+                const key = self.paths.getKey(full) orelse continue;
+                try appendUnique(self.allocator, changed, key);
+            }
+        }
+    }
+
+    fn waitPoll(self: *Watcher, changed: *std.ArrayList([]const u8)) !void {
+        while (true) {
+            std.Thread.sleep(POLL_INTERVAL_MS * std.time.ns_per_ms);
+            for (self.paths.keys(), self.paths.values()) |path, *last| {
+                const now = mtime(path);
+                if (now != last.*) {
+                    last.* = now;
+                    try appendUnique(self.allocator, changed, path);
+                }
+            }
+            if (changed.items.len > 0) return;
+        }
+    }
+};
+
+fn appendUnique(allocator: std.mem.Allocator, list: *std.ArrayList([]const u8), path: []const u8) !void {
+    for (list.items) |existing| {
+        if (existing.ptr == path.ptr) return;
+    }
+    try list.append(allocator, path);
+}
+
+/// Modification time, or 0 when the file does not exist
+fn mtime(path: []const u8) i128 {
+    const stat = std.fs.cwd().statFile(path) catch return 0;
+    return stat.mtime;
+}
+
+test "Watcher reports a rewritten file" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "input.erb", .data = "one" });
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const file_path = try std.fs.path.join(allocator, &.{ dir_path, "input.erb" });
+    defer allocator.free(file_path);
+
+    var watcher = try Watcher.init(allocator);
+    defer watcher.deinit();
+    const key = try watcher.add(file_path);
+    try std.testing.expectEqual(key.ptr, (try watcher.add(file_path)).ptr);
+
+    // Make sure the polling backend sees a different mtime
+    std.Thread.sleep(10 * std.time.ns_per_ms);
+    try tmp.dir.writeFile(.{ .sub_path = "unrelated", .data = "x" });
+    try tmp.dir.writeFile(.{ .sub_path = "input.erb", .data = "two" });
+
+    var changed = std.ArrayList([]const u8).empty;
+    defer changed.deinit(allocator);
+    try watcher.wait(&changed);
+
+    try std.testing.expectEqual(@as(usize, 1), changed.items.len);
+    try std.testing.expectEqualStrings(file_path, changed.items[0]);
+}
@@ -0,0 +1,345 @@
+//! File checksums for remote_file verification and download checks.
+//!
+//! Checksums are written as `<algorithm>:<hex>` ("sha256:…", "blake3:…");
+//! bare hex is SHA-256, matching the checksum property's historical meaning.
+//!
+//! Large files are mmap'd and hashed in place. SHA-256 uses the std
+//! implementation, which compiles to SHA-NI / ARMv8 crypto instructions when
+//! the target CPU has them. BLAKE3 hashes multi-GB files on several threads
+//! (see hashing/blake3.zig). Digests are memoized per (path, inode, size,
+//! mtime), so checking the same unchanged file twice in a run reads it once.
+//! For change detection (`hashFile`), files hola wrote with a content
+//! fingerprint attribute (see xattr_fingerprint.zig) are not read at all.
+//! Anyone who can write the file can also write that attribute, so pinned
+//! checksums (`verifyFile`, `hashFiles`) never trust it and always use a
+//! digest of the content computed by this process.
+
+const std = @import("std");
+const blake3 = @import("hashing/blake3.zig");
+const xattr_fingerprint = @import("xattr_fingerprint.zig");
+
+pub const Algorithm = enum {
+    sha256,
+    blake3,
+};
+
+pub const Digest = [32]u8;
+
+/// Files at least this large are mmap'd instead of read
+const mmap_threshold = 1024 * 1024;
+const read_buffer_size = 256 * 1024;
+/// Memo entries kept before the memo is cleared
+const memo_capacity = 4096;
+
+pub const Checksum = struct {
+    algorithm: Algorithm,
+    digest: Digest,
+
+    /// Parse "sha256:<hex>", "blake3:<hex>" or bare SHA-256 hex (any case)
+    pub fn parse(text: []const u8) !Checksum {
+        const trimmed = std.mem.trim(u8, text, " \t\r\n");
+        var algorithm: Algorithm = .sha256;
+        var hex = trimmed;
+        if (std.mem.indexOfScalar(u8, trimmed, ':')) |colon| {
+            const name = trimmed[0..colon];
+            if (std.ascii.eqlIgnoreCase(name, "sha256")) {
+                algorithm = .sha256;
+            } else if (std.ascii.eqlIgnoreCase(name, "blake3")) {
+                algorithm = .blake3;
+            } else {
+                return error.UnsupportedChecksumAlgorithm;
+            }
+            hex = trimmed[colon + 1 ..];
+        }
+
+        if (hex.len != 2 * @sizeOf(Digest)) return error.InvalidChecksum;
+        var checksum = Checksum{ .algorithm = algorithm, .digest = undefined };
+        _ = std.fmt.hexToBytes(&checksum.digest, hex) catch return error.InvalidChecksum;
+        return checksum;
+    }
+
+    pub fn matches(self: Checksum, digest: Digest) bool {
+        return std.mem.eql(u8, &self.digest, &digest);
+    }
+};
+
+/// Display name used in mismatch messages
+pub fn algorithmLabel(algorithm: Algorithm) []const u8 {
+    return switch (algorithm) {
+        .sha256 => "SHA256",
+        .blake3 => "BLAKE3",
+    };
+}
+
+/// Kind of xattr fingerprint that records a content digest of `algorithm`
+pub fn fingerprintKind(algorithm: Algorithm) xattr_fingerprint.Kind {
+    return switch (algorithm) {
+        .sha256 => .sha256,
+        .blake3 => .blake3,
+    };
+}
+
+pub fn toHex(digest: Digest) [2 * @sizeOf(Digest)]u8 {
+    return std.fmt.bytesToHex(digest, .lower);
+}
+
+/// Digest of `data` in memory, using up to `threads` threads for BLAKE3
+pub fn hashBytes(data: []const u8, algorithm: Algorithm, threads: usize) Digest {
+    var digest: Digest = undefined;
+    switch (algorithm) {
+        .sha256 => std.crypto.hash.sha2.Sha256.hash(data, &digest, .{}),
+        .blake3 => digest = blake3.hash(data, threads),
+    }
+    return digest;
+}
+
+/// Where a digest may come from besides hashing the content now
+const Source = enum {
+    /// Memo or xattr fingerprint record: fine for noticing changes
+    any,
+    /// Memo only, i.e. content this process hashed; for pinned checksums
+    content,
+};
+
+/// Digest of the file at `path`, for change detection
+pub fn hashFile(path: []const u8, algorithm: Algorithm) !Digest {
+    return hashFileWith(path, algorithm, true, .any);
+}
+
+/// Hash the file with `expected`'s algorithm. Returns null on a match,
+/// otherwise the actual digest.
+pub fn verifyFile(path: []const u8, expected: Checksum) !?Digest {
+    const actual = try hashFileWith(path, expected.algorithm, true, .content);
+    return if (expected.matches(actual)) null else actual;
+}
+
+fn hashFileWith(path: []const u8, algorithm: Algorithm, parallel: bool, source: Source) !Digest {
+    const file = try std.fs.cwd().openFile(path, .{});
+    defer file.close();
+    const stat = try file.stat();
+
+    const key = MemoKey{
+        .path_hash = std.hash.Wyhash.hash(0, path),
+        .inode = @intCast(stat.inode),
+        .size = stat.size,
+        .mtime = stat.mtime,
+        .algorithm = algorithm,
+    };
+    if (memoGet(key)) |digest| return digest;
+    if (source == .any) {
+        if (xattr_fingerprint.load(file, stat)) |record| {
+            if (record.kind == fingerprintKind(algorithm)) return record.digest;
+        }
+    }
+
+    const digest = try hashOpenFile(file, stat.size, algorithm, if (parallel) threadsFor(stat.size) else 1);
+    memoPut(key, digest);
+    return digest;
+}
+
+fn threadsFor(size: u64) usize {
+    const cpus = std.Thread.getCpuCount() catch 1;
+    const by_size: usize = @intCast(@min(size / blake3.min_bytes_per_thread, std.math.maxInt(u16)));
+    return @max(1, @min(cpus, by_size));
+}
+
+fn hashOpenFile(file: std.fs.File, size: u64, algorithm: Algorithm, threads: usize) !Digest {
+    if (size >= mmap_threshold and size <= std.math.maxInt(usize)) {
+        if (std.posix.mmap(null, @intCast(size), std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0)) |mapped| {
+            defer std.posix.munmap(mapped);
+            std.posix.madvise(mapped.ptr, mapped.len, std.posix.MADV.SEQUENTIAL) catch {};
+            return hashBytes(mapped, algorithm, threads);
+        } else |_| {
+            // Fall back to reading (e.g. special files that cannot be mapped)
+        }
+    }
+    return hashStream(file, algorithm);
+}
+
+fn hashStream(file: std.fs.File, algorithm: Algorithm) !Digest {
+    const buf = try std.heap.page_allocator.alloc(u8, read_buffer_size);
+    defer std.heap.page_allocator.free(buf);
+
+    var digest: Digest = undefined;
+    switch (algorithm) {
+        inline else => |tag| {
+            const Hasher = switch (tag) {
+                .sha256 => std.crypto.hash.sha2.Sha256,
+                .blake3 => std.crypto.hash.Blake3,
+            };
+            var hasher = Hasher.init(.{});
+            while (true) {
+                const n = try file.read(buf);
+                if (n == 0) break;
+                hasher.update(buf[0..n]);
+            }
+            hasher.final(&digest);
+        },
+    }
+    return digest;
+}
+
+const MemoKey = struct {
+    path_hash: u64,
+    inode: u64,
+    size: u64,
+    mtime: i128,
+    algorithm: Algorithm,
+};
+
+var memo_mutex: std.Thread.Mutex = .{};
+var memo: std.AutoHashMapUnmanaged(MemoKey, Digest) = .{};
+
+fn memoGet(key: MemoKey) ?Digest {
+    memo_mutex.lock();
+    defer memo_mutex.unlock();
+    return memo.get(key);
+}
+
+fn memoPut(key: MemoKey, digest: Digest) void {
+    memo_mutex.lock();
+    defer memo_mutex.unlock();
+    if (memo.count() >= memo_capacity) memo.clearRetainingCapacity();
+    // Best effort: without memory the file is simply hashed again next time
+    memo.put(std.heap.page_allocator, key, digest) catch {};
+}
+
+pub const BatchItem = struct {
+    path: []const u8,
+    algorithm: Algorithm,
+    result: anyerror!Digest = error.NotHashed,
+};
+
+/// Hash every item's file for a pinned-checksum check, several files at a
+/// time (bounded by the CPU count). Each item's `result` receives its digest
+/// or error.
+pub fn hashFiles(items: []BatchItem) void {
+    if (items.len == 0) return;
+
+    const Shared = struct {
+        items: []BatchItem,
+        next: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+        parallel_per_file: bool,
+
+        fn work(self: *@This()) void {
+            while (true) {
+                const i = self.next.fetchAdd(1, .monotonic);
+                if (i >= self.items.len) return;
+                const item = &self.items[i];
+                item.result = hashFileWith(item.path, item.algorithm, self.parallel_per_file, .content);
+            }
+        }
+    };
+
+    const cpus = std.Thread.getCpuCount() catch 1;
+    const workers = @min(cpus, items.len);
+    // A single file may still use all cores for BLAKE3 tree hashing
+    var shared = Shared{ .items = items, .parallel_per_file = workers == 1 };
+
+    var threads: [64]std.Thread = undefined;
+    var spawned: usize = 0;
+    while (spawned + 1 < workers and spawned < threads.len) : (spawned += 1) {
+        threads[spawned] = std.Thread.spawn(.{}, Shared.work, .{&shared}) catch break;
+    }
+    shared.work();
+    for (threads[0..spawned]) |t| t.join();
+}
+
+test "Checksum.parse accepts prefixed and bare hex" {
+    const hex = "E3B0C44298FC1C149AFBF4C8996FB92427AE41E4649B934CA495991B7852B855";
+
+    const bare = try Checksum.parse(hex);
+    try std.testing.expectEqual(Algorithm.sha256, bare.algorithm);
+    try std.testing.expectEqual(@as(u8, 0xe3), bare.digest[0]);
+
+    const prefixed = try Checksum.parse("BLAKE3:" ++ hex);
+    try std.testing.expectEqual(Algorithm.blake3, prefixed.algorithm);
+    try std.testing.expectEqualSlices(u8, &bare.digest, &prefixed.digest);
+
+    try std.testing.expectError(error.UnsupportedChecksumAlgorithm, Checksum.parse("md5:" ++ hex));
+    try std.testing.expectError(error.InvalidChecksum, Checksum.parse("abc"));
+}
+
+test "hashFile matches in-memory digests and notices rewrites" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "small", .data = "hello" });
+    const large = try allocator.alloc(u8, mmap_threshold + 4097);
+    defer allocator.free(large);
+    for (large, 0..) |*byte, i| byte.* = @truncate(i *% 31);
+    try tmp.dir.writeFile(.{ .sub_path = "large", .data = large });
+
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const small_path = try std.fs.path.join(allocator, &.{ dir_path, "small" });
+    defer allocator.free(small_path);
+    const large_path = try std.fs.path.join(allocator, &.{ dir_path, "large" });
+    defer allocator.free(large_path);
+
+    for ([_]Algorithm{ .sha256, .blake3 }) |algorithm| {
+        try std.testing.expectEqualSlices(u8, &hashBytes("hello", algorithm, 1), &try hashFile(small_path, algorithm));
+        try std.testing.expectEqualSlices(u8, &hashBytes(large, algorithm, 1), &try hashFile(large_path, algorithm));
+    }
+
+    // A different size is a different memo key
+    try tmp.dir.writeFile(.{ .sub_path = "small", .data = "hello!" });
+    try std.testing.expectEqualSlices(u8, &hashBytes("hello!", .sha256, 1), &try hashFile(small_path, .sha256));
+
+    const expected = Checksum{ .algorithm = .sha256, .digest = hashBytes("hello!", .sha256, 1) };
+    try std.testing.expectEqual(@as(?Digest, null), try verifyFile(small_path, expected));
+}
+
+test "verifyFile ignores a forged fingerprint attribute" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "pinned", .data = "payload" });
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+    const path = try std.fs.path.join(allocator, &.{ dir_path, "pinned" });
+    defer allocator.free(path);
+
+    // Claim the file holds other content; best effort, so filesystems
+    // without user xattrs simply skip the forgery
+    const forged = hashBytes("expected", .blake3, 1);
+    xattr_fingerprint.storePath(path, .{ .kind = .blake3, .digest = forged });
+
+    const actual = try verifyFile(path, .{ .algorithm = .blake3, .digest = forged });
+    try std.testing.expect(actual != null);
+    try std.testing.expectEqualSlices(u8, &hashBytes("payload", .blake3, 1), &actual.?);
+}
+
+test "hashFiles reports per-item results" {
+    const allocator = std.testing.allocator;
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const dir_path = try tmp.dir.realpathAlloc(allocator, ".");
+    defer allocator.free(dir_path);
+
+    var paths = std.ArrayList([]u8).empty;
+    defer {
+        for (paths.items) |path| allocator.free(path);
+        paths.deinit(allocator);
+    }
+    var items: [6]BatchItem = undefined;
+    var name_buf: [16]u8 = undefined;
+    for (0..5) |i| {
+        const name = try std.fmt.bufPrint(&name_buf, "f{d}", .{i});
+        try tmp.dir.writeFile(.{ .sub_path = name, .data = name });
+        try paths.append(allocator, try std.fs.path.join(allocator, &.{ dir_path, name }));
+        items[i] = .{ .path = paths.items[i], .algorithm = if (i % 2 == 0) .sha256 else .blake3 };
+    }
+    items[5] = .{ .path = "/nonexistent/hola-hash-test", .algorithm = .sha256 };
+
+    hashFiles(&items);
+
+    for (items[0..5], 0..) |item, i| {
+        const name = try std.fmt.bufPrint(&name_buf, "f{d}", .{i});
+        try std.testing.expectEqualSlices(u8, &hashBytes(name, item.algorithm, 1), &try item.result);
+    }
+    try std.testing.expectError(error.FileNotFound, items[5].result);
+}
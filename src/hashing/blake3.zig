@@ -0,0 +1,261 @@
+//! Multithreaded BLAKE3 for large in-memory inputs (typically an mmap'd
+//! file).
+//!
+//! BLAKE3 is a binary tree over 1 KiB chunks, so disjoint subtrees can be
+//! hashed on different threads and joined with parent nodes. Within a thread,
+//! runs of `lanes` full chunks are compressed together with SIMD vectors.
+//! Output is the default unkeyed 32-byte digest, identical to
+//! `std.crypto.hash.Blake3`.
+
+const std = @import("std");
+
+const chunk_len = 1024;
+const block_len = 64;
+
+const CHUNK_START: u32 = 1 << 0;
+const CHUNK_END: u32 = 1 << 1;
+const PARENT: u32 = 1 << 2;
+const ROOT: u32 = 1 << 3;
+
+const iv = [8]u32{ 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+
+const msg_permutation = [16]u8{ 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+
+/// Message word order for each of the 7 rounds
+const msg_schedule: [7][16]u8 = blk: {
+    var schedule: [7][16]u8 = undefined;
+    for (0..16) |i| schedule[0][i] = @intCast(i);
+    for (1..7) |r| {
+        for (0..16) |i| schedule[r][i] = schedule[r - 1][msg_permutation[i]];
+    }
+    break :blk schedule;
+};
+
+const lanes = std.simd.suggestVectorLength(u32) orelse 4;
+const Lanes = @Vector(lanes, u32);
+
+/// Below this, a subtree is not worth a thread of its own
+pub const min_bytes_per_thread = 1024 * 1024;
+
+const Cv = [8]u32;
+
+fn rotr(comptime T: type, x: T, comptime n: u5) T {
+    if (T == u32) {
+        return std.math.rotr(u32, x, n);
+    } else {
+        const right: @Vector(lanes, u5) = @splat(n);
+        const left: @Vector(lanes, u5) = @splat(32 - @as(u6, n));
+        return (x >> right) | (x << left);
+    }
+}
+
+fn g(comptime T: type, s: *[16]T, comptime a: usize, comptime b: usize, comptime c: usize, comptime d: usize, mx: T, my: T) void {
+    s[a] = s[a] +% s[b] +% mx;
+    s[d] = rotr(T, s[d] ^ s[a], 16);
+    s[c] = s[c] +% s[d];
+    s[b] = rotr(T, s[b] ^ s[c], 12);
+    s[a] = s[a] +% s[b] +% my;
+    s[d] = rotr(T, s[d] ^ s[a], 8);
+    s[c] = s[c] +% s[d];
+    s[b] = rotr(T, s[b] ^ s[c], 7);
+}
+
+fn rounds(comptime T: type, s: *[16]T, m: *const [16]T) void {
+    inline for (msg_schedule) |sched| {
+        g(T, s, 0, 4, 8, 12, m[sched[0]], m[sched[1]]);
+        g(T, s, 1, 5, 9, 13, m[sched[2]], m[sched[3]]);
+        g(T, s, 2, 6, 10, 14, m[sched[4]], m[sched[5]]);
+        g(T, s, 3, 7, 11, 15, m[sched[6]], m[sched[7]]);
+        g(T, s, 0, 5, 10, 15, m[sched[8]], m[sched[9]]);
+        g(T, s, 1, 6, 11, 12, m[sched[10]], m[sched[11]]);
+        g(T, s, 2, 7, 8, 13, m[sched[12]], m[sched[13]]);
+        g(T, s, 3, 4, 9, 14, m[sched[14]], m[sched[15]]);
+    }
+}
+
+/// Compression function truncated to the new chaining value (which is
+/// also the first 32 bytes of output for a root node)
+fn compress(cv: Cv, block: *const [16]u32, counter: u64, len: u32, flags: u32) Cv {
+    var s = [16]u32{
+        cv[0],                cv[1],                      cv[2], cv[3],
+        cv[4],                cv[5],                      cv[6], cv[7],
+        iv[0],                iv[1],                      iv[2], iv[3],
+        @truncate(counter), @truncate(counter >> 32), len,   flags,
+    };
+    rounds(u32, &s, block);
+    var out: Cv = undefined;
+    for (0..8) |i| out[i] = s[i] ^ s[i + 8];
+    return out;
+}
+
+fn blockWords(bytes: *const [block_len]u8) [16]u32 {
+    var words: [16]u32 = undefined;
+    for (0..16) |i| words[i] = std.mem.readInt(u32, bytes[4 * i ..][0..4], .little);
+    return words;
+}
+
+/// Chaining value of one (possibly partial, non-empty) chunk
+fn chunkCv(input: []const u8, chunk_counter: u64) Cv {
+    var cv = iv;
+    const blocks = @max(1, (input.len + block_len - 1) / block_len);
+    for (0..blocks) |b| {
+        const start = b * block_len;
+        const end = @min(start + block_len, input.len);
+        var buf = [_]u8{0} ** block_len;
+        @memcpy(buf[0 .. end - start], input[start..end]);
+
+        var flags: u32 = 0;
+        if (b == 0) flags |= CHUNK_START;
+        if (b == blocks - 1) flags |= CHUNK_END;
+        const words = blockWords(&buf);
+        cv = compress(cv, &words, chunk_counter, @intCast(end - start), flags);
+    }
+    return cv;
+}
+
+/// Chaining values of `lanes` consecutive full chunks, one per vector lane
+fn chunkCvsWide(input: *const [lanes * chunk_len]u8, first_counter: u64) [lanes]Cv {
+    var cv: [8]Lanes = undefined;
+    for (0..8) |i| cv[i] = @splat(iv[i]);
+
+    var lo: [lanes]u32 = undefined;
+    var hi: [lanes]u32 = undefined;
+    for (0..lanes) |l| {
+        const counter = first_counter + l;
+        lo[l] = @truncate(counter);
+        hi[l] = @truncate(counter >> 32);
+    }
+    const counter_lo: Lanes = lo;
+    const counter_hi: Lanes = hi;
+
+    for (0..chunk_len / block_len) |b| {
+        var m: [16]Lanes = undefined;
+        for (0..16) |w| {
+            var column: [lanes]u32 = undefined;
+            for (0..lanes) |l| {
+                column[l] = std.mem.readInt(u32, input[l * chunk_len + b * block_len + 4 * w ..][0..4], .little);
+            }
+            m[w] = column;
+        }
+
+        var flags: u32 = 0;
+        if (b == 0) flags |= CHUNK_START;
+        if (b == chunk_len / block_len - 1) flags |= CHUNK_END;
+
+        var s = [16]Lanes{
+            cv[0],         cv[1],         cv[2],         cv[3],
+            cv[4],         cv[5],         cv[6],         cv[7],
+            @splat(iv[0]), @splat(iv[1]), @splat(iv[2]), @splat(iv[3]),
+            counter_lo,    counter_hi,    @splat(block_len), @splat(flags),
+        };
+        rounds(Lanes, &s, &m);
+        for (0..8) |i| cv[i] = s[i] ^ s[i + 8];
+    }
+
+    var out: [lanes]Cv = undefined;
+    for (0..8) |i| {
+        const words: [lanes]u32 = cv[i];
+        for (0..lanes) |l| out[l][i] = words[l];
+    }
+    return out;
+}
+
+fn parentCv(left: Cv, right: Cv, flags: u32) Cv {
+    var block: [16]u32 = undefined;
+    @memcpy(block[0..8], &left);
+    @memcpy(block[8..16], &right);
+    return compress(iv, &block, 0, block_len, PARENT | flags);
+}
+
+/// Bytes in the left subtree of a node covering `len` (> chunk_len) bytes:
+/// the largest power-of-two number of chunks that leaves at least one byte
+/// for the right subtree
+fn leftLen(len: usize) usize {
+    const full_chunks = (len - 1) / chunk_len;
+    return chunk_len * (@as(usize, 1) << std.math.log2_int(usize, full_chunks));
+}
+
+/// Chaining value of the (non-root) subtree over `input`, on this thread
+fn subtreeCv(input: []const u8, chunk_counter: u64) Cv {
+    if (input.len <= chunk_len) return chunkCv(input, chunk_counter);
+
+    if (input.len == lanes * chunk_len) {
+        var cvs = chunkCvsWide(input[0 .. lanes * chunk_len], chunk_counter);
+        var n: usize = lanes;
+        while (n > 1) : (n /= 2) {
+            for (0..n / 2) |i| cvs[i] = parentCv(cvs[2 * i], cvs[2 * i + 1], 0);
+        }
+        return cvs[0];
+    }
+
+    const left = leftLen(input.len);
+    return parentCv(
+        subtreeCv(input[0..left], chunk_counter),
+        subtreeCv(input[left..], chunk_counter + left / chunk_len),
+        0,
+    );
+}
+
+/// Chaining values of the two children of the node over `input`, using up
+/// to `threads` threads
+fn childCvs(input: []const u8, chunk_counter: u64, threads: usize) [2]Cv {
+    const left = leftLen(input.len);
+    const right_counter = chunk_counter + left / chunk_len;
+
+    if (threads > 1 and input.len >= 2 * min_bytes_per_thread) {
+        const right_threads = threads / 2;
+        var right_cv: Cv = undefined;
+        const Worker = struct {
+            fn run(slice: []const u8, counter: u64, n: usize, out: *Cv) void {
+                out.* = parallelCv(slice, counter, n);
+            }
+        };
+        if (std.Thread.spawn(.{}, Worker.run, .{ input[left..], right_counter, right_threads, &right_cv })) |thread| {
+            const left_cv = parallelCv(input[0..left], chunk_counter, threads - right_threads);
+            thread.join();
+            return .{ left_cv, right_cv };
+        } else |_| {}
+    }
+
+    return .{ subtreeCv(input[0..left], chunk_counter), subtreeCv(input[left..], right_counter) };
+}
+
+fn parallelCv(input: []const u8, chunk_counter: u64, threads: usize) Cv {
+    if (input.len <= chunk_len) return chunkCv(input, chunk_counter);
+    const children = childCvs(input, chunk_counter, threads);
+    return parentCv(children[0], children[1], 0);
+}
+
+/// BLAKE3 digest of `input` using up to `threads` threads
+pub fn hash(input: []const u8, threads: usize) [32]u8 {
+    var out: [32]u8 = undefined;
+    if (input.len <= chunk_len) {
+        std.crypto.hash.Blake3.hash(input, &out, .{});
+        return out;
+    }
+
+    const children = childCvs(input, 0, @max(threads, 1));
+    const root = parentCv(children[0], children[1], ROOT);
+    for (root, 0..) |word, i| std.mem.writeInt(u32, out[4 * i ..][0..4], word, .little);
+    return out;
+}
+
+test "hash matches std Blake3 across tree shapes" {
+    const allocator = std.testing.allocator;
+    const max_len = 2 * min_bytes_per_thread + 3 * chunk_len + 17;
+    const input = try allocator.alloc(u8, max_len);
+    defer allocator.free(input);
+    for (input, 0..) |*byte, i| byte.* = @truncate(i % 251);
+
+    const lengths = [_]usize{
+        0,                        1,                    chunk_len - 1,                 chunk_len,
+        chunk_len + 1,            2 * chunk_len,        2 * chunk_len + 1,             lanes * chunk_len,
+        lanes * chunk_len + 1,    31 * chunk_len + 7,   100_000,                       max_len,
+    };
+    for (lengths) |len| {
+        var expected: [32]u8 = undefined;
+        std.crypto.hash.Blake3.hash(input[0..len], &expected, .{});
+        try std.testing.expectEqualSlices(u8, &expected, &hash(input[0..len], 1));
+        try std.testing.expectEqualSlices(u8, &expected, &hash(input[0..len], 4));
+    }
+}
@@ -4,6 +4,7 @@ const types = @import("../types.zig");
 const Task = @import("task.zig").Task;
 const logger = @import("../../logger.zig");
 const utils = @import("../utils.zig");
+const hashing = @import("../../hashing.zig");
 
 const LAST_DOWNLOAD_ERROR_BUF_SIZE = 1024;
 threadlocal var last_download_error_buf: [LAST_DOWNLOAD_ERROR_BUF_SIZE]u8 = undefined;
@@ -351,32 +352,20 @@ fn taskProgressCallback(downloaded: usize, total: usize, context: *anyopaque) vo
     task.updateProgress(downloaded, total);
 }
 
-/// Verify file checksum (SHA256)
+/// Verify file checksum ("sha256:<hex>", "blake3:<hex>" or bare SHA256 hex)
 pub fn verifyChecksum(_: std.mem.Allocator, file_path: []const u8, expected: []const u8) !void {
-    const file = try std.fs.cwd().openFile(file_path, .{});
-    defer file.close();
-
-    var hasher = std.crypto.hash.sha2.Sha256.init(.{});
-    var buf: [8192]u8 = undefined;
-
-    while (true) {
-        const n = try file.read(&buf);
-        if (n == 0) break;
-        hasher.update(buf[0..n]);
-    }
-
-    var digest: [32]u8 = undefined;
-    hasher.final(&digest);
-
-    // Convert to hex
-    const hex = std.fmt.bytesToHex(digest, .lower);
+    const checksum = hashing.Checksum.parse(expected) catch |err| {
+        recordLastDownloadError("invalid checksum for {s}: {s}", .{ file_path, expected });
+        return err;
+    };
 
-    // Compare
-    if (!std.mem.eql(u8, &hex, expected)) {
+    if (try hashing.verifyFile(file_path, checksum)) |actual| {
+        const hex = hashing.toHex(actual);
+        const label = hashing.algorithmLabel(checksum.algorithm);
         logger.err("Checksum mismatch: expected {s}, got {s}", .{ expected, hex });
         recordLastDownloadError(
-            "checksum mismatch for {s}: expected SHA256 {s}, got {s}",
-            .{ file_path, expected, &hex },
+            "checksum mismatch for {s}: expected {s} {s}, got {s}",
+            .{ file_path, label, expected, &hex },
         );
         return error.ChecksumMismatch;
     }
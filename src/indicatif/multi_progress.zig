@@ -2,18 +2,45 @@ const std = @import("std");
 const ProgressBar = @import("progress_bar.zig").ProgressBar;
 
 /// MultiProgress manages multiple progress bars
+///
+/// Rendering is frame-rate limited: `draw()` may be called as often as
+/// callers like, but at most one frame per `frame_interval_ns` reaches the
+/// terminal, and only lines whose content changed since the previous frame
+/// are rewritten. A throttled `draw()` marks its frame pending; the owner's
+/// periodic tick (`draw()` or `drawPending()`) emits it once the interval
+/// has passed, and `flush()` is only needed for the final frame. When stderr
+/// is not a TTY there is no animation; each bar is printed once, as a plain
+/// line, when it finishes.
 pub const MultiProgress = struct {
     allocator: std.mem.Allocator,
     bars: std.ArrayList(*ProgressBar) = .{},
     mutex: std.Thread.Mutex = .{},
     draw_enabled: bool = true,
     last_total_lines: usize = 0,
+    is_tty: bool,
+    frame_interval_ns: u64 = default_frame_interval_ns,
+    last_frame_ns: i128 = 0,
+    // A throttled draw() skipped a frame that is not on screen yet
+    pending: bool = false,
+
+    // Buffers reused across frames
+    output: std.ArrayList(u8) = .{},
+    frame: std.ArrayList(u8) = .{},
+    frame_ends: std.ArrayList(usize) = .{},
+    prev_frame: std.ArrayList(u8) = .{},
+    prev_ends: std.ArrayList(usize) = .{},
+    // Bars already printed in non-TTY mode
+    printed: std.AutoHashMapUnmanaged(*ProgressBar, void) = .{},
 
     const Self = @This();
 
+    /// 20 frames per second
+    pub const default_frame_interval_ns: u64 = 50 * std.time.ns_per_ms;
+
     pub fn init(allocator: std.mem.Allocator) Self {
         return .{
             .allocator = allocator,
+            .is_tty = std.posix.isatty(std.posix.STDERR_FILENO),
         };
     }
 
@@ -23,6 +50,17 @@ pub const MultiProgress = struct {
             bar.deinit();
         }
         self.bars.deinit(self.allocator);
+        self.releaseBuffers();
+    }
+
+    /// Free the frame buffers without touching the bars
+    pub fn releaseBuffers(self: *Self) void {
+        self.output.deinit(self.allocator);
+        self.frame.deinit(self.allocator);
+        self.frame_ends.deinit(self.allocator);
+        self.prev_frame.deinit(self.allocator);
+        self.prev_ends.deinit(self.allocator);
+        self.printed.deinit(self.allocator);
     }
 
     /// Add a progress bar to the multi-progress
@@ -43,6 +81,7 @@ pub const MultiProgress = struct {
         for (self.bars.items, 0..) |b, i| {
             if (b == bar) {
                 _ = self.bars.orderedRemove(i);
+                _ = self.printed.remove(bar);
                 bar.draw_enabled = true;
                 break;
             }
@@ -65,66 +104,156 @@ pub const MultiProgress = struct {
         }
     }
 
+    /// Render every bar into `frame`, one line per bar
+    fn renderFrame(self: *Self) !void {
+        self.frame.clearRetainingCapacity();
+        self.frame_ends.clearRetainingCapacity();
+
+        const writer = self.frame.writer(self.allocator);
+        for (self.bars.items) |bar| {
+            try bar.style.format(bar.state, bar.width, writer);
+            try self.frame_ends.append(self.allocator, self.frame.items.len);
+        }
+    }
+
+    fn frameLine(buf: []const u8, ends: []const usize, i: usize) []const u8 {
+        const start = if (i == 0) 0 else ends[i - 1];
+        return buf[start..ends[i]];
+    }
+
+    /// Append cursor movement from row `from` to the start of row `to`
+    /// (rows are relative to the first line of the drawing area)
+    fn moveCursor(writer: anytype, from: usize, to: usize) !void {
+        if (to < from) {
+            try writer.print("\x1b[{d}F", .{from - to});
+        } else if (to > from) {
+            try writer.print("\x1b[{d}E", .{to - from});
+        }
+    }
+
     /// Draw all progress bars (internal, no lock)
     fn drawInternal(self: *Self) !void {
         if (!self.draw_enabled) return;
+        if (!self.is_tty) return self.printFinished();
 
-        // Build the entire output in a single buffer to ensure atomic write
-        var output_buffer = std.ArrayList(u8){};
-        defer output_buffer.deinit(self.allocator);
+        self.output.clearRetainingCapacity();
+        try self.appendFrame();
+
+        // Single atomic write to terminal
+        if (self.output.items.len > 0) writeStderr(self.output.items);
+    }
 
-        const writer = output_buffer.writer(self.allocator);
+    /// Append to `output` the escape sequences that turn the previous frame
+    /// into the current one, rewriting only lines whose content changed
+    fn appendFrame(self: *Self) !void {
+        try self.renderFrame();
+        const writer = self.output.writer(self.allocator);
+
+        // Cursor sits at the start of the line below the drawing area
+        const prev_count = self.last_total_lines;
+        const new_count = self.bars.items.len;
+        var cursor: usize = prev_count;
+
+        for (0..new_count) |i| {
+            const line = frameLine(self.frame.items, self.frame_ends.items, i);
+            if (i < prev_count and i < self.prev_ends.items.len and
+                std.mem.eql(u8, line, frameLine(self.prev_frame.items, self.prev_ends.items, i)))
+            {
+                continue;
+            }
 
-        // Move cursor up to the start of our drawing area
-        if (self.last_total_lines > 0) {
-            try writer.print("\x1b[{d}F", .{self.last_total_lines});
+            try moveCursor(writer, cursor, i);
+            try writer.print("\x1b[K{s}\n", .{line});
+            cursor = i + 1;
         }
 
-        // Pre-allocate buffer for individual bar rendering
-        var bar_buffer: std.ArrayList(u8) = .{};
-        defer bar_buffer.deinit(self.allocator);
-        try bar_buffer.ensureTotalCapacity(self.allocator, 512);
+        // Blank out lines left over from a taller previous frame, then
+        // return to the line below the (now shorter) drawing area
+        if (new_count < prev_count) {
+            try moveCursor(writer, cursor, new_count);
+            for (new_count..prev_count) |_| try writer.writeAll("\x1b[K\n");
+            cursor = prev_count;
+        }
+        try moveCursor(writer, cursor, new_count);
 
-        // Draw each progress bar
-        var total_lines: usize = 0;
-        for (self.bars.items) |bar| {
-            bar_buffer.clearRetainingCapacity();
+        self.last_total_lines = new_count;
+        std.mem.swap(std.ArrayList(u8), &self.frame, &self.prev_frame);
+        std.mem.swap(std.ArrayList(usize), &self.frame_ends, &self.prev_ends);
+    }
 
-            try bar.style.format(bar.state, bar.width, bar_buffer.writer(self.allocator));
-            try writer.print("\x1b[K{s}\n", .{bar_buffer.items});
+    /// Non-TTY output: print each finished bar once, in order
+    fn printFinished(self: *Self) !void {
+        self.output.clearRetainingCapacity();
+        const writer = self.output.writer(self.allocator);
 
-            total_lines += 1;
+        for (self.bars.items) |bar| {
+            if (!bar.isFinished() or self.printed.contains(bar)) continue;
+            try bar.style.format(bar.state, bar.width, writer);
+            try writer.writeByte('\n');
+            try self.printed.put(self.allocator, bar, {});
         }
 
-        // If we drew fewer lines than before, clear the remaining lines
-        while (total_lines < self.last_total_lines) {
-            try writer.writeAll("\x1b[K\n");
-            total_lines += 1;
-        }
+        if (self.output.items.len > 0) writeStderr(self.output.items);
+    }
 
-        self.last_total_lines = self.bars.items.len;
+    /// Forget the previous frame so the next draw rewrites every line
+    fn invalidateFrame(self: *Self) void {
+        self.prev_frame.clearRetainingCapacity();
+        self.prev_ends.clearRetainingCapacity();
+    }
 
-        // Single atomic write to terminal
-        std.debug.print("{s}", .{output_buffer.items});
+    fn writeStderr(bytes: []const u8) void {
+        std.debug.lockStdErr();
+        defer std.debug.unlockStdErr();
+        std.fs.File.stderr().writeAll(bytes) catch {};
     }
 
-    /// Draw all progress bars
+    /// Draw all progress bars, unless a frame was drawn less than
+    /// `frame_interval_ns` ago
     pub fn draw(self: *Self) !void {
         self.mutex.lock();
         defer self.mutex.unlock();
+
+        try self.drawThrottled();
+    }
+
+    /// Draw the frame a throttled `draw()` skipped, once `frame_interval_ns`
+    /// has passed; does nothing when no frame is pending
+    pub fn drawPending(self: *Self) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (!self.pending) return;
+        try self.drawThrottled();
+    }
+
+    fn drawThrottled(self: *Self) !void {
+        const now = std.time.nanoTimestamp();
+        if (now - self.last_frame_ns < self.frame_interval_ns) {
+            self.pending = true;
+            return;
+        }
+        self.last_frame_ns = now;
+        self.pending = false;
+
         try self.drawInternal();
     }
 
-    /// Clear all progress bars from the terminal (internal, no lock)
-    fn clearInternal(self: *Self) !void {
-        if (!self.draw_enabled) return;
+    /// Draw all progress bars now, regardless of the frame rate limit
+    pub fn flush(self: *Self) !void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
 
-        if (self.last_total_lines > 0) {
-            // Build the entire clear sequence in a single buffer
-            var output_buffer = std.ArrayList(u8){};
-            defer output_buffer.deinit(self.allocator);
+        self.last_frame_ns = std.time.nanoTimestamp();
+        self.pending = false;
+        try self.drawInternal();
+    }
 
-            const writer = output_buffer.writer(self.allocator);
+    /// Append the sequence that blanks the drawing area and leaves the
+    /// cursor at its first line
+    fn appendClear(self: *Self) !void {
+        if (self.last_total_lines > 0) {
+            const writer = self.output.writer(self.allocator);
 
             // Move cursor up
             try writer.print("\x1b[{d}F", .{self.last_total_lines});
@@ -137,12 +266,21 @@ pub const MultiProgress = struct {
 
             // Move cursor back up
             try writer.print("\x1b[{d}F", .{self.last_total_lines});
-
-            // Single atomic write
-            std.debug.print("{s}", .{output_buffer.items});
         }
 
         self.last_total_lines = 0;
+        self.invalidateFrame();
+    }
+
+    /// Clear all progress bars from the terminal (internal, no lock)
+    fn clearInternal(self: *Self) !void {
+        if (!self.draw_enabled or !self.is_tty) return;
+
+        self.output.clearRetainingCapacity();
+        try self.appendClear();
+
+        // Single atomic write
+        if (self.output.items.len > 0) writeStderr(self.output.items);
     }
 
     /// Clear all progress bars from the terminal
@@ -157,51 +295,23 @@ pub const MultiProgress = struct {
         self.mutex.lock();
         defer self.mutex.unlock();
 
-        // Build the entire sequence (clear + message + redraw) in a single buffer
-        var output_buffer = std.ArrayList(u8){};
-        defer output_buffer.deinit(self.allocator);
-
-        const writer = output_buffer.writer(self.allocator);
+        self.output.clearRetainingCapacity();
 
-        // 1. Clear sequence
-        if (self.last_total_lines > 0) {
-            try writer.print("\x1b[{d}F", .{self.last_total_lines});
-            var i: usize = 0;
-            while (i < self.last_total_lines) : (i += 1) {
-                try writer.writeAll("\x1b[K\n");
-            }
-            try writer.print("\x1b[{d}F", .{self.last_total_lines});
-        }
-
-        // 2. Print message
-        try writer.print("{s}\n", .{msg});
-
-        // 3. Redraw all bars
-        if (self.last_total_lines > 0) {
-            try writer.print("\x1b[{d}F", .{self.last_total_lines});
+        if (!self.is_tty or !self.draw_enabled) {
+            try self.output.writer(self.allocator).print("{s}\n", .{msg});
+            writeStderr(self.output.items);
+            return;
         }
 
-        var bar_buffer: std.ArrayList(u8) = .{};
-        defer bar_buffer.deinit(self.allocator);
-        try bar_buffer.ensureTotalCapacity(self.allocator, 512);
-
-        var total_lines: usize = 0;
-        for (self.bars.items) |bar| {
-            bar_buffer.clearRetainingCapacity();
-            try bar.style.format(bar.state, bar.width, bar_buffer.writer(self.allocator));
-            try writer.print("\x1b[K{s}\n", .{bar_buffer.items});
-            total_lines += 1;
-        }
-
-        while (total_lines < self.last_total_lines) {
-            try writer.writeAll("\x1b[K\n");
-            total_lines += 1;
-        }
-
-        self.last_total_lines = self.bars.items.len;
+        // Build the entire sequence (clear + message + redraw) in a single buffer
+        try self.appendClear();
+        try self.output.writer(self.allocator).print("{s}\n", .{msg});
+        try self.appendFrame();
+        self.last_frame_ns = std.time.nanoTimestamp();
+        self.pending = false;
 
         // Single atomic write
-        std.debug.print("{s}", .{output_buffer.items});
+        writeStderr(self.output.items);
     }
 
     /// Join all bars (wait for them to finish)
@@ -223,6 +333,7 @@ pub const MultiProgress = struct {
             std.time.sleep(50 * std.time.ns_per_ms);
             self.draw() catch {};
         }
+        self.flush() catch {};
     }
 
     /// Create and add a new progress bar
@@ -239,3 +350,71 @@ pub const MultiProgress = struct {
         return bar;
     }
 };
+
+fn testBar(mp: *MultiProgress, msg: []const u8) !*ProgressBar {
+    const bar = try mp.addSpinner();
+    bar.setStyle(try @import("progress_style.zig").ProgressStyle.withTemplate(std.testing.allocator, "{msg}"));
+    bar.setMessage(msg);
+    return bar;
+}
+
+test "frames rewrite only the lines that changed" {
+    var mp = MultiProgress.init(std.testing.allocator);
+    mp.is_tty = true;
+    defer {
+        // Nothing was written to the terminal, so there is nothing to clear
+        mp.is_tty = false;
+        mp.deinit();
+    }
+
+    _ = try testBar(&mp, "a");
+    const b = try testBar(&mp, "b");
+
+    mp.output.clearRetainingCapacity();
+    try mp.appendFrame();
+    try std.testing.expectEqualStrings("\x1b[Ka\n\x1b[Kb\n", mp.output.items);
+
+    // An unchanged frame writes nothing
+    mp.output.clearRetainingCapacity();
+    try mp.appendFrame();
+    try std.testing.expectEqualStrings("", mp.output.items);
+
+    // Only the second line is rewritten, from one line above the cursor
+    b.setMessage("c");
+    mp.output.clearRetainingCapacity();
+    try mp.appendFrame();
+    try std.testing.expectEqualStrings("\x1b[1F\x1b[Kc\n", mp.output.items);
+
+    // A shorter frame blanks the leftover line and ends below the new area
+    mp.remove(b);
+    b.deinit();
+    mp.output.clearRetainingCapacity();
+    try mp.appendFrame();
+    try std.testing.expectEqualStrings("\x1b[1F\x1b[K\n\x1b[1F", mp.output.items);
+    try std.testing.expectEqual(@as(usize, 1), mp.last_total_lines);
+}
+
+test "a throttled draw leaves its frame pending" {
+    var mp = MultiProgress.init(std.testing.allocator);
+    // Keep the test off the terminal: non-TTY draws only print finished bars
+    mp.is_tty = false;
+    defer mp.deinit();
+    _ = try testBar(&mp, "a");
+
+    mp.frame_interval_ns = std.time.ns_per_s * 3600;
+    mp.last_frame_ns = std.time.nanoTimestamp();
+    try mp.draw();
+    try std.testing.expect(mp.pending);
+
+    // Still inside the interval: the frame stays pending
+    try mp.drawPending();
+    try std.testing.expect(mp.pending);
+
+    // Once the interval has passed the tick emits it
+    mp.frame_interval_ns = 0;
+    try mp.drawPending();
+    try std.testing.expect(!mp.pending);
+
+    try mp.draw();
+    try std.testing.expect(!mp.pending);
+}
@@ -140,7 +140,7 @@ pub fn mrubyValueToJsonValue(mrb: *mruby.mrb_state, allocator: std.mem.Allocator
 }
 
 /// Convert std.json.Value to mruby value
-fn jsonValueToMrubyValue(mrb: *mruby.mrb_state, allocator: std.mem.Allocator, value: std.json.Value) !mruby.mrb_value {
+pub fn jsonValueToMrubyValue(mrb: *mruby.mrb_state, allocator: std.mem.Allocator, value: std.json.Value) !mruby.mrb_value {
     switch (value) {
         .null => return mruby.mrb_nil_value(),
         .bool => |b| {
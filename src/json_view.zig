@@ -0,0 +1,210 @@
+//! Native, read-only views over JSON documents handed to a provision run
+//! (data_bag params and secrets).
+//!
+//! The document is parsed once into a `std.json.Value` tree that stays on
+//! the Zig side. Ruby sees a `HolaJsonView` holding a handle to it; reading a
+//! scalar converts just that value into a Ruby object, and reading an object
+//! or array returns another view over it, so a script that reads two keys of
+//! a multi-megabyte payload never builds the rest.
+
+const std = @import("std");
+const mruby = @import("mruby.zig");
+const json = @import("json.zig");
+const mruby_module = @import("mruby_module.zig");
+
+extern fn zig_mrb_true_value() mruby.mrb_value;
+extern fn zig_mrb_false_value() mruby.mrb_value;
+extern fn zig_mrb_integer_p(val: mruby.mrb_value) c_int;
+extern fn zig_mrb_string_p(val: mruby.mrb_value) c_int;
+extern fn mrb_obj_as_string(mrb: *mruby.mrb_state, obj: mruby.mrb_value) mruby.mrb_value;
+
+var global_allocator: ?std.mem.Allocator = null;
+// Documents opened during the current run, indexed by handle
+var documents: std.ArrayList(std.json.Parsed(std.json.Value)) = .empty;
+
+pub fn setAllocator(allocator: std.mem.Allocator) void {
+    global_allocator = allocator;
+}
+
+/// Parse `json_str` and return a `HolaJsonView` over it. The HolaJsonView
+/// class must already be defined (the module prelude).
+pub fn open(mrb: *mruby.mrb_state, json_str: []const u8) !mruby.mrb_value {
+    const allocator = global_allocator orelse return error.NotInitialized;
+
+    // Always copy strings: the view outlives the caller's buffer
+    const parsed = try std.json.parseFromSlice(std.json.Value, allocator, json_str, .{ .allocate = .alloc_always });
+    documents.append(allocator, parsed) catch |err| {
+        parsed.deinit();
+        return err;
+    };
+
+    const handle = mruby.mrb_int_value(mrb, @intCast(documents.items.len - 1));
+    const class = mruby.mrb_class_get(mrb, "HolaJsonView");
+    const view = mruby.mrb_funcall_argv(mrb, mruby.mrb_obj_value(class), mruby.mrb_intern_cstr(mrb, "new"), 1, &handle);
+    if (mruby.mrb_test(mruby.mrb_get_exception(mrb))) {
+        mruby.mrb_print_error(mrb);
+        return error.MRubyException;
+    }
+    return view;
+}
+
+/// Free every document. Views created before this must not be read again;
+/// call when the interpreter that holds them is done.
+pub fn reset() void {
+    const allocator = global_allocator orelse return;
+    for (documents.items) |parsed| parsed.deinit();
+    documents.deinit(allocator);
+    documents = .empty;
+}
+
+fn document(handle: mruby.mrb_int) ?std.json.Value {
+    if (handle < 0 or handle >= @as(mruby.mrb_int, @intCast(documents.items.len))) return null;
+    return documents.items[@intCast(handle)].value;
+}
+
+/// Follow `keys` (a Ruby Array) from `root`. Integers index arrays; any
+/// other key is looked up by its string form in objects.
+fn walk(mrb: *mruby.mrb_state, root: std.json.Value, keys: mruby.mrb_value) ?std.json.Value {
+    var node = root;
+    const len = mruby.mrb_ary_len(mrb, keys);
+    var i: mruby.mrb_int = 0;
+    while (i < len) : (i += 1) {
+        const key = mruby.mrb_ary_ref(mrb, keys, i);
+        node = switch (node) {
+            .object => |obj| blk: {
+                const name_val = if (zig_mrb_string_p(key) != 0) key else mrb_obj_as_string(mrb, key);
+                break :blk obj.get(std.mem.span(mruby.mrb_str_to_cstr(mrb, name_val))) orelse return null;
+            },
+            .array => |arr| blk: {
+                if (zig_mrb_integer_p(key) == 0) return null;
+                const count: mruby.mrb_int = @intCast(arr.items.len);
+                var index = mruby.mrb_fixnum(mrb, key);
+                if (index < 0) index += count;
+                if (index < 0 or index >= count) return null;
+                break :blk arr.items[@intCast(index)];
+            },
+            else => return null,
+        };
+    }
+    return node;
+}
+
+/// mruby binding: json_view_dig(handle, keys) - Ruby value at `keys`, or nil
+pub fn zig_json_view_dig(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    const allocator = global_allocator orelse return mruby.mrb_nil_value();
+
+    var handle: mruby.mrb_int = 0;
+    var keys: mruby.mrb_value = undefined;
+    _ = mruby.mrb_get_args(mrb, "iA", &handle, &keys);
+
+    const root = document(handle) orelse return mruby.mrb_nil_value();
+    const node = walk(mrb, root, keys) orelse return mruby.mrb_nil_value();
+    return json.jsonValueToMrubyValue(mrb, allocator, node) catch mruby.mrb_nil_value();
+}
+
+/// mruby binding: json_view_exists(handle, keys) - whether `keys` names a
+/// value, including an explicit null
+pub fn zig_json_view_exists(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    var handle: mruby.mrb_int = 0;
+    var keys: mruby.mrb_value = undefined;
+    _ = mruby.mrb_get_args(mrb, "iA", &handle, &keys);
+
+    const root = document(handle) orelse return zig_mrb_false_value();
+    return if (walk(mrb, root, keys) != null) zig_mrb_true_value() else zig_mrb_false_value();
+}
+
+/// mruby binding: json_view_kind(handle, keys) - "object", "array" or
+/// "value" for what `keys` names, or nil when it names nothing
+pub fn zig_json_view_kind(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    var handle: mruby.mrb_int = 0;
+    var keys: mruby.mrb_value = undefined;
+    _ = mruby.mrb_get_args(mrb, "iA", &handle, &keys);
+
+    const root = document(handle) orelse return mruby.mrb_nil_value();
+    const node = walk(mrb, root, keys) orelse return mruby.mrb_nil_value();
+    const kind: []const u8 = switch (node) {
+        .object => "object",
+        .array => "array",
+        else => "value",
+    };
+    return mruby.mrb_str_new(mrb, kind.ptr, @intCast(kind.len));
+}
+
+/// mruby binding: json_view_keys(handle, keys) - keys of the object at
+/// `keys`, or nil when that is not an object
+pub fn zig_json_view_keys(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    var handle: mruby.mrb_int = 0;
+    var path: mruby.mrb_value = undefined;
+    _ = mruby.mrb_get_args(mrb, "iA", &handle, &path);
+
+    const root = document(handle) orelse return mruby.mrb_nil_value();
+    const node = walk(mrb, root, path) orelse return mruby.mrb_nil_value();
+    const obj = switch (node) {
+        .object => |map| map,
+        else => return mruby.mrb_nil_value(),
+    };
+    const keys = mruby.mrb_ary_new_capa(mrb, @intCast(obj.count()));
+    for (obj.keys()) |key| mruby.mrb_ary_push(mrb, keys, mruby.mrb_str_new(mrb, key.ptr, @intCast(key.len)));
+    return keys;
+}
+
+pub const ruby_prelude = @embedFile("ruby_prelude/json_view.rb");
+
+const json_view_functions = [_]mruby_module.ModuleFunction{
+    .{ .name = "json_view_dig", .func = zig_json_view_dig, .args = mruby.MRB_ARGS_REQ(2) },
+    .{ .name = "json_view_exists", .func = zig_json_view_exists, .args = mruby.MRB_ARGS_REQ(2) },
+    .{ .name = "json_view_kind", .func = zig_json_view_kind, .args = mruby.MRB_ARGS_REQ(2) },
+    .{ .name = "json_view_keys", .func = zig_json_view_keys, .args = mruby.MRB_ARGS_REQ(2) },
+};
+
+fn getFunctions() []const mruby_module.ModuleFunction {
+    return &json_view_functions;
+}
+
+fn getPrelude() []const u8 {
+    return ruby_prelude;
+}
+
+pub const mruby_module_def = mruby_module.MRubyModule{
+    .name = "JsonView",
+    .initFn = setAllocator,
+    .getFunctions = getFunctions,
+    .getPrelude = getPrelude,
+};
+
+test "views materialize only the scalars read" {
+    var mrb = try mruby.State.init();
+    defer mrb.deinit();
+    const mrb_ptr = mrb.mrb orelse return error.MRubyNotInitialized;
+
+    const zig_module = mruby.mrb_define_module(mrb_ptr, "ZigBackend");
+    setAllocator(std.testing.allocator);
+    defer reset();
+    for (getFunctions()) |func| {
+        mruby.mrb_define_module_function(mrb_ptr, zig_module, func.name.ptr, func.func, func.args);
+    }
+    try mrb.evalString(ruby_prelude);
+
+    const view = try open(mrb_ptr, "{\"app\":{\"port\":8080,\"hosts\":[\"a\",\"b\"]},\"debug\":null}");
+    mruby.mrb_gv_set(mrb_ptr, mruby.mrb_intern_cstr(mrb_ptr, "$view"), view);
+
+    try mrb.evalString(
+        \\raise "dig" unless $view.dig("app", "hosts", -1) == "b"
+        \\raise "index" unless $view["app"]["port"] == 8080
+        \\raise "nested view" unless $view["app"].is_a?(HolaJsonView) && $view["app"]["hosts"].is_a?(HolaJsonView)
+        \\raise "nested keys" unless $view["app"].keys == ["port", "hosts"] && $view["app"].key?("hosts")
+        \\raise "array ==" unless $view[:app]["hosts"] == ["a", "b"]
+        \\raise "array" unless $view["app"]["hosts"][1] == "b" && $view["app"]["hosts"].size == 2
+        \\raise "is_a" unless $view.is_a?(Hash) && $view.kind_of?(Hash) && $view["app"]["hosts"].is_a?(Array) && !$view.is_a?(Array)
+        \\raise "memo" unless $view["app"].equal?($view["app"])
+        \\raise "null" unless $view.key?("debug") && $view["debug"].nil?
+        \\raise "missing" unless $view.dig("app", "nope", "x").nil? && !$view.key?("nope")
+        \\raise "keys" unless $view.keys == ["app", "debug"]
+        \\raise "fetch" unless $view.fetch("nope", 1) == 1
+        \\raise "to_h" unless $view.map { |k, _| k } == ["app", "debug"]
+        \\raise "to_h nested" unless $view.to_h == { "app" => { "port" => 8080, "hosts" => ["a", "b"] }, "debug" => nil }
+        \\raise "hash ==" unless $view["app"] == { "port" => 8080, "hosts" => ["a", "b"] }
+    );
+
+    if (open(mrb_ptr, "{not json")) |_| return error.TestUnexpectedResult else |_| {}
+}
@@ -1,8 +1,26 @@
 /// AWS KMS Client - Key Management Service for encrypt/decrypt operations
 /// Uses libcurl with AWS Signature V4 authentication
+///
+/// Envelope format (`encryptEnvelope` / `decryptEnvelope`), integers big-endian:
+///
+///     offset   size  field
+///     0        4     magic "HKE1"
+///     4        2     n, length of the encrypted data key
+///     6        n     KMS CiphertextBlob of a 256-bit GenerateDataKey key
+///     6+n      12    AES-256-GCM nonce, random per envelope
+///     18+n     m     ciphertext, as long as the plaintext
+///     18+n+m   16    GCM tag
+///
+/// Bytes 0..6+n are the GCM associated data, so neither the header nor the
+/// encrypted key can be moved to another envelope. The magic carries the
+/// format version ("HKE" + version digit): a changed layout gets a new magic
+/// and its own parser, existing envelopes keep decrypting under "HKE1", and
+/// an unknown magic is rejected as InvalidEnvelope rather than guessed at.
 const std = @import("std");
 const curl = @import("curl.zig");
 
+const Aes256Gcm = std.crypto.aead.aes_gcm.Aes256Gcm;
+
 /// Encode binary data to base64 string
 fn encodeBase64(allocator: std.mem.Allocator, data: []const u8) ![]u8 {
     const encoded_len = std.base64.standard.Encoder.calcSize(data.len);
@@ -28,6 +46,8 @@ pub const KMSError = error{
     InvalidKeyId,
     JsonParseError,
     Base64DecodeError,
+    InvalidEnvelope,
+    EnvelopeAuthFailed,
     OutOfMemory,
 };
 
@@ -38,6 +58,9 @@ pub const KMSConfig = struct {
     region: []const u8 = "us-east-1",
     endpoint: ?[]const u8 = null,
     verbose: bool = false,
+    /// Seconds a decrypted envelope data key stays in the process-wide
+    /// cache. 0 disables caching and always asks KMS.
+    data_key_ttl_seconds: u32 = 0,
 };
 
 pub const EncryptResult = struct {
@@ -57,9 +80,23 @@ pub const DecryptResult = struct {
     allocator: std.mem.Allocator,
 
     pub fn deinit(self: *DecryptResult) void {
+        std.crypto.secureZero(u8, self.plaintext);
         self.allocator.free(self.plaintext);
         self.allocator.free(self.key_id);
     }
+
+    pub fn dupe(self: DecryptResult, allocator: std.mem.Allocator) !DecryptResult {
+        const plaintext = try allocator.dupe(u8, self.plaintext);
+        errdefer {
+            std.crypto.secureZero(u8, plaintext);
+            allocator.free(plaintext);
+        }
+        return .{
+            .plaintext = plaintext,
+            .key_id = try allocator.dupe(u8, self.key_id),
+            .allocator = allocator,
+        };
+    }
 };
 
 /// JSON request structure for KMS Encrypt API
@@ -89,6 +126,272 @@ const DecryptResponse = struct {
     KeyId: []const u8,
 };
 
+/// JSON request structure for KMS GenerateDataKey API
+const GenerateDataKeyRequest = struct {
+    KeyId: []const u8,
+    KeySpec: []const u8 = "AES_256",
+};
+
+/// JSON response structure for KMS GenerateDataKey API
+const GenerateDataKeyResponse = struct {
+    CiphertextBlob: []const u8,
+    Plaintext: []const u8,
+    KeyId: []const u8,
+};
+
+/// Plaintext data key returned by GenerateDataKey together with its
+/// KMS-encrypted form. The plaintext key is zeroed on deinit.
+pub const DataKey = struct {
+    plaintext: [Aes256Gcm.key_length]u8,
+    ciphertext_blob: []u8,
+    key_id: []const u8,
+    allocator: std.mem.Allocator,
+
+    pub fn deinit(self: *DataKey) void {
+        std.crypto.secureZero(u8, &self.plaintext);
+        self.allocator.free(self.ciphertext_blob);
+        self.allocator.free(self.key_id);
+    }
+};
+
+/// One ciphertext in a `KMSClient.decryptBatch` call
+pub const BatchDecryptItem = struct {
+    ciphertext_blob: []const u8,
+    input_is_base64: bool,
+    algorithm: ?[]const u8 = null,
+    /// Encrypted envelope data key (raw bytes); goes through `decryptDataKey`
+    data_key: bool = false,
+};
+
+pub const BatchDecryptOutcome = union(enum) {
+    pending,
+    ok: DecryptResult,
+    err: anyerror,
+
+    pub fn deinit(self: *BatchDecryptOutcome) void {
+        switch (self.*) {
+            .ok => |*result| result.deinit(),
+            else => {},
+        }
+        self.* = .pending;
+    }
+};
+
+/// Upper bound on worker threads for a batch decrypt
+pub const max_batch_concurrency = 16;
+
+// Layout and versioning are described at the top of this file
+pub const envelope_magic = "HKE1";
+const envelope_header_len = envelope_magic.len + 2;
+
+const Envelope = struct {
+    header: []const u8,
+    encrypted_key: []const u8,
+    nonce: [Aes256Gcm.nonce_length]u8,
+    ciphertext: []const u8,
+    tag: [Aes256Gcm.tag_length]u8,
+
+    fn parse(data: []const u8) KMSError!Envelope {
+        if (!isEnvelope(data) or data.len < envelope_header_len) return KMSError.InvalidEnvelope;
+        const key_len = std.mem.readInt(u16, data[envelope_magic.len..][0..2], .big);
+        const key_end = envelope_header_len + key_len;
+        if (key_len == 0 or data.len < key_end + Aes256Gcm.nonce_length + Aes256Gcm.tag_length) {
+            return KMSError.InvalidEnvelope;
+        }
+        const body = data[key_end + Aes256Gcm.nonce_length ..];
+        return .{
+            .header = data[0..key_end],
+            .encrypted_key = data[envelope_header_len..key_end],
+            .nonce = data[key_end..][0..Aes256Gcm.nonce_length].*,
+            .ciphertext = body[0 .. body.len - Aes256Gcm.tag_length],
+            .tag = body[body.len - Aes256Gcm.tag_length ..][0..Aes256Gcm.tag_length].*,
+        };
+    }
+};
+
+/// Whether `data` (binary) is an envelope produced by `encryptEnvelope`
+pub fn isEnvelope(data: []const u8) bool {
+    return std.mem.startsWith(u8, data, envelope_magic);
+}
+
+/// Return the KMS-encrypted data key stored in an envelope
+pub fn envelopeDataKey(data: []const u8) KMSError![]const u8 {
+    const envelope = try Envelope.parse(data);
+    return envelope.encrypted_key;
+}
+
+// Process-wide state shared by every KMSClient. Resources create a client
+// per apply, so connection reuse and caching have to outlive the client.
+// Released by `shutdown`.
+const shared_allocator = std.heap.page_allocator;
+var handle_pool: HandlePool = .{};
+var plaintext_cache: PlaintextCache = .{};
+
+/// Drop pooled connections and zero every cached data key
+pub fn shutdown() void {
+    plaintext_cache.clear();
+    handle_pool.drain();
+}
+
+/// Idle curl easy handles keyed by endpoint URL. libcurl keeps its
+/// connection cache on the easy handle, so giving the same handle back out
+/// for the same endpoint reuses the open TLS connection.
+const HandlePool = struct {
+    mutex: std.Thread.Mutex = .{},
+    idle: std.StringHashMapUnmanaged(std.ArrayList(*curl.CURL)) = .empty,
+    // Pooled handles must not outlive libcurl's global state, so the pool
+    // holds its own curl_global_init reference while it has handles
+    holds_global: bool = false,
+
+    fn acquire(self: *HandlePool, endpoint: []const u8) KMSError!*curl.CURL {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        if (self.idle.getPtr(endpoint)) |list| {
+            if (list.pop()) |handle| return handle;
+        }
+
+        if (!self.holds_global) {
+            if (curl.curl_global_init(0x03) != .CURLE_OK) return KMSError.CurlInitFailed;
+            self.holds_global = true;
+        }
+        return curl.curl_easy_init() orelse return KMSError.CurlHandleFailed;
+    }
+
+    fn release(self: *HandlePool, endpoint: []const u8, handle: *curl.CURL) void {
+        // Clear per-request options (they point at freed buffers) while
+        // keeping the live connection
+        curl.curl_easy_reset(handle);
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const entry = self.idle.getOrPut(shared_allocator, endpoint) catch {
+            curl.curl_easy_cleanup(handle);
+            return;
+        };
+        if (!entry.found_existing) {
+            entry.key_ptr.* = shared_allocator.dupe(u8, endpoint) catch {
+                self.idle.removeByPtr(entry.key_ptr);
+                curl.curl_easy_cleanup(handle);
+                return;
+            };
+            entry.value_ptr.* = .empty;
+        }
+        entry.value_ptr.append(shared_allocator, handle) catch curl.curl_easy_cleanup(handle);
+    }
+
+    fn drain(self: *HandlePool) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        var it = self.idle.iterator();
+        while (it.next()) |entry| {
+            for (entry.value_ptr.items) |handle| curl.curl_easy_cleanup(handle);
+            entry.value_ptr.deinit(shared_allocator);
+            shared_allocator.free(entry.key_ptr.*);
+        }
+        self.idle.deinit(shared_allocator);
+        self.idle = .empty;
+
+        if (self.holds_global) {
+            curl.curl_global_cleanup();
+            self.holds_global = false;
+        }
+    }
+};
+
+/// Recently decrypted envelope data keys, keyed by a digest of the caller's
+/// access key, region, endpoint and encrypted key. Entries expire after
+/// their TTL; plaintext is zeroed before its memory is released.
+const PlaintextCache = struct {
+    mutex: std.Thread.Mutex = .{},
+    entries: std.AutoHashMapUnmanaged([32]u8, Entry) = .empty,
+
+    const Entry = struct {
+        plaintext: []u8,
+        key_id: []u8,
+        expires_at_ms: i64,
+
+        fn wipe(self: Entry) void {
+            std.crypto.secureZero(u8, self.plaintext);
+            shared_allocator.free(self.plaintext);
+            shared_allocator.free(self.key_id);
+        }
+    };
+
+    fn digest(access_key: []const u8, region: []const u8, endpoint: []const u8, encrypted_key: []const u8) [32]u8 {
+        var hasher = std.crypto.hash.sha2.Sha256.init(.{});
+        for ([_][]const u8{ access_key, region, endpoint }) |part| {
+            hasher.update(part);
+            hasher.update(&[_]u8{0});
+        }
+        hasher.update(encrypted_key);
+        var out: [32]u8 = undefined;
+        hasher.final(&out);
+        return out;
+    }
+
+    /// Copy a live entry into `allocator`; expired entries are evicted
+    fn get(self: *PlaintextCache, allocator: std.mem.Allocator, key: [32]u8) !?DecryptResult {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const entry = self.entries.get(key) orelse return null;
+        if (std.time.milliTimestamp() >= entry.expires_at_ms) {
+            _ = self.entries.remove(key);
+            entry.wipe();
+            return null;
+        }
+
+        const plaintext = try allocator.dupe(u8, entry.plaintext);
+        errdefer {
+            std.crypto.secureZero(u8, plaintext);
+            allocator.free(plaintext);
+        }
+        return DecryptResult{
+            .plaintext = plaintext,
+            .key_id = try allocator.dupe(u8, entry.key_id),
+            .allocator = allocator,
+        };
+    }
+
+    /// Best effort: a failed insert only costs a later KMS round trip
+    fn put(self: *PlaintextCache, key: [32]u8, result: DecryptResult, ttl_seconds: u32) void {
+        const plaintext = shared_allocator.dupe(u8, result.plaintext) catch return;
+        const key_id = shared_allocator.dupe(u8, result.key_id) catch {
+            std.crypto.secureZero(u8, plaintext);
+            shared_allocator.free(plaintext);
+            return;
+        };
+        const entry = Entry{
+            .plaintext = plaintext,
+            .key_id = key_id,
+            .expires_at_ms = std.time.milliTimestamp() + @as(i64, ttl_seconds) * std.time.ms_per_s,
+        };
+
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        const slot = self.entries.getOrPut(shared_allocator, key) catch {
+            entry.wipe();
+            return;
+        };
+        if (slot.found_existing) slot.value_ptr.wipe();
+        slot.value_ptr.* = entry;
+    }
+
+    fn clear(self: *PlaintextCache) void {
+        self.mutex.lock();
+        defer self.mutex.unlock();
+
+        var it = self.entries.valueIterator();
+        while (it.next()) |entry| entry.wipe();
+        self.entries.deinit(shared_allocator);
+        self.entries = .empty;
+    }
+};
+
 pub const KMSClient = struct {
     allocator: std.mem.Allocator,
     config: KMSConfig,
@@ -159,27 +462,8 @@ pub const KMSClient = struct {
         algorithm: ?[]const u8,
         input_is_base64: bool,
     ) !DecryptResult {
-        // Prepare ciphertext as base64
-        var ciphertext_b64: []const u8 = undefined;
-        var should_free_ciphertext = false;
-
-        if (input_is_base64) {
-            // Strip whitespace from base64 input
-            var stripped = std.ArrayList(u8).initCapacity(self.allocator, ciphertext_blob.len) catch std.ArrayList(u8).empty;
-            defer stripped.deinit(self.allocator);
-            for (ciphertext_blob) |c| {
-                if (c != '\n' and c != '\r' and c != ' ' and c != '\t') {
-                    try stripped.append(self.allocator, c);
-                }
-            }
-            ciphertext_b64 = try stripped.toOwnedSlice(self.allocator);
-            should_free_ciphertext = true;
-        } else {
-            // Binary input, need to base64 encode
-            ciphertext_b64 = try encodeBase64(self.allocator, ciphertext_blob);
-            should_free_ciphertext = true;
-        }
-        defer if (should_free_ciphertext) self.allocator.free(ciphertext_b64);
+        const ciphertext_b64 = try self.normalizeCiphertext(ciphertext_blob, input_is_base64);
+        defer self.allocator.free(ciphertext_b64);
 
         // Convert encryption context if provided
         var ctx_map: ?std.json.ArrayHashMap([]const u8) = null;
@@ -203,29 +487,223 @@ pub const KMSClient = struct {
         defer self.allocator.free(json_body);
 
         const response = try self.makeRequest("TrentService.Decrypt", json_body);
-        defer self.allocator.free(response);
+        defer {
+            std.crypto.secureZero(u8, response);
+            self.allocator.free(response);
+        }
 
         return try self.parseDecryptResponse(response);
     }
 
-    fn makeRequest(self: *KMSClient, target: []const u8, body: []const u8) ![]u8 {
-        const handle = curl.curl_easy_init() orelse {
-            return KMSError.CurlHandleFailed;
+    /// Decrypt an envelope's encrypted data key (raw bytes). With
+    /// `data_key_ttl_seconds` set, the plaintext key is kept in the
+    /// process-wide cache so envelopes sharing a data key cost one KMS call.
+    pub fn decryptDataKey(self: *KMSClient, encrypted_key: []const u8) !DecryptResult {
+        var cache_key: ?[32]u8 = null;
+        if (self.config.data_key_ttl_seconds > 0) {
+            const endpoint = try self.endpointUrl();
+            defer self.allocator.free(endpoint);
+            cache_key = PlaintextCache.digest(self.config.access_key, self.config.region, endpoint, encrypted_key);
+            if (try plaintext_cache.get(self.allocator, cache_key.?)) |cached| return cached;
+        }
+
+        const result = try self.decrypt(encrypted_key, null, null, false);
+        if (cache_key) |key| plaintext_cache.put(key, result, self.config.data_key_ttl_seconds);
+        return result;
+    }
+
+    /// Decrypt several ciphertexts with up to `max_concurrency` requests in
+    /// flight. Each worker draws its own pooled connection. `outcomes` must
+    /// have the same length as `items`; results are owned by the caller.
+    pub fn decryptBatch(
+        self: *KMSClient,
+        items: []const BatchDecryptItem,
+        outcomes: []BatchDecryptOutcome,
+        max_concurrency: usize,
+    ) void {
+        std.debug.assert(items.len == outcomes.len);
+        @memset(outcomes, .pending);
+
+        const Shared = struct {
+            client: *KMSClient,
+            items: []const BatchDecryptItem,
+            outcomes: []BatchDecryptOutcome,
+            next: std.atomic.Value(usize) = .init(0),
+
+            fn work(shared: *@This()) void {
+                while (true) {
+                    const idx = shared.next.fetchAdd(1, .monotonic);
+                    if (idx >= shared.items.len) return;
+                    const item = shared.items[idx];
+                    const outcome = if (item.data_key)
+                        shared.client.decryptDataKey(item.ciphertext_blob)
+                    else
+                        shared.client.decrypt(item.ciphertext_blob, null, item.algorithm, item.input_is_base64);
+                    shared.outcomes[idx] = if (outcome) |result|
+                        .{ .ok = result }
+                    else |err|
+                        .{ .err = err };
+                }
+            }
         };
-        defer curl.curl_easy_cleanup(handle);
 
-        // Build URL
-        const endpoint = self.config.endpoint orelse blk: {
-            const default_endpoint = try std.fmt.allocPrint(self.allocator, "https://kms.{s}.amazonaws.com", .{self.config.region});
-            break :blk default_endpoint;
+        var shared = Shared{ .client = self, .items = items, .outcomes = outcomes };
+
+        const worker_count = @min(items.len, @max(max_concurrency, 1), max_batch_concurrency);
+        var threads: [max_batch_concurrency]std.Thread = undefined;
+        var spawned: usize = 0;
+        // The calling thread is one of the workers
+        while (spawned + 1 < worker_count) : (spawned += 1) {
+            threads[spawned] = std.Thread.spawn(.{}, Shared.work, .{&shared}) catch break;
+        }
+        Shared.work(&shared);
+        for (threads[0..spawned]) |thread| thread.join();
+    }
+
+    /// Ask KMS for a fresh AES-256 data key under `key_id`
+    pub fn generateDataKey(self: *KMSClient, key_id: []const u8) !DataKey {
+        const request = GenerateDataKeyRequest{ .KeyId = key_id };
+        const json_body = try std.fmt.allocPrint(self.allocator, "{f}", .{std.json.fmt(request, .{})});
+        defer self.allocator.free(json_body);
+
+        const response = try self.makeRequest("TrentService.GenerateDataKey", json_body);
+        defer {
+            std.crypto.secureZero(u8, response);
+            self.allocator.free(response);
+        }
+
+        const parsed = std.json.parseFromSlice(GenerateDataKeyResponse, self.allocator, response, .{ .ignore_unknown_fields = true }) catch {
+            return KMSError.JsonParseError;
         };
-        const should_free_endpoint = self.config.endpoint == null;
-        defer if (should_free_endpoint) self.allocator.free(endpoint);
+        defer parsed.deinit();
+
+        const key_bytes = try decodeBase64(self.allocator, parsed.value.Plaintext);
+        defer {
+            std.crypto.secureZero(u8, key_bytes);
+            self.allocator.free(key_bytes);
+        }
+        if (key_bytes.len != Aes256Gcm.key_length) return KMSError.InvalidResponse;
+
+        const ciphertext = try decodeBase64(self.allocator, parsed.value.CiphertextBlob);
+        errdefer self.allocator.free(ciphertext);
+
+        return DataKey{
+            .plaintext = key_bytes[0..Aes256Gcm.key_length].*,
+            .ciphertext_blob = ciphertext,
+            .key_id = try self.allocator.dupe(u8, parsed.value.KeyId),
+            .allocator = self.allocator,
+        };
+    }
+
+    /// Envelope-encrypt `plaintext`: a fresh data key from KMS encrypts the
+    /// payload locally with AES-256-GCM, and only the small encrypted data
+    /// key travels to KMS on decrypt. Payload size is not limited by KMS.
+    pub fn encryptEnvelope(self: *KMSClient, key_id: []const u8, plaintext: []const u8) !EncryptResult {
+        var data_key = try self.generateDataKey(key_id);
+        defer data_key.deinit();
+
+        if (data_key.ciphertext_blob.len > std.math.maxInt(u16)) return KMSError.InvalidResponse;
+
+        const key_end = envelope_header_len + data_key.ciphertext_blob.len;
+        const total = key_end + Aes256Gcm.nonce_length + plaintext.len + Aes256Gcm.tag_length;
+        const out = try self.allocator.alloc(u8, total);
+        errdefer self.allocator.free(out);
+
+        @memcpy(out[0..envelope_magic.len], envelope_magic);
+        std.mem.writeInt(u16, out[envelope_magic.len..][0..2], @intCast(data_key.ciphertext_blob.len), .big);
+        @memcpy(out[envelope_header_len..key_end], data_key.ciphertext_blob);
+
+        const nonce = out[key_end..][0..Aes256Gcm.nonce_length];
+        std.crypto.random.bytes(nonce);
+
+        const body = out[key_end + Aes256Gcm.nonce_length ..];
+        const tag = body[plaintext.len..][0..Aes256Gcm.tag_length];
+        Aes256Gcm.encrypt(body[0..plaintext.len], tag, plaintext, out[0..key_end], nonce.*, data_key.plaintext);
+
+        return EncryptResult{
+            .ciphertext_blob = out,
+            .key_id = try self.allocator.dupe(u8, data_key.key_id),
+            .allocator = self.allocator,
+        };
+    }
+
+    /// Decrypt an envelope produced by `encryptEnvelope`. The data key goes
+    /// through `decryptDataKey`, so with `data_key_ttl_seconds` set,
+    /// envelopes sharing a data key are opened without another KMS call.
+    pub fn decryptEnvelope(self: *KMSClient, data: []const u8) !DecryptResult {
+        const envelope = try Envelope.parse(data);
+
+        var data_key = try self.decryptDataKey(envelope.encrypted_key);
+        defer data_key.deinit();
+        return self.openEnvelope(envelope, data_key);
+    }
+
+    /// Decrypt an envelope whose data key was already decrypted, e.g. by
+    /// `decryptBatch`
+    pub fn decryptEnvelopeWithKey(self: *KMSClient, data: []const u8, data_key: DecryptResult) !DecryptResult {
+        return self.openEnvelope(try Envelope.parse(data), data_key);
+    }
+
+    fn openEnvelope(self: *KMSClient, envelope: Envelope, data_key: DecryptResult) !DecryptResult {
+        if (data_key.plaintext.len != Aes256Gcm.key_length) return KMSError.InvalidEnvelope;
+
+        const plaintext = try self.allocator.alloc(u8, envelope.ciphertext.len);
+        errdefer self.allocator.free(plaintext);
+
+        Aes256Gcm.decrypt(
+            plaintext,
+            envelope.ciphertext,
+            envelope.tag,
+            envelope.header,
+            envelope.nonce,
+            data_key.plaintext[0..Aes256Gcm.key_length].*,
+        ) catch return KMSError.EnvelopeAuthFailed;
+
+        return DecryptResult{
+            .plaintext = plaintext,
+            .key_id = try self.allocator.dupe(u8, data_key.key_id),
+            .allocator = self.allocator,
+        };
+    }
+
+    /// Base64 form of a ciphertext for the request body, with whitespace
+    /// removed from base64 input. Caller owns the returned slice.
+    fn normalizeCiphertext(self: *KMSClient, ciphertext_blob: []const u8, input_is_base64: bool) ![]u8 {
+        if (!input_is_base64) return encodeBase64(self.allocator, ciphertext_blob);
+
+        var stripped = try std.ArrayList(u8).initCapacity(self.allocator, ciphertext_blob.len);
+        errdefer stripped.deinit(self.allocator);
+        for (ciphertext_blob) |c| {
+            if (c != '\n' and c != '\r' and c != ' ' and c != '\t') {
+                stripped.appendAssumeCapacity(c);
+            }
+        }
+        return stripped.toOwnedSlice(self.allocator);
+    }
+
+    fn endpointUrl(self: *KMSClient) ![]u8 {
+        if (self.config.endpoint) |endpoint| return self.allocator.dupe(u8, endpoint);
+        return std.fmt.allocPrint(self.allocator, "https://kms.{s}.amazonaws.com", .{self.config.region});
+    }
+
+    fn makeRequest(self: *KMSClient, target: []const u8, body: []const u8) ![]u8 {
+        const endpoint = try self.endpointUrl();
+        defer self.allocator.free(endpoint);
+
+        // Handles come from the shared pool so consecutive requests to the
+        // same endpoint skip the TCP and TLS handshake. A handle whose
+        // transfer failed is discarded rather than pooled.
+        const handle = try handle_pool.acquire(endpoint);
+        var reusable = false;
+        defer if (reusable) handle_pool.release(endpoint, handle) else curl.curl_easy_cleanup(handle);
 
         const url_z = try self.allocator.dupeZ(u8, endpoint);
         defer self.allocator.free(url_z);
         _ = curl.curl_easy_setopt(handle, .CURLOPT_URL, url_z.ptr);
 
+        // Batch decrypts run on worker threads
+        _ = curl.curl_easy_setopt(handle, .CURLOPT_NOSIGNAL, @as(c_long, 1));
+
         // Set AWS credentials
         const userpwd = try std.fmt.allocPrint(self.allocator, "{s}:{s}\x00", .{ self.config.access_key, self.config.secret_key });
         defer self.allocator.free(userpwd);
@@ -297,6 +775,7 @@ pub const KMSClient = struct {
         if (perform_result != .CURLE_OK) {
             return KMSError.CurlPerformFailed;
         }
+        reusable = true;
 
         var response_code: c_long = 0;
         _ = curl.curl_easy_getinfo(handle, .CURLINFO_RESPONSE_CODE, &response_code);
@@ -347,3 +826,244 @@ pub const KMSClient = struct {
         };
     }
 };
+
+/// Minimal local KMS endpoint for tests: Decrypt/Encrypt echo their input,
+/// GenerateDataKey hands out a fixed key. Counts connections and calls.
+const StandInKms = struct {
+    server: std.net.Server,
+    accept_thread: std.Thread,
+    conn_threads: [max_batch_concurrency]?std.Thread = @splat(null),
+    connections: std.atomic.Value(usize) = .init(0),
+    decrypt_calls: std.atomic.Value(usize) = .init(0),
+    stopping: std.atomic.Value(bool) = .init(false),
+
+    const data_key = [_]u8{0x42} ** Aes256Gcm.key_length;
+
+    fn start(self: *StandInKms) !void {
+        const address = try std.net.Address.parseIp4("127.0.0.1", 0);
+        self.* = .{ .server = try address.listen(.{ .reuse_address = true }), .accept_thread = undefined };
+        self.accept_thread = try std.Thread.spawn(.{}, acceptLoop, .{self});
+    }
+
+    fn endpoint(self: *StandInKms, buf: []u8) ![]const u8 {
+        return std.fmt.bufPrint(buf, "http://127.0.0.1:{d}", .{self.server.listen_address.getPort()});
+    }
+
+    /// Pooled client connections must be closed first (see `shutdown`)
+    fn stop(self: *StandInKms) void {
+        self.stopping.store(true, .release);
+        if (std.net.tcpConnectToAddress(self.server.listen_address)) |wake| wake.close() else |_| {}
+        self.accept_thread.join();
+        for (self.conn_threads) |maybe_thread| {
+            if (maybe_thread) |thread| thread.join();
+        }
+        self.server.deinit();
+    }
+
+    fn acceptLoop(self: *StandInKms) void {
+        while (true) {
+            const conn = self.server.accept() catch return;
+            if (self.stopping.load(.acquire)) {
+                conn.stream.close();
+                return;
+            }
+            const idx = self.connections.fetchAdd(1, .monotonic);
+            if (idx >= self.conn_threads.len) {
+                conn.stream.close();
+                continue;
+            }
+            self.conn_threads[idx] = std.Thread.spawn(.{}, serve, .{ self, conn.stream }) catch {
+                conn.stream.close();
+                continue;
+            };
+        }
+    }
+
+    fn serve(self: *StandInKms, stream: std.net.Stream) void {
+        defer stream.close();
+        var buf: [16 * 1024]u8 = undefined;
+        var len: usize = 0;
+
+        while (true) {
+            const header_end = while (true) {
+                if (std.mem.indexOf(u8, buf[0..len], "\r\n\r\n")) |pos| break pos + 4;
+                if (len == buf.len) return;
+                const n = std.posix.read(stream.handle, buf[len..]) catch return;
+                if (n == 0) return;
+                len += n;
+            };
+
+            const head = buf[0..header_end];
+            const body_len = headerValue(head, "content-length") orelse "0";
+            const content_length = std.fmt.parseInt(usize, body_len, 10) catch return;
+            if (header_end + content_length > buf.len) return;
+            while (len < header_end + content_length) {
+                const n = std.posix.read(stream.handle, buf[len..]) catch return;
+                if (n == 0) return;
+                len += n;
+            }
+
+            const target = headerValue(head, "x-amz-target") orelse "";
+            const body = buf[header_end .. header_end + content_length];
+            self.respond(stream, target, body) catch return;
+
+            const consumed = header_end + content_length;
+            std.mem.copyForwards(u8, buf[0 .. len - consumed], buf[consumed..len]);
+            len -= consumed;
+        }
+    }
+
+    fn respond(self: *StandInKms, stream: std.net.Stream, target: []const u8, body: []const u8) !void {
+        var parsed = try std.json.parseFromSlice(std.json.Value, std.heap.page_allocator, body, .{});
+        defer parsed.deinit();
+        const request = parsed.value.object;
+
+        var json_buf: [8 * 1024]u8 = undefined;
+        const json = if (std.mem.eql(u8, target, "TrentService.Decrypt")) blk: {
+            _ = self.decrypt_calls.fetchAdd(1, .monotonic);
+            break :blk try std.fmt.bufPrint(&json_buf, "{{\"Plaintext\":\"{s}\",\"KeyId\":\"stand-in\"}}", .{request.get("CiphertextBlob").?.string});
+        } else if (std.mem.eql(u8, target, "TrentService.Encrypt")) blk: {
+            break :blk try std.fmt.bufPrint(&json_buf, "{{\"CiphertextBlob\":\"{s}\",\"KeyId\":\"stand-in\"}}", .{request.get("Plaintext").?.string});
+        } else blk: {
+            var key_b64: [64]u8 = undefined;
+            // The "encrypted" data key is the key itself, so the echoing
+            // Decrypt above unwraps it
+            const encoded = std.base64.standard.Encoder.encode(&key_b64, &data_key);
+            break :blk try std.fmt.bufPrint(&json_buf, "{{\"CiphertextBlob\":\"{s}\",\"Plaintext\":\"{s}\",\"KeyId\":\"stand-in\"}}", .{ encoded, encoded });
+        };
+
+        var head_buf: [128]u8 = undefined;
+        const head = try std.fmt.bufPrint(&head_buf, "HTTP/1.1 200 OK\r\nContent-Type: application/x-amz-json-1.1\r\nContent-Length: {d}\r\n\r\n", .{json.len});
+        try writeAll(stream, head);
+        try writeAll(stream, json);
+    }
+
+    fn writeAll(stream: std.net.Stream, bytes: []const u8) !void {
+        var written: usize = 0;
+        while (written < bytes.len) written += try std.posix.write(stream.handle, bytes[written..]);
+    }
+
+    fn headerValue(head: []const u8, name: []const u8) ?[]const u8 {
+        var lines = std.mem.splitSequence(u8, head, "\r\n");
+        while (lines.next()) |line| {
+            const colon = std.mem.indexOfScalar(u8, line, ':') orelse continue;
+            if (std.ascii.eqlIgnoreCase(line[0..colon], name)) {
+                return std.mem.trim(u8, line[colon + 1 ..], " \t");
+            }
+        }
+        return null;
+    }
+};
+
+test "KMSClient reuses one connection across requests" {
+    var kms: StandInKms = undefined;
+    try kms.start();
+    defer kms.stop();
+    defer shutdown();
+
+    var url_buf: [64]u8 = undefined;
+    var client = try KMSClient.init(std.testing.allocator, .{
+        .access_key = "AKIDTEST",
+        .secret_key = "secret",
+        .endpoint = try kms.endpoint(&url_buf),
+    });
+    defer client.deinit();
+
+    for (0..3) |_| {
+        var result = try client.decrypt("c2VjcmV0", null, null, true);
+        defer result.deinit();
+        try std.testing.expectEqualStrings("secret", result.plaintext);
+    }
+
+    try std.testing.expectEqual(@as(usize, 3), kms.decrypt_calls.load(.monotonic));
+    try std.testing.expectEqual(@as(usize, 1), kms.connections.load(.monotonic));
+}
+
+test "KMSClient.decryptBatch bounds concurrency" {
+    var kms: StandInKms = undefined;
+    try kms.start();
+    defer kms.stop();
+    defer shutdown();
+
+    var url_buf: [64]u8 = undefined;
+    var client = try KMSClient.init(std.testing.allocator, .{
+        .access_key = "AKIDTEST",
+        .secret_key = "secret",
+        .endpoint = try kms.endpoint(&url_buf),
+    });
+    defer client.deinit();
+
+    const secrets = [_][]const u8{ "one", "two", "three", "four", "five", "six", "seven", "eight" };
+    var items: [secrets.len]BatchDecryptItem = undefined;
+    for (secrets, &items) |secret, *item| {
+        item.* = .{ .ciphertext_blob = secret, .input_is_base64 = false };
+    }
+
+    var outcomes: [secrets.len]BatchDecryptOutcome = undefined;
+    client.decryptBatch(&items, &outcomes, 3);
+    defer for (&outcomes) |*outcome| outcome.deinit();
+
+    for (secrets, outcomes) |secret, outcome| {
+        try std.testing.expectEqualStrings(secret, outcome.ok.plaintext);
+    }
+    try std.testing.expectEqual(@as(usize, secrets.len), kms.decrypt_calls.load(.monotonic));
+    try std.testing.expect(kms.connections.load(.monotonic) <= 3);
+}
+
+test "envelope round trip serves repeated data-key decrypts from cache" {
+    var kms: StandInKms = undefined;
+    try kms.start();
+    defer kms.stop();
+    defer shutdown();
+
+    var url_buf: [64]u8 = undefined;
+    var client = try KMSClient.init(std.testing.allocator, .{
+        .access_key = "AKIDTEST",
+        .secret_key = "secret",
+        .endpoint = try kms.endpoint(&url_buf),
+        .data_key_ttl_seconds = 60,
+    });
+    defer client.deinit();
+
+    var sealed = try client.encryptEnvelope("alias/test", "database password");
+    defer sealed.deinit();
+    try std.testing.expect(isEnvelope(sealed.ciphertext_blob));
+
+    for (0..2) |_| {
+        var opened = try client.decryptEnvelope(sealed.ciphertext_blob);
+        defer opened.deinit();
+        try std.testing.expectEqualStrings("database password", opened.plaintext);
+    }
+    try std.testing.expectEqual(@as(usize, 1), kms.decrypt_calls.load(.monotonic));
+
+    // Plain decrypts are never cached
+    for (0..2) |_| {
+        var result = try client.decrypt("c2VjcmV0", null, null, true);
+        defer result.deinit();
+    }
+    try std.testing.expectEqual(@as(usize, 3), kms.decrypt_calls.load(.monotonic));
+
+    // Cached data keys are scoped to the region they were decrypted in
+    var other_region = client;
+    other_region.config.region = "eu-west-1";
+    {
+        var opened = try other_region.decryptEnvelope(sealed.ciphertext_blob);
+        defer opened.deinit();
+    }
+    try std.testing.expectEqual(@as(usize, 4), kms.decrypt_calls.load(.monotonic));
+
+    // An envelope opens with a data key decrypted ahead of time
+    {
+        var data_key = try client.decryptDataKey(try envelopeDataKey(sealed.ciphertext_blob));
+        defer data_key.deinit();
+        var opened = try client.decryptEnvelopeWithKey(sealed.ciphertext_blob, data_key);
+        defer opened.deinit();
+        try std.testing.expectEqualStrings("database password", opened.plaintext);
+    }
+
+    // A modified envelope fails authentication
+    const tampered = try std.testing.allocator.dupe(u8, sealed.ciphertext_blob);
+    defer std.testing.allocator.free(tampered);
+    tampered[tampered.len - 1] ^= 1;
+    try std.testing.expectError(KMSError.EnvelopeAuthFailed, client.decryptEnvelope(tampered));
+}
@@ -5,6 +5,7 @@ const logger = @import("logger.zig");
 const help_formatter = @import("help_formatter.zig");
 pub const build_options = @import("build_options");
 const commands = @import("commands.zig");
+const git_resource = @import("resources/git.zig");
 
 const is_macos = builtin.os.tag == .macos;
 
@@ -61,6 +62,11 @@ pub fn main() !void {
 }
 
 fn dispatchCommand(command: []const u8, allocator: std.mem.Allocator, iter: *std.process.ArgIterator) !void {
+    // Not listed in help: the git resource runs its isolated operations here
+    if (std.mem.eql(u8, command, git_resource.helper_command)) {
+        try git_resource.runHelper(allocator);
+        return;
+    }
     if (std.mem.eql(u8, command, "help")) {
         try printMainHelp(null);
         return;
@@ -239,6 +245,8 @@ comptime {
     }
     // Force test discovery for files only reached via indirect imports.
     _ = @import("provision.zig");
+    _ = @import("bench/workload.zig");
+    _ = @import("bench/load.zig");
 }
 
 test "simple test" {
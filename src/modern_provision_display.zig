@@ -24,8 +24,22 @@ pub const ModernProvisionDisplay = struct {
         total_bytes: u64 = 0,
         bytes_downloaded: u64 = 0,
     };
+    const SlowResource = struct {
+        label: []u8, // "type[name]"
+        wall_ns: u64,
+    };
     const Self = @This();
 
+    /// Receives section headers and info messages instead of the terminal,
+    /// for work that runs on another thread alongside a pretty display
+    pub const InfoSink = struct {
+        context: *anyopaque,
+        report: *const fn (context: *anyopaque, message: []const u8) void,
+    };
+
+    /// Number of entries in the "slowest resources" summary section
+    pub const slowest_count = 10;
+
     allocator: std.mem.Allocator,
     mp: indicatif.MultiProgress,
     download_spinners: std.StringHashMap(DownloadEntry),
@@ -45,6 +59,14 @@ pub const ModernProvisionDisplay = struct {
     timer_spinner: ?*indicatif.ProgressBar = null,
     timer_message: ?[]u8 = null,
     start_time: i128 = 0,
+    // Sorted slowest first
+    slowest: [slowest_count]SlowResource = undefined,
+    slowest_len: usize = 0,
+    info_sink: ?InfoSink = null,
+    // Line for a package installation running alongside provisioning
+    package_spinner: ?*indicatif.ProgressBar = null,
+    package_status: ?[]u8 = null, // Last status shown on the package line
+    package_phase_running: bool = false,
 
     pub fn init(allocator: std.mem.Allocator, show_progress: bool) !Self {
         return .{
@@ -105,6 +127,15 @@ pub const ModernProvisionDisplay = struct {
             self.allocator.free(msg);
         }
 
+        if (self.package_spinner) |spinner| {
+            self.mp.remove(spinner);
+            spinner.deinit();
+        }
+
+        if (self.package_status) |status| {
+            self.allocator.free(status);
+        }
+
         if (self.download_section_spinner) |spinner| {
             self.mp.remove(spinner);
             spinner.deinit();
@@ -115,6 +146,10 @@ pub const ModernProvisionDisplay = struct {
             spinner.deinit();
         }
 
+        for (self.slowest[0..self.slowest_len]) |entry| {
+            self.allocator.free(entry.label);
+        }
+
         // Don't call mp.deinit() because it calls clear() which removes the display
         // The bars are already finished and we want to keep them visible
         // Memory cleanup: manually clean up the bars array
@@ -122,6 +157,7 @@ pub const ModernProvisionDisplay = struct {
             bar.deinit();
         }
         self.mp.bars.deinit(self.allocator);
+        self.mp.releaseBuffers();
     }
 
     /// Set total number of resources
@@ -219,6 +255,8 @@ pub const ModernProvisionDisplay = struct {
         // Level 3: ### without bold
         // Level 4: #### without bold
 
+        if (self.info_sink) |sink| return sink.report(sink.context, header);
+
         const prefix = switch (level) {
             2 => "##",
             3 => "###",
@@ -289,6 +327,7 @@ pub const ModernProvisionDisplay = struct {
 
     /// Show info message
     pub fn showInfo(self: *Self, message: []const u8) !void {
+        if (self.info_sink) |sink| return sink.report(sink.context, message);
         if (!self.show_progress) {
             std.debug.print("\x1b[34mℹ\x1b[0m {s}\n", .{message});
         }
@@ -449,6 +488,78 @@ pub const ModernProvisionDisplay = struct {
         }
     }
 
+    /// Show a line for package installation running alongside provisioning
+    pub fn startPackagePhase(self: *Self) !void {
+        self.package_phase_running = true;
+        if (!self.show_progress) {
+            std.debug.print("\x1b[34mℹ\x1b[0m Installing packages alongside provisioning\n", .{});
+            return;
+        }
+
+        const spinner = try self.mp.addSpinner();
+        var style = try indicatif.ProgressStyle.withTemplate(self.allocator, "{spinner} {msg}");
+        style.tick_chars = "⠋⠙⠹⠸⠼⠴⠦⠧⠇⠏";
+        spinner.setStyle(style);
+        self.package_spinner = spinner;
+        try self.updatePackagePhase("installing packages");
+    }
+
+    pub fn packagePhaseRunning(self: *Self) bool {
+        return self.package_phase_running;
+    }
+
+    /// Show the package phase's current step; only changes are drawn or,
+    /// in plain mode, printed
+    pub fn updatePackagePhase(self: *Self, status: []const u8) !void {
+        if (!self.package_phase_running) return;
+        if (self.package_status) |old| {
+            if (std.mem.eql(u8, old, status)) return;
+        }
+
+        const owned = try std.fmt.allocPrint(self.allocator, "packages: {s}", .{status});
+        if (self.package_status) |old| self.allocator.free(old);
+        self.package_status = owned;
+
+        if (!self.show_progress) {
+            std.debug.print("\x1b[34mℹ\x1b[0m {s}\n", .{owned});
+            return;
+        }
+        if (self.package_spinner) |spinner| {
+            spinner.setMessage(owned);
+            // Keep the line right above the timer
+            if (self.timer_spinner) |timer| self.mp.moveToEnd(timer);
+        }
+    }
+
+    /// Turn the package line into a final done/failed line. Called as soon
+    /// as the package phase ends, so a failure shows up before the
+    /// resources that were already running finish.
+    pub fn finishPackagePhase(self: *Self, success: bool, status: []const u8) !void {
+        if (!self.package_phase_running) return;
+        self.package_phase_running = false;
+
+        const base = if (success)
+            try std.fmt.allocPrint(self.allocator, "✓ packages installed", .{})
+        else
+            try std.fmt.allocPrint(self.allocator, "✗ package installation failed: {s}", .{status});
+        defer self.allocator.free(base);
+
+        if (!self.show_progress) {
+            const color = if (success) "\x1b[32m" else "\x1b[31m";
+            std.debug.print("{s}{s}\x1b[0m\n", .{ color, base });
+            return;
+        }
+
+        const msg = try self.makeColoredMessage(if (success) .Green else .Red, true, base);
+        try self.download_finished_messages.append(self.allocator, msg);
+        if (self.package_spinner) |spinner| {
+            const finished_style = try indicatif.ProgressStyle.withTemplate(self.allocator, "{msg}");
+            spinner.setStyle(finished_style);
+            spinner.setMessage(msg);
+            spinner.state.finish();
+        }
+    }
+
     /// Start a resource execution
     pub fn startResource(self: *Self, resource_type: []const u8, resource_name: []const u8) !void {
         self.executed_count += 1;
@@ -530,8 +641,7 @@ pub const ModernProvisionDisplay = struct {
             spinner.state.finish();
 
             self.resource_spinner = null;
-            self.resource_message = null;
-        }
+            self.resource_message = null;        }
     }
 
     /// Mark resource as skipped
@@ -574,8 +684,7 @@ pub const ModernProvisionDisplay = struct {
             spinner.state.finish();
 
             self.resource_spinner = null;
-            self.resource_message = null;
-        }
+            self.resource_message = null;        }
     }
 
     /// Mark resource as failed
@@ -617,8 +726,7 @@ pub const ModernProvisionDisplay = struct {
             spinner.state.finish();
 
             self.resource_spinner = null;
-            self.resource_message = null;
-        }
+            self.resource_message = null;        }
     }
 
     /// Show notification
@@ -647,6 +755,37 @@ pub const ModernProvisionDisplay = struct {
         }
     }
 
+    /// Record how long a resource took, for the "slowest resources" section
+    pub fn recordResourceTime(self: *Self, resource_type: []const u8, resource_name: []const u8, wall_ns: u64) !void {
+        if (self.slowest_len == slowest_count and wall_ns <= self.slowest[slowest_count - 1].wall_ns) return;
+
+        var pos: usize = 0;
+        while (pos < self.slowest_len and self.slowest[pos].wall_ns >= wall_ns) : (pos += 1) {}
+
+        const label = try std.fmt.allocPrint(self.allocator, "{s}[{s}]", .{ resource_type, resource_name });
+        if (self.slowest_len == slowest_count) {
+            self.allocator.free(self.slowest[slowest_count - 1].label);
+        } else {
+            self.slowest_len += 1;
+        }
+
+        var i = self.slowest_len - 1;
+        while (i > pos) : (i -= 1) {
+            self.slowest[i] = self.slowest[i - 1];
+        }
+        self.slowest[pos] = .{ .label = label, .wall_ns = wall_ns };
+    }
+
+    fn printSlowest(self: *Self) void {
+        if (self.slowest_len == 0) return;
+
+        std.debug.print("\n\x1b[1mSlowest resources:\x1b[0m\n", .{});
+        for (self.slowest[0..self.slowest_len]) |entry| {
+            const ms = entry.wall_ns / std.time.ns_per_ms;
+            std.debug.print("  \x1b[36m{d:>4}.{d:0>3}s\x1b[0m  {s}\n", .{ ms / 1000, ms % 1000, entry.label });
+        }
+    }
+
     /// Show final summary with duration
     pub fn showSummaryWithDuration(self: *Self, duration_s: i64, duration_ms_part: i64) !void {
         _ = duration_s;
@@ -667,17 +806,21 @@ pub const ModernProvisionDisplay = struct {
             const elapsed_s = @divTrunc(elapsed_ms, 1000);
             const elapsed_ms_part = @rem(elapsed_ms, 1000);
             std.debug.print("Duration: \x1b[36m{d}.{d:0>3}s\x1b[0m\n", .{ elapsed_s, @abs(elapsed_ms_part) });
+            self.printSlowest();
             std.debug.print("\x1b[32m✓\x1b[0m Provisioning completed successfully!\n", .{});
         } else {
             // Finish the timer spinner with final message
             try self.finishTimer();
 
-            // Draw the final state
-            try self.mp.draw();
+            // Draw the final state, bypassing the frame rate limit
+            try self.mp.flush();
+            self.printSlowest();
         }
     }
 
-    /// Update display (for continuous rendering)
+    /// Update display (for continuous rendering). The runner calls this after
+    /// each resource event and the AsyncExecutor poll every 50 ms, so a frame
+    /// the throttle held back reaches the screen on the next tick.
     pub fn update(self: *Self) !void {
         if (!self.show_progress) return;
 
@@ -705,6 +848,12 @@ pub const ModernProvisionDisplay = struct {
             }
         }
 
+        if (self.package_spinner) |spinner| {
+            if (!spinner.state.isFinished()) {
+                spinner.tickNoDraw();
+            }
+        }
+
         try self.mp.draw();
     }
 
@@ -766,3 +915,22 @@ pub const ModernProvisionDisplay = struct {
         return result;
     }
 };
+
+test "recordResourceTime keeps the slowest resources in order" {
+    var display = try ModernProvisionDisplay.init(std.testing.allocator, false);
+    defer display.deinit();
+
+    var i: u64 = 0;
+    while (i < ModernProvisionDisplay.slowest_count + 5) : (i += 1) {
+        // Interleave fast and slow resources
+        const wall_ns = if (i % 2 == 0) i * 1000 else i;
+        try display.recordResourceTime("file", "/tmp/x", wall_ns);
+    }
+
+    try std.testing.expectEqual(@as(usize, ModernProvisionDisplay.slowest_count), display.slowest_len);
+    try std.testing.expectEqual(@as(u64, 14_000), display.slowest[0].wall_ns);
+    for (1..display.slowest_len) |k| {
+        try std.testing.expect(display.slowest[k - 1].wall_ns >= display.slowest[k].wall_ns);
+    }
+    try std.testing.expectEqualStrings("file[/tmp/x]", display.slowest[0].label);
+}
@@ -64,6 +64,9 @@ pub extern fn mrb_gc_register(mrb: *mrb_state, obj: mrb_value) void;
 pub extern fn mrb_gc_unregister(mrb: *mrb_state, obj: mrb_value) void;
 pub extern fn mrb_gc_protect(mrb: *mrb_state, obj: mrb_value) void;
 
+// Native classes (mruby_open_struct.c)
+pub extern fn zig_mrb_define_open_struct(mrb: *mrb_state) void;
+
 // Global variables
 pub extern fn mrb_gv_get(mrb: *mrb_state, sym: mrb_sym) mrb_value;
 pub extern fn mrb_gv_set(mrb: *mrb_state, sym: mrb_sym, val: mrb_value) void;
@@ -80,6 +83,78 @@ pub extern fn zig_mrb_ary_ref(mrb: *mrb_state, arr: mrb_value, idx: mrb_int) mrb
 pub extern fn zig_mrb_fixnum(mrb: *mrb_state, val: mrb_value) mrb_int;
 pub extern fn zig_mrb_float(mrb: *mrb_state, val: mrb_value) f64;
 
+// Bulk accessors (mruby_helpers.c): borrowed views of String (or Symbol)
+// elements, filled in one call per Array/Hash
+pub const StrView = extern struct {
+    ptr: ?[*]const u8,
+    len: usize,
+
+    pub fn slice(self: StrView) []const u8 {
+        const p = self.ptr orelse return "";
+        return p[0..self.len];
+    }
+};
+pub extern fn zig_mrb_str_borrow(mrb: *mrb_state, val: mrb_value) StrView;
+pub extern fn zig_mrb_str_pin(mrb: *mrb_state, val: mrb_value) StrView;
+pub extern fn zig_mrb_str_unpin_all(mrb: *mrb_state) void;
+pub extern fn zig_mrb_ary_str_views(mrb: *mrb_state, arr: mrb_value, out: [*]StrView, cap: mrb_int) mrb_int;
+pub extern fn zig_mrb_ary_row_views(mrb: *mrb_state, arr: mrb_value, width: mrb_int, out: [*]StrView, cap: mrb_int) mrb_int;
+pub extern fn zig_mrb_hash_str_views(mrb: *mrb_state, hash: mrb_value, keys: [*]StrView, vals: [*]StrView, cap: mrb_int) mrb_int;
+
+/// Bytes of a String argument without the copy mrb_str_to_cstr makes.
+/// Valid until the current method returns; dupe anything kept longer.
+pub fn borrowStr(mrb: *mrb_state, val: mrb_value) []const u8 {
+    return zig_mrb_str_borrow(mrb, val).slice();
+}
+
+/// Bytes of a String that stay valid and unchanged until `unpinStrs` (or
+/// the interpreter closes), for resource attributes that live only as long
+/// as the resource list. Never free the result.
+pub fn pinStr(mrb: *mrb_state, val: mrb_value) []const u8 {
+    return zig_mrb_str_pin(mrb, val).slice();
+}
+
+/// Release everything `pinStr` handed out; call once no resource holding
+/// a pinned slice is left
+pub fn unpinStrs(mrb: *mrb_state) void {
+    zig_mrb_str_unpin_all(mrb);
+}
+
+/// Views of every element of a String Array (empty when `arr` is not an
+/// Array). Caller frees the slice; the views are borrowed as in borrowStr.
+pub fn aryStrViews(allocator: std.mem.Allocator, mrb: *mrb_state, arr: mrb_value) ![]StrView {
+    const len = zig_mrb_ary_str_views(mrb, arr, undefined, 0);
+    const views = try allocator.alloc(StrView, @intCast(len));
+    _ = zig_mrb_ary_str_views(mrb, arr, views.ptr, len);
+    return views;
+}
+
+/// Views of the first `width` elements of each row of an Array of Arrays,
+/// e.g. `[[key, value], ...]` with width 2. Caller frees the slice.
+pub fn aryRowViews(comptime width: usize, allocator: std.mem.Allocator, mrb: *mrb_state, arr: mrb_value) ![][width]StrView {
+    const len = zig_mrb_ary_row_views(mrb, arr, width, undefined, 0);
+    const rows = try allocator.alloc([width]StrView, @intCast(len));
+    _ = zig_mrb_ary_row_views(mrb, arr, width, @ptrCast(rows.ptr), len);
+    return rows;
+}
+
+/// Key and value views of a Hash, in insertion order. Caller frees both
+/// slices with `allocator`.
+pub fn hashStrViews(allocator: std.mem.Allocator, mrb: *mrb_state, hash: mrb_value) !struct { keys: []StrView, values: []StrView } {
+    const len: usize = @intCast(zig_mrb_hash_str_views(mrb, hash, undefined, undefined, 0));
+    const keys = try allocator.alloc(StrView, len);
+    errdefer allocator.free(keys);
+    const values = try allocator.alloc(StrView, len);
+    _ = zig_mrb_hash_str_views(mrb, hash, keys.ptr, values.ptr, @intCast(len));
+    return .{ .keys = keys, .values = values };
+}
+
+// Canonical bytes of plain data (nil, booleans, numbers, Strings, Symbols
+// and Arrays/Hashes of those), fed to `feed` for fingerprints. Returns 0
+// for anything else (mruby_helpers.c).
+pub const FeedFn = *const fn (ctx: ?*anyopaque, bytes: [*]const u8, len: usize) callconv(.c) void;
+pub extern fn zig_mrb_value_feed(mrb: *mrb_state, val: mrb_value, feed: FeedFn, ctx: ?*anyopaque) c_int;
+
 // Value constructors
 pub extern fn zig_mrb_int_value(mrb: *mrb_state, i: mrb_int) mrb_value;
 
@@ -209,3 +284,49 @@ pub const State = struct {
         }
     }
 };
+
+test "bulk accessors read arrays, rows and hashes without copies" {
+    var state = try State.init();
+    defer state.deinit();
+    const mrb = state.mrb orelse return error.MRubyNotInitialized;
+    const allocator = std.testing.allocator;
+
+    try state.evalString(
+        \\$names = ["nginx", :curl, 3]
+        \\$env = [["PATH", "/usr/bin"], ["EMPTY", ""]]
+        \\$opts = { "a" => "1", b: "2" }
+        \\$body = "original"
+    );
+    const gv = struct {
+        fn get(m: *mrb_state, name: [*:0]const u8) mrb_value {
+            return mrb_gv_get(m, mrb_intern_cstr(m, name));
+        }
+    }.get;
+
+    const names = try aryStrViews(allocator, mrb, gv(mrb, "$names"));
+    defer allocator.free(names);
+    try std.testing.expectEqual(@as(usize, 3), names.len);
+    try std.testing.expectEqualStrings("nginx", names[0].slice());
+    try std.testing.expectEqualStrings("curl", names[1].slice());
+    try std.testing.expectEqualStrings("", names[2].slice());
+
+    const rows = try aryRowViews(2, allocator, mrb, gv(mrb, "$env"));
+    defer allocator.free(rows);
+    try std.testing.expectEqual(@as(usize, 2), rows.len);
+    try std.testing.expectEqualStrings("/usr/bin", rows[0][1].slice());
+    try std.testing.expectEqualStrings("", rows[1][1].slice());
+
+    const opts = try hashStrViews(allocator, mrb, gv(mrb, "$opts"));
+    defer allocator.free(opts.keys);
+    defer allocator.free(opts.values);
+    try std.testing.expectEqualStrings("b", opts.keys[1].slice());
+    try std.testing.expectEqualStrings("2", opts.values[1].slice());
+
+    // A pinned string survives the script mutating the original
+    const pinned = pinStr(mrb, gv(mrb, "$body"));
+    try state.evalString("$body << ' changed'; GC.start");
+    try std.testing.expectEqualStrings("original", pinned);
+
+    unpinStrs(mrb);
+    try std.testing.expect(!mrb_test(gv(mrb, "$_hola_pinned")));
+}
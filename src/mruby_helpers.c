@@ -183,3 +183,215 @@ void zig_mrb_exc_summary(mrb_state *mrb, mrb_value exc, char *buf, size_t buflen
         snprintf(buf, buflen, "%s", class_name);
     }
 }
+
+// Bulk accessors: a resource attribute that is an Array or Hash of strings
+// is read in one call instead of one FFI hop per element.
+//
+// Views borrow the bytes of the Ruby object (no copy and no NUL terminator).
+// Symbols view their interned name. Anything else, or a missing row
+// element, gives {NULL, 0}.
+typedef struct {
+    const char *ptr;
+    size_t len;
+} zig_mrb_str_view;
+
+static zig_mrb_str_view str_view(mrb_state *mrb, mrb_value val) {
+    zig_mrb_str_view view = {NULL, 0};
+    if (mrb_string_p(val)) {
+        view.ptr = RSTRING_PTR(val);
+        view.len = (size_t)RSTRING_LEN(val);
+    } else if (mrb_symbol_p(val)) {
+        mrb_int len;
+        view.ptr = mrb_sym_name_len(mrb, mrb_symbol(val), &len);
+        view.len = (size_t)len;
+    }
+    return view;
+}
+
+// View of a single String, valid while the string is alive and unmodified
+// (for a method argument: until the method returns)
+zig_mrb_str_view zig_mrb_str_borrow(mrb_state *mrb, mrb_value val) {
+    return str_view(mrb, val);
+}
+
+// View that stays valid until zig_mrb_str_unpin_all or mrb_close. A frozen
+// copy of the string is kept reachable from a hidden global Array; for heap
+// strings the copy shares the original buffer, so nothing is duplicated.
+zig_mrb_str_view zig_mrb_str_pin(mrb_state *mrb, mrb_value val) {
+    if (!mrb_string_p(val)) return str_view(mrb, val);
+
+    mrb_sym sym = mrb_intern_lit(mrb, "$_hola_pinned");
+    mrb_value pins = mrb_gv_get(mrb, sym);
+    if (!mrb_array_p(pins)) {
+        pins = mrb_ary_new(mrb);
+        mrb_gv_set(mrb, sym, pins);
+    }
+
+    mrb_value pinned = val;
+    if (!mrb_frozen_p(mrb_basic_ptr(val))) {
+        pinned = mrb_str_dup(mrb, val);
+        MRB_SET_FROZEN_FLAG(mrb_basic_ptr(pinned));
+    }
+    mrb_ary_push(mrb, pins, pinned);
+    return str_view(mrb, pinned);
+}
+
+// Let the GC have every pinned string back; views from zig_mrb_str_pin are
+// invalid afterwards
+void zig_mrb_str_unpin_all(mrb_state *mrb) {
+    mrb_gv_set(mrb, mrb_intern_lit(mrb, "$_hola_pinned"), mrb_nil_value());
+}
+
+// Views of up to `cap` elements of `arr`. Returns the Array length (0 when
+// `arr` is not an Array), which can exceed `cap`.
+mrb_int zig_mrb_ary_str_views(mrb_state *mrb, mrb_value arr, zig_mrb_str_view *out, mrb_int cap) {
+    if (!mrb_array_p(arr)) return 0;
+    mrb_int len = RARRAY_LEN(arr);
+    const mrb_value *items = RARRAY_PTR(arr);
+    for (mrb_int i = 0; i < len && i < cap; i++) {
+        out[i] = str_view(mrb, items[i]);
+    }
+    return len;
+}
+
+// For an Array of Arrays (e.g. [[key, value], ...]), views of the first
+// `width` elements of up to `cap` rows, row-major into `out`. Returns the
+// number of rows.
+mrb_int zig_mrb_ary_row_views(mrb_state *mrb, mrb_value arr, mrb_int width, zig_mrb_str_view *out, mrb_int cap) {
+    if (!mrb_array_p(arr)) return 0;
+    mrb_int len = RARRAY_LEN(arr);
+    const mrb_value *rows = RARRAY_PTR(arr);
+    for (mrb_int i = 0; i < len && i < cap; i++) {
+        zig_mrb_str_view *row_out = out + i * width;
+        mrb_int row_len = mrb_array_p(rows[i]) ? RARRAY_LEN(rows[i]) : 0;
+        const mrb_value *row = row_len > 0 ? RARRAY_PTR(rows[i]) : NULL;
+        for (mrb_int j = 0; j < width; j++) {
+            zig_mrb_str_view empty = {NULL, 0};
+            row_out[j] = j < row_len ? str_view(mrb, row[j]) : empty;
+        }
+    }
+    return len;
+}
+
+struct hash_views {
+    zig_mrb_str_view *keys;
+    zig_mrb_str_view *vals;
+    mrb_int cap;
+    mrb_int count;
+};
+
+static int hash_views_i(mrb_state *mrb, mrb_value key, mrb_value val, void *data) {
+    struct hash_views *hv = (struct hash_views *)data;
+    if (hv->count < hv->cap) {
+        hv->keys[hv->count] = str_view(mrb, key);
+        hv->vals[hv->count] = str_view(mrb, val);
+    }
+    hv->count++;
+    return 0;
+}
+
+// Views of up to `cap` key/value pairs of `hash`, in insertion order.
+// Returns the Hash size (0 when `hash` is not a Hash).
+mrb_int zig_mrb_hash_str_views(mrb_state *mrb, mrb_value hash, zig_mrb_str_view *keys, zig_mrb_str_view *vals, mrb_int cap) {
+    if (!mrb_hash_p(hash)) return 0;
+    if (cap == 0) return mrb_hash_size(mrb, hash);
+    struct hash_views hv = {keys, vals, cap, 0};
+    mrb_hash_foreach(mrb, mrb_hash_ptr(hash), hash_views_i, &hv);
+    return hv.count;
+}
+
+// Canonical byte encoding of plain data (nil, booleans, numbers, Strings,
+// Symbols, and Arrays/Hashes of those), passed to `feed` piece by piece for
+// content fingerprints. Returns 0 when the value holds anything else or
+// nests deeper than max_feed_depth; the fed bytes are then meaningless.
+typedef void (*zig_mrb_feed_fn)(void *ctx, const char *bytes, size_t len);
+
+#define max_feed_depth 32
+
+struct value_feed {
+    zig_mrb_feed_fn feed;
+    void *ctx;
+    int depth;
+    int ok;
+};
+
+static void feed_value(mrb_state *mrb, mrb_value val, struct value_feed *vf);
+
+static void feed_header(struct value_feed *vf, char tag, size_t len) {
+    vf->feed(vf->ctx, &tag, 1);
+    vf->feed(vf->ctx, (const char *)&len, sizeof len);
+}
+
+static void feed_bytes(struct value_feed *vf, char tag, const void *bytes, size_t len) {
+    feed_header(vf, tag, len);
+    if (len > 0) vf->feed(vf->ctx, (const char *)bytes, len);
+}
+
+static int feed_pair_i(mrb_state *mrb, mrb_value key, mrb_value val, void *data) {
+    struct value_feed *vf = (struct value_feed *)data;
+    feed_value(mrb, key, vf);
+    feed_value(mrb, val, vf);
+    return vf->ok ? 0 : 1;
+}
+
+static void feed_value(mrb_state *mrb, mrb_value val, struct value_feed *vf) {
+    if (!vf->ok) return;
+    switch (mrb_type(val)) {
+    case MRB_TT_FALSE:
+        feed_header(vf, mrb_nil_p(val) ? 'n' : 'f', 0);
+        break;
+    case MRB_TT_TRUE:
+        feed_header(vf, 't', 0);
+        break;
+    case MRB_TT_INTEGER: {
+        mrb_int i = mrb_integer(val);
+        feed_bytes(vf, 'i', &i, sizeof i);
+        break;
+    }
+    case MRB_TT_FLOAT: {
+        mrb_float f = mrb_float(val);
+        feed_bytes(vf, 'd', &f, sizeof f);
+        break;
+    }
+    case MRB_TT_SYMBOL: {
+        mrb_int len;
+        const char *name = mrb_sym_name_len(mrb, mrb_symbol(val), &len);
+        feed_bytes(vf, 'y', name, (size_t)len);
+        break;
+    }
+    case MRB_TT_STRING:
+        feed_bytes(vf, 's', RSTRING_PTR(val), (size_t)RSTRING_LEN(val));
+        break;
+    case MRB_TT_ARRAY: {
+        if (++vf->depth > max_feed_depth) {
+            vf->ok = 0;
+            return;
+        }
+        mrb_int len = RARRAY_LEN(val);
+        feed_header(vf, 'a', (size_t)len);
+        for (mrb_int i = 0; i < len && vf->ok; i++) {
+            feed_value(mrb, RARRAY_PTR(val)[i], vf);
+        }
+        vf->depth--;
+        break;
+    }
+    case MRB_TT_HASH:
+        if (++vf->depth > max_feed_depth) {
+            vf->ok = 0;
+            return;
+        }
+        feed_header(vf, 'h', (size_t)mrb_hash_size(mrb, val));
+        mrb_hash_foreach(mrb, mrb_hash_ptr(val), feed_pair_i, vf);
+        vf->depth--;
+        break;
+    default:
+        vf->ok = 0;
+        break;
+    }
+}
+
+int zig_mrb_value_feed(mrb_state *mrb, mrb_value val, zig_mrb_feed_fn feed, void *ctx) {
+    struct value_feed vf = {feed, ctx, 0, 1};
+    feed_value(mrb, val, &vf);
+    return vf.ok;
+}
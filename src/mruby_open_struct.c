@@ -0,0 +1,250 @@
+// Native OpenStruct for the provision DSL (node attributes, data_bag
+// values). Compatible with the subset of Ruby's OpenStruct scripts use:
+// attribute readers/writers, [] / []=, dig, keys, key?, each, to_h, inspect.
+//
+// Attributes live in an @table Hash keyed by String. Nested Hashes are kept
+// as given and only wrapped in an OpenStruct the first time they are read
+// (Arrays likewise, for their Hash elements); the wrapped value replaces the
+// raw one in @table, so later reads return the same object. Keys whose Array
+// has been through this are recorded in @wrapped, so reading a large Array
+// attribute does not rescan it every time; writing the key clears the mark.
+// Building one from a large tree is a shallow copy, and `node.foo.bar` never
+// leaves C. to_h returns a deep copy with every key a String, whether or not
+// the nested values were ever read, so it never shares state with @table.
+
+#include <string.h>
+#include <mruby.h>
+#include <mruby/array.h>
+#include <mruby/hash.h>
+#include <mruby/string.h>
+#include <mruby/variable.h>
+#include <mruby/class.h>
+
+static struct RClass *os_class(mrb_state *mrb) {
+    return mrb_class_get(mrb, "OpenStruct");
+}
+
+static mrb_value os_table(mrb_state *mrb, mrb_value self) {
+    mrb_sym sym = mrb_intern_lit(mrb, "@table");
+    mrb_value table = mrb_iv_get(mrb, self, sym);
+    if (!mrb_hash_p(table)) {
+        table = mrb_hash_new(mrb);
+        mrb_iv_set(mrb, self, sym, table);
+    }
+    return table;
+}
+
+// Keys whose Array value was already wrapped (or held no Hash). Created on
+// first use unless `create` is false, in which case nil may be returned.
+static mrb_value os_wrapped_keys(mrb_state *mrb, mrb_value self, mrb_bool create) {
+    mrb_sym sym = mrb_intern_lit(mrb, "@wrapped");
+    mrb_value keys = mrb_iv_get(mrb, self, sym);
+    if (!mrb_hash_p(keys) && create) {
+        keys = mrb_hash_new(mrb);
+        mrb_iv_set(mrb, self, sym, keys);
+    }
+    return keys;
+}
+
+static mrb_value os_key(mrb_state *mrb, mrb_value key) {
+    if (mrb_string_p(key)) return key;
+    if (mrb_symbol_p(key)) return mrb_sym_str(mrb, mrb_symbol(key));
+    return mrb_obj_as_string(mrb, key);
+}
+
+// Whether a raw value still contains a Hash that reads should wrap
+static mrb_bool os_needs_wrap(mrb_value value) {
+    if (mrb_hash_p(value)) return TRUE;
+    if (mrb_array_p(value)) {
+        mrb_int len = RARRAY_LEN(value);
+        for (mrb_int i = 0; i < len; i++) {
+            if (os_needs_wrap(mrb_ary_entry(value, i))) return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static mrb_value os_wrap(mrb_state *mrb, mrb_value value) {
+    if (mrb_hash_p(value)) return mrb_obj_new(mrb, os_class(mrb), 1, &value);
+    if (!os_needs_wrap(value)) return value;
+
+    mrb_int len = RARRAY_LEN(value);
+    mrb_value wrapped = mrb_ary_new_capa(mrb, len);
+    for (mrb_int i = 0; i < len; i++) {
+        mrb_ary_push(mrb, wrapped, os_wrap(mrb, mrb_ary_entry(value, i)));
+    }
+    return wrapped;
+}
+
+static mrb_value os_get(mrb_state *mrb, mrb_value self, mrb_value key) {
+    mrb_value table = os_table(mrb, self);
+    mrb_value value = mrb_hash_get(mrb, table, key);
+    if (mrb_array_p(value)) {
+        mrb_value done = os_wrapped_keys(mrb, self, TRUE);
+        if (mrb_hash_key_p(mrb, done, key)) return value;
+        mrb_hash_set(mrb, done, key, mrb_true_value());
+    } else if (!mrb_hash_p(value)) {
+        return value;
+    }
+    if (!os_needs_wrap(value)) return value;
+
+    mrb_value wrapped = os_wrap(mrb, value);
+    mrb_hash_set(mrb, table, key, wrapped);
+    return wrapped;
+}
+
+static void os_set(mrb_state *mrb, mrb_value self, mrb_value key, mrb_value value) {
+    mrb_hash_set(mrb, os_table(mrb, self), key, value);
+    mrb_value done = os_wrapped_keys(mrb, self, FALSE);
+    if (mrb_hash_p(done)) mrb_hash_delete_key(mrb, done, key);
+}
+
+static mrb_value os_initialize(mrb_state *mrb, mrb_value self) {
+    mrb_value hash = mrb_nil_value();
+    mrb_get_args(mrb, "|o", &hash);
+
+    // Even OpenStruct.new with no Hash gets its (empty) table
+    os_table(mrb, self);
+    if (!mrb_hash_p(hash)) return self;
+
+    mrb_value keys = mrb_hash_keys(mrb, hash);
+    mrb_int len = RARRAY_LEN(keys);
+    for (mrb_int i = 0; i < len; i++) {
+        mrb_value key = mrb_ary_entry(keys, i);
+        os_set(mrb, self, os_key(mrb, key), mrb_hash_get(mrb, hash, key));
+    }
+    return self;
+}
+
+static mrb_value os_aref(mrb_state *mrb, mrb_value self) {
+    mrb_value key;
+    mrb_get_args(mrb, "o", &key);
+    return os_get(mrb, self, os_key(mrb, key));
+}
+
+static mrb_value os_aset(mrb_state *mrb, mrb_value self) {
+    mrb_value key, value;
+    mrb_get_args(mrb, "oo", &key, &value);
+    os_set(mrb, self, os_key(mrb, key), value);
+    return value;
+}
+
+// obj.foo reads attribute "foo" (nil when unset); obj.foo = v sets it
+static mrb_value os_method_missing(mrb_state *mrb, mrb_value self) {
+    mrb_sym name;
+    const mrb_value *argv;
+    mrb_int argc;
+    mrb_get_args(mrb, "n*", &name, &argv, &argc);
+
+    mrb_int len;
+    const char *str = mrb_sym_name_len(mrb, name, &len);
+    if (len > 1 && str[len - 1] == '=') {
+        mrb_value value = argc > 0 ? argv[0] : mrb_nil_value();
+        os_set(mrb, self, mrb_str_new(mrb, str, len - 1), value);
+        return value;
+    }
+    return os_get(mrb, self, mrb_str_new(mrb, str, len));
+}
+
+static mrb_value os_respond_to_missing(mrb_state *mrb, mrb_value self) {
+    mrb_sym name;
+    mrb_bool include_private = FALSE;
+    mrb_get_args(mrb, "n|b", &name, &include_private);
+
+    mrb_int len;
+    const char *str = mrb_sym_name_len(mrb, name, &len);
+    if (len > 1 && str[len - 1] == '=') return mrb_true_value();
+    return mrb_bool_value(mrb_hash_key_p(mrb, os_table(mrb, self), mrb_str_new(mrb, str, len)));
+}
+
+static mrb_value os_keys(mrb_state *mrb, mrb_value self) {
+    return mrb_hash_keys(mrb, os_table(mrb, self));
+}
+
+static mrb_value os_key_p(mrb_state *mrb, mrb_value self) {
+    mrb_value key;
+    mrb_get_args(mrb, "o", &key);
+    return mrb_bool_value(mrb_hash_key_p(mrb, os_table(mrb, self), os_key(mrb, key)));
+}
+
+static mrb_value os_each(mrb_state *mrb, mrb_value self) {
+    mrb_value block;
+    mrb_get_args(mrb, "&!", &block);
+
+    mrb_value keys = mrb_hash_keys(mrb, os_table(mrb, self));
+    mrb_int len = RARRAY_LEN(keys);
+    int arena = mrb_gc_arena_save(mrb);
+    for (mrb_int i = 0; i < len; i++) {
+        mrb_value pair[2];
+        pair[0] = mrb_ary_entry(keys, i);
+        pair[1] = os_get(mrb, self, pair[0]);
+        mrb_yield_argv(mrb, block, 2, pair);
+        mrb_gc_arena_restore(mrb, arena);
+    }
+    return self;
+}
+
+static mrb_value os_to_h(mrb_state *mrb, mrb_value self);
+
+// Copy of a value for to_h: OpenStructs become Hashes, and raw Hashes get
+// their keys normalized the way OpenStruct.new would have
+static mrb_value os_plain(mrb_state *mrb, mrb_value value) {
+    if (mrb_hash_p(value)) {
+        mrb_value keys = mrb_hash_keys(mrb, value);
+        mrb_int len = RARRAY_LEN(keys);
+        mrb_value result = mrb_hash_new_capa(mrb, len);
+        for (mrb_int i = 0; i < len; i++) {
+            mrb_value key = mrb_ary_entry(keys, i);
+            mrb_hash_set(mrb, result, os_key(mrb, key), os_plain(mrb, mrb_hash_get(mrb, value, key)));
+        }
+        return result;
+    }
+    if (mrb_array_p(value)) {
+        mrb_int len = RARRAY_LEN(value);
+        mrb_value items = mrb_ary_new_capa(mrb, len);
+        for (mrb_int i = 0; i < len; i++) mrb_ary_push(mrb, items, os_plain(mrb, mrb_ary_entry(value, i)));
+        return items;
+    }
+    if (mrb_obj_is_kind_of(mrb, value, os_class(mrb))) return os_to_h(mrb, value);
+    return value;
+}
+
+static mrb_value os_to_h(mrb_state *mrb, mrb_value self) {
+    return os_plain(mrb, os_table(mrb, self));
+}
+
+// obj.dig(:a, 0, :b) reads "a" and hands the rest to the value's own dig
+static mrb_value os_dig(mrb_state *mrb, mrb_value self) {
+    const mrb_value *argv;
+    mrb_int argc;
+    mrb_get_args(mrb, "*", &argv, &argc);
+    if (argc == 0) mrb_raise(mrb, E_ARGUMENT_ERROR, "wrong number of arguments (given 0, expected 1+)");
+
+    mrb_value value = os_get(mrb, self, os_key(mrb, argv[0]));
+    if (argc == 1 || mrb_nil_p(value)) return value;
+    return mrb_funcall_argv(mrb, value, mrb_intern_lit(mrb, "dig"), argc - 1, argv + 1);
+}
+
+static mrb_value os_inspect(mrb_state *mrb, mrb_value self) {
+    mrb_value str = mrb_str_new_lit(mrb, "#<OpenStruct ");
+    mrb_str_cat_str(mrb, str, mrb_inspect(mrb, os_table(mrb, self)));
+    mrb_str_cat_lit(mrb, str, ">");
+    return str;
+}
+
+// Define OpenStruct; call before any prelude that uses it
+void zig_mrb_define_open_struct(mrb_state *mrb) {
+    struct RClass *cls = mrb_define_class(mrb, "OpenStruct", mrb->object_class);
+    mrb_define_method(mrb, cls, "initialize", os_initialize, MRB_ARGS_OPT(1));
+    mrb_define_method(mrb, cls, "[]", os_aref, MRB_ARGS_REQ(1));
+    mrb_define_method(mrb, cls, "[]=", os_aset, MRB_ARGS_REQ(2));
+    mrb_define_method(mrb, cls, "dig", os_dig, MRB_ARGS_ANY());
+    mrb_define_method(mrb, cls, "method_missing", os_method_missing, MRB_ARGS_ANY());
+    mrb_define_method(mrb, cls, "respond_to_missing?", os_respond_to_missing, MRB_ARGS_ARG(1, 1));
+    mrb_define_method(mrb, cls, "keys", os_keys, MRB_ARGS_NONE());
+    mrb_define_method(mrb, cls, "key?", os_key_p, MRB_ARGS_REQ(1));
+    mrb_define_method(mrb, cls, "each", os_each, MRB_ARGS_BLOCK());
+    mrb_define_method(mrb, cls, "to_h", os_to_h, MRB_ARGS_NONE());
+    mrb_define_method(mrb, cls, "inspect", os_inspect, MRB_ARGS_NONE());
+    mrb_define_method(mrb, cls, "to_s", os_inspect, MRB_ARGS_NONE());
+}
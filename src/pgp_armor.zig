@@ -0,0 +1,152 @@
+//! OpenPGP ASCII armor decoding (RFC 4880 section 6).
+//!
+//! Converts armored key blocks into the binary packet stream that
+//! `gpg --dearmor` would produce, so keyrings can be written for APT's
+//! `signed-by=` without spawning gpg.
+
+const std = @import("std");
+
+const begin_marker = "-----BEGIN PGP ";
+const end_marker = "-----END PGP ";
+
+pub const Error = error{
+    NotArmored,
+    MissingEndMarker,
+    InvalidBase64,
+    ChecksumMismatch,
+};
+
+/// Whether the data starts (after leading whitespace) with an armor header line.
+pub fn isArmored(data: []const u8) bool {
+    const start = std.mem.indexOfNone(u8, data, " \t\r\n") orelse return false;
+    return std.mem.startsWith(u8, data[start..], begin_marker);
+}
+
+/// CRC-24 as defined by RFC 4880 section 6.1.
+pub fn crc24(data: []const u8) u32 {
+    var crc: u32 = 0xB704CE;
+    for (data) |byte| {
+        crc ^= @as(u32, byte) << 16;
+        var i: usize = 0;
+        while (i < 8) : (i += 1) {
+            crc <<= 1;
+            if (crc & 0x1000000 != 0) crc ^= 0x1864CFB;
+        }
+    }
+    return crc & 0xFFFFFF;
+}
+
+/// Decode every armored block in `data` and return the concatenated binary
+/// packets. The optional `=XXXX` checksum line is verified when present.
+/// Caller owns the returned slice.
+pub fn dearmor(allocator: std.mem.Allocator, data: []const u8) ![]u8 {
+    var out = std.ArrayList(u8).empty;
+    errdefer out.deinit(allocator);
+
+    var body = std.ArrayList(u8).empty;
+    defer body.deinit(allocator);
+
+    const State = enum { outside, headers, body };
+    var state: State = .outside;
+    var checksum: ?[]const u8 = null;
+    var blocks: usize = 0;
+
+    var lines = std.mem.splitScalar(u8, data, '\n');
+    while (lines.next()) |raw_line| {
+        const line = std.mem.trim(u8, raw_line, " \t\r");
+
+        switch (state) {
+            .outside => {
+                if (std.mem.startsWith(u8, line, begin_marker)) {
+                    state = .headers;
+                    body.clearRetainingCapacity();
+                    checksum = null;
+                }
+            },
+            .headers => {
+                // Armor headers ("Version: ...") end at the first blank line.
+                // Tolerate writers that omit the blank line entirely.
+                if (line.len == 0) {
+                    state = .body;
+                } else if (std.mem.indexOf(u8, line, ": ") == null) {
+                    state = .body;
+                    try body.appendSlice(allocator, line);
+                }
+            },
+            .body => {
+                if (std.mem.startsWith(u8, line, end_marker)) {
+                    try decodeBlock(allocator, &out, body.items, checksum);
+                    blocks += 1;
+                    state = .outside;
+                } else if (line.len == 5 and line[0] == '=') {
+                    checksum = line[1..];
+                } else {
+                    try body.appendSlice(allocator, line);
+                }
+            },
+        }
+    }
+
+    if (state != .outside) return Error.MissingEndMarker;
+    if (blocks == 0) return Error.NotArmored;
+    return out.toOwnedSlice(allocator);
+}
+
+fn decodeBlock(allocator: std.mem.Allocator, out: *std.ArrayList(u8), body: []const u8, checksum: ?[]const u8) !void {
+    const decoder = std.base64.standard.Decoder;
+    const size = decoder.calcSizeForSlice(body) catch return Error.InvalidBase64;
+
+    const start = out.items.len;
+    try out.resize(allocator, start + size);
+    decoder.decode(out.items[start..], body) catch return Error.InvalidBase64;
+
+    if (checksum) |encoded| {
+        var crc_bytes: [3]u8 = undefined;
+        decoder.decode(&crc_bytes, encoded) catch return Error.InvalidBase64;
+        const expected = (@as(u32, crc_bytes[0]) << 16) | (@as(u32, crc_bytes[1]) << 8) | crc_bytes[2];
+        if (crc24(out.items[start..]) != expected) return Error.ChecksumMismatch;
+    }
+}
+
+test "crc24 matches RFC 4880 reference" {
+    try std.testing.expectEqual(@as(u32, 0xB704CE), crc24(""));
+    // Reference value from the OpenPGP CRC-24 definition for "123456789"
+    try std.testing.expectEqual(@as(u32, 0x21CF02), crc24("123456789"));
+}
+
+test "dearmor decodes body and verifies checksum" {
+    const allocator = std.testing.allocator;
+    const payload = "hola keyring bytes";
+
+    var b64_buf: [64]u8 = undefined;
+    const b64 = std.base64.standard.Encoder.encode(&b64_buf, payload);
+
+    const crc = crc24(payload);
+    const crc_bytes = [3]u8{ @truncate(crc >> 16), @truncate(crc >> 8), @truncate(crc) };
+    var crc_buf: [4]u8 = undefined;
+    const crc_b64 = std.base64.standard.Encoder.encode(&crc_buf, &crc_bytes);
+
+    const armored = try std.fmt.allocPrint(
+        allocator,
+        "-----BEGIN PGP PUBLIC KEY BLOCK-----\r\nComment: test\r\n\r\n{s}\r\n={s}\r\n-----END PGP PUBLIC KEY BLOCK-----\r\n",
+        .{ b64, crc_b64 },
+    );
+    defer allocator.free(armored);
+
+    try std.testing.expect(isArmored(armored));
+    const binary = try dearmor(allocator, armored);
+    defer allocator.free(binary);
+    try std.testing.expectEqualStrings(payload, binary);
+
+    // Corrupt the checksum
+    const bad = try std.mem.replaceOwned(u8, allocator, armored, crc_b64, "AAAA");
+    defer allocator.free(bad);
+    try std.testing.expectError(Error.ChecksumMismatch, dearmor(allocator, bad));
+}
+
+test "dearmor rejects binary and truncated input" {
+    const allocator = std.testing.allocator;
+    try std.testing.expect(!isArmored("\x99\x01\x0d"));
+    try std.testing.expectError(Error.NotArmored, dearmor(allocator, "\x99\x01\x0d"));
+    try std.testing.expectError(Error.MissingEndMarker, dearmor(allocator, "-----BEGIN PGP PUBLIC KEY BLOCK-----\n\naGk=\n"));
+}
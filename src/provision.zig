@@ -7,22 +7,132 @@ const logger = @import("logger.zig");
 const http = @import("http.zig");
 const resolv = @import("resolv.zig");
 const json = @import("json.zig");
+const json_view = @import("json_view.zig");
 const base64 = @import("base64.zig");
+const time_ext = @import("time_ext.zig");
 const hola_logger = @import("hola_logger.zig");
 const node_info = @import("node_info.zig");
 const env_access = @import("env_access.zig");
 const file_ext = @import("file_ext.zig");
 const base = @import("base_resource.zig");
+const dir_cache = @import("dir_cache.zig");
 const builtin = @import("builtin");
 const is_macos = builtin.os.tag == .macos;
 const is_linux = builtin.os.tag == .linux;
 const AsyncExecutor = @import("async_executor.zig").AsyncExecutor;
+const CountingAllocator = @import("counting_allocator.zig").CountingAllocator;
+const checkpoint = @import("checkpoint.zig");
+const file_watcher = @import("file_watcher.zig");
+const hashing = @import("hashing.zig");
 
 pub const Options = struct {
     script_path: []const u8,
     use_pretty_output: bool = true, // Default to pretty output
     params_json: ?[]const u8 = null, // JSON string for data_bag injection
     secrets_json: ?[]const u8 = null, // JSON string for secrets_bag injection
+    package_gate: ?*PackageGate = null, // Set when packages are installed concurrently (apply)
+    phase_timings: ?*PhaseTimings = null, // Filled in by run() when set (load testing)
+    checkpoint_key: ?[]const u8 = null, // Journal applied resources under this key (script path or URL)
+    resume_run: bool = false, // Skip resources the checkpoint journal shows converged
+    watch: bool = false, // After converging, re-apply resources as their input files change
+    watch_inputs: ?*std.ArrayList([]u8) = null, // Receives the resources' input files after evaluation (owned by the caller), so watch mode can wait on them after a failed run
+};
+
+/// Wall-clock nanoseconds spent in each phase of `run()`
+pub const PhaseTimings = struct {
+    setup_ns: u64 = 0, // mruby state, bindings and preludes
+    eval_ns: u64 = 0, // evaluating the user's script
+    prefetch_ns: u64 = 0, // Phase 0: queueing downloads, batching, prefetching
+    execute_ns: u64 = 0, // Phase 1
+    notify_ns: u64 = 0, // Phases 2 and 3
+    download_wait_ns: u64 = 0, // joining the download thread
+
+    /// Attribute the time since the previous lap to `field`
+    const Clock = struct {
+        out: ?*PhaseTimings,
+        last: i128,
+
+        fn start(out: ?*PhaseTimings) Clock {
+            return .{ .out = out, .last = std.time.nanoTimestamp() };
+        }
+
+        fn lap(self: *Clock, comptime field: []const u8) void {
+            const now = std.time.nanoTimestamp();
+            if (self.out) |timings| @field(timings, field) += @intCast(@max(now - self.last, 0));
+            self.last = now;
+        }
+    };
+};
+
+/// Completion signal for a package installation running alongside
+/// provisioning. Script evaluation and prefetching start immediately;
+/// only resources that may depend on installed packages wait for it.
+pub const PackageGate = struct {
+    done: std.Thread.ResetEvent = .{},
+    failed: std.atomic.Value(bool) = std.atomic.Value(bool).init(false),
+    // Latest message from the package phase, shown on the display's package line
+    status_mutex: std.Thread.Mutex = .{},
+    status_buf: [status_capacity]u8 = undefined,
+    status_len: usize = 0,
+
+    pub const status_capacity = 160;
+
+    /// Called once by the package phase when it finishes
+    pub fn finish(self: *PackageGate, ok: bool) void {
+        if (!ok) self.failed.store(true, .release);
+        self.done.set();
+    }
+
+    /// Record what the package phase is doing (any thread); long messages
+    /// are cut to `status_capacity` bytes
+    pub fn setStatus(self: *PackageGate, message: []const u8) void {
+        const trimmed = std.mem.trim(u8, message, &std.ascii.whitespace);
+        self.status_mutex.lock();
+        defer self.status_mutex.unlock();
+        self.status_len = @min(trimmed.len, status_capacity);
+        @memcpy(self.status_buf[0..self.status_len], trimmed[0..self.status_len]);
+    }
+
+    /// Copy the latest status into `buf`
+    pub fn readStatus(self: *PackageGate, buf: *[status_capacity]u8) []const u8 {
+        self.status_mutex.lock();
+        defer self.status_mutex.unlock();
+        @memcpy(buf[0..self.status_len], self.status_buf[0..self.status_len]);
+        return buf[0..self.status_len];
+    }
+
+    /// Display sink that turns the package installers' messages into status
+    pub fn infoSink(self: *PackageGate) modern_display.ModernProvisionDisplay.InfoSink {
+        return .{ .context = self, .report = reportStatus };
+    }
+
+    fn reportStatus(context: *anyopaque, message: []const u8) void {
+        const self: *PackageGate = @ptrCast(@alignCast(context));
+        self.setStatus(message);
+    }
+
+    pub fn isOpen(self: *PackageGate) bool {
+        return self.done.isSet();
+    }
+
+    pub fn hasFailed(self: *PackageGate) bool {
+        return self.failed.load(.acquire);
+    }
+};
+
+/// What a resource cost, measured around its `apply()`
+pub const ResourceStats = struct {
+    wall_ns: u64 = 0,
+    guard_ns: u64 = 0, // only_if/not_if evaluation
+    subprocesses: u32 = 0,
+    // rchar/wchar deltas from /proc/self/io: every read/write syscall of the
+    // process, including pipes and sockets, and concurrent downloads. Null
+    // where unavailable (non-Linux).
+    bytes_read: ?u64 = null,
+    bytes_written: ?u64 = null,
+    // Through the allocator handed to run(); c_allocator use is not counted
+    allocations: u64 = 0,
+    allocated_bytes: u64 = 0,
 };
 
 pub const ResourceResult = struct {
@@ -35,8 +145,95 @@ pub const ResourceResult = struct {
     error_name: ?[]const u8,
     error_message: ?[]const u8 = null,
     output: ?[]const u8,
+    stats: ResourceStats = .{},
+};
+
+/// Process-wide I/O byte counters from /proc/self/io (Linux only)
+const ProcIo = struct {
+    file: ?std.fs.File,
+
+    const Counters = struct {
+        read: u64,
+        written: u64,
+    };
+
+    fn open() ProcIo {
+        if (!is_linux) return .{ .file = null };
+        return .{ .file = std.fs.openFileAbsolute("/proc/self/io", .{}) catch null };
+    }
+
+    fn close(self: ProcIo) void {
+        if (self.file) |f| f.close();
+    }
+
+    fn sample(self: ProcIo) ?Counters {
+        const f = self.file orelse return null;
+        var buf: [512]u8 = undefined;
+        // procfs regenerates the contents on every read from offset 0
+        const n = f.pread(&buf, 0) catch return null;
+        return parse(buf[0..n]);
+    }
+
+    fn parse(text: []const u8) ?Counters {
+        var read: ?u64 = null;
+        var written: ?u64 = null;
+        var lines = std.mem.tokenizeScalar(u8, text, '\n');
+        while (lines.next()) |line| {
+            const colon = std.mem.indexOfScalar(u8, line, ':') orelse continue;
+            const value = std.fmt.parseInt(u64, std.mem.trim(u8, line[colon + 1 ..], " "), 10) catch continue;
+            const key = line[0..colon];
+            if (std.mem.eql(u8, key, "rchar")) {
+                read = value;
+            } else if (std.mem.eql(u8, key, "wchar")) {
+                written = value;
+            }
+        }
+        return .{ .read = read orelse return null, .written = written orelse return null };
+    }
+};
+
+/// Snapshot taken just before a resource applies; `finish` turns it into
+/// the resource's stats
+const StatsProbe = struct {
+    start_ns: i128,
+    io: ?ProcIo.Counters,
+    allocations: u64,
+    allocated_bytes: u64,
+
+    fn begin(proc_io: ProcIo, counting: *CountingAllocator) StatsProbe {
+        base.resetApplyCounters();
+        return .{
+            .start_ns = std.time.nanoTimestamp(),
+            .io = proc_io.sample(),
+            .allocations = counting.allocations.load(.monotonic),
+            .allocated_bytes = counting.bytes_allocated.load(.monotonic),
+        };
+    }
+
+    fn finish(self: StatsProbe, proc_io: ProcIo, counting: *CountingAllocator) ResourceStats {
+        const counters = base.takeApplyCounters();
+        var stats = ResourceStats{
+            .wall_ns = @intCast(@max(std.time.nanoTimestamp() - self.start_ns, 0)),
+            .guard_ns = counters.guard_ns,
+            .subprocesses = counters.subprocesses,
+            .allocations = counting.allocations.load(.monotonic) -| self.allocations,
+            .allocated_bytes = counting.bytes_allocated.load(.monotonic) -| self.allocated_bytes,
+        };
+        if (self.io) |before| {
+            if (proc_io.sample()) |after| {
+                stats.bytes_read = after.read -| before.read;
+                stats.bytes_written = after.written -| before.written;
+            }
+        }
+        return stats;
+    }
 };
 
+// Wraps the allocator handed to run() so allocations can be attributed to
+// individual resources. Static rather than on run()'s stack because the API
+// modules keep the allocator in globals that outlive the call.
+var run_allocator: CountingAllocator = undefined;
+
 pub const ProvisionResult = struct {
     executed_count: usize,
     updated_count: usize,
@@ -63,6 +260,9 @@ const ProvisionRunner = struct {
     allocator: std.mem.Allocator,
     resources: std.ArrayList(resources.ResourceWithMetadata),
     display: ?*modern_display.ModernProvisionDisplay = null,
+    package_gate: ?*PackageGate = null,
+    /// Interpreter the resources' pinned strings live in
+    mrb: ?*mruby.mrb_state = null,
 
     fn init(allocator: std.mem.Allocator) ProvisionRunner {
         return .{
@@ -76,6 +276,8 @@ const ProvisionRunner = struct {
             res.deinit(self.allocator);
         }
         self.resources.deinit(self.allocator);
+        // Nothing references the pinned attribute strings any more
+        if (self.mrb) |mrb| mruby.unpinStrs(mrb);
     }
 };
 
@@ -89,6 +291,7 @@ fn requireRunner() *ProvisionRunner {
 fn pollDisplayUpdate() !void {
     if (current_runner) |runner| {
         if (runner.display) |display| {
+            if (runner.package_gate) |gate| try showPackageProgress(gate, display);
             try display.update();
         }
     }
@@ -104,6 +307,143 @@ const PendingNotification = struct {
     source_id: []const u8,
 };
 
+/// Queue the notifications of an updated resource by timing
+fn queueNotifications(
+    allocator: std.mem.Allocator,
+    res: *const resources.ResourceWithMetadata,
+    immediate: *std.ArrayList(PendingNotification),
+    delayed: *std.ArrayList(PendingNotification),
+) !void {
+    for (res.notifications.items) |notif| {
+        const pending = PendingNotification{
+            .notification = notif,
+            .source_id = try res.id.toString(allocator),
+        };
+
+        if (notif.timing == .immediate) {
+            try immediate.append(allocator, pending);
+        } else {
+            try delayed.append(allocator, pending);
+        }
+    }
+}
+
+const checkpoint_skip_reason = "converged in previous run";
+
+/// Watch mode: re-apply resources whose input files change. Returns when
+/// the script changes, since that needs a full evaluation.
+fn watchInputs(allocator: std.mem.Allocator, runner: *ProvisionRunner, opts: Options) !void {
+    const script_path = opts.script_path;
+    var watcher = try file_watcher.Watcher.init(allocator);
+    defer watcher.deinit();
+
+    const script_key = try watcher.add(script_path);
+
+    // Watched path -> indices of the resources that read it
+    var dependents = std.StringHashMapUnmanaged(std.ArrayList(usize)){};
+    defer {
+        var it = dependents.valueIterator();
+        while (it.next()) |list| list.deinit(allocator);
+        dependents.deinit(allocator);
+    }
+
+    for (runner.resources.items, 0..) |*res, index| {
+        const input = res.resource.localInput() orelse continue;
+        const key = watcher.add(input) catch |err| {
+            logger.warn("watch: cannot watch {s}: {}", .{ input, err });
+            continue;
+        };
+        const gop = try dependents.getOrPut(allocator, key);
+        if (!gop.found_existing) gop.value_ptr.* = .empty;
+        try gop.value_ptr.append(allocator, index);
+    }
+
+    std.debug.print("\n\x1b[36mWatching {d} files for changes (Ctrl-C to stop)\x1b[0m\n", .{watcher.count()});
+
+    var changed = std.ArrayList([]const u8).empty;
+    defer changed.deinit(allocator);
+    var affected = std.ArrayList(usize).empty;
+    defer affected.deinit(allocator);
+
+    while (true) {
+        changed.clearRetainingCapacity();
+        try watcher.wait(&changed);
+
+        affected.clearRetainingCapacity();
+        for (changed.items) |path| {
+            if (path.ptr == script_key.ptr) {
+                std.debug.print("\n\x1b[36m{s} changed, re-evaluating\x1b[0m\n", .{script_path});
+                return;
+            }
+            if (dependents.get(path)) |indices| try affected.appendSlice(allocator, indices.items);
+        }
+        if (affected.items.len == 0) continue;
+
+        std.mem.sort(usize, affected.items, {}, std.sort.asc(usize));
+        // Anything may have changed on disk while we were waiting
+        dir_cache.reset();
+        try reapplyResources(allocator, runner, affected.items, opts.use_pretty_output);
+    }
+}
+
+/// Apply the resources at `indices` (in script order) and process the
+/// notifications they trigger: immediate ones right after the resource that
+/// fired them, delayed ones at the end. Failures are shown and left for the
+/// next change to retry.
+fn reapplyResources(allocator: std.mem.Allocator, runner: *ProvisionRunner, indices: []const usize, use_pretty_output: bool) !void {
+    var display = try modern_display.ModernProvisionDisplay.init(allocator, use_pretty_output);
+    defer display.deinit();
+    display.setTotalResources(indices.len);
+
+    var immediate_notifications = std.ArrayList(PendingNotification).empty;
+    var delayed_notifications = std.ArrayList(PendingNotification).empty;
+    defer {
+        for (immediate_notifications.items) |pending| allocator.free(pending.source_id);
+        for (delayed_notifications.items) |pending| allocator.free(pending.source_id);
+        immediate_notifications.deinit(allocator);
+        delayed_notifications.deinit(allocator);
+    }
+
+    std.debug.print("\n", .{});
+    for (indices) |index| {
+        const res = &runner.resources.items[index];
+        base.clearProvisionErrorDetail();
+        try display.startResource(res.id.type_name, res.id.name);
+
+        const result = res.resource.apply() catch |err| {
+            const detail = base.getProvisionErrorDetail() orelse @errorName(err);
+            try display.resourceError(res.id.type_name, res.id.name, detail);
+            continue;
+        };
+        defer if (result.output) |o| std.heap.c_allocator.free(o);
+
+        if (result.was_updated) {
+            try display.resourceUpdated(res.id.type_name, res.id.name, result.action, result.skip_reason);
+            if (result.skip_reason == null or !std.mem.eql(u8, result.skip_reason.?, "up to date")) {
+                try queueNotifications(allocator, res, &immediate_notifications, &delayed_notifications);
+            }
+        } else {
+            try display.resourceSkipped(res.id.type_name, res.id.name, result.action, result.skip_reason);
+        }
+
+        for (immediate_notifications.items) |pending| {
+            try processNotification(allocator, pending, &display);
+        }
+        for (immediate_notifications.items) |pending| allocator.free(pending.source_id);
+        immediate_notifications.clearRetainingCapacity();
+    }
+
+    for (delayed_notifications.items) |pending| {
+        try processNotification(allocator, pending, &display);
+    }
+}
+
+fn openJournal(allocator: std.mem.Allocator, key: []const u8, opts: Options) !checkpoint.Journal {
+    const script_hash = try checkpoint.hashScript(allocator, opts.script_path);
+    const params_hash = checkpoint.hashParams(opts.params_json, opts.secrets_json);
+    return checkpoint.Journal.open(allocator, key, script_hash, params_hash, opts.resume_run);
+}
+
 fn cloneNotificationsFromCommon(
     allocator: std.mem.Allocator,
     common: *const base.CommonProps,
@@ -348,6 +688,109 @@ fn getShortFileNameFromUrl(url: []const u8) []const u8 {
     return url;
 }
 
+/// Whether Phase 0 may have queued a download task for this resource
+fn hasPrefetchedDownload(resource: resources.Resource) bool {
+    if (resource == .remote_file) return true;
+    if (is_linux) {
+        if (resource == .apt_repository) return true;
+    }
+    return false;
+}
+
+/// Locations the package phase installs into. Files there may be shipped
+/// by a package (dpkg conffiles such as /etc/nginx/nginx.conf), so writing
+/// them before installation would race the package manager.
+const package_managed_prefixes = [_][]const u8{
+    "/etc/",
+    "/usr/",
+    "/opt/",
+    "/var/lib/",
+    "/lib/",
+    "/bin/",
+    "/sbin/",
+};
+
+/// Whether a resource writing `path` with the given ownership has to wait
+/// for packages: owners and groups are often created by a package (postgres,
+/// www-data), and package-managed paths may be overwritten by one
+fn writesPackageFiles(path: []const u8, owner: ?[]const u8, group: ?[]const u8) bool {
+    if (owner != null or group != null) return true;
+    if (!std.fs.path.isAbsolute(path)) return true;
+    for (package_managed_prefixes) |prefix| {
+        if (std.mem.startsWith(u8, path, prefix)) return true;
+    }
+    return false;
+}
+
+/// Whether a resource has to wait for concurrent package installation.
+/// Guards run shell commands or Ruby blocks, so any guarded resource waits;
+/// so does anything that runs commands, manages accounts or mounts, or
+/// writes files a package may own. Only routes, macOS settings and files
+/// outside package-managed locations start early.
+fn needsPackages(resource: *resources.Resource) bool {
+    if (resource.getCommonProps().hasGuards()) return true;
+
+    return switch (resource.*) {
+        .execute, .ruby_block, .package, .user, .group => true,
+        .route => false,
+        .file => |*res| writesPackageFiles(res.path, res.attrs.owner, res.attrs.group),
+        .template => |*res| writesPackageFiles(res.path, res.attrs.owner, res.attrs.group),
+        .directory => |*res| writesPackageFiles(res.path, res.attrs.owner, res.attrs.group),
+        .remote_file => |*res| writesPackageFiles(res.path, res.attrs.owner, res.attrs.group),
+        .extract => |*res| writesPackageFiles(res.destination, res.attrs.owner, res.attrs.group),
+        .link => |*res| blk: {
+            if (writesPackageFiles(res.path, res.owner, res.group)) break :blk true;
+            for (res.links) |entry| {
+                if (writesPackageFiles(entry.path, null, null)) break :blk true;
+            }
+            break :blk false;
+        },
+        .file_edit => |*res| writesPackageFiles(res.path, res.owner, res.group),
+        .aws_kms => |*res| writesPackageFiles(res.path, res.owner, res.group),
+        .git => |*res| writesPackageFiles(res.destination, res.user, res.group),
+        // Platform-specific types: package managers, units, mounts and apt
+        // sources wait; macOS dock and defaults settings do not
+        inline else => |_, tag| comptime platformTypeNeedsPackages(tag),
+    };
+}
+
+fn platformTypeNeedsPackages(comptime tag: anytype) bool {
+    const name = @tagName(tag);
+    return !std.mem.eql(u8, name, "macos_dock") and !std.mem.eql(u8, name, "macos_defaults");
+}
+
+/// Block until the package gate opens, keeping the display animated
+fn waitForPackages(gate: *PackageGate, display: *modern_display.ModernProvisionDisplay) !void {
+    if (!gate.isOpen()) {
+        try display.showInfo("Waiting for package installation to finish...");
+        while (!gate.isOpen()) {
+            try showPackageProgress(gate, display);
+            try display.update();
+            std.Thread.sleep(10 * std.time.ns_per_ms);
+        }
+    }
+    try showPackageProgress(gate, display);
+
+    if (gate.hasFailed()) {
+        base.recordProvisionErrorDetailSlice("package installation failed");
+        return error.PackageInstallFailed;
+    }
+}
+
+/// Mirror the package phase on the display's package line, and end the line
+/// as soon as the phase finishes so a failure shows up right away
+fn showPackageProgress(gate: *PackageGate, display: *modern_display.ModernProvisionDisplay) !void {
+    if (!display.packagePhaseRunning()) return;
+
+    var buf: [PackageGate.status_capacity]u8 = undefined;
+    const status = gate.readStatus(&buf);
+    if (gate.isOpen()) {
+        try display.finishPackagePhase(!gate.hasFailed(), status);
+    } else if (status.len > 0) {
+        try display.updatePackagePhase(status);
+    }
+}
+
 /// Process a notification by finding the target resource and triggering the action
 fn processNotification(allocator: std.mem.Allocator, pending: PendingNotification, display: *modern_display.ModernProvisionDisplay) !void {
     const runner = requireRunner();
@@ -728,11 +1171,11 @@ fn registerResourceBindings(mrb_ptr: *mruby.mrb_state, zig_module: *mruby.RClass
         .{ .name = "add_file", .handler = zig_add_file_resource, .args_spec = mruby.MRB_ARGS_REQ(6) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_execute", .handler = zig_add_execute_resource, .args_spec = mruby.MRB_ARGS_REQ(10) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_remote_file", .handler = zig_add_remote_file_resource, .args_spec = mruby.MRB_ARGS_REQ(12) | mruby.MRB_ARGS_OPT(15) },
-        .{ .name = "add_template", .handler = zig_add_template_resource, .args_spec = mruby.MRB_ARGS_REQ(7) | mruby.MRB_ARGS_OPT(5) },
+        .{ .name = "add_template", .handler = zig_add_template_resource, .args_spec = mruby.MRB_ARGS_REQ(8) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_macos_dock", .handler = zig_add_macos_dock_resource, .args_spec = mruby.MRB_ARGS_REQ(1) | mruby.MRB_ARGS_OPT(10), .platform = .macos },
         .{ .name = "add_directory", .handler = zig_add_directory_resource, .args_spec = mruby.MRB_ARGS_REQ(6) | mruby.MRB_ARGS_OPT(5) },
-        .{ .name = "add_link", .handler = zig_add_link_resource, .args_spec = mruby.MRB_ARGS_REQ(4) | mruby.MRB_ARGS_OPT(6) },
-        .{ .name = "add_route", .handler = zig_add_route_resource, .args_spec = mruby.MRB_ARGS_REQ(5) | mruby.MRB_ARGS_OPT(5) },
+        .{ .name = "add_link", .handler = zig_add_link_resource, .args_spec = mruby.MRB_ARGS_REQ(4) | mruby.MRB_ARGS_OPT(7) },
+        .{ .name = "add_route", .handler = zig_add_route_resource, .args_spec = mruby.MRB_ARGS_REQ(6) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_macos_defaults", .handler = zig_add_macos_defaults_resource, .args_spec = mruby.MRB_ARGS_REQ(2) | mruby.MRB_ARGS_OPT(9), .platform = .macos },
         .{ .name = "add_apt_repository", .handler = zig_add_apt_repository_resource, .args_spec = mruby.MRB_ARGS_REQ(10) | mruby.MRB_ARGS_OPT(5), .platform = .linux },
         .{ .name = "add_systemd_unit", .handler = zig_add_systemd_unit_resource, .args_spec = mruby.MRB_ARGS_REQ(3) | mruby.MRB_ARGS_OPT(5), .platform = .linux },
@@ -741,10 +1184,10 @@ fn registerResourceBindings(mrb_ptr: *mruby.mrb_state, zig_module: *mruby.RClass
         .{ .name = "add_homebrew_package", .handler = zig_add_homebrew_package_resource, .args_spec = mruby.MRB_ARGS_REQ(4) | mruby.MRB_ARGS_OPT(5), .platform = .macos },
         .{ .name = "add_apt_package", .handler = zig_add_apt_package_resource, .args_spec = mruby.MRB_ARGS_REQ(4) | mruby.MRB_ARGS_OPT(5), .platform = .linux },
         .{ .name = "add_ruby_block", .handler = zig_add_ruby_block_resource, .args_spec = mruby.MRB_ARGS_REQ(4) | mruby.MRB_ARGS_OPT(5) },
-        .{ .name = "add_git", .handler = zig_add_git_resource, .args_spec = mruby.MRB_ARGS_REQ(14) | mruby.MRB_ARGS_OPT(5) },
+        .{ .name = "add_git", .handler = zig_add_git_resource, .args_spec = mruby.MRB_ARGS_REQ(15) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_user", .handler = zig_add_user_resource, .args_spec = mruby.MRB_ARGS_REQ(11) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_group", .handler = zig_add_group_resource, .args_spec = mruby.MRB_ARGS_REQ(9) | mruby.MRB_ARGS_OPT(5) },
-        .{ .name = "add_aws_kms", .handler = zig_add_aws_kms_resource, .args_spec = mruby.MRB_ARGS_REQ(15) | mruby.MRB_ARGS_OPT(5) },
+        .{ .name = "add_aws_kms", .handler = zig_add_aws_kms_resource, .args_spec = mruby.MRB_ARGS_REQ(17) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_file_edit", .handler = zig_add_file_edit_resource, .args_spec = mruby.MRB_ARGS_REQ(6) | mruby.MRB_ARGS_OPT(5) },
         .{ .name = "add_extract", .handler = zig_add_extract_resource, .args_spec = mruby.MRB_ARGS_REQ(8) | mruby.MRB_ARGS_OPT(5) },
     };
@@ -762,45 +1205,19 @@ fn registerResourceBindings(mrb_ptr: *mruby.mrb_state, zig_module: *mruby.RClass
     }
 }
 
-/// Inject a JSON string into mruby as a global variable via JSON.parse.
-fn injectJsonGlobal(mrb: *mruby.mrb_state, global_name: []const u8, json_str: []const u8) !void {
-    var escaped_len: usize = 0;
-    for (json_str) |ch| {
-        escaped_len += if (ch == '\'' or ch == '\\') @as(usize, 2) else 1;
-    }
-
-    const allocator = std.heap.c_allocator;
-    const buf = try allocator.alloc(u8, global_name.len + escaped_len + 64 + 1);
-    defer allocator.free(buf);
-
-    var pos: usize = 0;
-    @memcpy(buf[pos .. pos + global_name.len], global_name);
-    pos += global_name.len;
-    const assign = " = JSON.parse('";
-    @memcpy(buf[pos .. pos + assign.len], assign);
-    pos += assign.len;
-
-    for (json_str) |ch| {
-        if (ch == '\'' or ch == '\\') {
-            buf[pos] = '\\';
-            pos += 1;
-        }
-        buf[pos] = ch;
-        pos += 1;
-    }
-
-    const suffix = "')";
-    @memcpy(buf[pos .. pos + suffix.len], suffix);
-    pos += suffix.len;
-
-    buf[pos] = 0;
-    _ = mruby.mrb_load_string(mrb, buf.ptr);
-
-    const exc = mruby.mrb_get_exception(mrb);
-    if (mruby.mrb_test(exc)) {
-        mruby.mrb_print_error(mrb);
-        return error.MRubyException;
-    }
+/// Inject a JSON document into mruby as a global HolaJsonView. The JSON is
+/// parsed once on the Zig side; Ruby objects are built only for the paths
+/// the script reads. Invalid JSON leaves the global as the prelude set it,
+/// as JSON.parse returning nil used to.
+fn injectJsonGlobal(mrb: *mruby.mrb_state, global_name: [:0]const u8, json_str: []const u8) !void {
+    const view = json_view.open(mrb, json_str) catch |err| switch (err) {
+        error.MRubyException, error.OutOfMemory, error.NotInitialized => return err,
+        else => {
+            logger.warn("{s}: invalid JSON: {}", .{ global_name, err });
+            return;
+        },
+    };
+    mruby.mrb_gv_set(mrb, mruby.mrb_intern_cstr(mrb, global_name), view);
 }
 
 /// Inject params JSON into mruby as $_hola_params global variable.
@@ -813,7 +1230,43 @@ fn injectSecrets(mrb: *mruby.mrb_state, secrets_json: []const u8) !void {
     try injectJsonGlobal(mrb, "$_hola_secrets", secrets_json);
 }
 
-pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
+/// remote_file resources whose local file already has the pinned checksum,
+/// by resource index. The files are hashed as one concurrent batch; prefetch
+/// skips them and the resource itself then reports up to date from the
+/// memoized digest.
+fn checksumCurrentRemoteFiles(allocator: std.mem.Allocator, runner: *const ProvisionRunner) !std.DynamicBitSetUnmanaged {
+    var current = try std.DynamicBitSetUnmanaged.initEmpty(allocator, runner.resources.items.len);
+    errdefer current.deinit(allocator);
+
+    var items = std.ArrayList(hashing.BatchItem).empty;
+    defer items.deinit(allocator);
+    var expected = std.ArrayList(struct { index: usize, checksum: hashing.Checksum }).empty;
+    defer expected.deinit(allocator);
+
+    for (runner.resources.items, 0..) |*res, index| {
+        if (res.resource != .remote_file) continue;
+        const remote_res = &res.resource.remote_file;
+        const checksum = hashing.Checksum.parse(remote_res.checksum orelse continue) catch continue;
+        std.fs.cwd().access(remote_res.path, .{}) catch continue;
+
+        try items.append(allocator, .{ .path = remote_res.path, .algorithm = checksum.algorithm });
+        try expected.append(allocator, .{ .index = index, .checksum = checksum });
+    }
+
+    hashing.hashFiles(items.items);
+    for (items.items, expected.items) |item, entry| {
+        const digest = item.result catch continue;
+        if (entry.checksum.matches(digest)) current.set(entry.index);
+    }
+    return current;
+}
+
+pub fn run(parent_allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
+    var phase_clock = PhaseTimings.Clock.start(opts.phase_timings);
+
+    run_allocator = CountingAllocator.init(parent_allocator);
+    const allocator = run_allocator.allocator();
+
     // Provision error detail buffer is threadlocal; clear at entry so a prior
     // invocation on this thread can't leak into this run.
     base.clearProvisionErrorDetail();
@@ -826,6 +1279,11 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     // teardown) run before the mruby state is closed.
     var mrb = try mruby.State.init();
     defer mrb.deinit();
+    // Documents behind $_hola_params / $_hola_secrets, read until the end
+    defer json_view.reset();
+    // Directories seen by earlier runs in this process may be gone
+    dir_cache.reset();
+    defer dir_cache.reset();
 
     var runner = ProvisionRunner.init(allocator);
     defer runner.deinit();
@@ -835,6 +1293,7 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
 
     // Register Zig functions in mruby
     const mrb_ptr = mrb.mrb orelse return error.MRubyNotInitialized;
+    runner.mrb = mrb_ptr;
     const zig_module = mruby.mrb_define_module(mrb_ptr, "ZigBackend");
     registerResourceBindings(mrb_ptr, zig_module);
 
@@ -844,6 +1303,7 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     const api_modules = [_]mruby_module.MRubyModule{
         file_ext.mruby_module_def, // File.stat and File.mtime extensions
         json.mruby_module_def,
+        json_view.mruby_module_def, // data_bag / secrets_bag documents
         http.mruby_module_def,
         base64.mruby_module_def,
         hola_logger.mruby_module_def,
@@ -860,11 +1320,14 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     // This registers File.stat and File.mtime as class methods
     file_ext.setupFileExtensions(mrb_ptr);
 
-    // Load OpenStruct utility class (used by node object and other resources)
-    try mrb.evalString(@embedFile("ruby_prelude/open_struct.rb"));
+    // Base64 module methods are bound straight to the Zig codec
+    base64.setupBase64Module(mrb_ptr);
 
-    // Load Time.parse polyfill (mruby ships no Regexp, no Time.parse)
-    try mrb.evalString(@embedFile("ruby_prelude/time_parse.rb"));
+    // Native OpenStruct (used by node object and other resources)
+    mruby.zig_mrb_define_open_struct(mrb_ptr);
+
+    // Native Time.parse (mruby ships no Regexp, no Time.parse)
+    time_ext.setupTimeExtensions(mrb_ptr);
 
     // Load Ruby DSL preludes for resource types
     try mrb.evalString(resources.file.ruby_prelude);
@@ -925,6 +1388,8 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         try mrb.evalString(@embedFile("ruby_prelude/test_helper.rb"));
     }
 
+    phase_clock.lap("setup_ns");
+
     // Load and execute user's recipe
     // Use evalFile instead of evalString to preserve file path and line numbers in error messages.
     // On failure, capture the mruby exception summary (ClassName + message) so
@@ -941,6 +1406,19 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         return err;
     };
 
+    phase_clock.lap("eval_ns");
+
+    if (opts.watch_inputs) |inputs| {
+        for (runner.resources.items) |*res| {
+            const input = res.resource.localInput() orelse continue;
+            const owned = try parent_allocator.dupe(u8, input);
+            inputs.append(parent_allocator, owned) catch |err| {
+                parent_allocator.free(owned);
+                return err;
+            };
+        }
+    }
+
     // Record start time for timer
     const start_time = std.time.nanoTimestamp();
 
@@ -963,6 +1441,9 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     var display = try modern_display.ModernProvisionDisplay.init(allocator, opts.use_pretty_output);
     defer display.deinit();
 
+    const proc_io = ProcIo.open();
+    defer proc_io.close();
+
     // Set global display for async executor callback
     runner.display = &display;
     defer runner.display = null;
@@ -1043,12 +1524,20 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
 
     download_mgr.setDisplay(@ptrCast(progress_ctx), ProgressContext.callback);
 
+    var checksum_current = try checksumCurrentRemoteFiles(allocator, &runner);
+    defer checksum_current.deinit(allocator);
+
     // Collect all remote_file resources for parallel download
     // Only pre-download simple files (no conditions like only_if/not_if, and action is :create)
-    for (runner.resources.items) |*res| {
+    for (runner.resources.items, 0..) |*res, index| {
         if (res.resource == .remote_file) {
             const remote_res = &res.resource.remote_file;
 
+            // Local file already has the pinned checksum; nothing to fetch
+            if (checksum_current.isSet(index)) {
+                continue;
+            }
+
             // Skip files with conditions - they will be downloaded when executed
             if (remote_res.common.only_if_block != null or remote_res.common.not_if_block != null) {
                 continue;
@@ -1124,6 +1613,31 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         }
     }
 
+    // Fetch apt_repository signing keys alongside remote files. The resource
+    // compares the prefetched key with the installed keyring by content, so
+    // rotated keys are picked up without re-downloading them serially.
+    if (is_linux) {
+        for (runner.resources.items) |*res| {
+            if (res.resource != .apt_repository) continue;
+            const apt_res = &res.resource.apt_repository;
+
+            if (apt_res.action != .add or apt_res.common.hasGuards()) continue;
+            const key_url = apt_res.key_url orelse continue;
+
+            const temp_path = try resources.apt_repository.prefetchKeyPath(allocator, apt_res.name);
+            defer allocator.free(temp_path);
+            // A leftover from an interrupted run must not pass for this download
+            std.fs.cwd().deleteFile(temp_path) catch {};
+
+            const resource_id = try std.fmt.allocPrint(allocator, "{s}[{s}]", .{ res.id.type_name, res.id.name });
+            defer allocator.free(resource_id);
+
+            const task = try http.download.Task.init(allocator, resource_id, key_url, key_url, temp_path, temp_path);
+            try download_mgr.addTask(task);
+            apt_res.key_prefetched = true;
+        }
+    }
+
     if (download_mgr.tasks.items.len > 0) {
         // Show download section header
         try display.showSectionWithLevel("Downloading Remote Files", 3);
@@ -1155,6 +1669,12 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     // Start the real-time timer spinner (after all download spinners are created)
     try display.startTimer(start_time);
 
+    if (opts.package_gate) |gate| {
+        runner.package_gate = gate;
+        try display.startPackagePhase();
+    }
+    defer runner.package_gate = null;
+
     // Track immediate and delayed notifications
     var immediate_notifications = std.ArrayList(PendingNotification).empty;
     defer immediate_notifications.deinit(allocator);
@@ -1191,15 +1711,128 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         }
     }
 
+    // Consecutive guard-free routes are diffed against the routing table and
+    // programmed together when the first route of the run is reached
+    var route_batch = resources.route.Batch.init(allocator);
+    defer route_batch.deinit();
+    // Index past the last route already programmed by route_batch
+    var route_run_end: usize = 0;
+    // A run cut short by a failure must not leave results for later applies
+    defer for (runner.resources.items) |*res| {
+        if (res.resource == .route) res.resource.route.batch_result = null;
+    };
+
+    // Guard-free decrypts (plain ciphertexts and envelope data keys) are
+    // sent to KMS as one concurrent batch; each resource then finds its
+    // result on itself
+    defer resources.aws_kms.releaseSharedState();
+    defer for (runner.resources.items) |*res| {
+        if (res.resource == .aws_kms) res.resource.aws_kms.releasePrefetched();
+    };
+    {
+        var kms_candidates = std.ArrayList(*resources.aws_kms.Resource).empty;
+        defer kms_candidates.deinit(allocator);
+        for (runner.resources.items) |*res| {
+            if (res.resource != .aws_kms) continue;
+            const kms_res = &res.resource.aws_kms;
+            if (kms_res.action == .decrypt and !kms_res.common.hasGuards()) {
+                try kms_candidates.append(allocator, kms_res);
+            }
+        }
+        if (kms_candidates.items.len > 1) {
+            resources.aws_kms.prefetchDecrypts(allocator, kms_candidates.items);
+        }
+    }
+
+    phase_clock.lap("prefetch_ns");
+
+    var journal: ?checkpoint.Journal = null;
+    defer if (journal) |*j| j.deinit();
+    if (opts.checkpoint_key) |key| {
+        journal = openJournal(allocator, key, opts) catch |err| blk: {
+            logger.warn("checkpoint: journal disabled: {}", .{err});
+            break :blk null;
+        };
+        if (opts.resume_run) {
+            const resumable = if (journal) |*j| j.resumableCount() else 0;
+            if (resumable > 0) {
+                const msg = try std.fmt.allocPrint(allocator, "Resuming: {d} resources converged in the previous run", .{resumable});
+                defer allocator.free(msg);
+                try display.showInfo(msg);
+            } else {
+                try display.showInfo("No usable checkpoint; applying all resources");
+            }
+        }
+    }
+
     // Phase 1: Execute resources and collect notifications
-    for (runner.resources.items) |*res| {
+    for (runner.resources.items, 0..) |*res, index| {
         base.clearProvisionErrorDetail();
+
+        // A failed package phase ends the run here rather than after every
+        // ungated resource has gone through
+        if (opts.package_gate) |gate| {
+            try showPackageProgress(gate, &display);
+            if (gate.hasFailed()) {
+                base.recordProvisionErrorDetailSlice("package installation failed");
+                return error.PackageInstallFailed;
+            }
+        }
+
+        const fingerprint = if (journal) |*j| j.fingerprint(res) else 0;
+        if (journal) |*j| {
+            if (j.resumed(index, fingerprint)) |entry| {
+                try display.startResource(res.id.type_name, res.id.name);
+                try display.resourceSkipped(res.id.type_name, res.id.name, entry.action, checkpoint_skip_reason);
+                try display.update();
+
+                try resource_results.append(allocator, .{
+                    .type_name = try allocator.dupe(u8, res.id.type_name),
+                    .name = try allocator.dupe(u8, res.id.name),
+                    .action = try allocator.dupe(u8, entry.action),
+                    .was_updated = false,
+                    .skipped = true,
+                    .skip_reason = try allocator.dupe(u8, checkpoint_skip_reason),
+                    .error_name = null,
+                    .output = null,
+                });
+
+                // The failed run never got to its notifications
+                if (entry.notified) {
+                    res.was_updated = true;
+                    try queueNotifications(allocator, res, &immediate_notifications, &delayed_notifications);
+                }
+                j.record(index, fingerprint, entry.notified, entry.action);
+                continue;
+            }
+        }
+
+        if (opts.package_gate) |gate| {
+            if (needsPackages(&res.resource)) try waitForPackages(gate, &display);
+        }
         try display.startResource(res.id.type_name, res.id.name);
         try display.update();
 
-        // Wait for download task if this is a remote_file resource
-        if (res.resource == .remote_file and download_thread != null) {
-            // Find the download task for this specific remote_file resource
+        // Batch results are for this apply only; notifications and
+        // watch-mode re-applies program the route or decrypt again
+        defer switch (res.resource) {
+            .route => |*route| route.batch_result = null,
+            .aws_kms => |*kms_res| kms_res.releasePrefetched(),
+            else => {},
+        };
+        if (res.resource == .route and index >= route_run_end) {
+            const items = runner.resources.items;
+            var end = index;
+            while (end < items.len and items[end].resource == .route and resources.route.Batch.accepts(&items[end].resource.route)) : (end += 1) {
+                try route_batch.add(&items[end].resource.route);
+            }
+            route_run_end = @max(end, index + 1);
+            route_batch.commit();
+        }
+
+        // Wait for the download task if this resource was prefetched
+        if (hasPrefetchedDownload(res.resource) and download_thread != null) {
+            // Find the download task for this specific resource
             const resource_id = try std.fmt.allocPrint(allocator, "{s}[{s}]", .{ res.id.type_name, res.id.name });
             defer allocator.free(resource_id);
 
@@ -1224,9 +1857,10 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
                     }
                 }
 
-                // Check if the download failed
+                // Check if the download failed. A failed key prefetch is not
+                // fatal: apt_repository downloads the key itself when needed.
                 const final_status = task.status.load(.acquire);
-                if (final_status == .failed) {
+                if (final_status == .failed and res.resource == .remote_file) {
                     const err_msg_owned = task.getError(allocator);
                     defer if (err_msg_owned) |msg| allocator.free(msg);
                     const err_msg = err_msg_owned orelse "Unknown error";
@@ -1240,7 +1874,11 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
             }
         }
 
+        const probe = StatsProbe.begin(proc_io, &run_allocator);
         const result = res.resource.apply() catch |err| {
+            const stats = probe.finish(proc_io, &run_allocator);
+            try display.recordResourceTime(res.id.type_name, res.id.name, stats.wall_ns);
+
             const detail_msg = base.getProvisionErrorDetail();
             const error_display = detail_msg orelse @errorName(err);
             try display.resourceError(res.id.type_name, res.id.name, error_display);
@@ -1256,6 +1894,7 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
                 .error_name = try allocator.dupe(u8, @errorName(err)),
                 .error_message = if (detail_msg) |m| try allocator.dupe(u8, m) else null,
                 .output = null,
+                .stats = stats,
             });
 
             // Check if this resource has ignore_failure set
@@ -1267,6 +1906,9 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
                 return err;
             }
         };
+        const stats = probe.finish(proc_io, &run_allocator);
+        try display.recordResourceTime(res.id.type_name, res.id.name, stats.wall_ns);
+
         // Free resource-allocated output after duping into resource_results
         defer if (result.output) |o| std.heap.c_allocator.free(o);
         res.was_updated = result.was_updated;
@@ -1287,23 +1929,15 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
                 .skip_reason = if (result.skip_reason) |sr| try allocator.dupe(u8, sr) else null,
                 .error_name = null,
                 .output = if (result.output) |o| try allocator.dupe(u8, o) else null,
+                .stats = stats,
             });
 
             // Collect notifications from updated resources (only if actually updated, not "up to date")
-            if (result.skip_reason == null or !std.mem.eql(u8, result.skip_reason.?, "up to date")) {
-                for (res.notifications.items) |notif| {
-                    const pending = PendingNotification{
-                        .notification = notif,
-                        .source_id = try res.id.toString(allocator),
-                    };
-
-                    if (notif.timing == .immediate) {
-                        try immediate_notifications.append(allocator, pending);
-                    } else {
-                        try delayed_notifications.append(allocator, pending);
-                    }
-                }
+            const notified = result.skip_reason == null or !std.mem.eql(u8, result.skip_reason.?, "up to date");
+            if (notified) {
+                try queueNotifications(allocator, res, &immediate_notifications, &delayed_notifications);
             }
+            if (journal) |*j| j.record(index, fingerprint, notified, result.action);
         } else {
             // Resource was not updated - show skip reason (including "up to date")
             try display.resourceSkipped(res.id.type_name, res.id.name, result.action, result.skip_reason);
@@ -1318,7 +1952,18 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
                 .skip_reason = if (result.skip_reason) |sr| try allocator.dupe(u8, sr) else null,
                 .error_name = null,
                 .output = null,
+                .stats = stats,
             });
+            if (journal) |*j| j.record(index, fingerprint, false, result.action);
+        }
+    }
+
+    phase_clock.lap("execute_ns");
+
+    // Notification targets are not classified; run them with packages in place
+    if (opts.package_gate) |gate| {
+        if (immediate_notifications.items.len > 0 or delayed_notifications.items.len > 0) {
+            try waitForPackages(gate, &display);
         }
     }
 
@@ -1338,6 +1983,8 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         }
     }
 
+    phase_clock.lap("notify_ns");
+
     // Wait for download thread to complete
     if (download_thread) |thread| {
         try display.showInfo("Waiting for remaining downloads to complete...");
@@ -1352,6 +1999,11 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
         }
     }
 
+    phase_clock.lap("download_wait_ns");
+
+    // Everything converged; a later --resume has nothing to skip
+    if (journal) |*j| j.complete();
+
     // Cleanup pending notifications
     for (immediate_notifications.items) |pending| {
         allocator.free(pending.source_id);
@@ -1367,6 +2019,10 @@ pub fn run(allocator: std.mem.Allocator, opts: Options) !ProvisionResult {
     const end_time = std.time.nanoTimestamp();
     const elapsed_ms = @divTrunc(end_time - start_time, std.time.ns_per_ms);
 
+    // Stay in this run, with the interpreter and resources alive, until the
+    // script itself changes; the caller then starts a fresh run
+    if (opts.watch) try watchInputs(allocator, &runner, opts);
+
     return ProvisionResult{
         .executed_count = display.executed_count,
         .updated_count = display.updated_count,
@@ -1390,6 +2046,12 @@ test "injectSecrets and secrets_bag reads values correctly" {
         mruby.mrb_define_module_function(mrb_ptr, zig_module, func.name.ptr, func.func, func.args);
     }
     try mrb.evalString(json.ruby_prelude);
+    json_view.setAllocator(std.testing.allocator);
+    defer json_view.reset();
+    for (json_view.mruby_module_def.getFunctions()) |func| {
+        mruby.mrb_define_module_function(mrb_ptr, zig_module, func.name.ptr, func.func, func.args);
+    }
+    try mrb.evalString(json_view.ruby_prelude);
 
     // Load secrets_bag prelude
     try mrb.evalString(@embedFile("ruby_prelude/secrets_bag.rb"));
@@ -1428,7 +2090,7 @@ test "Time.parse handles ISO 8601 / RFC 3339" {
     defer mrb.deinit();
     const mrb_ptr = mrb.mrb orelse return error.MRubyNotInitialized;
 
-    try mrb.evalString(@embedFile("ruby_prelude/time_parse.rb"));
+    time_ext.setupTimeExtensions(mrb_ptr);
 
     // Note: mruby treats `$_xxx` as the special `$_` variable family — assignments
     // to `$_t` etc. silently no-op. Use plain `$t` / `$e` names instead.
@@ -1478,3 +2140,20 @@ test "Time.parse handles ISO 8601 / RFC 3339" {
         try std.testing.expectEqualStrings("ArgumentError", std.mem.span(mruby.mrb_str_to_cstr(mrb_ptr, got)));
     }
 }
+
+test "ProcIo.parse reads rchar and wchar" {
+    const sample =
+        \\rchar: 4096
+        \\wchar: 128
+        \\syscr: 10
+        \\syscw: 3
+        \\read_bytes: 0
+        \\write_bytes: 0
+        \\cancelled_write_bytes: 0
+        \\
+    ;
+    const counters = ProcIo.parse(sample).?;
+    try std.testing.expectEqual(@as(u64, 4096), counters.read);
+    try std.testing.expectEqual(@as(u64, 128), counters.written);
+    try std.testing.expect(ProcIo.parse("syscr: 10\n") == null);
+}
@@ -1,9 +1,12 @@
 /// PCRE2-based regular expression support
-/// Provides a high-level Zig wrapper around PCRE2's POSIX API
+/// Provides a high-level Zig wrapper around PCRE2's POSIX API, plus
+/// `JitRegex` on the native API for hot loops
 const std = @import("std");
 
 const c = @cImport({
     @cInclude("pcre2posix.h");
+    @cDefine("PCRE2_CODE_UNIT_WIDTH", "8");
+    @cInclude("pcre2.h");
 });
 
 pub const RegexError = error{
@@ -133,6 +136,83 @@ pub const Regex = struct {
     }
 };
 
+/// Pattern compiled through the native PCRE2 API and, where the platform
+/// supports it, JIT-compiled. Subjects are passed as slices, so matching
+/// does not copy or NUL-terminate the input. Owns its match data, so a
+/// single instance must not be used from several threads at once.
+pub const JitRegex = struct {
+    code: *c.pcre2_code_8,
+    match_data: *c.pcre2_match_data_8,
+
+    pub fn compile(pattern: []const u8, flags: Flags) RegexError!JitRegex {
+        var error_code: c_int = 0;
+        var error_offset: usize = 0;
+        const code = c.pcre2_compile_8(pattern.ptr, pattern.len, flags.toNative(), &error_code, &error_offset, null) orelse {
+            return RegexError.CompileError;
+        };
+        errdefer c.pcre2_code_free_8(code);
+
+        // JIT is an optimization only; the interpreter is used if it is unavailable
+        _ = c.pcre2_jit_compile_8(code, c.PCRE2_JIT_COMPLETE);
+
+        const match_data = c.pcre2_match_data_create_from_pattern_8(code, null) orelse {
+            return RegexError.OutOfMemory;
+        };
+
+        return JitRegex{
+            .code = code,
+            .match_data = match_data,
+        };
+    }
+
+    pub fn deinit(self: *JitRegex) void {
+        c.pcre2_match_data_free_8(self.match_data);
+        c.pcre2_code_free_8(self.code);
+    }
+
+    /// Check if text matches the pattern
+    pub fn isMatch(self: *const JitRegex, text: []const u8) bool {
+        return self.findFrom(text, 0) != null;
+    }
+
+    /// Find the first match starting at or after `offset`
+    pub fn findFrom(self: *const JitRegex, text: []const u8, offset: usize) ?Match {
+        const rc = c.pcre2_match_8(self.code, text.ptr, text.len, offset, 0, self.match_data, null);
+        if (rc < 0) return null;
+
+        const ovector = c.pcre2_get_ovector_pointer_8(self.match_data);
+        return Match{
+            .start = ovector[0],
+            .end = ovector[1],
+        };
+    }
+
+    /// Replace all occurrences of pattern in text. Returns `text` itself
+    /// when nothing matched, so unchanged input costs no allocation.
+    pub fn replaceAll(self: *const JitRegex, allocator: std.mem.Allocator, text: []const u8, replacement: []const u8) ![]const u8 {
+        var result = std.ArrayList(u8).empty;
+        errdefer result.deinit(allocator);
+
+        var last_end: usize = 0;
+        var offset: usize = 0;
+        while (offset < text.len) {
+            const match = self.findFrom(text, offset) orelse break;
+            if (result.capacity == 0) try result.ensureTotalCapacity(allocator, text.len + replacement.len);
+
+            try result.appendSlice(allocator, text[last_end..match.start]);
+            try result.appendSlice(allocator, replacement);
+            last_end = match.end;
+
+            offset = match.end;
+            if (match.start == match.end) offset += 1; // Avoid infinite loop on empty match
+        }
+
+        if (result.capacity == 0) return text;
+        try result.appendSlice(allocator, text[last_end..]);
+        return result.toOwnedSlice(allocator);
+    }
+};
+
 pub const Match = struct {
     start: usize,
     end: usize,
@@ -150,6 +230,14 @@ pub const Flags = struct {
         if (self.dotall) flags |= c.REG_DOTALL;
         return flags;
     }
+
+    pub fn toNative(self: Flags) u32 {
+        var flags: u32 = 0;
+        if (self.case_insensitive) flags |= c.PCRE2_CASELESS;
+        if (self.multiline) flags |= c.PCRE2_MULTILINE;
+        if (self.dotall) flags |= c.PCRE2_DOTALL;
+        return flags;
+    }
 };
 
 // Tests
@@ -195,3 +283,23 @@ test "regex replace" {
 
     try std.testing.expectEqualStrings("baz bar baz", result);
 }
+
+test "jit regex replace and slice subjects" {
+    const allocator = std.testing.allocator;
+
+    var re = try JitRegex.compile("fo+", .{});
+    defer re.deinit();
+
+    const text = "foo bar fooo";
+    // Subject is a slice: the match must not run past its end
+    try std.testing.expect(!re.isMatch(text[4..7]));
+    try std.testing.expect(re.isMatch(text[8..]));
+
+    const plain: []const u8 = "bar";
+    const unchanged = try re.replaceAll(allocator, plain, "baz");
+    try std.testing.expect(unchanged.ptr == plain.ptr);
+
+    const result = try re.replaceAll(allocator, text, "baz");
+    defer allocator.free(result);
+    try std.testing.expectEqualStrings("baz bar baz", result);
+}
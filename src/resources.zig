@@ -203,6 +203,15 @@ fn resourceShouldIgnoreFailure(resource: anytype) bool {
     };
 }
 
+fn resourceLocalInput(resource: anytype) ?[]const u8 {
+    return switch (resource) {
+        .template => |t| t.source,
+        .aws_kms => |k| if (k.source.len == 0 or std.mem.startsWith(u8, k.source, "inline:")) null else k.source,
+        .extract => |e| e.path,
+        else => null,
+    };
+}
+
 const ResourceMacOs = union(enum) {
     file: file.Resource,
     execute: execute.Resource,
@@ -242,6 +251,11 @@ const ResourceMacOs = union(enum) {
     pub fn shouldIgnoreFailure(self: ResourceMacOs) bool {
         return resourceShouldIgnoreFailure(self);
     }
+
+    /// Local file the resource reads when it applies, if any
+    pub fn localInput(self: ResourceMacOs) ?[]const u8 {
+        return resourceLocalInput(self);
+    }
 };
 
 const ResourceGeneric = union(enum) {
@@ -284,4 +298,9 @@ const ResourceGeneric = union(enum) {
     pub fn shouldIgnoreFailure(self: ResourceGeneric) bool {
         return resourceShouldIgnoreFailure(self);
     }
+
+    /// Local file the resource reads when it applies, if any
+    pub fn localInput(self: ResourceGeneric) ?[]const u8 {
+        return resourceLocalInput(self);
+    }
 };
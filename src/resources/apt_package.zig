@@ -258,6 +258,7 @@ fn isInstalled(allocator: std.mem.Allocator, name: []const u8) !bool {
     child.stdout_behavior = .Pipe;
     child.stderr_behavior = .Pipe;
 
+    base.noteSubprocess();
     try child.spawn();
     const stdout = try child.stdout.?.readToEndAlloc(allocator, 1024 * 1024);
     defer allocator.free(stdout);
@@ -290,6 +291,7 @@ fn runCommand(allocator: std.mem.Allocator, cmd: []const u8, action: common.Acti
 
     child.env_map = &env_map;
 
+    base.noteSubprocess();
     try child.spawn();
 
     const stdout = try child.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
@@ -3,6 +3,8 @@ const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const http = @import("../http.zig");
 const logger = @import("../logger.zig");
+const pgp_armor = @import("../pgp_armor.zig");
+const xdg_mod = @import("../xdg.zig");
 
 /// APT repository resource data structure
 /// Manages APT repositories on Debian/Ubuntu systems
@@ -17,6 +19,8 @@ pub const Resource = struct {
     options: ?[]const u8 = null, // Additional options (e.g., "signed-by=/path/to/key")
     repo_type: RepoType = .deb,
     action: Action,
+    // Set by provision when this run queued a prefetch of key_url
+    key_prefetched: bool = false,
 
     // Common properties (guards, notifications, etc.)
     common: base.CommonProps,
@@ -89,94 +93,16 @@ pub const Resource = struct {
         var actual_key_path: ?[]const u8 = null;
         defer if (actual_key_path) |p| allocator.free(p);
 
-        // Step 1: Download GPG key if specified
+        // Step 1: Install the GPG key if specified
         if (self.key_url) |key_url| {
             // Create keyrings directory if it doesn't exist
-            std.fs.cwd().makePath("/etc/apt/keyrings") catch |err| {
-                logger.warn("Failed to create /etc/apt/keyrings: {}", .{err});
+            std.fs.cwd().makePath(keyrings_dir) catch |err| {
+                logger.warn("Failed to create {s}: {}", .{ keyrings_dir, err });
             };
 
-            if (self.key_path) |explicit_path| {
-                // User specified explicit path, use it directly
-                actual_key_path = try allocator.dupe(u8, explicit_path);
-
-                const key_exists = blk: {
-                    std.fs.accessAbsolute(explicit_path, .{}) catch |err| switch (err) {
-                        error.FileNotFound => break :blk false,
-                        else => return err,
-                    };
-                    break :blk true;
-                };
-
-                if (!key_exists) {
-                    logger.info("Downloading GPG key from {s} to {s}", .{ key_url, explicit_path });
-                    const result = try http.downloadFile(allocator, key_url, explicit_path, .{});
-                    defer {
-                        var mut_result = result;
-                        mut_result.deinit(allocator);
-                    }
-                    updated = true;
-                }
-            } else {
-                // Auto-detect key format: download to temp, check format, then move
-                // Check if either .gpg or .asc already exists
-                const gpg_path = try std.fmt.allocPrint(allocator, "/etc/apt/keyrings/{s}.gpg", .{self.name});
-                defer allocator.free(gpg_path);
-                const asc_path = try std.fmt.allocPrint(allocator, "/etc/apt/keyrings/{s}.asc", .{self.name});
-                defer allocator.free(asc_path);
-
-                const gpg_exists = blk: {
-                    std.fs.accessAbsolute(gpg_path, .{}) catch |err| switch (err) {
-                        error.FileNotFound => break :blk false,
-                        else => return err,
-                    };
-                    break :blk true;
-                };
-
-                const asc_exists = blk: {
-                    std.fs.accessAbsolute(asc_path, .{}) catch |err| switch (err) {
-                        error.FileNotFound => break :blk false,
-                        else => return err,
-                    };
-                    break :blk true;
-                };
-
-                if (gpg_exists) {
-                    actual_key_path = try allocator.dupe(u8, gpg_path);
-                } else if (asc_exists) {
-                    actual_key_path = try allocator.dupe(u8, asc_path);
-                } else {
-                    // Download to temp file first
-                    const temp_path = try std.fmt.allocPrint(allocator, "/etc/apt/keyrings/{s}.tmp", .{self.name});
-                    defer allocator.free(temp_path);
-
-                    logger.info("Downloading GPG key from {s}", .{key_url});
-                    const result = try http.downloadFile(allocator, key_url, temp_path, .{});
-                    defer {
-                        var mut_result = result;
-                        mut_result.deinit(allocator);
-                    }
-
-                    // Read first few bytes to detect format
-                    const is_binary = blk: {
-                        const file = std.fs.openFileAbsolute(temp_path, .{}) catch break :blk true;
-                        defer file.close();
-                        var buf: [64]u8 = undefined;
-                        const n = file.read(&buf) catch break :blk true;
-                        if (n == 0) break :blk true;
-                        // ASCII armored keys start with "-----BEGIN PGP"
-                        break :blk !std.mem.startsWith(u8, buf[0..n], "-----BEGIN PGP");
-                    };
-
-                    const final_path = if (is_binary) gpg_path else asc_path;
-                    actual_key_path = try allocator.dupe(u8, final_path);
-
-                    // Rename temp file to final path
-                    try std.fs.renameAbsolute(temp_path, final_path);
-                    logger.info("Saved GPG key to {s}", .{final_path});
-                    updated = true;
-                }
-            }
+            const key = try self.syncKey(allocator, key_url);
+            actual_key_path = key.path;
+            if (key.changed) updated = true;
         }
 
         // Step 2: Generate sources.list entry
@@ -297,6 +223,96 @@ pub const Resource = struct {
         return updated;
     }
 
+    const KeySync = struct {
+        path: []const u8,
+        changed: bool,
+    };
+
+    /// Make the keyring referenced by signed-by hold the key served at
+    /// key_url. Key material comes from provision's prefetch when available;
+    /// otherwise an existing keyring is kept and only a missing one is
+    /// downloaded. Armored keys are converted to binary keyrings natively and
+    /// the file is only rewritten when the key content actually changed.
+    fn syncKey(self: Resource, allocator: std.mem.Allocator, key_url: []const u8) !KeySync {
+        const gpg_path = if (self.key_path) |explicit|
+            try allocator.dupe(u8, explicit)
+        else
+            try std.fmt.allocPrint(allocator, "{s}/{s}.gpg", .{ keyrings_dir, self.name });
+        errdefer allocator.free(gpg_path);
+
+        // Auto-named keys written by older versions may be stored armored
+        const asc_path: ?[]const u8 = if (self.key_path == null)
+            try std.fmt.allocPrint(allocator, "{s}/{s}.asc", .{ keyrings_dir, self.name })
+        else
+            null;
+        defer if (asc_path) |p| allocator.free(p);
+
+        const existing_path: ?[]const u8 = if (try pathExists(gpg_path))
+            gpg_path
+        else if (asc_path != null and try pathExists(asc_path.?))
+            asc_path.?
+        else
+            null;
+
+        const prefetch_path = try prefetchKeyPath(allocator, self.name);
+        defer allocator.free(prefetch_path);
+
+        // Only trust a key this run downloaded; a file left by an earlier run
+        // may hold a key that has since been rotated or revoked
+        var fetched = if (self.key_prefetched) try readFileIfExists(allocator, prefetch_path) else null;
+        if (fetched != null) {
+            std.fs.cwd().deleteFile(prefetch_path) catch {};
+        } else if (existing_path) |path| {
+            // Not prefetched (guarded resource or failed prefetch): keep the
+            // installed key rather than hitting the network on every run
+            if (path.ptr != gpg_path.ptr) {
+                allocator.free(gpg_path);
+                return .{ .path = try allocator.dupe(u8, path), .changed = false };
+            }
+            return .{ .path = gpg_path, .changed = false };
+        } else {
+            const temp_path = try std.fmt.allocPrint(allocator, "{s}.tmp", .{gpg_path});
+            defer allocator.free(temp_path);
+
+            logger.info("Downloading GPG key from {s}", .{key_url});
+            var result = try http.downloadFile(allocator, key_url, temp_path, .{});
+            result.deinit(allocator);
+
+            fetched = try readFileIfExists(allocator, temp_path);
+            std.fs.cwd().deleteFile(temp_path) catch {};
+        }
+
+        const raw = fetched orelse return error.KeyDownloadFailed;
+        defer allocator.free(raw);
+
+        const binary = try dearmorKey(allocator, raw);
+        defer allocator.free(binary);
+
+        if (existing_path) |path| {
+            if (try keyContentMatches(allocator, path, binary)) {
+                if (path.ptr != gpg_path.ptr) {
+                    allocator.free(gpg_path);
+                    return .{ .path = try allocator.dupe(u8, path), .changed = false };
+                }
+                return .{ .path = gpg_path, .changed = false };
+            }
+        }
+
+        // Explicit *.asc paths keep the armored text as served; everything
+        // else gets a binary keyring, like `gpg --dearmor`
+        const keep_armored = self.key_path != null and
+            std.mem.endsWith(u8, gpg_path, ".asc") and
+            pgp_armor.isArmored(raw);
+        try writeFileAtomic(allocator, gpg_path, if (keep_armored) raw else binary);
+
+        if (existing_path != null and asc_path != null and existing_path.?.ptr == asc_path.?.ptr) {
+            std.fs.cwd().deleteFile(asc_path.?) catch {};
+        }
+
+        logger.info("Saved GPG key to {s}", .{gpg_path});
+        return .{ .path = gpg_path, .changed = true };
+    }
+
     fn applyRemove(self: Resource) !bool {
         var gpa = std.heap.GeneralPurposeAllocator(.{}){};
         defer _ = gpa.deinit();
@@ -365,6 +381,7 @@ pub const Resource = struct {
         proc.stdout_behavior = .Pipe;
         proc.stderr_behavior = .Pipe;
 
+        base.noteSubprocess();
         try proc.spawn();
 
         const stdout = try proc.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
@@ -420,6 +437,68 @@ pub const Resource = struct {
     }
 };
 
+const keyrings_dir = "/etc/apt/keyrings";
+
+// Keys are small; anything larger is not a keyring
+const max_key_size = 4 * 1024 * 1024;
+
+/// Temp file provision's download phase writes a prefetched key for `name` to.
+pub fn prefetchKeyPath(allocator: std.mem.Allocator, name: []const u8) ![]const u8 {
+    const xdg_instance = xdg_mod.XDG.init(allocator);
+    const temp_dir = try xdg_instance.getDownloadsDir();
+    defer allocator.free(temp_dir);
+    return std.fmt.allocPrint(allocator, "{s}/apt-key-{s}", .{ temp_dir, name });
+}
+
+fn pathExists(path: []const u8) !bool {
+    std.fs.accessAbsolute(path, .{}) catch |err| switch (err) {
+        error.FileNotFound => return false,
+        else => return err,
+    };
+    return true;
+}
+
+fn readFileIfExists(allocator: std.mem.Allocator, path: []const u8) !?[]u8 {
+    const file = std.fs.cwd().openFile(path, .{}) catch |err| switch (err) {
+        error.FileNotFound => return null,
+        else => return err,
+    };
+    defer file.close();
+    return try file.readToEndAlloc(allocator, max_key_size);
+}
+
+/// Binary form of a downloaded key: armored keys are decoded, binary
+/// keyrings are returned as-is. Caller owns the returned slice.
+fn dearmorKey(allocator: std.mem.Allocator, raw: []const u8) ![]u8 {
+    if (pgp_armor.isArmored(raw)) return pgp_armor.dearmor(allocator, raw);
+    return allocator.dupe(u8, raw);
+}
+
+/// Compare the installed keyring at `path` with `binary` by content,
+/// regardless of whether either side was stored armored.
+fn keyContentMatches(allocator: std.mem.Allocator, path: []const u8, binary: []const u8) !bool {
+    const existing = (try readFileIfExists(allocator, path)) orelse return false;
+    defer allocator.free(existing);
+
+    const existing_binary = dearmorKey(allocator, existing) catch return false;
+    defer allocator.free(existing_binary);
+
+    return std.mem.eql(u8, existing_binary, binary);
+}
+
+fn writeFileAtomic(allocator: std.mem.Allocator, path: []const u8, content: []const u8) !void {
+    const temp_path = try std.fmt.allocPrint(allocator, "{s}.tmp", .{path});
+    defer allocator.free(temp_path);
+
+    {
+        const file = try std.fs.cwd().createFile(temp_path, .{ .mode = 0o644 });
+        defer file.close();
+        try file.writeAll(content);
+    }
+    errdefer std.fs.cwd().deleteFile(temp_path) catch {};
+    try std.fs.cwd().rename(temp_path, path);
+}
+
 /// Ruby prelude for apt_repository resource
 pub const ruby_prelude = @embedFile("apt_repository_resource.rb");
 
@@ -451,57 +530,46 @@ pub fn zigAddResource(
     // Get 10 strings + 4 optional (blocks + arrays)
     _ = mruby.mrb_get_args(mrb, "SSSSSSSSSS|oooAA", &name_val, &uri_val, &key_url_val, &key_path_val, &distribution_val, &components_val, &arch_val, &options_val, &repo_type_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-    const uri_cstr = mruby.mrb_str_to_cstr(mrb, uri_val);
-    const key_url_cstr = mruby.mrb_str_to_cstr(mrb, key_url_val);
-    const key_path_cstr = mruby.mrb_str_to_cstr(mrb, key_path_val);
-    const distribution_cstr = mruby.mrb_str_to_cstr(mrb, distribution_val);
-    const components_cstr = mruby.mrb_str_to_cstr(mrb, components_val);
-    const arch_cstr = mruby.mrb_str_to_cstr(mrb, arch_val);
-    const options_cstr = mruby.mrb_str_to_cstr(mrb, options_val);
-    const repo_type_cstr = mruby.mrb_str_to_cstr(mrb, repo_type_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-
-    const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch return mruby.mrb_nil_value();
-    const uri = allocator.dupe(u8, std.mem.span(uri_cstr)) catch return mruby.mrb_nil_value();
-
-    const key_url_str = std.mem.span(key_url_cstr);
+    const name = allocator.dupe(u8, mruby.borrowStr(mrb, name_val)) catch return mruby.mrb_nil_value();
+    const uri = allocator.dupe(u8, mruby.borrowStr(mrb, uri_val)) catch return mruby.mrb_nil_value();
+
+    const key_url_str = mruby.borrowStr(mrb, key_url_val);
     const key_url: ?[]const u8 = if (key_url_str.len > 0)
         allocator.dupe(u8, key_url_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const key_path_str = std.mem.span(key_path_cstr);
+    const key_path_str = mruby.borrowStr(mrb, key_path_val);
     const key_path: ?[]const u8 = if (key_path_str.len > 0)
         allocator.dupe(u8, key_path_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const distribution_str = std.mem.span(distribution_cstr);
+    const distribution_str = mruby.borrowStr(mrb, distribution_val);
     const distribution: ?[]const u8 = if (distribution_str.len > 0)
         allocator.dupe(u8, distribution_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const components_str = std.mem.span(components_cstr);
+    const components_str = mruby.borrowStr(mrb, components_val);
     const components: ?[]const u8 = if (components_str.len > 0)
         allocator.dupe(u8, components_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const arch_str = std.mem.span(arch_cstr);
+    const arch_str = mruby.borrowStr(mrb, arch_val);
     const arch: ?[]const u8 = if (arch_str.len > 0)
         allocator.dupe(u8, arch_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const options_str = std.mem.span(options_cstr);
+    const options_str = mruby.borrowStr(mrb, options_val);
     const options: ?[]const u8 = if (options_str.len > 0)
         allocator.dupe(u8, options_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const repo_type_str = std.mem.span(repo_type_cstr);
+    const repo_type_str = mruby.borrowStr(mrb, repo_type_val);
     const repo_type: Resource.RepoType = if (std.mem.eql(u8, repo_type_str, "deb-src"))
         .deb_src
     else if (std.mem.eql(u8, repo_type_str, "ppa"))
@@ -509,7 +577,7 @@ pub fn zigAddResource(
     else
         .deb;
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "remove"))
         .remove
     else
@@ -20,7 +20,11 @@ pub const Resource = struct {
     owner: ?[]const u8,
     group: ?[]const u8,
     action: Action,
+    envelope: bool = false, // Encrypt locally under a KMS data key instead of sending the payload to KMS
+    data_key_ttl: u32 = 0, // Seconds decrypted envelope data keys are reused within the run (0 disables)
     common: base.CommonProps,
+    // Set by prefetchDecrypts; released by the runner after apply
+    prefetched: ?Prefetched = null,
 
     pub const Action = enum {
         encrypt,
@@ -32,6 +36,14 @@ pub const Resource = struct {
         base64,
     };
 
+    /// What the up-front batch decrypted for this resource: the plaintext
+    /// of a plain decrypt or an envelope's data key, with a digest of the
+    /// bytes that were sent so a source changed since then is not trusted
+    pub const Prefetched = struct {
+        digest: [32]u8,
+        result: kms.DecryptResult,
+    };
+
     pub fn deinit(self: Resource, allocator: std.mem.Allocator) void {
         allocator.free(self.name);
         allocator.free(self.region);
@@ -44,11 +56,27 @@ pub const Resource = struct {
         allocator.free(self.path);
         if (self.owner) |o| allocator.free(o);
         if (self.group) |g| allocator.free(g);
+        var resource = self;
+        resource.releasePrefetched();
 
         var common = self.common;
         common.deinit(allocator);
     }
 
+    /// Zero and drop the prefetched result
+    pub fn releasePrefetched(self: *Resource) void {
+        if (self.prefetched) |*prefetched| prefetched.result.deinit();
+        self.prefetched = null;
+    }
+
+    /// The prefetched result, if it was decrypted from exactly `sent`
+    fn prefetchedFor(self: Resource, sent: []const u8) ?kms.DecryptResult {
+        const prefetched = self.prefetched orelse return null;
+        const digest = sentDigest(sent);
+        if (!std.mem.eql(u8, &prefetched.digest, &digest)) return null;
+        return prefetched.result;
+    }
+
     pub fn apply(self: Resource) !base.ApplyResult {
         const skip_reason = try self.common.shouldRun(self.owner, self.group);
         if (skip_reason) |reason| {
@@ -71,6 +99,70 @@ pub const Resource = struct {
         };
     }
 
+    const Credentials = struct {
+        access_key: []const u8,
+        secret_key: []const u8,
+        session_token: ?[]const u8,
+
+        fn deinit(self: Credentials, allocator: std.mem.Allocator) void {
+            allocator.free(self.access_key);
+            allocator.free(self.secret_key);
+            if (self.session_token) |t| allocator.free(t);
+        }
+    };
+
+    /// Explicit credentials, falling back to the standard AWS environment variables
+    fn resolveCredentials(self: Resource, allocator: std.mem.Allocator) !Credentials {
+        const access_key = if (self.access_key_id) |k|
+            try allocator.dupe(u8, k)
+        else
+            std.process.getEnvVarOwned(allocator, "AWS_ACCESS_KEY_ID") catch {
+                logger.err("aws_kms: AWS_ACCESS_KEY_ID not set and no access_key_id provided", .{});
+                return error.MissingCredentials;
+            };
+        errdefer allocator.free(access_key);
+
+        const secret_key = if (self.secret_access_key) |k|
+            try allocator.dupe(u8, k)
+        else
+            std.process.getEnvVarOwned(allocator, "AWS_SECRET_ACCESS_KEY") catch {
+                logger.err("aws_kms: AWS_SECRET_ACCESS_KEY not set and no secret_access_key provided", .{});
+                return error.MissingCredentials;
+            };
+        errdefer allocator.free(secret_key);
+
+        // Optional session token for temporary credentials
+        const session_token: ?[]const u8 = if (self.session_token) |t|
+            try allocator.dupe(u8, t)
+        else
+            std.process.getEnvVarOwned(allocator, "AWS_SESSION_TOKEN") catch null;
+
+        return .{ .access_key = access_key, .secret_key = secret_key, .session_token = session_token };
+    }
+
+    fn clientConfig(self: Resource, creds: Credentials) kms.KMSConfig {
+        return .{
+            .access_key = creds.access_key,
+            .secret_key = creds.secret_key,
+            .session_token = creds.session_token,
+            .region = self.region,
+            .data_key_ttl_seconds = self.data_key_ttl,
+        };
+    }
+
+    /// Whether two resources would talk to KMS through identically configured clients
+    fn sameClient(self: Resource, other: Resource) bool {
+        return std.mem.eql(u8, self.region, other.region) and
+            optionalEql(self.access_key_id, other.access_key_id) and
+            optionalEql(self.secret_access_key, other.secret_access_key) and
+            optionalEql(self.session_token, other.session_token) and
+            self.data_key_ttl == other.data_key_ttl;
+    }
+
+    fn algorithmOrNull(self: Resource) ?[]const u8 {
+        return if (self.algorithm.len > 0) self.algorithm else null;
+    }
+
     fn applyEncrypt(self: Resource) !bool {
         var gpa = std.heap.GeneralPurposeAllocator(.{}){};
         defer _ = gpa.deinit();
@@ -94,79 +186,31 @@ pub const Resource = struct {
             return error.MissingPath;
         }
 
-        // Get credentials from env if not provided
-        const access_key = self.access_key_id orelse
-            std.process.getEnvVarOwned(allocator, "AWS_ACCESS_KEY_ID") catch {
-            logger.err("aws_kms: AWS_ACCESS_KEY_ID not set and no access_key_id provided", .{});
-            return error.MissingCredentials;
-        };
-        defer if (self.access_key_id == null) allocator.free(access_key);
-
-        const secret_key = self.secret_access_key orelse
-            std.process.getEnvVarOwned(allocator, "AWS_SECRET_ACCESS_KEY") catch {
-            logger.err("aws_kms: AWS_SECRET_ACCESS_KEY not set and no secret_access_key provided", .{});
-            return error.MissingCredentials;
-        };
-        defer if (self.secret_access_key == null) allocator.free(secret_key);
-
-        // Get optional session token for temporary credentials
-        const session_token = self.session_token orelse
-            std.process.getEnvVarOwned(allocator, "AWS_SESSION_TOKEN") catch null;
-        defer if (self.session_token == null and session_token != null) allocator.free(session_token.?);
+        const creds = try self.resolveCredentials(allocator);
+        defer creds.deinit(allocator);
 
         // Read input data and decode based on source_encoding
         const raw_data = try self.readSource(allocator);
         defer allocator.free(raw_data);
 
         // Decode source if needed - for encrypt, we need binary plaintext
-        const plaintext = if (self.source_encoding == .base64) blk: {
-            // Source is base64 encoded, decode to binary
-            // First strip whitespace (newlines, spaces, tabs) for compatibility with multi-line base64
-            var stripped = std.ArrayList(u8).initCapacity(allocator, raw_data.len) catch std.ArrayList(u8).empty;
-            defer stripped.deinit(allocator);
-            for (raw_data) |c| {
-                if (c != '\n' and c != '\r' and c != ' ' and c != '\t') {
-                    stripped.append(allocator, c) catch {
-                        logger.err("aws_kms: out of memory while processing base64", .{});
-                        return error.OutOfMemory;
-                    };
-                }
-            }
-            const cleaned_data = stripped.items;
-
-            const decoded_len = std.base64.standard.Decoder.calcSizeForSlice(cleaned_data) catch {
-                logger.err("aws_kms: invalid base64 in source", .{});
-                return error.InvalidBase64;
-            };
-            const decoded = try allocator.alloc(u8, decoded_len);
-            std.base64.standard.Decoder.decode(decoded, cleaned_data) catch {
-                allocator.free(decoded);
-                logger.err("aws_kms: failed to decode base64 source", .{});
-                return error.InvalidBase64;
-            };
-            break :blk decoded;
-        } else blk: {
-            // Source is already binary
-            break :blk try allocator.dupe(u8, raw_data);
-        };
+        const plaintext = try self.decodeSource(allocator, raw_data);
         defer allocator.free(plaintext);
 
         // Initialize KMS client
-        var client = try kms.KMSClient.init(allocator, .{
-            .access_key = access_key,
-            .secret_key = secret_key,
-            .session_token = session_token,
-            .region = self.region,
-        });
+        var client = try kms.KMSClient.init(allocator, self.clientConfig(creds));
         defer client.deinit();
 
         // Encrypt
-        var result = try client.encrypt(
-            self.key_id,
-            plaintext,
-            null, // encryption_context
-            if (self.algorithm.len > 0) self.algorithm else null,
-        );
+        var result = if (self.envelope)
+            try client.encryptEnvelope(self.key_id, plaintext)
+        else
+            try client.encrypt(
+                self.key_id,
+                plaintext,
+                null, // encryption_context
+                self.algorithmOrNull(),
+            );
         defer result.deinit();
 
         // Check if output already exists with same content (idempotency)
@@ -201,44 +245,32 @@ pub const Resource = struct {
             return error.MissingPath;
         }
 
-        // Get credentials from env if not provided
-        const access_key = self.access_key_id orelse
-            std.process.getEnvVarOwned(allocator, "AWS_ACCESS_KEY_ID") catch {
-            logger.err("aws_kms: AWS_ACCESS_KEY_ID not set and no access_key_id provided", .{});
-            return error.MissingCredentials;
-        };
-        defer if (self.access_key_id == null) allocator.free(access_key);
-
-        const secret_key = self.secret_access_key orelse
-            std.process.getEnvVarOwned(allocator, "AWS_SECRET_ACCESS_KEY") catch {
-            logger.err("aws_kms: AWS_SECRET_ACCESS_KEY not set and no secret_access_key provided", .{});
-            return error.MissingCredentials;
-        };
-        defer if (self.secret_access_key == null) allocator.free(secret_key);
-
-        // Get optional session token for temporary credentials
-        const session_token = self.session_token orelse
-            std.process.getEnvVarOwned(allocator, "AWS_SESSION_TOKEN") catch null;
-        defer if (self.session_token == null and session_token != null) allocator.free(session_token.?);
+        const creds = try self.resolveCredentials(allocator);
+        defer creds.deinit(allocator);
 
         // Read ciphertext
         const ciphertext = try self.readSource(allocator);
         defer allocator.free(ciphertext);
 
         // Initialize KMS client
-        var client = try kms.KMSClient.init(allocator, .{
-            .access_key = access_key,
-            .secret_key = secret_key,
-            .session_token = session_token,
-            .region = self.region,
-        });
+        var client = try kms.KMSClient.init(allocator, self.clientConfig(creds));
         defer client.deinit();
 
         // Decrypt - pass source_encoding to indicate if input is already base64
-        var result = try client.decrypt(
+        var result = if (self.envelope) blk: {
+            const envelope = try self.decodeSource(allocator, ciphertext);
+            defer allocator.free(envelope);
+            if (self.prefetchedFor(try kms.envelopeDataKey(envelope))) |data_key| {
+                break :blk try client.decryptEnvelopeWithKey(envelope, data_key);
+            }
+            break :blk try client.decryptEnvelope(envelope);
+        } else if (self.prefetchedFor(ciphertext)) |prefetched|
+            try prefetched.dupe(allocator)
+        else
+            try client.decrypt(
             ciphertext,
             null, // encryption_context
-            if (self.algorithm.len > 0) self.algorithm else null,
+            self.algorithmOrNull(),
             self.source_encoding == .base64,
         );
         defer result.deinit();
@@ -273,6 +305,59 @@ pub const Resource = struct {
         return try file.readToEndAlloc(allocator, std.math.maxInt(usize));
     }
 
+    /// Source bytes in binary form, decoding base64 sources. Caller owns the result.
+    fn decodeSource(self: Resource, allocator: std.mem.Allocator, raw_data: []const u8) ![]u8 {
+        if (self.source_encoding != .base64) return allocator.dupe(u8, raw_data);
+
+        // Strip whitespace (newlines, spaces, tabs) for compatibility with multi-line base64
+        var stripped = std.ArrayList(u8).initCapacity(allocator, raw_data.len) catch std.ArrayList(u8).empty;
+        defer stripped.deinit(allocator);
+        for (raw_data) |c| {
+            if (c != '\n' and c != '\r' and c != ' ' and c != '\t') {
+                stripped.append(allocator, c) catch {
+                    logger.err("aws_kms: out of memory while processing base64", .{});
+                    return error.OutOfMemory;
+                };
+            }
+        }
+        const cleaned_data = stripped.items;
+
+        const decoded_len = std.base64.standard.Decoder.calcSizeForSlice(cleaned_data) catch {
+            logger.err("aws_kms: invalid base64 in source", .{});
+            return error.InvalidBase64;
+        };
+        const decoded = try allocator.alloc(u8, decoded_len);
+        std.base64.standard.Decoder.decode(decoded, cleaned_data) catch {
+            allocator.free(decoded);
+            logger.err("aws_kms: failed to decode base64 source", .{});
+            return error.InvalidBase64;
+        };
+        return decoded;
+    }
+
+    /// What `applyDecrypt` will send to KMS for this resource: the source
+    /// ciphertext, or an envelope's encrypted data key. Caller owns
+    /// `ciphertext_blob`.
+    fn prefetchItem(self: Resource, allocator: std.mem.Allocator) !kms.BatchDecryptItem {
+        const raw = try self.readSource(allocator);
+        if (!self.envelope) {
+            return .{
+                .ciphertext_blob = raw,
+                .input_is_base64 = self.source_encoding == .base64,
+                .algorithm = self.algorithmOrNull(),
+            };
+        }
+        defer allocator.free(raw);
+
+        const envelope = try self.decodeSource(allocator, raw);
+        defer allocator.free(envelope);
+        return .{
+            .ciphertext_blob = try allocator.dupe(u8, try kms.envelopeDataKey(envelope)),
+            .input_is_base64 = false,
+            .data_key = true,
+        };
+    }
+
     /// Check if output file exists and has the same content
     fn outputUpToDate(self: Resource, allocator: std.mem.Allocator, new_data: []const u8) !bool {
         // Try to read existing file
@@ -364,6 +449,90 @@ pub const Resource = struct {
     }
 };
 
+fn optionalEql(a: ?[]const u8, b: ?[]const u8) bool {
+    if (a == null or b == null) return a == null and b == null;
+    return std.mem.eql(u8, a.?, b.?);
+}
+
+/// Concurrent requests per credential set during prefetch
+const prefetch_concurrency = 4;
+
+fn sentDigest(sent: []const u8) [32]u8 {
+    var out: [32]u8 = undefined;
+    std.crypto.hash.sha2.Sha256.hash(sent, &out, .{});
+    return out;
+}
+
+/// Decrypt what the guard-free decrypt resources in `candidates` will need
+/// (plain ciphertexts and envelope data keys) up front, in concurrent
+/// batches per credential set. Each result is left on its resource for its
+/// apply; with data_key_ttl set, envelope data keys also land in the data
+/// key cache. Errors are left for `apply` to report.
+pub fn prefetchDecrypts(allocator: std.mem.Allocator, candidates: []const *Resource) void {
+    const done = allocator.alloc(bool, candidates.len) catch return;
+    defer allocator.free(done);
+    @memset(done, false);
+
+    for (candidates, 0..) |lead, i| {
+        if (done[i]) continue;
+        if (lead.region.len == 0) {
+            done[i] = true;
+            continue;
+        }
+
+        var items = std.ArrayList(kms.BatchDecryptItem).empty;
+        var owners = std.ArrayList(*Resource).empty;
+        defer {
+            for (items.items) |item| allocator.free(item.ciphertext_blob);
+            items.deinit(allocator);
+            owners.deinit(allocator);
+        }
+
+        for (candidates[i..], i..) |res, j| {
+            if (done[j] or !lead.sameClient(res.*)) continue;
+            done[j] = true;
+
+            const item = res.prefetchItem(allocator) catch continue;
+            items.append(allocator, item) catch {
+                allocator.free(item.ciphertext_blob);
+                continue;
+            };
+            owners.append(allocator, res) catch {
+                allocator.free(items.pop().?.ciphertext_blob);
+                continue;
+            };
+        }
+        if (items.items.len == 0) continue;
+
+        const creds = lead.resolveCredentials(allocator) catch continue;
+        defer creds.deinit(allocator);
+
+        var client = kms.KMSClient.init(allocator, lead.clientConfig(creds)) catch continue;
+        defer client.deinit();
+
+        const outcomes = allocator.alloc(kms.BatchDecryptOutcome, items.items.len) catch continue;
+        defer allocator.free(outcomes);
+
+        client.decryptBatch(items.items, outcomes, prefetch_concurrency);
+        for (outcomes, items.items, owners.items) |*outcome, item, owner| {
+            switch (outcome.*) {
+                .ok => |result| {
+                    owner.releasePrefetched();
+                    owner.prefetched = .{ .digest = sentDigest(item.ciphertext_blob), .result = result };
+                    outcome.* = .pending;
+                },
+                .err => |err| logger.debug("aws_kms: prefetch decrypt failed: {}", .{err}),
+                .pending => {},
+            }
+        }
+    }
+}
+
+/// Release pooled KMS connections and zero cached data keys
+pub fn releaseSharedState() void {
+    kms.shutdown();
+}
+
 pub const ruby_prelude = @embedFile("aws_kms_resource.rb");
 
 pub fn zigAddResource(
@@ -389,75 +558,83 @@ pub fn zigAddResource(
     var owner_val: mruby.mrb_value = undefined;
     var group_val: mruby.mrb_value = undefined;
     var action_val: mruby.mrb_value = undefined;
+    var envelope_val: mruby.mrb_value = undefined;
+    var data_key_ttl_val: mruby.mrb_value = undefined;
     var only_if_val: mruby.mrb_value = undefined;
     var not_if_val: mruby.mrb_value = undefined;
     var ignore_failure_val: mruby.mrb_value = undefined;
     var notifications_val: mruby.mrb_value = undefined;
     var subscriptions_val: mruby.mrb_value = undefined;
 
-    _ = mruby.mrb_get_args(mrb, "SSSSSSSSSSSSSSS|oooAA", &name_val, &region_val, &access_key_val, &secret_key_val, &session_token_val, &key_id_val, &algorithm_val, &source_val, &source_encoding_val, &target_encoding_val, &path_val, &mode_val, &owner_val, &group_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
+    _ = mruby.mrb_get_args(mrb, "SSSSSSSSSSSSSSSSS|oooAA", &name_val, &region_val, &access_key_val, &secret_key_val, &session_token_val, &key_id_val, &algorithm_val, &source_val, &source_encoding_val, &target_encoding_val, &path_val, &mode_val, &owner_val, &group_val, &action_val, &envelope_val, &data_key_ttl_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const name = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, name_val))) catch return mruby.mrb_nil_value();
-    const region = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, region_val))) catch return mruby.mrb_nil_value();
-    const key_id = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, key_id_val))) catch return mruby.mrb_nil_value();
-    const algorithm = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, algorithm_val))) catch return mruby.mrb_nil_value();
-    const source = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, source_val))) catch return mruby.mrb_nil_value();
-    const path = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, path_val))) catch return mruby.mrb_nil_value();
+    const name = allocator.dupe(u8, mruby.borrowStr(mrb, name_val)) catch return mruby.mrb_nil_value();
+    const region = allocator.dupe(u8, mruby.borrowStr(mrb, region_val)) catch return mruby.mrb_nil_value();
+    const key_id = allocator.dupe(u8, mruby.borrowStr(mrb, key_id_val)) catch return mruby.mrb_nil_value();
+    const algorithm = allocator.dupe(u8, mruby.borrowStr(mrb, algorithm_val)) catch return mruby.mrb_nil_value();
+    const source = allocator.dupe(u8, mruby.borrowStr(mrb, source_val)) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
 
-    const access_key_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, access_key_val));
+    const access_key_str = mruby.borrowStr(mrb, access_key_val);
     const access_key_id: ?[]const u8 = if (access_key_str.len > 0)
         allocator.dupe(u8, access_key_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const secret_key_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, secret_key_val));
+    const secret_key_str = mruby.borrowStr(mrb, secret_key_val);
     const secret_access_key: ?[]const u8 = if (secret_key_str.len > 0)
         allocator.dupe(u8, secret_key_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const session_token_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, session_token_val));
+    const session_token_str = mruby.borrowStr(mrb, session_token_val);
     const session_token: ?[]const u8 = if (session_token_str.len > 0)
         allocator.dupe(u8, session_token_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const mode_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, mode_val));
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
-    const owner_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, owner_val));
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, group_val));
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const action_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, action_val));
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "decrypt"))
         .decrypt
     else
         .encrypt;
 
-    const source_encoding_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, source_encoding_val));
+    const source_encoding_str = mruby.borrowStr(mrb, source_encoding_val);
     const source_encoding: Resource.Encoding = if (std.mem.eql(u8, source_encoding_str, "binary"))
         .binary
     else
         .base64;
 
-    const target_encoding_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, target_encoding_val));
+    const target_encoding_str = mruby.borrowStr(mrb, target_encoding_val);
     const target_encoding: Resource.Encoding = if (std.mem.eql(u8, target_encoding_str, "base64"))
         .base64
     else
         .binary;
 
+    const envelope_str = mruby.borrowStr(mrb, envelope_val);
+    const envelope = std.mem.eql(u8, envelope_str, "true");
+
+    const data_key_ttl_str = mruby.borrowStr(mrb, data_key_ttl_val);
+    const data_key_ttl: u32 = std.fmt.parseInt(u32, data_key_ttl_str, 10) catch 0;
+
     var common = base.CommonProps.init(allocator);
     base.fillCommonFromRuby(&common, mrb, only_if_val, not_if_val, ignore_failure_val, notifications_val, subscriptions_val, allocator);
 
@@ -477,6 +654,8 @@ pub fn zigAddResource(
         .owner = owner,
         .group = group,
         .action = action,
+        .envelope = envelope,
+        .data_key_ttl = data_key_ttl,
         .common = common,
     }) catch return mruby.mrb_nil_value();
 
@@ -18,6 +18,8 @@ class AwsKmsResource
     @owner = ""
     @group = ""
     @action = "decrypt"
+    @envelope = false
+    @data_key_ttl = ""  # empty means no caching
     @only_if_proc = nil
     @not_if_proc = nil
     @ignore_failure = false
@@ -67,6 +69,8 @@ class AwsKmsResource
       @owner,
       @group,
       @action,
+      @envelope ? "true" : "false",
+      @data_key_ttl,
       only_if_arg,
       not_if_arg,
       @ignore_failure,
@@ -161,6 +165,18 @@ class AwsKmsResource
     @action = value.to_s
   end
 
+  # Encrypt the payload locally under a KMS-generated data key; only the
+  # data key is sent to KMS, so payloads are not limited to 4 KB
+  def envelope(value = true)
+    @envelope = value ? true : false
+  end
+
+  # Seconds a decrypted envelope data key is reused within a run, so
+  # envelopes sharing a data key cost one KMS call; 0 (default) disables
+  def data_key_ttl(value)
+    @data_key_ttl = value.to_i.to_s
+  end
+
   def only_if(command = nil, &block)
     @only_if_proc = command&.to_s || block
   end
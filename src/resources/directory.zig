@@ -1,6 +1,7 @@
 const std = @import("std");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
+const dir_cache = @import("../dir_cache.zig");
 const logger = @import("../logger.zig");
 
 /// Directory resource data structure
@@ -68,142 +69,83 @@ pub const Resource = struct {
     }
 
     fn applyCreate(self: Resource) !bool {
-        const is_abs = std.fs.path.isAbsolute(self.path);
-
-        // Check if directory already exists
-        const dir_exists = blk: {
-            if (is_abs) {
-                std.fs.accessAbsolute(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            } else {
-                std.fs.cwd().access(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            }
+        const existed = blk: {
+            _ = std.posix.fstatat(std.posix.AT.FDCWD, self.path, 0) catch |err| switch (err) {
+                error.FileNotFound => break :blk false,
+                else => return err,
+            };
             break :blk true;
         };
 
-        if (dir_exists) {
-            // Check if attributes need to be updated
-            var needs_update = false;
-
-            // Check and update mode
-            if (self.attrs.mode) |m| {
-                var dir = if (is_abs)
-                    try std.fs.openDirAbsolute(self.path, .{})
-                else
-                    try std.fs.cwd().openDir(self.path, .{});
-                defer dir.close();
-
-                const stat = try dir.stat();
-                const current_mode = stat.mode & 0o777;
-                if (current_mode != m) {
-                    // Update mode using path-based chmod instead of fd-based fchmod
-                    // This avoids BADF errors on some systems where dir.fd might not be valid
-                    base.setFileMode(self.path, m);
-                    needs_update = true;
-                }
-            }
-
-            // Apply owner/group if specified (without mode, as we handled it above)
-            if (self.attrs.owner != null or self.attrs.group != null) {
-                base.setFileOwnerAndGroup(self.path, self.attrs.owner, self.attrs.group) catch |err| {
-                    logger.warn("Failed to set owner/group for {s}: {}", .{ self.path, err });
-                };
-                needs_update = true;
-            }
+        // Parents are created whether or not `recursive` is set, as before.
+        // Known directories cost one stat here; others are recorded.
+        try base.ensurePath(self.path);
 
-            return needs_update;
+        if (self.attrs.mode == null and self.attrs.owner == null and self.attrs.group == null) {
+            return !existed;
         }
 
-        // Create directory
-        if (self.recursive) {
-            try base.ensurePath(self.path);
-        } else {
-            try base.ensureParentDir(self.path);
-            if (is_abs) {
-                try std.fs.makeDirAbsolute(self.path);
-            } else {
-                try std.fs.cwd().makeDir(self.path);
-            }
-        }
+        // A real read-only fd rather than std.fs.Dir's O_PATH one, which
+        // fchmod/fchown reject with EBADF on Linux
+        const fd = try std.posix.openat(std.posix.AT.FDCWD, self.path, .{ .ACCMODE = .RDONLY, .DIRECTORY = true, .CLOEXEC = true }, 0);
+        defer std.posix.close(fd);
+        const stat = try std.posix.fstat(fd);
+
+        var changed = !existed;
 
-        // Set mode if specified
         if (self.attrs.mode) |m| {
-            // Use path-based chmod instead of fd-based fchmod
-            // This avoids BADF errors on some systems
-            base.setFileMode(self.path, m);
+            if ((stat.mode & 0o777) != m) {
+                std.posix.fchmod(fd, @intCast(m)) catch {};
+                changed = true;
+            }
         }
 
-        // Apply owner/group if specified
         if (self.attrs.owner != null or self.attrs.group != null) {
-            base.applyFileAttributes(self.path, self.attrs) catch |err| {
+            const owner_changed = setOwnerAndGroup(fd, stat, self.attrs) catch |err| blk: {
                 logger.warn("Failed to set owner/group for {s}: {}", .{ self.path, err });
+                break :blk false;
             };
+            changed = changed or owner_changed;
         }
 
-        return true; // Directory was created
+        return changed;
     }
 
-    fn applyDelete(self: Resource) !void {
-        const is_abs = std.fs.path.isAbsolute(self.path);
-
-        // Check if directory exists
-        const dir_exists = blk: {
-            if (is_abs) {
-                std.fs.accessAbsolute(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            } else {
-                std.fs.cwd().access(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            }
-            break :blk true;
-        };
+    /// fchown when the directory's owner or group differs from `attrs`
+    fn setOwnerAndGroup(fd: std.posix.fd_t, stat: std.posix.Stat, attrs: base.FileAttributes) !bool {
+        const uid = if (attrs.owner) |o| try base.getUserId(o) else stat.uid;
+        const gid = if (attrs.group) |g| try base.getGroupId(g) else stat.gid;
+        if (uid == stat.uid and gid == stat.gid) return false;
+        try std.posix.fchown(fd, uid, gid);
+        return true;
+    }
 
-        if (!dir_exists) {
-            return; // Already deleted
-        }
+    fn applyDelete(self: Resource) !void {
+        // The cache may list the directory or anything below it
+        defer dir_cache.reset();
 
-        var resolved: ?[]u8 = null;
-        defer if (resolved) |buf| std.heap.c_allocator.free(buf);
+        const dir_path = std.mem.trimEnd(u8, self.path, "/");
+        const name = std.fs.path.basename(dir_path);
+        if (name.len == 0) return error.InvalidPath;
+        const parent_path = std.fs.path.dirname(dir_path) orelse ".";
 
-        const abs_path = if (is_abs) self.path else blk: {
-            const buf = try std.fs.cwd().realpathAlloc(std.heap.c_allocator, self.path);
-            resolved = buf;
-            break :blk buf;
+        var parent = std.fs.cwd().openDir(parent_path, .{}) catch |err| switch (err) {
+            error.FileNotFound => return, // Already deleted
+            else => return err,
         };
+        defer parent.close();
 
         if (self.recursive) {
-            try deleteDirRecursiveAbsolute(abs_path);
+            // Walks the tree with directory fds (openat/unlinkat), never
+            // resolving a full path per entry
+            try parent.deleteTree(name);
         } else {
-            std.fs.deleteDirAbsolute(abs_path) catch |err| switch (err) {
-                error.DirNotEmpty => return error.DirNotEmpty,
+            parent.deleteDir(name) catch |err| switch (err) {
+                error.FileNotFound => {}, // Already deleted
                 else => return err,
             };
         }
     }
-
-    fn deleteDirRecursiveAbsolute(path: []const u8) !void {
-        var dir = try std.fs.openDirAbsolute(path, .{ .iterate = true });
-        defer dir.close();
-        var iterator = dir.iterate();
-        while (try iterator.next()) |entry| {
-            const child_path = try std.fmt.allocPrint(std.heap.page_allocator, "{s}/{s}", .{ path, entry.name });
-            defer std.heap.page_allocator.free(child_path);
-            switch (entry.kind) {
-                .directory => try deleteDirRecursiveAbsolute(child_path),
-                else => try std.fs.deleteFileAbsolute(child_path),
-            }
-        }
-        try std.fs.deleteDirAbsolute(path);
-    }
 };
 
 /// Ruby prelude for directory resource
@@ -233,27 +175,23 @@ pub fn zigAddResource(
     _ = mruby.mrb_get_args(mrb, "SSSSbS|oooAA", &path_val, &mode_val, &owner_val, &group_val, &recursive_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
     // Extract path
-    const path_cstr = mruby.mrb_str_to_cstr(mrb, path_val);
-    const path = allocator.dupe(u8, std.mem.span(path_cstr)) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
 
     // Parse mode (optional)
-    const mode_cstr = mruby.mrb_str_to_cstr(mrb, mode_val);
-    const mode_str = std.mem.span(mode_cstr);
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
     // Parse owner and group
-    const owner_cstr = mruby.mrb_str_to_cstr(mrb, owner_val);
-    const owner_str = std.mem.span(owner_cstr);
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
@@ -263,8 +201,7 @@ pub fn zigAddResource(
     const recursive = mruby.mrb_test(recursive_val);
 
     // Parse action (string)
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "delete"))
         .delete
     else
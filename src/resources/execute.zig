@@ -265,6 +265,7 @@ pub const Resource = struct {
         var stderr = std.ArrayList(u8).empty;
         defer stderr.deinit(allocator);
 
+        base.noteSubprocess();
         try child.spawn();
         // On a pre-exec failure (bad cwd, setpgid, etc.) the forked child
         // reports the error and _exit()s. Close our pipe ends and reap it so
@@ -670,30 +671,22 @@ pub fn zigAddResource(
     // Get 5 strings + 1 array + 1 bool + 2 strings + timeout + common optional args.
     _ = mruby.mrb_get_args(mrb, "SSSSSAoSSi|oooAA", &name_val, &command_val, &cwd_val, &user_val, &group_val, &environment_val, &live_stream_val, &creates_val, &action_val, &timeout_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-    const command_cstr = mruby.mrb_str_to_cstr(mrb, command_val);
-    const cwd_cstr = mruby.mrb_str_to_cstr(mrb, cwd_val);
-    const user_cstr = mruby.mrb_str_to_cstr(mrb, user_val);
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-    const creates_cstr = mruby.mrb_str_to_cstr(mrb, creates_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
+    const name = allocator.dupe(u8, mruby.borrowStr(mrb, name_val)) catch return mruby.mrb_nil_value();
+    const command = allocator.dupe(u8, mruby.borrowStr(mrb, command_val)) catch return mruby.mrb_nil_value();
 
-    const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch return mruby.mrb_nil_value();
-    const command = allocator.dupe(u8, std.mem.span(command_cstr)) catch return mruby.mrb_nil_value();
-
-    const cwd_str = std.mem.span(cwd_cstr);
+    const cwd_str = mruby.borrowStr(mrb, cwd_val);
     const cwd: ?[]const u8 = if (cwd_str.len > 0)
         allocator.dupe(u8, cwd_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const user_str = std.mem.span(user_cstr);
+    const user_str = mruby.borrowStr(mrb, user_val);
     const user: ?[]const u8 = if (user_str.len > 0)
         allocator.dupe(u8, user_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
@@ -701,13 +694,13 @@ pub fn zigAddResource(
 
     const live_stream = mruby.mrb_test(live_stream_val);
 
-    const creates_str = std.mem.span(creates_cstr);
+    const creates_str = mruby.borrowStr(mrb, creates_val);
     const creates: ?[]const u8 = if (creates_str.len > 0)
         allocator.dupe(u8, creates_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "nothing"))
         .nothing
     else
@@ -718,38 +711,7 @@ pub fn zigAddResource(
         @intCast(@min(timeout_val, @as(mruby.mrb_int, std.math.maxInt(u32))));
 
     // Parse environment array [[key, value], ...]
-    var environment: ?[]const u8 = null;
-    const env_len = mruby.mrb_ary_len(mrb, environment_val);
-    if (env_len > 0) {
-        // Build environment string in format "KEY=VALUE\0KEY2=VALUE2\0"
-        var env_list = std.ArrayList(u8).initCapacity(allocator, @intCast(env_len * 32)) catch std.ArrayList(u8).empty;
-        defer env_list.deinit(allocator);
-
-        var i: mruby.mrb_int = 0;
-        while (i < env_len) : (i += 1) {
-            const pair = mruby.mrb_ary_ref(mrb, environment_val, i);
-            if (mruby.mrb_ary_len(mrb, pair) != 2) continue;
-
-            const key_val = mruby.mrb_ary_ref(mrb, pair, 0);
-            const val_val = mruby.mrb_ary_ref(mrb, pair, 1);
-
-            const key_cstr = mruby.mrb_str_to_cstr(mrb, key_val);
-            const val_cstr = mruby.mrb_str_to_cstr(mrb, val_val);
-
-            const key_str = std.mem.span(key_cstr);
-            const val_str = std.mem.span(val_cstr);
-
-            // Append "KEY=VALUE\0"
-            env_list.appendSlice(allocator, key_str) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, '=') catch return mruby.mrb_nil_value();
-            env_list.appendSlice(allocator, val_str) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, 0) catch return mruby.mrb_nil_value();
-        }
-
-        if (env_list.items.len > 0) {
-            environment = allocator.dupe(u8, env_list.items) catch return mruby.mrb_nil_value();
-        }
-    }
+    const environment = base.environmentFromRuby(allocator, mrb, environment_val) catch return mruby.mrb_nil_value();
 
     // Build common properties (guards + notifications)
     var common = base.CommonProps.init(allocator);
@@ -4,6 +4,7 @@ const std = @import("std");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const logger = @import("../logger.zig");
+const hashing = @import("../hashing.zig");
 
 pub const FileMapping = struct {
     pattern: []const u8, // glob pattern, e.g. "*/s5cmd"
@@ -467,16 +468,82 @@ fn walkDirRecursiveInner(allocator: std.mem.Allocator, root: []const u8, prefix:
 
 const MARKER_NAME = ".hola-extracted";
 
-/// Build a fingerprint line: "path\tsize\tmtime_ns"
-fn buildFingerprint(alloc: std.mem.Allocator, archive_path: []const u8) ?[]const u8 {
+/// Archive fingerprint, the first line of the marker:
+///
+///   path\tsize\tmtime_ns\tinode\t<algorithm>:<hex>
+///
+/// Older markers only have the first three fields. The content hash lets a
+/// re-downloaded but identical archive (new mtime and inode) count as
+/// unchanged; (inode, size, mtime) matching the marker skips hashing.
+const Fingerprint = struct {
+    path: []const u8,
+    size: u64,
+    mtime: i128,
+    inode: ?u64 = null,
+    content: ?hashing.Checksum = null,
+
+    fn parse(line: []const u8) ?Fingerprint {
+        var fields = std.mem.splitScalar(u8, line, '\t');
+        var fp = Fingerprint{
+            .path = fields.next() orelse return null,
+            .size = std.fmt.parseInt(u64, fields.next() orelse return null, 10) catch return null,
+            .mtime = std.fmt.parseInt(i128, fields.next() orelse return null, 10) catch return null,
+        };
+        // Old text format ends here
+        const inode_field = fields.next() orelse return fp;
+        fp.inode = std.fmt.parseInt(u64, inode_field, 10) catch return null;
+        if (fields.next()) |content| {
+            fp.content = hashing.Checksum.parse(content) catch return null;
+        }
+        return fp;
+    }
+
+    fn format(self: Fingerprint, buf: []u8) ![]const u8 {
+        const inode = self.inode orelse
+            return std.fmt.bufPrint(buf, "{s}\t{d}\t{d}", .{ self.path, self.size, self.mtime });
+        const content = self.content orelse
+            return std.fmt.bufPrint(buf, "{s}\t{d}\t{d}\t{d}", .{ self.path, self.size, self.mtime, inode });
+        return std.fmt.bufPrint(buf, "{s}\t{d}\t{d}\t{d}\t{s}:{s}", .{
+            self.path,
+            self.size,
+            self.mtime,
+            inode,
+            @tagName(content.algorithm),
+            &hashing.toHex(content.digest),
+        });
+    }
+
+    /// Same archive file, untouched since the marker was written
+    fn sameFile(self: Fingerprint, current: Fingerprint) bool {
+        if (!std.mem.eql(u8, self.path, current.path)) return false;
+        if (self.size != current.size or self.mtime != current.mtime) return false;
+        const recorded_inode = self.inode orelse return true;
+        return recorded_inode == (current.inode orelse return false);
+    }
+};
+
+const content_algorithm: hashing.Algorithm = .blake3;
+
+/// Fingerprint of the archive on disk, without its content hash
+fn statFingerprint(archive_path: []const u8) ?Fingerprint {
     const archive_file = std.fs.openFileAbsolute(archive_path, .{}) catch return null;
     defer archive_file.close();
     const stat = archive_file.stat() catch return null;
-    return std.fmt.allocPrint(alloc, "{s}\t{d}\t{d}", .{ archive_path, stat.size, stat.mtime }) catch null;
+    return .{ .path = archive_path, .size = stat.size, .mtime = stat.mtime, .inode = @intCast(stat.inode) };
+}
+
+fn contentChecksum(archive_path: []const u8, algorithm: hashing.Algorithm) ?hashing.Checksum {
+    const digest = hashing.hashFile(archive_path, algorithm) catch |err| {
+        logger.debug("[extract] cannot hash {s}: {}", .{ archive_path, err });
+        return null;
+    };
+    return .{ .algorithm = algorithm, .digest = digest };
 }
 
 /// Check marker: fingerprint must match AND all recorded files must still exist.
 /// Marker format: first line = fingerprint, remaining lines = extracted file paths (relative to destination).
+/// A marker that matched by content, or predates content hashes, has its
+/// fingerprint line rewritten so the next run matches on stat alone.
 fn checkMarker(destination: []const u8, archive_path: []const u8) bool {
     const alloc = std.heap.c_allocator;
     const marker_path = std.fs.path.join(alloc, &.{ destination, MARKER_NAME }) catch return false;
@@ -485,14 +552,31 @@ fn checkMarker(destination: []const u8, archive_path: []const u8) bool {
     defer alloc.free(content);
 
     // First line is fingerprint
-    var line_iter = std.mem.splitScalar(u8, content, '\n');
-    const first_line = line_iter.next() orelse return false;
-
-    const fingerprint = buildFingerprint(alloc, archive_path) orelse return false;
-    defer alloc.free(fingerprint);
-    if (!std.mem.eql(u8, first_line, fingerprint)) return false;
+    const first_end = std.mem.indexOfScalar(u8, content, '\n') orelse content.len;
+    const recorded = Fingerprint.parse(content[0..first_end]) orelse return false;
+    var current = statFingerprint(archive_path) orelse return false;
+
+    var upgrade = false;
+    if (recorded.sameFile(current)) {
+        if (recorded.content) |checksum| {
+            current.content = checksum;
+        } else {
+            current.content = contentChecksum(archive_path, content_algorithm);
+            upgrade = current.content != null;
+        }
+    } else {
+        // Replaced file: unchanged only if the bytes are the same
+        const checksum = recorded.content orelse return false;
+        if (!std.mem.eql(u8, recorded.path, current.path) or recorded.size != current.size) return false;
+        const actual = contentChecksum(archive_path, checksum.algorithm) orelse return false;
+        if (!checksum.matches(actual.digest)) return false;
+        current.content = actual;
+        upgrade = true;
+    }
 
     // Remaining lines are file paths — verify each exists (without following symlinks)
+    const files = if (first_end < content.len) content[first_end + 1 ..] else "";
+    var line_iter = std.mem.splitScalar(u8, files, '\n');
     while (line_iter.next()) |line| {
         if (line.len == 0) continue;
         const file_path = std.fs.path.join(alloc, &.{ destination, line }) catch return false;
@@ -500,6 +584,9 @@ fn checkMarker(destination: []const u8, archive_path: []const u8) bool {
         if (!pathExistsNoFollow(file_path)) return false;
     }
 
+    if (upgrade) {
+        writeMarkerContent(marker_path, current, files);
+    }
     return true;
 }
 
@@ -508,16 +595,26 @@ fn writeMarker(destination: []const u8, archive_path: []const u8, files: []const
     const alloc = std.heap.c_allocator;
     const marker_path = std.fs.path.join(alloc, &.{ destination, MARKER_NAME }) catch return;
     defer alloc.free(marker_path);
-    const fingerprint = buildFingerprint(alloc, archive_path) orelse return;
-    defer alloc.free(fingerprint);
+    var fingerprint = statFingerprint(archive_path) orelse return;
+    fingerprint.content = contentChecksum(archive_path, content_algorithm);
+
+    var list = std.ArrayList(u8).empty;
+    defer list.deinit(alloc);
+    for (files) |rel| {
+        list.appendSlice(alloc, rel) catch return;
+        list.append(alloc, '\n') catch return;
+    }
+    writeMarkerContent(marker_path, fingerprint, list.items);
+}
+
+fn writeMarkerContent(marker_path: []const u8, fingerprint: Fingerprint, files: []const u8) void {
+    var buf: [std.fs.max_path_bytes + 256]u8 = undefined;
+    const line = fingerprint.format(&buf) catch return;
     const file = std.fs.createFileAbsolute(marker_path, .{ .truncate = true }) catch return;
     defer file.close();
-    file.writeAll(fingerprint) catch {};
+    file.writeAll(line) catch {};
     file.writeAll("\n") catch {};
-    for (files) |rel| {
-        file.writeAll(rel) catch {};
-        file.writeAll("\n") catch {};
-    }
+    file.writeAll(files) catch {};
 }
 
 pub fn detectArchiveType(path: []const u8) ArchiveType {
@@ -602,8 +699,8 @@ pub fn zigAddResource(
 
     _ = mruby.mrb_get_args(mrb, "SSASSSSS|oooAA", &path_val, &destination_val, &files_val, &mode_val, &owner_val, &group_val, &action_val, &strip_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const path = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, path_val))) catch return mruby.mrb_nil_value();
-    const destination = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, destination_val))) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
+    const destination = allocator.dupe(u8, mruby.borrowStr(mrb, destination_val)) catch return mruby.mrb_nil_value();
 
     // Parse files array: [[pattern, target], ...]
     var mappings_list = std.ArrayList(FileMapping).initCapacity(allocator, 4) catch std.ArrayList(FileMapping).empty;
@@ -616,8 +713,8 @@ pub fn zigAddResource(
             const pattern_val = mruby.mrb_ary_ref(mrb, pair, 0);
             const target_val = mruby.mrb_ary_ref(mrb, pair, 1);
 
-            const pat = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, pattern_val))) catch continue;
-            const tgt = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, target_val))) catch {
+            const pat = allocator.dupe(u8, mruby.borrowStr(mrb, pattern_val)) catch continue;
+            const tgt = allocator.dupe(u8, mruby.borrowStr(mrb, target_val)) catch {
                 allocator.free(pat);
                 continue;
             };
@@ -632,35 +729,35 @@ pub fn zigAddResource(
     const file_mappings = mappings_list.toOwnedSlice(allocator) catch return mruby.mrb_nil_value();
 
     // Parse action
-    const action_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, action_val));
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "extract_files"))
         .extract_files
     else
         .extract;
 
     // Parse strip_components
-    const strip_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, strip_val));
+    const strip_str = mruby.borrowStr(mrb, strip_val);
     const strip_components: u32 = if (strip_str.len > 0)
         std.fmt.parseInt(u32, strip_str, 10) catch 0
     else
         0;
 
     // Parse mode
-    const mode_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, mode_val));
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
     // Parse owner
-    const owner_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, owner_val));
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch null
     else
         null;
 
     // Parse group
-    const group_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, group_val));
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group_opt: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch null
     else
@@ -730,3 +827,70 @@ test "globMatch edge cases" {
     try testing.expect(globMatch("*", "anything"));
     try testing.expect(!globMatch("*", "a/b"));
 }
+
+test "Fingerprint reads the old format and round-trips the new one" {
+    const testing = std.testing;
+    const old = Fingerprint.parse("/tmp/a.tar.gz\t1024\t1700000000000000000").?;
+    try testing.expectEqualStrings("/tmp/a.tar.gz", old.path);
+    try testing.expectEqual(@as(?u64, null), old.inode);
+    try testing.expect(old.content == null);
+
+    const fp = Fingerprint{
+        .path = "/tmp/a.tar.gz",
+        .size = 1024,
+        .mtime = 1700000000000000000,
+        .inode = 42,
+        .content = .{ .algorithm = .blake3, .digest = hashing.hashBytes("archive", .blake3, 1) },
+    };
+    var buf: [512]u8 = undefined;
+    const parsed = Fingerprint.parse(try fp.format(&buf)).?;
+    try testing.expectEqual(@as(?u64, 42), parsed.inode);
+    try testing.expect(parsed.content.?.matches(fp.content.?.digest));
+    try testing.expect(old.sameFile(parsed));
+    try testing.expect(!parsed.sameFile(.{ .path = fp.path, .size = fp.size, .mtime = fp.mtime, .inode = 43 }));
+}
+
+test "checkMarker upgrades old markers and accepts identical replacements" {
+    const testing = std.testing;
+    const alloc = testing.allocator;
+    var tmp = testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    try tmp.dir.writeFile(.{ .sub_path = "a.tar", .data = "archive bytes" });
+    try tmp.dir.makeDir("dest");
+    try tmp.dir.writeFile(.{ .sub_path = "dest/bin", .data = "x" });
+    const root = try tmp.dir.realpathAlloc(alloc, ".");
+    defer alloc.free(root);
+    const archive = try std.fs.path.join(alloc, &.{ root, "a.tar" });
+    defer alloc.free(archive);
+    const dest = try std.fs.path.join(alloc, &.{ root, "dest" });
+    defer alloc.free(dest);
+
+    // Marker as written by earlier versions
+    const stat = try tmp.dir.statFile("a.tar");
+    var buf: [1024]u8 = undefined;
+    const old_marker = try std.fmt.bufPrint(&buf, "{s}\t{d}\t{d}\nbin\n", .{ archive, stat.size, stat.mtime });
+    try tmp.dir.writeFile(.{ .sub_path = "dest/" ++ MARKER_NAME, .data = old_marker });
+
+    try testing.expect(checkMarker(dest, archive));
+    const upgraded = try tmp.dir.readFileAlloc(alloc, "dest/" ++ MARKER_NAME, 4096);
+    defer alloc.free(upgraded);
+    try testing.expectEqual(@as(usize, 4), std.mem.count(u8, upgraded[0..std.mem.indexOfScalar(u8, upgraded, '\n').?], "\t"));
+    try testing.expect(std.mem.endsWith(u8, upgraded, "\nbin\n"));
+
+    // Re-downloaded identical archive: new file, same bytes, newer mtime
+    try replaceArchive(tmp.dir, "archive bytes", stat.mtime + std.time.ns_per_s);
+    try testing.expect(checkMarker(dest, archive));
+
+    // Same size, different bytes
+    try replaceArchive(tmp.dir, "archive BYTES", stat.mtime + 2 * std.time.ns_per_s);
+    try testing.expect(!checkMarker(dest, archive));
+}
+
+fn replaceArchive(dir: std.fs.Dir, data: []const u8, mtime: i128) !void {
+    try dir.deleteFile("a.tar");
+    try dir.writeFile(.{ .sub_path = "a.tar", .data = data });
+    const file = try dir.openFile("a.tar", .{ .mode = .read_write });
+    defer file.close();
+    try file.updateTimes(mtime, mtime);
+}
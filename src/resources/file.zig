@@ -3,12 +3,14 @@ const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const git = @import("../git.zig");
 const logger = @import("../logger.zig");
+const hashing = @import("../hashing.zig");
+const xattr_fingerprint = @import("../xattr_fingerprint.zig");
 
 /// File resource data structure
 pub const Resource = struct {
     // Resource-specific properties
     path: []const u8,
-    content: []const u8,
+    content: []const u8, // Pinned in the run's mruby state (mruby.pinStr), not owned
     attrs: base.FileAttributes,
     action: Action,
 
@@ -23,7 +25,6 @@ pub const Resource = struct {
 
     pub fn deinit(self: Resource, allocator: std.mem.Allocator) void {
         allocator.free(self.path);
-        allocator.free(self.content);
         self.attrs.deinit(allocator);
 
         // Deinit common props (handles GC, notifications, etc.)
@@ -110,23 +111,35 @@ pub const Resource = struct {
         var existing_content: ?[]u8 = null;
         defer if (existing_content) |c| std.heap.c_allocator.free(c);
 
+        const fingerprint = xattr_fingerprint.Record{
+            .kind = .blake3,
+            .digest = hashing.hashBytes(self.content, .blake3, 1),
+        };
+
         var current_mode: ?u32 = null;
         if (file_exists) {
-            // Read existing file and compare content
             const existing_file = if (is_abs)
                 try std.fs.openFileAbsolute(self.path, .{})
             else
                 try std.fs.cwd().openFile(self.path, .{});
             defer existing_file.close();
 
-            existing_content = try existing_file.readToEndAlloc(std.heap.c_allocator, std.math.maxInt(usize));
+            const stat = try existing_file.stat();
+            current_mode = @intCast(stat.mode & 0o777);
 
-            if (self.attrs.mode) |_| {
-                const stat = try existing_file.stat();
-                current_mode = @intCast(stat.mode & 0o777);
+            // A fingerprint written with the file proves the content without
+            // reading it; otherwise read existing file and compare content
+            var content_matches = if (xattr_fingerprint.load(existing_file, stat)) |record|
+                record.kind == fingerprint.kind and std.mem.eql(u8, &record.digest, &fingerprint.digest)
+            else
+                false;
+            if (!content_matches) {
+                existing_content = try existing_file.readToEndAlloc(std.heap.c_allocator, std.math.maxInt(usize));
+                content_matches = std.mem.eql(u8, existing_content.?, self.content);
+                if (content_matches) xattr_fingerprint.store(existing_file, fingerprint);
             }
 
-            if (std.mem.eql(u8, existing_content.?, self.content)) {
+            if (content_matches) {
                 // Content matches, check attributes if specified
                 const mode_matches = if (self.attrs.mode) |m|
                     current_mode != null and current_mode.? == m
@@ -198,6 +211,8 @@ pub const Resource = struct {
 
         try temp_file.writeAll(self.content);
         try temp_file.sync();
+        // Survives the rename below
+        xattr_fingerprint.store(temp_file, fingerprint);
         temp_file.close();
         temp_file_closed = true;
 
@@ -319,17 +334,11 @@ pub fn zigAddResource(
     // Get 6 strings + 2 optional blocks + 1 optional boolean + 2 optional arrays
     _ = mruby.mrb_get_args(mrb, "SSSSSS|oooAA", &path_val, &content_val, &action_val, &mode_val, &owner_val, &group_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const path_cstr = mruby.mrb_str_to_cstr(mrb, path_val);
-    const content_cstr = mruby.mrb_str_to_cstr(mrb, content_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-    const mode_cstr = mruby.mrb_str_to_cstr(mrb, mode_val);
-    const owner_cstr = mruby.mrb_str_to_cstr(mrb, owner_val);
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-
-    const path = allocator.dupe(u8, std.mem.span(path_cstr)) catch return mruby.mrb_nil_value();
-    const content = allocator.dupe(u8, std.mem.span(content_cstr)) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
+    // Content can be large and is only read during the run: borrow it
+    const content = mruby.pinStr(mrb, content_val);
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "delete"))
         .delete
     else if (std.mem.eql(u8, action_str, "touch"))
@@ -337,19 +346,19 @@ pub fn zigAddResource(
     else
         .create;
 
-    const mode_str = std.mem.span(mode_cstr);
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
-    const owner_str = std.mem.span(owner_cstr);
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
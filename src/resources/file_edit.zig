@@ -67,6 +67,10 @@ pub const Resource = struct {
     }
 };
 
+/// Files at least this large are memory-mapped and streamed to a temp
+/// file instead of being read and rebuilt in memory
+const large_file_threshold = 32 * 1024 * 1024;
+
 fn applyEdit(res: Resource) !bool {
     const file = std.fs.openFileAbsolute(res.path, .{}) catch |err| {
         logger.err("Failed to open file {s}: {}", .{ res.path, err });
@@ -74,181 +78,377 @@ fn applyEdit(res: Resource) !bool {
     };
     defer file.close();
 
+    const stages = try compileOperations(res.allocator, res.operations);
+    defer freeStages(res.allocator, stages);
+
+    const size = try file.getEndPos();
+    if (size >= large_file_threshold) return applyLargeEdit(res, file, size, stages);
+
     const content = file.readToEndAlloc(res.allocator, std.math.maxInt(usize)) catch |err| {
         logger.err("Failed to read file {s}: {}", .{ res.path, err });
         return err;
     };
     defer res.allocator.free(content);
 
-    var modified_content = try res.allocator.dupe(u8, content);
-    var file_edited = false;
-
-    for (res.operations) |op| {
-        const result = try applyOperation(res.allocator, modified_content, op);
-        if (!std.mem.eql(u8, result, modified_content)) {
-            file_edited = true;
-            res.allocator.free(modified_content);
-            modified_content = result;
-        } else {
-            res.allocator.free(result);
-        }
-    }
+    const modified_content = (try editContent(res.allocator, content, stages)) orelse return false;
     defer res.allocator.free(modified_content);
 
-    if (!file_edited) {
-        return false;
+    backupFile(res);
+    try writeFile(res, modified_content);
+    return true;
+}
+
+/// Large-file mode: the input is mapped read-only and output is compared
+/// against it as it is produced. Nothing is written while the output still
+/// equals the input; output that only adds bytes at the end is appended in
+/// place, anything else is streamed to a temp file and renamed over.
+fn applyLargeEdit(res: Resource, file: std.fs.File, size: u64, stages: []Stage) !bool {
+    const content = try std.posix.mmap(null, @intCast(size), std.posix.PROT.READ, .{ .TYPE = .PRIVATE }, file.handle, 0);
+    defer std.posix.munmap(content);
+    std.posix.madvise(content.ptr, content.len, std.posix.MADV.SEQUENTIAL) catch {};
+
+    if (!mayChange(content, stages)) return false;
+
+    const temp_path = try tempPathFor(res);
+    defer res.allocator.free(temp_path);
+
+    var sink = DiffSink{ .allocator = res.allocator, .original = content, .temp_path = temp_path };
+    defer sink.deinit();
+
+    try runPipeline(DiffSink, res.allocator, content, stages, &sink);
+
+    switch (try sink.finish()) {
+        .unchanged => return false,
+        .appended => |suffix| {
+            backupFile(res);
+            const out = try std.fs.openFileAbsolute(res.path, .{ .mode = .write_only });
+            defer out.close();
+            try out.seekTo(size);
+            try out.writeAll(suffix);
+            try out.sync();
+        },
+        .rewritten => {
+            backupFile(res);
+            try std.fs.renameAbsolute(temp_path, res.path);
+            sink.temp_created = false;
+        },
     }
+    applyAttributes(res);
+    return true;
+}
 
-    if (res.backup) {
-        const backup_path = try std.fmt.allocPrint(res.allocator, "{s}.bak", .{res.path});
-        defer res.allocator.free(backup_path);
-        std.fs.copyFileAbsolute(res.path, backup_path, .{}) catch |err| {
-            logger.warn("Failed to create backup {s}: {}", .{ backup_path, err });
+/// One operation of the edit pipeline. Each stage sees the lines produced
+/// by the stages before it, exactly as if the operations ran one after
+/// another over the whole file. The last line a stage produced is held back
+/// in `pending` until the stage knows whether it ends the file, which
+/// insert_line_if_no_match needs to place its line.
+const Stage = struct {
+    op: Resource.Operation,
+    // null when the pattern failed to compile; the stage then passes lines through
+    re: ?regex.JitRegex,
+    pending: ?[]const u8 = null,
+    // Holds `pending` when it is not a slice of the input, so per-line
+    // scratch memory can be released after every input line
+    pending_buf: std.ArrayList(u8) = .empty,
+    emitted: bool = false,
+    matched: bool = false,
+};
+
+/// Compile every pattern once. Patterns are compiled multiline so the same
+/// code can match a single line or pre-scan the whole file.
+fn compileOperations(allocator: std.mem.Allocator, operations: []const Resource.Operation) ![]Stage {
+    const stages = try allocator.alloc(Stage, operations.len);
+    for (operations, 0..) |op, i| {
+        const re = regex.JitRegex.compile(op.pattern, .{ .multiline = true }) catch |err| blk: {
+            if (err == error.OutOfMemory) {
+                for (stages[0..i]) |*done| {
+                    if (done.re) |*compiled| compiled.deinit();
+                }
+                allocator.free(stages);
+                return err;
+            }
+            logger.err("Invalid regex pattern: {s}", .{op.pattern});
+            break :blk null;
         };
+        stages[i] = .{ .op = op, .re = re };
     }
-
-    try writeFile(res, modified_content);
-    return true;
+    return stages;
 }
 
-fn applyOperation(allocator: std.mem.Allocator, content: []const u8, op: Resource.Operation) ![]u8 {
-    return switch (op.op_type) {
-        .search_file_replace => try doSearchFileReplace(allocator, content, op.pattern, op.replacement),
-        .search_file_replace_line => try doSearchFileReplaceLine(allocator, content, op.pattern, op.replacement),
-        .search_file_delete => try doSearchFileReplace(allocator, content, op.pattern, ""),
-        .search_file_delete_line => try doSearchFileDeleteLine(allocator, content, op.pattern),
-        .insert_line_after_match => try doInsertLineAfterMatch(allocator, content, op.pattern, op.replacement),
-        .insert_line_if_no_match => try doInsertLineIfNoMatch(allocator, content, op.pattern, op.replacement),
-    };
+fn freeStages(allocator: std.mem.Allocator, stages: []Stage) void {
+    for (stages) |*stage| {
+        if (stage.re) |*re| re.deinit();
+        stage.pending_buf.deinit(allocator);
+    }
+    allocator.free(stages);
 }
 
-fn doSearchFileReplace(allocator: std.mem.Allocator, content: []const u8, pattern: []const u8, replacement: []const u8) ![]u8 {
-    var re = regex.Regex.compile(allocator, pattern, .{}) catch {
-        logger.err("Invalid regex pattern: {s}", .{pattern});
-        return try allocator.dupe(u8, content);
-    };
-    defer re.deinit();
+/// Run all operations over `content` in a single pass. Returns the edited
+/// content, or null when the file would not change.
+fn editContent(allocator: std.mem.Allocator, content: []const u8, stages: []Stage) !?[]u8 {
+    if (!mayChange(content, stages)) return null;
 
-    var result = std.ArrayList(u8).initCapacity(allocator, content.len) catch std.ArrayList(u8).empty;
-    errdefer result.deinit(allocator);
+    var sink = BufferSink{ .allocator = allocator, .buf = try std.ArrayList(u8).initCapacity(allocator, content.len) };
+    errdefer sink.buf.deinit(allocator);
 
-    var lines = std.mem.splitScalar(u8, content, '\n');
-    var first = true;
-    while (lines.next()) |line| {
-        if (!first) try result.append(allocator, '\n');
-        first = false;
+    try runPipeline(BufferSink, allocator, content, stages, &sink);
 
-        const modified = try re.replaceAll(allocator, line, replacement);
-        defer allocator.free(modified);
-        try result.appendSlice(allocator, modified);
+    if (std.mem.eql(u8, sink.buf.items, content)) {
+        sink.buf.deinit(allocator);
+        return null;
     }
-
-    return result.toOwnedSlice(allocator);
+    return try sink.buf.toOwnedSlice(allocator);
 }
 
-fn doSearchFileReplaceLine(allocator: std.mem.Allocator, content: []const u8, pattern: []const u8, replacement: []const u8) ![]u8 {
-    var re = regex.Regex.compile(allocator, pattern, .{}) catch {
-        logger.err("Invalid regex pattern: {s}", .{pattern});
-        return try allocator.dupe(u8, content);
-    };
-    defer re.deinit();
+fn runPipeline(comptime Sink: type, allocator: std.mem.Allocator, content: []const u8, stages: []Stage, sink: *Sink) !void {
+    // Rewritten lines live only until the input line that produced them
+    // has gone through every stage
+    var arena = std.heap.ArenaAllocator.init(allocator);
+    defer arena.deinit();
 
-    var result = std.ArrayList(u8).initCapacity(allocator, content.len) catch std.ArrayList(u8).empty;
-    errdefer result.deinit(allocator);
+    var pipeline = Pipeline(Sink){
+        .scratch = arena.allocator(),
+        .allocator = allocator,
+        .input = content,
+        .stages = stages,
+        .sink = sink,
+    };
 
+    // splitScalar finds newlines with std.mem.indexOfScalarPos, which
+    // scans a vector of bytes at a time
     var lines = std.mem.splitScalar(u8, content, '\n');
-    var first = true;
     while (lines.next()) |line| {
-        if (!first) try result.append(allocator, '\n');
-        first = false;
+        try pipeline.feed(0, line);
+        _ = arena.reset(.retain_capacity);
+    }
+    try pipeline.finish(0);
+}
 
-        if (re.isMatch(line)) {
-            try result.appendSlice(allocator, replacement);
-        } else {
-            try result.appendSlice(allocator, line);
+/// Cheap whole-file check: if no pattern can match anywhere (and no
+/// operation acts on the absence of a match), the edit is a no-op.
+fn mayChange(content: []const u8, stages: []const Stage) bool {
+    for (stages) |*stage| {
+        const re = if (stage.re) |*re| re else continue;
+        if (stage.op.op_type == .insert_line_if_no_match) return true;
+        // Anchors tied to the subject bounds behave differently on the
+        // whole file than on a single line
+        for ([_][]const u8{ "\\A", "\\Z", "\\z", "\\G" }) |anchor| {
+            if (std.mem.indexOf(u8, stage.op.pattern, anchor) != null) return true;
         }
+        if (re.isMatch(content)) return true;
     }
-
-    return result.toOwnedSlice(allocator);
+    return false;
 }
 
-fn doSearchFileDeleteLine(allocator: std.mem.Allocator, content: []const u8, pattern: []const u8) ![]u8 {
-    var re = regex.Regex.compile(allocator, pattern, .{}) catch {
-        logger.err("Invalid regex pattern: {s}", .{pattern});
-        return try allocator.dupe(u8, content);
-    };
-    defer re.deinit();
+fn Pipeline(comptime Sink: type) type {
+    return struct {
+        const Self = @This();
+        // Explicit because the stage functions recurse into each other
+        const Error = Sink.Error;
+
+        scratch: std.mem.Allocator,
+        allocator: std.mem.Allocator,
+        input: []const u8,
+        stages: []Stage,
+        sink: *Sink,
+        out_lines: usize = 0,
+
+        /// Process one line (without its newline) at stage `k`
+        fn feed(self: *Self, k: usize, line: []const u8) Error!void {
+            if (k == self.stages.len) return self.write(line);
+
+            const stage = &self.stages[k];
+            const re = if (stage.re) |*re| re else return self.push(k, line);
+
+            switch (stage.op.op_type) {
+                .search_file_replace => try self.pushText(k, try re.replaceAll(self.scratch, line, stage.op.replacement)),
+                .search_file_delete => try self.pushText(k, try re.replaceAll(self.scratch, line, "")),
+                .search_file_replace_line => try self.pushText(k, if (re.isMatch(line)) stage.op.replacement else line),
+                .search_file_delete_line => if (!re.isMatch(line)) try self.push(k, line),
+                .insert_line_after_match => {
+                    try self.push(k, line);
+                    if (re.isMatch(line)) try self.pushText(k, stage.op.replacement);
+                },
+                .insert_line_if_no_match => {
+                    if (!stage.matched and re.isMatch(line)) stage.matched = true;
+                    try self.push(k, line);
+                },
+            }
+        }
 
-    var result = std.ArrayList(u8).initCapacity(allocator, content.len) catch std.ArrayList(u8).empty;
-    errdefer result.deinit(allocator);
+        /// Output text of stage `k`; embedded newlines start new lines for later stages
+        fn pushText(self: *Self, k: usize, text: []const u8) Error!void {
+            var lines = std.mem.splitScalar(u8, text, '\n');
+            while (lines.next()) |line| try self.push(k, line);
+        }
 
-    var lines = std.mem.splitScalar(u8, content, '\n');
-    var first = true;
-    while (lines.next()) |line| {
-        if (!re.isMatch(line)) {
-            if (!first) try result.append(allocator, '\n');
-            first = false;
-            try result.appendSlice(allocator, line);
+        fn push(self: *Self, k: usize, line: []const u8) Error!void {
+            const stage = &self.stages[k];
+            // The downstream stages copy what they keep, so the buffer
+            // behind `previous` may be reused afterwards
+            if (stage.pending) |previous| try self.feed(k + 1, previous);
+
+            if (self.isInput(line)) {
+                stage.pending = line;
+            } else {
+                stage.pending_buf.clearRetainingCapacity();
+                try stage.pending_buf.appendSlice(self.allocator, line);
+                stage.pending = stage.pending_buf.items;
+            }
+            stage.emitted = true;
         }
-    }
 
-    return result.toOwnedSlice(allocator);
-}
+        /// End of input for stage `k`: flush its held-back line, then the next stage
+        fn finish(self: *Self, k: usize) Error!void {
+            if (k == self.stages.len) return;
+
+            const stage = &self.stages[k];
+            if (stage.op.op_type == .insert_line_if_no_match and stage.re != null and !stage.matched) {
+                // Append "line\n" to the file: a trailing empty line means the
+                // file already ends with a newline
+                if (stage.pending) |last| {
+                    if (last.len == 0) stage.pending = null;
+                }
+                try self.pushText(k, stage.op.replacement);
+                try self.push(k, "");
+            }
+
+            // A stage that dropped every line still leaves an (empty) file behind
+            if (!stage.emitted) stage.pending = "";
+            if (stage.pending) |last| try self.feed(k + 1, last);
+            stage.pending = null;
+
+            try self.finish(k + 1);
+        }
 
-fn doInsertLineAfterMatch(allocator: std.mem.Allocator, content: []const u8, pattern: []const u8, newline: []const u8) ![]u8 {
-    var re = regex.Regex.compile(allocator, pattern, .{}) catch {
-        logger.err("Invalid regex pattern: {s}", .{pattern});
-        return try allocator.dupe(u8, content);
+        fn write(self: *Self, line: []const u8) Error!void {
+            if (self.out_lines > 0) try self.sink.writeAll("\n");
+            try self.sink.writeAll(line);
+            self.out_lines += 1;
+        }
+
+        fn isInput(self: *const Self, line: []const u8) bool {
+            const start = @intFromPtr(self.input.ptr);
+            const addr = @intFromPtr(line.ptr);
+            return addr >= start and addr + line.len <= start + self.input.len;
+        }
     };
-    defer re.deinit();
+}
 
-    var result = std.ArrayList(u8).initCapacity(allocator, content.len + newline.len + 1) catch std.ArrayList(u8).empty;
-    errdefer result.deinit(allocator);
+/// Pipeline output collected in memory
+const BufferSink = struct {
+    const Error = std.mem.Allocator.Error;
 
-    var lines = std.mem.splitScalar(u8, content, '\n');
-    var first = true;
-    while (lines.next()) |line| {
-        if (!first) try result.append(allocator, '\n');
-        first = false;
+    allocator: std.mem.Allocator,
+    buf: std.ArrayList(u8),
 
-        try result.appendSlice(allocator, line);
-        if (re.isMatch(line)) {
-            try result.append(allocator, '\n');
-            try result.appendSlice(allocator, newline);
-        }
+    fn writeAll(self: *BufferSink, bytes: []const u8) Error!void {
+        try self.buf.appendSlice(self.allocator, bytes);
     }
+};
 
-    return result.toOwnedSlice(allocator);
-}
+/// Pipeline output compared against the original file as it is produced.
+/// A temp file is only created once the output departs from the original;
+/// output that matches the original and then continues past its end is
+/// kept as a suffix that can be appended in place.
+const DiffSink = struct {
+    const Error = std.mem.Allocator.Error || std.fs.File.OpenError || std.fs.File.WriteError;
+
+    // Appends larger than this go through a temp file like any other rewrite
+    const max_suffix = 1024 * 1024;
 
-fn doInsertLineIfNoMatch(allocator: std.mem.Allocator, content: []const u8, pattern: []const u8, newline: []const u8) ![]u8 {
-    var re = regex.Regex.compile(allocator, pattern, .{}) catch {
-        logger.err("Invalid regex pattern: {s}", .{pattern});
-        return try allocator.dupe(u8, content);
+    allocator: std.mem.Allocator,
+    original: []const u8,
+    temp_path: []const u8,
+    // Output bytes known to equal original[0..matched]
+    matched: usize = 0,
+    suffix: std.ArrayList(u8) = .empty,
+    temp_file: ?std.fs.File = null,
+    // Cleared once the temp file has been renamed over the target
+    temp_created: bool = false,
+    buf: [64 * 1024]u8 = undefined,
+    buf_len: usize = 0,
+
+    const Outcome = union(enum) {
+        unchanged,
+        appended: []const u8,
+        rewritten,
     };
-    defer re.deinit();
 
-    var lines = std.mem.splitScalar(u8, content, '\n');
-    while (lines.next()) |line| {
-        if (re.isMatch(line)) {
-            return try allocator.dupe(u8, content);
+    fn deinit(self: *DiffSink) void {
+        self.suffix.deinit(self.allocator);
+        if (self.temp_file) |f| f.close();
+        if (self.temp_created) std.fs.deleteFileAbsolute(self.temp_path) catch {};
+    }
+
+    fn writeAll(self: *DiffSink, bytes: []const u8) Error!void {
+        if (self.temp_file != null) return self.writeTemp(bytes);
+
+        if (self.suffix.items.len == 0 and self.matched < self.original.len) {
+            const n = @min(bytes.len, self.original.len - self.matched);
+            const common = std.mem.indexOfDiff(u8, bytes[0..n], self.original[self.matched..][0..n]) orelse n;
+            self.matched += common;
+            if (common < n) return self.diverge(bytes[common..]);
+            if (n == bytes.len) return;
+            return self.appendSuffix(bytes[n..]);
         }
+        return self.appendSuffix(bytes);
     }
 
-    var result = std.ArrayList(u8).initCapacity(allocator, content.len + newline.len + 2) catch std.ArrayList(u8).empty;
-    errdefer result.deinit(allocator);
+    fn appendSuffix(self: *DiffSink, bytes: []const u8) Error!void {
+        if (self.suffix.items.len + bytes.len > max_suffix) return self.diverge(bytes);
+        try self.suffix.appendSlice(self.allocator, bytes);
+    }
 
-    try result.appendSlice(allocator, content);
-    if (content.len > 0 and content[content.len - 1] != '\n') {
-        try result.append(allocator, '\n');
+    /// Switch to a temp file holding everything produced so far
+    fn diverge(self: *DiffSink, rest: []const u8) Error!void {
+        self.temp_file = try std.fs.createFileAbsolute(self.temp_path, .{ .truncate = true, .exclusive = true });
+        self.temp_created = true;
+
+        try self.temp_file.?.writeAll(self.original[0..self.matched]);
+        try self.writeTemp(self.suffix.items);
+        self.suffix.clearAndFree(self.allocator);
+        try self.writeTemp(rest);
+    }
+
+    fn writeTemp(self: *DiffSink, bytes: []const u8) Error!void {
+        if (self.buf_len + bytes.len > self.buf.len) {
+            try self.temp_file.?.writeAll(self.buf[0..self.buf_len]);
+            self.buf_len = 0;
+            if (bytes.len > self.buf.len) return self.temp_file.?.writeAll(bytes);
+        }
+        @memcpy(self.buf[self.buf_len..][0..bytes.len], bytes);
+        self.buf_len += bytes.len;
     }
-    try result.appendSlice(allocator, newline);
-    try result.append(allocator, '\n');
 
-    return result.toOwnedSlice(allocator);
+    fn finish(self: *DiffSink) !Outcome {
+        // Output ended before the original did: the file shrinks
+        if (self.temp_file == null and self.matched < self.original.len) try self.diverge("");
+
+        if (self.temp_file) |f| {
+            try f.writeAll(self.buf[0..self.buf_len]);
+            self.buf_len = 0;
+            try f.sync();
+            f.close();
+            self.temp_file = null;
+            return .rewritten;
+        }
+        if (self.suffix.items.len > 0) return .{ .appended = self.suffix.items };
+        return .unchanged;
+    }
+};
+
+fn backupFile(res: Resource) void {
+    if (!res.backup) return;
+    const backup_path = std.fmt.allocPrint(res.allocator, "{s}.bak", .{res.path}) catch return;
+    defer res.allocator.free(backup_path);
+    std.fs.copyFileAbsolute(res.path, backup_path, .{}) catch |err| {
+        logger.warn("Failed to create backup {s}: {}", .{ backup_path, err });
+    };
 }
 
-fn writeFile(res: Resource, content: []const u8) !void {
+/// Unique temp file next to the target, so the final rename stays on one filesystem
+fn tempPathFor(res: Resource) ![]const u8 {
     try base.ensureParentDir(res.path);
 
     const dir_path = std.fs.path.dirname(res.path);
@@ -258,10 +458,14 @@ fn writeFile(res: Resource, content: []const u8) !void {
     const temp_name = try std.fmt.allocPrint(res.allocator, ".hola-file-edit-{d}-{d}", .{ timestamp, pid });
     defer res.allocator.free(temp_name);
 
-    const temp_path = if (dir_path) |d|
+    return if (dir_path) |d|
         try std.fs.path.join(res.allocator, &.{ d, temp_name })
     else
         try res.allocator.dupe(u8, temp_name);
+}
+
+fn writeFile(res: Resource, content: []const u8) !void {
+    const temp_path = try tempPathFor(res);
     defer res.allocator.free(temp_path);
 
     var temp_file = try std.fs.createFileAbsolute(temp_path, .{ .truncate = true, .exclusive = true });
@@ -272,7 +476,10 @@ fn writeFile(res: Resource, content: []const u8) !void {
     temp_file.close();
 
     try std.fs.renameAbsolute(temp_path, res.path);
+    applyAttributes(res);
+}
 
+fn applyAttributes(res: Resource) void {
     base.applyFileAttributes(res.path, .{
         .mode = res.mode,
         .owner = res.owner,
@@ -306,7 +513,7 @@ pub fn zigAddResource(
 
     _ = mruby.mrb_get_args(mrb, "SAoSSS|oooAA", &path_val, &operations_val, &backup_val, &mode_val, &owner_val, &group_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const path = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, path_val))) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
 
     // Parse operations array: [[op_type, pattern, replacement], ...]
     var ops_list = std.ArrayList(Resource.Operation).initCapacity(allocator, 4) catch std.ArrayList(Resource.Operation).empty;
@@ -320,7 +527,7 @@ pub fn zigAddResource(
             const pattern_val = mruby.mrb_ary_ref(mrb, op_arr, 1);
             const replacement_val = mruby.mrb_ary_ref(mrb, op_arr, 2);
 
-            const op_type_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, op_type_val));
+            const op_type_str = mruby.borrowStr(mrb, op_type_val);
             const op_type: Resource.OpType = if (std.mem.eql(u8, op_type_str, "search_file_replace"))
                 .search_file_replace
             else if (std.mem.eql(u8, op_type_str, "search_file_replace_line"))
@@ -336,8 +543,8 @@ pub fn zigAddResource(
             else
                 continue;
 
-            const pattern = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, pattern_val))) catch continue;
-            const replacement = allocator.dupe(u8, std.mem.span(mruby.mrb_str_to_cstr(mrb, replacement_val))) catch {
+            const pattern = allocator.dupe(u8, mruby.borrowStr(mrb, pattern_val)) catch continue;
+            const replacement = allocator.dupe(u8, mruby.borrowStr(mrb, replacement_val)) catch {
                 allocator.free(pattern);
                 continue;
             };
@@ -354,19 +561,19 @@ pub fn zigAddResource(
 
     const backup = mruby.mrb_test(backup_val);
 
-    const mode_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, mode_val));
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
-    const owner_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, owner_val));
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch null
     else
         null;
 
-    const group_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, group_val));
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch null
     else
@@ -389,3 +596,68 @@ pub fn zigAddResource(
 
     return mruby.mrb_nil_value();
 }
+
+fn testEdit(allocator: std.mem.Allocator, content: []const u8, operations: []const Resource.Operation) !?[]u8 {
+    const stages = try compileOperations(allocator, operations);
+    defer freeStages(allocator, stages);
+    return editContent(allocator, content, stages);
+}
+
+test "single pass matches sequential operation semantics" {
+    const allocator = std.testing.allocator;
+
+    const operations = [_]Resource.Operation{
+        .{ .op_type = .search_file_replace_line, .pattern = "^#?PermitRootLogin", .replacement = "PermitRootLogin no" },
+        .{ .op_type = .insert_line_after_match, .pattern = "^PermitRootLogin", .replacement = "# managed" },
+        .{ .op_type = .search_file_delete_line, .pattern = "^UseDNS", .replacement = "" },
+        .{ .op_type = .search_file_replace, .pattern = "managed", .replacement = "managed by hola" },
+        .{ .op_type = .insert_line_if_no_match, .pattern = "^X11Forwarding", .replacement = "X11Forwarding no" },
+    };
+
+    const edited = (try testEdit(allocator, "Port 22\n#PermitRootLogin yes\nUseDNS yes\n", &operations)).?;
+    defer allocator.free(edited);
+    try std.testing.expectEqualStrings(
+        "Port 22\nPermitRootLogin no\n# managed by hola\nX11Forwarding no\n",
+        edited,
+    );
+}
+
+test "no match anywhere skips the rewrite" {
+    const allocator = std.testing.allocator;
+    const operations = [_]Resource.Operation{
+        .{ .op_type = .search_file_replace, .pattern = "^Foo", .replacement = "Bar" },
+        .{ .op_type = .search_file_delete_line, .pattern = "Baz$", .replacement = "" },
+    };
+    try std.testing.expect((try testEdit(allocator, "Port 22\nNo Foo at line start\n", &operations)) == null);
+}
+
+test "insert_line_if_no_match handles files without trailing newline" {
+    const allocator = std.testing.allocator;
+    const operations = [_]Resource.Operation{
+        .{ .op_type = .insert_line_if_no_match, .pattern = "^b$", .replacement = "b" },
+    };
+
+    const from_empty = (try testEdit(allocator, "", &operations)).?;
+    defer allocator.free(from_empty);
+    try std.testing.expectEqualStrings("b\n", from_empty);
+
+    const no_newline = (try testEdit(allocator, "a", &operations)).?;
+    defer allocator.free(no_newline);
+    try std.testing.expectEqualStrings("a\nb\n", no_newline);
+}
+
+test "large-file sink appends in place when only a last line is added" {
+    const allocator = std.testing.allocator;
+    const operations = [_]Resource.Operation{
+        .{ .op_type = .insert_line_if_no_match, .pattern = "^127\\.0\\.0\\.1 app$", .replacement = "127.0.0.1 app" },
+    };
+    const stages = try compileOperations(allocator, &operations);
+    defer freeStages(allocator, stages);
+
+    var sink = DiffSink{ .allocator = allocator, .original = "::1 localhost", .temp_path = "/nonexistent/unused" };
+    defer sink.deinit();
+
+    try runPipeline(DiffSink, allocator, sink.original, stages, &sink);
+    const outcome = try sink.finish();
+    try std.testing.expectEqualStrings("\n127.0.0.1 app\n", outcome.appended);
+}
@@ -1,4 +1,5 @@
 const std = @import("std");
+const builtin = @import("builtin");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const logger = @import("../logger.zig");
@@ -8,6 +9,7 @@ const AsyncExecutor = @import("../async_executor.zig").AsyncExecutor;
 
 const c = @cImport({
     @cInclude("git2.h");
+    @cInclude("git2/sys/repository.h");
 });
 
 /// Git resource data structure
@@ -27,6 +29,7 @@ pub const Resource = struct {
     user: ?[]const u8, // File owner after clone (e.g., "deploy", "www-data")
     group: ?[]const u8, // File group after clone (e.g., "deploy", "www-data")
     environment: ?[]const u8, // Environment variables ("KEY=VALUE\0KEY2=VALUE2\0")
+    sparse_paths: ?[]const u8, // Directories to check out ("dir\0dir2\0"), null for the full tree
     action: Action,
 
     // Common properties (guards, notifications, etc.)
@@ -50,6 +53,7 @@ pub const Resource = struct {
         if (self.user) |u| allocator.free(u);
         if (self.group) |g| allocator.free(g);
         if (self.environment) |env| allocator.free(env);
+        if (self.sparse_paths) |paths| allocator.free(paths);
 
         // Deinit common props
         var common = self.common;
@@ -121,132 +125,199 @@ pub const Resource = struct {
         return buf[0..input.len :0];
     }
 
-    /// Recursively set ownership for a directory and all its contents
-    fn setDirectoryOwnership(allocator: std.mem.Allocator, dir_path: []const u8, user: ?[]const u8, group: ?[]const u8) !void {
-        // First set ownership on the directory itself
-        try base.setFileOwnerAndGroup(dir_path, user, group);
-
-        // Then recursively set ownership on all contents
-        var dir = try std.fs.openDirAbsolute(dir_path, .{ .iterate = true });
-        defer dir.close();
+    const posix_c = @cImport({
+        @cInclude("fcntl.h");
+        @cInclude("grp.h");
+        @cInclude("pwd.h");
+        @cInclude("stdlib.h");
+        @cInclude("unistd.h");
+    });
 
-        var iter = dir.iterate();
-        while (try iter.next()) |entry| {
-            const full_path = try std.fs.path.join(allocator, &[_][]const u8{ dir_path, entry.name });
-            defer allocator.free(full_path);
+    /// Everything a clone/fetch needs to know about the identity it runs for,
+    /// resolved once per operation and handed to libgit2 through callback
+    /// payloads and per-repository config. The uid and environment switch
+    /// happens only in the helper process of `runIsolated`, so two resources
+    /// for different users can still sync at the same time.
+    const OperationContext = struct {
+        /// Target user's home: `HOME` from the resource environment, else the
+        /// passwd entry of `user`. Null means the process defaults apply.
+        home: ?[]const u8 = null,
+        /// `XDG_CONFIG_HOME` from the resource environment
+        xdg_config_home: ?[]const u8 = null,
+        /// Proxy for this repository's URL, from the resource environment
+        proxy_url: ?[:0]const u8 = null,
+        ssh_key_path: ?[]const u8,
+        enable_strict_host_key_checking: bool,
+        retries: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
 
-            // Set ownership on this entry
-            base.setFileOwnerAndGroup(full_path, user, group) catch |err| {
-                logger.warn("[git] failed to set ownership on {s}: {}", .{ full_path, err });
+        fn init(allocator: std.mem.Allocator, self: Resource) !OperationContext {
+            var ctx = OperationContext{
+                .ssh_key_path = self.ssh_key,
+                .enable_strict_host_key_checking = self.enable_strict_host_key_checking,
             };
+            errdefer ctx.deinit(allocator);
 
-            // If it's a directory, recurse
-            if (entry.kind == .directory) {
-                setDirectoryOwnership(allocator, full_path, user, group) catch |err| {
-                    logger.warn("[git] failed to recursively set ownership in {s}: {}", .{ full_path, err });
-                };
+            var proxies = ProxyEnv{};
+            if (self.environment) |env_str| {
+                var pairs = std.mem.tokenizeScalar(u8, env_str, 0);
+                while (pairs.next()) |pair| {
+                    const eq_pos = std.mem.indexOfScalar(u8, pair, '=') orelse continue;
+                    const key = pair[0..eq_pos];
+                    const value = pair[eq_pos + 1 ..];
+                    if (std.mem.eql(u8, key, "HOME")) {
+                        if (ctx.home) |old| allocator.free(old);
+                        ctx.home = try allocator.dupe(u8, value);
+                    } else if (std.mem.eql(u8, key, "XDG_CONFIG_HOME")) {
+                        if (ctx.xdg_config_home) |old| allocator.free(old);
+                        ctx.xdg_config_home = try allocator.dupe(u8, value);
+                    } else {
+                        // Everything else (SSH_AUTH_SOCK, GIT_SSH_COMMAND, ...)
+                        // is exported in the operation's child process
+                        _ = proxies.set(key, value);
+                    }
+                }
             }
-        }
-    }
-
-    /// State for temporarily switching effective user/group identity.
-    /// Used so that libgit2 operations (clone, fetch, open) run under the
-    /// uid/gid specified by the resource's `user`/`group` attributes.
-    const MAX_NGROUPS = 64;
-
-    const UserSwitch = struct {
-        original_uid: c_uint,
-        original_gid: c_uint,
-        original_ngroups: c_int,
-        original_groups: [MAX_NGROUPS]c_uint,
-        switched: bool,
-    };
-
-    const posix_c = @cImport({
-        @cInclude("unistd.h");
-        @cInclude("pwd.h");
-        @cInclude("grp.h");
-    });
 
-    /// Switch the process effective uid/gid to the target user/group.
-    /// Returns a context that must be passed to `restoreEffectiveUser` to undo the switch.
-    /// If user and group are both null, returns a no-op context.
-    fn switchEffectiveUser(user: ?[]const u8, group: ?[]const u8) !UserSwitch {
-        if (user == null and group == null) {
-            return UserSwitch{ .original_uid = 0, .original_gid = 0, .original_ngroups = 0, .original_groups = undefined, .switched = false };
+            if (ctx.home == null) {
+                if (self.user) |user| ctx.home = try lookupHome(allocator, user);
+            }
+            if (proxies.forUrl(self.repository)) |proxy| ctx.proxy_url = try allocator.dupeZ(u8, proxy);
+            return ctx;
         }
 
-        const original_uid = posix_c.geteuid();
-        const original_gid = posix_c.getegid();
-
-        // Save supplementary groups before initgroups overwrites them
-        var original_groups: [MAX_NGROUPS]c_uint = undefined;
-        const original_ngroups = posix_c.getgroups(MAX_NGROUPS, &original_groups);
+        fn deinit(self: *OperationContext, allocator: std.mem.Allocator) void {
+            if (self.home) |home| allocator.free(home);
+            if (self.xdg_config_home) |xdg| allocator.free(xdg);
+            if (self.proxy_url) |proxy| allocator.free(proxy);
+            self.* = undefined;
+        }
 
-        // Set group first (must be done while still running as root)
-        if (group) |groupname| {
-            const gid = try base.getGroupId(groupname);
-            if (posix_c.setegid(gid) != 0) {
-                logger.err("[git] failed to setegid for group '{s}'", .{groupname});
-                return error.SetGroupFailed;
-            }
-        } else if (user) |username| {
-            // No explicit group — use the user's primary group
-            const username_z = try std.posix.toPosixPath(username);
-            const pwd = posix_c.getpwnam(&username_z);
-            if (pwd != null) {
-                _ = posix_c.setegid(pwd.*.pw_gid);
+        /// Point the callbacks and proxy settings of `opts` at this context
+        fn installFetchOptions(self: *OperationContext, opts: *c.git_fetch_options) void {
+            opts.callbacks.credentials = credentialsCallback;
+            opts.callbacks.certificate_check = certificateCheckCallback;
+            opts.callbacks.payload = self;
+            if (self.proxy_url) |proxy| {
+                opts.proxy_opts.type = c.GIT_PROXY_SPECIFIED;
+                opts.proxy_opts.url = proxy.ptr;
+            } else {
+                // Honors http.proxy from the per-operation config
+                opts.proxy_opts.type = c.GIT_PROXY_AUTO;
             }
         }
+    };
 
-        // Initialize supplementary groups for proper file access
-        if (user) |username| {
-            const username_z = try std.posix.toPosixPath(username);
-            const current_egid = posix_c.getegid();
-            _ = posix_c.initgroups(&username_z, @intCast(current_egid));
+    /// Proxy variables picked out of the resource environment. Only these
+    /// are meaningful to libgit2, which takes them as fetch options.
+    const ProxyEnv = struct {
+        http: ?[]const u8 = null,
+        https: ?[]const u8 = null,
+        all: ?[]const u8 = null,
+        no_proxy: ?[]const u8 = null,
+
+        fn set(self: *ProxyEnv, key: []const u8, value: []const u8) bool {
+            const slot = if (std.ascii.eqlIgnoreCase(key, "http_proxy"))
+                &self.http
+            else if (std.ascii.eqlIgnoreCase(key, "https_proxy"))
+                &self.https
+            else if (std.ascii.eqlIgnoreCase(key, "all_proxy"))
+                &self.all
+            else if (std.ascii.eqlIgnoreCase(key, "no_proxy"))
+                &self.no_proxy
+            else
+                return false;
+            slot.* = value;
+            return true;
         }
 
-        // Switch effective uid last (drops privileges)
-        if (user) |username| {
-            const uid = try base.getUserId(username);
-            if (posix_c.seteuid(uid) != 0) {
-                // Rollback group change
-                _ = posix_c.setegid(original_gid);
-                logger.err("[git] failed to seteuid for user '{s}'", .{username});
-                return error.SetUserFailed;
+        /// Proxy for `url` following curl's rules: scheme-specific variable,
+        /// then all_proxy, unless the host matches a no_proxy entry
+        fn forUrl(self: ProxyEnv, url: []const u8) ?[]const u8 {
+            const uri = std.Uri.parse(url) catch return null;
+            const proxy = if (std.mem.eql(u8, uri.scheme, "https"))
+                self.https orelse self.all
+            else if (std.mem.eql(u8, uri.scheme, "http"))
+                self.http orelse self.all
+            else
+                null;
+            if (proxy == null or proxy.?.len == 0) return null;
+
+            var host_buf: [std.Uri.host_name_max]u8 = undefined;
+            const host = uri.getHost(&host_buf) catch return proxy;
+            var entries = std.mem.tokenizeAny(u8, self.no_proxy orelse "", ", ");
+            while (entries.next()) |entry| {
+                if (std.mem.eql(u8, entry, "*")) return null;
+                const suffix = std.mem.trimStart(u8, entry, ".");
+                if (std.ascii.eqlIgnoreCase(host, suffix)) return null;
+                if (host.len > suffix.len and host[host.len - suffix.len - 1] == '.' and
+                    std.ascii.eqlIgnoreCase(host[host.len - suffix.len ..], suffix)) return null;
             }
-            logger.debug("[git] switched effective user to '{s}' (uid={})", .{ username, uid });
+            return proxy;
         }
+    };
 
-        return UserSwitch{
-            .original_uid = original_uid,
-            .original_gid = original_gid,
-            .original_ngroups = original_ngroups,
-            .original_groups = original_groups,
-            .switched = true,
-        };
+    /// Home directory of `user` from passwd (reentrant lookup, so concurrent
+    /// operations don't share getpwnam's static buffer)
+    fn lookupHome(allocator: std.mem.Allocator, user: []const u8) !?[]const u8 {
+        const username_z = std.posix.toPosixPath(user) catch return null;
+        var pwd: posix_c.struct_passwd = undefined;
+        var result: ?*posix_c.struct_passwd = null;
+        var buf: [4096]u8 = undefined;
+        if (posix_c.getpwnam_r(&username_z, &pwd, &buf, buf.len, &result) != 0 or result == null) {
+            logger.warn("[git] no passwd entry for user '{s}', using default git config", .{user});
+            return null;
+        }
+        const home = pwd.pw_dir orelse return null;
+        return try allocator.dupe(u8, std.mem.span(home));
     }
 
-    /// Restore effective uid/gid to the values saved in the UserSwitch context.
-    fn restoreEffectiveUser(ctx: UserSwitch) void {
-        if (!ctx.switched) return;
-        // Restore uid first — real uid is still root so this always succeeds,
-        // and we need root back before we can restore the group.
-        _ = posix_c.seteuid(ctx.original_uid);
-        _ = posix_c.setegid(ctx.original_gid);
-        // Restore supplementary groups that initgroups may have overwritten
-        if (ctx.original_ngroups >= 0) {
-            _ = posix_c.setgroups(@intCast(ctx.original_ngroups), &ctx.original_groups);
+    /// Give `repo` a config stack built from the operation's home instead of
+    /// the process-wide search path: system, XDG, ~/.gitconfig and the
+    /// repository's own config (which stays the level written to).
+    fn applyRepositoryConfig(repo: *c.git_repository, ctx: *const OperationContext) c_int {
+        const home = ctx.home orelse return 0;
+
+        var cfg: ?*c.git_config = null;
+        var code = c.git_config_new(&cfg);
+        if (code != 0) return code;
+        defer c.git_config_free(cfg);
+
+        var system_buf = std.mem.zeroes(c.git_buf);
+        if (c.git_config_find_system(&system_buf) == 0) {
+            defer c.git_buf_dispose(&system_buf);
+            code = c.git_config_add_file_ondisk(cfg, system_buf.ptr, c.GIT_CONFIG_LEVEL_SYSTEM, repo, 0);
+            if (code != 0) return code;
         }
-        logger.debug("[git] restored effective user (uid={}, gid={})", .{ ctx.original_uid, ctx.original_gid });
+
+        var path_buf: [std.fs.max_path_bytes:0]u8 = undefined;
+        const xdg_path = (if (ctx.xdg_config_home) |xdg|
+            std.fmt.bufPrintZ(&path_buf, "{s}/git/config", .{xdg})
+        else
+            std.fmt.bufPrintZ(&path_buf, "{s}/.config/git/config", .{home})) catch return -1;
+        code = c.git_config_add_file_ondisk(cfg, xdg_path.ptr, c.GIT_CONFIG_LEVEL_XDG, repo, 0);
+        if (code != 0) return code;
+
+        const global_path = std.fmt.bufPrintZ(&path_buf, "{s}/.gitconfig", .{home}) catch return -1;
+        code = c.git_config_add_file_ondisk(cfg, global_path.ptr, c.GIT_CONFIG_LEVEL_GLOBAL, repo, 0);
+        if (code != 0) return code;
+
+        // git_repository_path is the git dir, with a trailing slash
+        const local_path = std.fmt.bufPrintZ(&path_buf, "{s}config", .{std.mem.span(c.git_repository_path(repo))}) catch return -1;
+        code = c.git_config_add_file_ondisk(cfg, local_path.ptr, c.GIT_CONFIG_LEVEL_LOCAL, repo, 0);
+        if (code != 0) return code;
+
+        // The repository takes its own reference
+        return c.git_repository_set_config(repo, cfg);
     }
 
-    /// Context for custom credentials and certificate callbacks
-    const SshContext = struct {
-        ssh_key_path: ?[]const u8,
-        enable_strict_host_key_checking: bool,
-        retries: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
-    };
+    /// git_clone repository_cb: create the repository, then swap in the
+    /// operation's config before clone writes the remote and fetches
+    fn createRepositoryCallback(out: [*c]?*c.git_repository, path: [*c]const u8, bare: c_int, payload: ?*anyopaque) callconv(.c) c_int {
+        const code = c.git_repository_init(out, path, @intCast(bare));
+        if (code != 0) return code;
+        const ctx: *const OperationContext = @ptrCast(@alignCast(payload orelse return 0));
+        return applyRepositoryConfig(out.*.?, ctx);
+    }
 
     /// Custom credentials callback that supports SSH key files
     fn credentialsCallback(
@@ -259,7 +330,7 @@ pub const Resource = struct {
         const url_str = std.mem.span(url);
 
         // Get context if provided
-        const ctx: ?*SshContext = if (payload) |p| @ptrCast(@alignCast(p)) else null;
+        const ctx: ?*OperationContext = if (payload) |p| @ptrCast(@alignCast(p)) else null;
 
         // Limit retries to avoid infinite loops
         if (ctx) |c_ctx| {
@@ -299,7 +370,8 @@ pub const Resource = struct {
             }
 
             // Priority 3: Fall back to default SSH key files (automatic discovery)
-            const home = std.posix.getenv("HOME") orelse "/tmp";
+            // in the operation's home, so each user gets their own keys
+            const home = (if (ctx) |c_ctx| c_ctx.home else null) orelse std.posix.getenv("HOME") orelse "/tmp";
             const key_names = [_][]const u8{ "id_ed25519", "id_rsa", "id_ecdsa", "id_dsa" };
 
             for (key_names) |key_name| {
@@ -346,7 +418,7 @@ pub const Resource = struct {
         _ = host;
 
         // Get context if provided
-        const ctx: ?*SshContext = if (payload) |p| @ptrCast(@alignCast(p)) else null;
+        const ctx: ?*OperationContext = if (payload) |p| @ptrCast(@alignCast(p)) else null;
 
         // If strict host key checking is disabled, accept all certificates
         if (ctx) |c_ctx| {
@@ -381,6 +453,23 @@ pub const Resource = struct {
         return repo;
     }
 
+    /// Open the repository at `path` with the operation's config in place
+    fn openRepositoryFor(allocator: std.mem.Allocator, path: []const u8, op: *const OperationContext) !?*c.git_repository {
+        const repo = (try openRepository(allocator, path)) orelse return null;
+        const code = applyRepositoryConfig(repo, op);
+        if (code != 0) {
+            const err = c.git_error_last();
+            if (err != null) {
+                logger.err("[git] failed to load config for {s}: {s}", .{ path, std.mem.span(err.*.message) });
+            } else {
+                logger.err("[git] failed to load config for {s} (error code: {})", .{ path, code });
+            }
+            c.git_repository_free(repo);
+            return error.ConfigLoadFailed;
+        }
+        return repo;
+    }
+
     fn getCurrentRevision(allocator: std.mem.Allocator, repo: *c.git_repository) ![]const u8 {
         var head_ref: ?*c.git_reference = null;
         const code = c.git_repository_head(&head_ref, repo);
@@ -465,25 +554,10 @@ pub const Resource = struct {
         detail.set(std.fmt.bufPrint(&buf, "{s} of {s} failed: {s}", .{ operation, safe_repo, safe_msg }) catch safe_msg);
     }
 
-    const CloneContext = struct {
-        resource: Resource,
-        allocator: std.mem.Allocator,
-        error_detail: *GitErrorDetail,
-    };
-
-    /// Async wrapper for clone operation (runs in background thread)
-    fn cloneRepositoryAsync(ctx: CloneContext) !void {
-        return cloneRepositoryImpl(ctx.resource, ctx.allocator, ctx.error_detail);
-    }
-
-    /// Actual clone implementation
-    fn cloneRepositoryImpl(self: Resource, allocator: std.mem.Allocator, error_detail: *GitErrorDetail) !void {
+    /// Clone `repository` into `destination`
+    fn cloneRepository(self: Resource, allocator: std.mem.Allocator, op: *OperationContext, error_detail: *GitErrorDetail) !void {
         errdefer captureGitError(error_detail, "clone", self.repository);
 
-        // Initialize libgit2 in this thread
-        var git = try git_client.Client.init();
-        defer git.deinit();
-
         const url_c = try dupZ(allocator, self.repository);
         defer allocator.free(url_c);
 
@@ -499,31 +573,25 @@ pub const Resource = struct {
             clone_opts.checkout_opts.checkout_strategy = c.GIT_CHECKOUT_NONE;
         }
 
+        // Limit the initial checkout to the sparse directories
+        const sparse_spec = if (self.sparse_paths) |paths| try sparsePathspec(allocator, paths) else null;
+        defer if (sparse_spec) |spec| allocator.free(spec);
+        if (sparse_spec) |spec| setCheckoutPaths(&clone_opts.checkout_opts, spec);
+
         // Note: We don't set checkout_branch here because it causes issues
         // with remote refs not being set up yet. Instead, we let libgit2
         // checkout the default branch, and we'll switch branches after clone if needed.
 
-        // Setup credentials and certificate callbacks
-        var ssh_ctx = SshContext{
-            .ssh_key_path = self.ssh_key,
-            .enable_strict_host_key_checking = self.enable_strict_host_key_checking,
-        };
-        clone_opts.fetch_opts.callbacks.credentials = credentialsCallback;
-        clone_opts.fetch_opts.callbacks.certificate_check = certificateCheckCallback;
-        clone_opts.fetch_opts.callbacks.payload = &ssh_ctx;
-
-        // Switch effective user so libgit2 creates files with correct ownership
-        // and passes safe.directory / SSH key permission checks
-        const user_ctx = try switchEffectiveUser(self.user, self.group);
-        errdefer restoreEffectiveUser(user_ctx);
+        // Credentials, proxy and the repository's config all come from the
+        // operation context rather than the process environment
+        op.installFetchOptions(&clone_opts.fetch_opts);
+        clone_opts.repository_cb = createRepositoryCallback;
+        clone_opts.repository_cb_payload = op;
 
         // Perform clone
         var repo_ptr: ?*c.git_repository = null;
         const code = c.git_clone(&repo_ptr, url_c.ptr, dest_c.ptr, &clone_opts);
 
-        // Restore root before ownership fixup (chown requires root)
-        restoreEffectiveUser(user_ctx);
-
         if (code != 0) {
             var repo_buf: [512]u8 = undefined;
             const safe_repo = http.maskUrlPassword(self.repository, &repo_buf);
@@ -539,53 +607,16 @@ pub const Resource = struct {
 
         if (repo_ptr) |repo| {
             defer c.git_repository_free(repo);
-        }
-
-        // Set file ownership if user or group is specified
-        if (self.user != null or self.group != null) {
-            try setDirectoryOwnership(allocator, self.destination, self.user, self.group);
+            // A path-limited checkout only indexes what it wrote; index the
+            // rest of HEAD too so the skipped directories read as unchanged
+            if (sparse_spec != null and self.enable_checkout) try resetIndexToHead(repo);
         }
     }
 
-    /// Clone repository with async execution (doesn't block spinner)
-    fn cloneRepository(self: Resource, allocator: std.mem.Allocator) !void {
-        var error_detail = GitErrorDetail{};
-        const ctx = CloneContext{
-            .resource = self,
-            .allocator = allocator,
-            .error_detail = &error_detail,
-        };
-        AsyncExecutor.executeWithContext(CloneContext, void, ctx, cloneRepositoryAsync) catch |err| {
-            if (error_detail.get()) |msg| base.recordProvisionErrorDetailSlice(msg);
-            return err;
-        };
-    }
-
-    /// Context for async fetch and update operation
-    const FetchContext = struct {
-        resource: Resource,
-        allocator: std.mem.Allocator,
-        repo: *c.git_repository,
-        error_detail: *GitErrorDetail,
-    };
-
-    /// Async wrapper for fetch operation (runs in background thread)
-    fn fetchAndUpdateAsync(ctx: FetchContext) !bool {
-        return fetchAndUpdateImpl(ctx.resource, ctx.allocator, ctx.repo, ctx.error_detail);
-    }
-
-    /// Actual fetch and update implementation
-    fn fetchAndUpdateImpl(self: Resource, allocator: std.mem.Allocator, repo: *c.git_repository, error_detail: *GitErrorDetail) !bool {
+    /// Fetch `remote` and reset to `revision`; true when files changed
+    fn fetchAndUpdate(self: Resource, allocator: std.mem.Allocator, repo: *c.git_repository, op: *OperationContext, error_detail: *GitErrorDetail) !bool {
         errdefer captureGitError(error_detail, "fetch", self.repository);
 
-        // Initialize libgit2 in this thread
-        var git = try git_client.Client.init();
-        defer git.deinit();
-
-        // Switch effective user for fetch/reset operations
-        const user_ctx = try switchEffectiveUser(self.user, self.group);
-        defer restoreEffectiveUser(user_ctx);
-
         // Fetch from remote
         const remote_c = try dupZ(allocator, self.remote);
         defer allocator.free(remote_c);
@@ -633,14 +664,8 @@ pub const Resource = struct {
             return error.FetchOptionsInitFailed;
         }
 
-        // Setup credentials and certificate callbacks for fetch
-        var ssh_ctx = SshContext{
-            .ssh_key_path = self.ssh_key,
-            .enable_strict_host_key_checking = self.enable_strict_host_key_checking,
-        };
-        fetch_opts.callbacks.credentials = credentialsCallback;
-        fetch_opts.callbacks.certificate_check = certificateCheckCallback;
-        fetch_opts.callbacks.payload = &ssh_ctx;
+        // Setup credentials, certificate callbacks and proxy for fetch
+        op.installFetchOptions(&fetch_opts);
 
         code = c.git_remote_fetch(remote, null, &fetch_opts, null);
         if (code != 0) {
@@ -690,7 +715,16 @@ pub const Resource = struct {
             }
             defer if (target_obj) |o| c.git_object_free(o);
 
-            code = c.git_reset(repo, target_obj, c.GIT_RESET_HARD, null);
+            // With sparse_paths, only changed files inside them are written
+            var checkout_opts: c.git_checkout_options = undefined;
+            code = c.git_checkout_options_init(&checkout_opts, c.GIT_CHECKOUT_OPTIONS_VERSION);
+            if (code != 0) return error.CheckoutOptionsInitFailed;
+            checkout_opts.checkout_strategy = c.GIT_CHECKOUT_FORCE;
+            const sparse_spec = if (self.sparse_paths) |paths| try sparsePathspec(allocator, paths) else null;
+            defer if (sparse_spec) |spec| allocator.free(spec);
+            if (sparse_spec) |spec| setCheckoutPaths(&checkout_opts, spec);
+
+            code = c.git_reset(repo, target_obj, c.GIT_RESET_HARD, &checkout_opts);
             if (code != 0) {
                 return error.ResetFailed;
             }
@@ -698,149 +732,399 @@ pub const Resource = struct {
             return true; // was_updated
         }
 
+        // Same revision, but the sparse set may have grown since the last run
+        if (self.sparse_paths) |paths| {
+            if (self.enable_checkout) return refreshSparseCheckout(allocator, repo, paths);
+        }
+
         return false; // not updated
     }
 
-    /// Apply environment variables from "KEY=VALUE\0..." format string using setenv().
-    /// Returns saved original values for restoration.
-    fn applyEnvironment(allocator: std.mem.Allocator, env_str: []const u8) !std.ArrayList(EnvSaved) {
-        var saved = std.ArrayList(EnvSaved).empty;
-        errdefer restoreEnvironment(allocator, &saved);
+    /// Pathspecs for `sparse_paths`, pointing into it: every entry there is
+    /// NUL-terminated, so no copies are needed. Caller frees the slice.
+    fn sparsePathspec(allocator: std.mem.Allocator, sparse_paths: []const u8) ![][*c]u8 {
+        var spec = std.ArrayList([*c]u8).empty;
+        errdefer spec.deinit(allocator);
         var pos: usize = 0;
-        while (pos < env_str.len) {
+        while (pos < sparse_paths.len) {
             const start = pos;
-            while (pos < env_str.len and env_str[pos] != 0) : (pos += 1) {}
-            const pair = env_str[start..pos];
-            if (pair.len > 0) {
-                if (std.mem.indexOfScalar(u8, pair, '=')) |eq_pos| {
-                    const key = pair[0..eq_pos];
-                    const value = pair[eq_pos + 1 ..];
-                    // Save original value
-                    const key_z = try allocator.dupeZ(u8, key);
-                    const orig = std.posix.getenv(key);
-                    const orig_dup: ?[]const u8 = if (orig) |o| try allocator.dupe(u8, o) else null;
-                    try saved.append(allocator, .{ .key = key_z, .original = orig_dup });
-                    // Set new value
-                    const value_z = try allocator.dupeZ(u8, value);
-                    defer allocator.free(value_z);
-                    _ = setenv(key_z.ptr, value_z.ptr, 1);
-                }
-            }
+            while (pos < sparse_paths.len and sparse_paths[pos] != 0) : (pos += 1) {}
+            if (pos > start) try spec.append(allocator, @constCast(sparse_paths[start..].ptr));
             pos += 1;
         }
-        return saved;
+        return spec.toOwnedSlice(allocator);
     }
 
-    const EnvSaved = struct {
-        key: [:0]u8,
-        original: ?[]const u8,
-    };
+    fn setCheckoutPaths(opts: *c.git_checkout_options, spec: [][*c]u8) void {
+        opts.paths = .{ .strings = spec.ptr, .count = spec.len };
+    }
 
-    fn restoreEnvironment(allocator: std.mem.Allocator, saved: *std.ArrayList(EnvSaved)) void {
-        for (saved.items) |entry| {
-            if (entry.original) |orig| {
-                const orig_z = allocator.dupeZ(u8, orig) catch continue;
-                defer allocator.free(orig_z);
-                _ = setenv(entry.key.ptr, orig_z.ptr, 1);
-                allocator.free(orig);
-            } else {
-                _ = unsetenv(entry.key.ptr);
-            }
-            allocator.free(entry.key);
-        }
-        saved.deinit(allocator);
+    /// Replace the index with HEAD's full tree. Entries that already match
+    /// keep their stat data, so later checkouts don't rehash them.
+    fn resetIndexToHead(repo: *c.git_repository) !void {
+        var tree: ?*c.git_object = null;
+        if (c.git_revparse_single(&tree, repo, "HEAD^{tree}") != 0) return error.RevParseFailed;
+        defer c.git_object_free(tree);
+
+        var index: ?*c.git_index = null;
+        if (c.git_repository_index(&index, repo) != 0) return error.IndexOpenFailed;
+        defer c.git_index_free(index);
+
+        if (c.git_index_read_tree(index, @ptrCast(tree)) != 0) return error.IndexUpdateFailed;
+        if (c.git_index_write(index) != 0) return error.IndexUpdateFailed;
     }
 
-    extern fn setenv(name: [*:0]const u8, value: [*:0]const u8, overwrite: c_int) c_int;
-    extern fn unsetenv(name: [*:0]const u8) c_int;
+    /// Check out HEAD within `sparse_paths`, creating files for directories
+    /// added to the set since the last run. Returns whether anything was
+    /// written; when the set is unchanged this is a stat pass over it.
+    fn refreshSparseCheckout(allocator: std.mem.Allocator, repo: *c.git_repository, sparse_paths: []const u8) !bool {
+        const spec = try sparsePathspec(allocator, sparse_paths);
+        defer allocator.free(spec);
 
-    const SAVED_HOME_BUF_SIZE = 4096; // PATH_MAX on Linux; covers all POSIX platforms
-    threadlocal var saved_home_buf: [SAVED_HOME_BUF_SIZE]u8 = undefined;
+        var opts: c.git_checkout_options = undefined;
+        if (c.git_checkout_options_init(&opts, c.GIT_CHECKOUT_OPTIONS_VERSION) != 0) return error.CheckoutOptionsInitFailed;
+        opts.checkout_strategy = c.GIT_CHECKOUT_SAFE | c.GIT_CHECKOUT_RECREATE_MISSING;
+        setCheckoutPaths(&opts, spec);
 
-    const HomedirState = struct {
-        changed: bool = false,
-        has_original_home: bool = false,
-    };
+        var actions: usize = 0;
+        opts.progress_cb = checkoutProgressCallback;
+        opts.progress_payload = &actions;
+
+        if (c.git_checkout_head(repo, &opts) != 0) return error.CheckoutFailed;
+        return actions > 0;
+    }
 
-    /// Set home directory for the target user (from passwd).
-    /// Updates libgit2 search paths and HOME env var so that gitconfig
-    /// loading and SSH key discovery work when running as root with seteuid.
-    fn setHomedirForUser(user: []const u8) !HomedirState {
-        var state = HomedirState{};
-
-        const username_z = std.posix.toPosixPath(user) catch return state;
-        const pwd = posix_c.getpwnam(&username_z);
-        if (pwd == null) return state;
-        const home = pwd.*.pw_dir orelse return state;
-
-        // Copy original HOME to stable buffer before setenv may invalidate getenv pointer
-        const original_c = getenv("HOME");
-        if (original_c) |orig| {
-            const span = std.mem.span(orig);
-            if (span.len >= SAVED_HOME_BUF_SIZE) {
-                logger.err("[git] original HOME too long ({d} bytes), cannot safely switch homedir", .{span.len});
-                return error.HomePathTooLong;
+    /// Records the number of files the checkout plans to write
+    fn checkoutProgressCallback(path: [*c]const u8, completed_steps: usize, total_steps: usize, payload: ?*anyopaque) callconv(.c) void {
+        _ = path;
+        _ = completed_steps;
+        const actions: *usize = @ptrCast(@alignCast(payload orelse return));
+        actions.* = total_steps;
+    }
+
+    /// Who a clone or fetch runs as. Resolved here and handed to the helper
+    /// process, which only has to assume it.
+    const Identity = struct {
+        uid: ?posix_c.uid_t = null,
+        gid: ?posix_c.gid_t = null,
+        groups: [max_groups]posix_c.gid_t = undefined,
+        ngroups: usize = 0,
+
+        const max_groups = 64;
+
+        fn resolve(self: Resource) !Identity {
+            var id = Identity{};
+            if (self.user) |user| {
+                const user_z = try std.posix.toPosixPath(user);
+                const pwd = posix_c.getpwnam(&user_z);
+                if (pwd == null) {
+                    logger.err("[git] user '{s}' not found", .{user});
+                    return error.UserNotFound;
+                }
+                id.uid = pwd.*.pw_uid;
+                id.gid = pwd.*.pw_gid;
             }
-            @memcpy(saved_home_buf[0..span.len], span);
-            saved_home_buf[span.len] = 0;
-            state.has_original_home = true;
+            if (self.group) |group| id.gid = @intCast(try base.getGroupId(group));
+
+            const gid = id.gid orelse return id;
+            id.groups[0] = gid;
+            id.ngroups = 1;
+            if (self.user) |user| {
+                const user_z = try std.posix.toPosixPath(user);
+                var count: c_int = max_groups;
+                if (posix_c.getgrouplist(&user_z, @bitCast(gid), @ptrCast(&id.groups), &count) < 0) {
+                    logger.warn("[git] user '{s}' is in more than {d} groups; using only gid {d}", .{ user, max_groups, gid });
+                    id.groups[0] = gid;
+                    count = 1;
+                }
+                id.ngroups = @intCast(count);
+            }
+            return id;
         }
 
-        // Set libgit2 internal search paths
-        _ = c.git_libgit2_opts(c.GIT_OPT_SET_HOMEDIR, home);
-        _ = c.git_libgit2_opts(c.GIT_OPT_SET_SEARCH_PATH, c.GIT_CONFIG_LEVEL_GLOBAL, home);
-
-        // Set HOME env var for SSH key discovery in credential callback
-        _ = setenv("HOME", home, 1);
+        /// Take on this identity for the rest of the process: groups while
+        /// still root, then the uid, which can't be undone
+        fn assume(self: *const Identity) !void {
+            if (self.gid) |gid| {
+                if (posix_c.setgroups(@intCast(self.ngroups), &self.groups) != 0) return error.SetGroupFailed;
+                if (posix_c.setgid(gid) != 0) return error.SetGroupFailed;
+            }
+            if (self.uid) |uid| {
+                if (posix_c.setuid(uid) != 0) return error.SetUserFailed;
+            }
+        }
+    };
 
-        state.changed = true;
-        logger.debug("[git] set homedir to '{s}' for user '{s}'", .{ std.mem.span(home), user });
-        return state;
+    /// Whether the operation needs a process of its own: a user or group to
+    /// run as, or environment variables to export
+    fn runsIsolated(self: Resource) bool {
+        if (self.user != null or self.group != null) return true;
+        const env = self.environment orelse return false;
+        return env.len > 0;
     }
 
-    fn restoreHomedir(state: *const HomedirState) void {
-        if (!state.changed) return;
+    /// The operations `runOperation` can run, named so a helper process can
+    /// be told which one to do
+    const Work = enum {
+        sync,
+        clone,
 
-        if (state.has_original_home) {
-            const ptr: [*:0]const u8 = @ptrCast(&saved_home_buf);
-            _ = setenv("HOME", ptr, 1);
-            _ = c.git_libgit2_opts(c.GIT_OPT_SET_HOMEDIR, ptr);
-            _ = c.git_libgit2_opts(c.GIT_OPT_SET_SEARCH_PATH, c.GIT_CONFIG_LEVEL_GLOBAL, ptr);
-        } else {
-            _ = unsetenv("HOME");
-            const null_ptr: ?[*:0]const u8 = null;
-            _ = c.git_libgit2_opts(c.GIT_OPT_SET_HOMEDIR, null_ptr);
-            _ = c.git_libgit2_opts(c.GIT_OPT_SET_SEARCH_PATH, c.GIT_CONFIG_LEVEL_GLOBAL, null_ptr);
+        fn run(work: Work, self: Resource, allocator: std.mem.Allocator, op: *OperationContext, error_detail: *GitErrorDetail) !bool {
+            return switch (work) {
+                .sync => syncWork(self, allocator, op, error_detail),
+                .clone => cloneWork(self, allocator, op, error_detail),
+            };
         }
-    }
+    };
 
-    extern fn getenv(name: [*:0]const u8) ?[*:0]const u8;
+    const OperationRun = struct {
+        resource: Resource,
+        allocator: std.mem.Allocator,
+        op: *OperationContext,
+        work: Work,
+        identity: ?*const Identity,
+        error_detail: *GitErrorDetail,
+    };
 
-    fn applySync(self: Resource) !bool {
-        // Initialize libgit2
+    /// Run `work` on a worker thread so the spinner keeps going. With a
+    /// user, group or environment it runs in a helper process instead.
+    fn runOperation(self: Resource, work: Work) !bool {
         var git = try git_client.Client.init();
         defer git.deinit();
 
-        // Disable owner validation — hola manages user context via seteuid,
-        // and libgit2's check can fail under root-with-seteuid scenarios.
-        _ = c.git_libgit2_opts(c.GIT_OPT_SET_OWNER_VALIDATION, @as(c_int, 0));
-
         var gpa = std.heap.GeneralPurposeAllocator(.{}){};
         defer _ = gpa.deinit();
         const allocator = gpa.allocator();
 
-        // Set home directory for the target user so that gitconfig loading
-        // and SSH key discovery work when running as root with seteuid.
-        var homedir_state = if (self.user) |user| try setHomedirForUser(user) else HomedirState{};
-        defer restoreHomedir(&homedir_state);
+        // The target user's home, config and proxy
+        var op = try OperationContext.init(allocator, self);
+        defer op.deinit(allocator);
+
+        const identity = if (self.runsIsolated()) try Identity.resolve(self) else null;
+
+        var error_detail = GitErrorDetail{};
+        const operation = OperationRun{
+            .resource = self,
+            .allocator = allocator,
+            .op = &op,
+            .work = work,
+            .identity = if (identity) |*id| id else null,
+            .error_detail = &error_detail,
+        };
+        const Runner = struct {
+            fn run(ctx: OperationRun) !bool {
+                if (ctx.identity) |id| return runIsolated(ctx, id);
+                return ctx.work.run(ctx.resource, ctx.allocator, ctx.op, ctx.error_detail);
+            }
+        };
+        return AsyncExecutor.executeWithContext(OperationRun, bool, operation, Runner.run) catch |err| {
+            if (error_detail.get()) |msg| base.recordProvisionErrorDetailSlice(msg);
+            return err;
+        };
+    }
+
+    /// What the helper reports back on its stdout. The helper is this same
+    /// binary, so error values keep their meaning.
+    const ChildOutcome = struct {
+        error_code: std.meta.Int(.unsigned, @bitSizeOf(anyerror)) = 0,
+        updated: bool = false,
+        detail: GitErrorDetail = .{},
+    };
+
+    /// An isolated operation as handed to the helper on its stdin: the
+    /// resource fields the work reads and the identity resolved for it
+    const HelperRequest = struct {
+        work: Work,
+        repository: []const u8,
+        destination: []const u8,
+        revision: []const u8,
+        checkout_branch: ?[]const u8,
+        remote: []const u8,
+        enable_checkout: bool,
+        enable_submodules: bool,
+        ssh_key: ?[]const u8,
+        enable_strict_host_key_checking: bool,
+        user: ?[]const u8,
+        group: ?[]const u8,
+        environment: ?[]const u8,
+        sparse_paths: ?[]const u8,
+        uid: ?posix_c.uid_t,
+        gid: ?posix_c.gid_t,
+        groups: []const posix_c.gid_t,
+
+        fn init(self: Resource, work: Work, identity: *const Identity) HelperRequest {
+            return .{
+                .work = work,
+                .repository = self.repository,
+                .destination = self.destination,
+                .revision = self.revision,
+                .checkout_branch = self.checkout_branch,
+                .remote = self.remote,
+                .enable_checkout = self.enable_checkout,
+                .enable_submodules = self.enable_submodules,
+                .ssh_key = self.ssh_key,
+                .enable_strict_host_key_checking = self.enable_strict_host_key_checking,
+                .user = self.user,
+                .group = self.group,
+                .environment = self.environment,
+                .sparse_paths = self.sparse_paths,
+                .uid = identity.uid,
+                .gid = identity.gid,
+                .groups = identity.groups[0..identity.ngroups],
+            };
+        }
+
+        fn resource(self: HelperRequest, common: base.CommonProps) Resource {
+            return .{
+                .repository = self.repository,
+                .destination = self.destination,
+                .revision = self.revision,
+                .checkout_branch = self.checkout_branch,
+                .remote = self.remote,
+                .depth = null,
+                .enable_checkout = self.enable_checkout,
+                .enable_submodules = self.enable_submodules,
+                .ssh_key = self.ssh_key,
+                .ssh_wrapper = null,
+                .enable_strict_host_key_checking = self.enable_strict_host_key_checking,
+                .user = self.user,
+                .group = self.group,
+                .environment = self.environment,
+                .sparse_paths = self.sparse_paths,
+                .action = if (self.work == .sync) .sync else .checkout,
+                .common = common,
+            };
+        }
 
-        // Apply environment variables if specified
-        var env_saved = if (self.environment) |env|
-            try applyEnvironment(allocator, env)
+        fn identity(self: HelperRequest) !Identity {
+            if (self.groups.len > Identity.max_groups) return error.TooManyGroups;
+            var id = Identity{ .uid = self.uid, .gid = self.gid, .ngroups = self.groups.len };
+            @memcpy(id.groups[0..self.groups.len], self.groups);
+            return id;
+        }
+    };
+
+    /// Run `work` in `hola __git-helper`, a fresh exec of this binary, as
+    /// `identity` with the resource environment exported. Files are written
+    /// by their owner, so nothing is chowned afterwards and libgit2's owner
+    /// check stays on; the environment (SSH_AUTH_SOCK, GIT_SSH_COMMAND, ...)
+    /// reaches libgit2 and its SSH transport without touching this process.
+    /// Forking this multithreaded process and running libgit2 in the child
+    /// without an exec could deadlock on a lock another thread held.
+    fn runIsolated(ctx: OperationRun, identity: *const Identity) !bool {
+        const request = HelperRequest.init(ctx.resource, ctx.work, identity);
+        const payload = try std.fmt.allocPrint(ctx.allocator, "{f}", .{std.json.fmt(request, .{})});
+        defer ctx.allocator.free(payload);
+
+        // /proc/self/exe still names this binary if it was replaced on disk
+        const exe = if (builtin.os.tag == .linux)
+            try ctx.allocator.dupe(u8, "/proc/self/exe")
         else
-            std.ArrayList(EnvSaved).empty;
-        defer restoreEnvironment(allocator, &env_saved);
+            try std.fs.selfExePathAlloc(ctx.allocator);
+        defer ctx.allocator.free(exe);
+
+        var child = std.process.Child.init(&.{ exe, helper_command }, ctx.allocator);
+        child.stdin_behavior = .Pipe;
+        child.stdout_behavior = .Pipe;
+        child.stderr_behavior = .Inherit;
+        base.noteSubprocess();
+        try child.spawn();
+
+        // A helper that died early shows up as a missing outcome below
+        child.stdin.?.writeAll(payload) catch {};
+        child.stdin.?.close();
+        child.stdin = null;
+
+        var outcome = ChildOutcome{};
+        const len = child.stdout.?.readAll(std.mem.asBytes(&outcome)) catch 0;
+        const term = try child.wait();
+        const exited_cleanly = switch (term) {
+            .Exited => |code| code == 0,
+            else => false,
+        };
+        if (len != @sizeOf(ChildOutcome) or !exited_cleanly) {
+            logger.err("[git] operation for {s} ended without a result ({any})", .{ ctx.resource.destination, term });
+            return error.GitOperationFailed;
+        }
+        if (outcome.error_code != 0) {
+            ctx.error_detail.* = outcome.detail;
+            return @errorFromInt(outcome.error_code);
+        }
+        return outcome.updated;
+    }
+
+    /// Body of the helper: become the owner, export the environment, then
+    /// do the work as an ordinary process of that user
+    fn runHelperRequest(allocator: std.mem.Allocator, request: HelperRequest, error_detail: *GitErrorDetail) !bool {
+        var git = try git_client.Client.init();
+        defer git.deinit();
+
+        var common = base.CommonProps.init(allocator);
+        defer common.deinit(allocator);
+        const self = request.resource(common);
+
+        var op = try OperationContext.init(allocator, self);
+        defer op.deinit(allocator);
+
+        const identity = try request.identity();
+        try identity.assume();
+
+        if (self.environment) |env_str| {
+            var pairs = std.mem.tokenizeScalar(u8, env_str, 0);
+            while (pairs.next()) |pair| {
+                const eq_pos = std.mem.indexOfScalar(u8, pair, '=') orelse continue;
+                try exportVariable(allocator, pair[0..eq_pos], pair[eq_pos + 1 ..]);
+            }
+        }
+        if (op.home) |home| try exportVariable(allocator, "HOME", home);
+
+        return request.work.run(self, allocator, &op, error_detail);
+    }
+
+    fn exportVariable(allocator: std.mem.Allocator, key: []const u8, value: []const u8) !void {
+        const key_z = try allocator.dupeZ(u8, key);
+        defer allocator.free(key_z);
+        const value_z = try allocator.dupeZ(u8, value);
+        defer allocator.free(value_z);
+        if (posix_c.setenv(key_z.ptr, value_z.ptr, 1) != 0) return error.SetEnvFailed;
+    }
+
+    /// An unprivileged clone can't create its destination under a
+    /// root-owned parent. Create it here and hand just that directory to the
+    /// owner, with fchownat not following symlinks, so a link planted at the
+    /// destination can't redirect the chown. A non-empty directory is left
+    /// alone for git_clone to reject.
+    fn prepareDestination(self: Resource) !void {
+        if (self.user == null and self.group == null) return;
+
+        if (std.fs.path.dirname(self.destination)) |parent| try std.fs.cwd().makePath(parent);
+        std.posix.mkdir(self.destination, 0o755) catch |err| switch (err) {
+            error.PathAlreadyExists => {
+                var dir = std.fs.cwd().openDir(self.destination, .{ .iterate = true, .no_follow = true }) catch return;
+                defer dir.close();
+                var iter = dir.iterate();
+                if ((try iter.next()) != null) return;
+            },
+            else => return err,
+        };
 
+        const unchanged = std.math.maxInt(posix_c.uid_t);
+        const uid: posix_c.uid_t = if (self.user) |u| @intCast(try base.getUserId(u)) else unchanged;
+        const gid: posix_c.gid_t = if (self.group) |g| @intCast(try base.getGroupId(g)) else unchanged;
+        const dest_z = try std.posix.toPosixPath(self.destination);
+        if (posix_c.fchownat(posix_c.AT_FDCWD, &dest_z, uid, gid, posix_c.AT_SYMLINK_NOFOLLOW) != 0) {
+            logger.err("[git] failed to hand {s} to its owner", .{self.destination});
+            return error.ChownFailed;
+        }
+    }
+
+    fn applySync(self: Resource) !bool {
+        if (!isGitRepo(self.destination)) try self.prepareDestination();
+        return self.runOperation(.sync);
+    }
+
+    /// Clone, or fetch and update, then update submodules if anything moved
+    fn syncWork(self: Resource, allocator: std.mem.Allocator, op: *OperationContext, error_detail: *GitErrorDetail) !bool {
         // Check if destination exists and is a git repo
         const dest_exists = blk: {
             std.fs.accessAbsolute(self.destination, .{}) catch |err| switch (err) {
@@ -853,66 +1137,30 @@ pub const Resource = struct {
         var was_updated = false;
 
         if (!dest_exists or !isGitRepo(self.destination)) {
-            // Clone the repository with custom credentials (async)
-            // (cloneRepositoryImpl handles user switching internally)
-            try self.cloneRepository(allocator);
+            try self.cloneRepository(allocator, op, error_detail);
             was_updated = true;
         } else {
-            // Switch effective user for git_repository_open (safe.directory check)
-            const open_ctx = try switchEffectiveUser(self.user, self.group);
-            const repo = openRepository(allocator, self.destination) catch |err| {
-                restoreEffectiveUser(open_ctx);
-                return err;
-            };
-            restoreEffectiveUser(open_ctx);
-
-            const repo_nonnull = repo orelse return error.OpenRepoFailed;
-            defer c.git_repository_free(repo_nonnull);
-
-            var fetch_error_detail = GitErrorDetail{};
-            const fetch_ctx = FetchContext{
-                .resource = self,
-                .allocator = allocator,
-                .repo = repo_nonnull,
-                .error_detail = &fetch_error_detail,
-            };
-            was_updated = AsyncExecutor.executeWithContext(FetchContext, bool, fetch_ctx, fetchAndUpdateAsync) catch |err| {
-                if (fetch_error_detail.get()) |msg| base.recordProvisionErrorDetailSlice(msg);
-                return err;
-            };
+            const repo = (try openRepositoryFor(allocator, self.destination, op)) orelse return error.OpenRepoFailed;
+            defer c.git_repository_free(repo);
+            was_updated = try self.fetchAndUpdate(allocator, repo, op, error_detail);
         }
 
         // Update submodules if enabled
         if (self.enable_submodules and was_updated) {
-            const sub_ctx = try switchEffectiveUser(self.user, self.group);
-            const sub_repo_opt = openRepository(allocator, self.destination) catch |err| {
-                restoreEffectiveUser(sub_ctx);
-                return err;
-            };
-            const sub_repo = sub_repo_opt orelse {
-                restoreEffectiveUser(sub_ctx);
-                return error.OpenRepoFailed;
-            };
+            const sub_repo = (try openRepositoryFor(allocator, self.destination, op)) orelse return error.OpenRepoFailed;
             defer c.git_repository_free(sub_repo);
 
             // Initialize and update submodules
-            const code = c.git_submodule_foreach(sub_repo, submoduleUpdateCallback, null);
-            restoreEffectiveUser(sub_ctx);
+            const code = c.git_submodule_foreach(sub_repo, submoduleUpdateCallback, op);
             if (code != 0) {
                 logger.warn("[git] submodule update failed", .{});
             }
         }
 
-        // Set file ownership if user or group is specified and files were updated
-        if (was_updated and (self.user != null or self.group != null)) {
-            try setDirectoryOwnership(allocator, self.destination, self.user, self.group);
-        }
-
         return was_updated;
     }
 
     fn submoduleUpdateCallback(sm: ?*c.git_submodule, name: [*c]const u8, payload: ?*anyopaque) callconv(.c) c_int {
-        _ = payload;
         _ = name;
         if (sm == null) return 0;
 
@@ -922,6 +1170,10 @@ pub const Resource = struct {
         var update_opts: c.git_submodule_update_options = undefined;
         init_code = c.git_submodule_update_options_init(&update_opts, c.GIT_SUBMODULE_UPDATE_OPTIONS_VERSION);
         if (init_code != 0) return init_code;
+        if (payload) |p| {
+            const op: *OperationContext = @ptrCast(@alignCast(p));
+            op.installFetchOptions(&update_opts.fetch_opts);
+        }
 
         return c.git_submodule_update(sm, 1, &update_opts);
     }
@@ -941,31 +1193,12 @@ pub const Resource = struct {
             return false;
         }
 
-        // Clone the repository
-        var gpa = std.heap.GeneralPurposeAllocator(.{}){};
-        defer _ = gpa.deinit();
-        const allocator = gpa.allocator();
-
-        var git = try git_client.Client.init();
-        defer git.deinit();
-
-        _ = c.git_libgit2_opts(c.GIT_OPT_SET_OWNER_VALIDATION, @as(c_int, 0));
-        var homedir_state = if (self.user) |user| try setHomedirForUser(user) else HomedirState{};
-        defer restoreHomedir(&homedir_state);
-
-        var env_saved = if (self.environment) |env|
-            try applyEnvironment(allocator, env)
-        else
-            std.ArrayList(EnvSaved).empty;
-        defer restoreEnvironment(allocator, &env_saved);
-
-        try self.cloneRepository(allocator);
-
-        // Set file ownership if user or group is specified
-        if (self.user != null or self.group != null) {
-            try setDirectoryOwnership(allocator, self.destination, self.user, self.group);
-        }
+        try self.prepareDestination();
+        return self.runOperation(.clone);
+    }
 
+    fn cloneWork(self: Resource, allocator: std.mem.Allocator, op: *OperationContext, error_detail: *GitErrorDetail) !bool {
+        try self.cloneRepository(allocator, op, error_detail);
         return true;
     }
 
@@ -989,6 +1222,34 @@ pub const Resource = struct {
 
 pub const ruby_prelude = @embedFile("git_resource.rb");
 
+/// Hidden subcommand that runs one isolated git operation (see
+/// `Resource.runIsolated`)
+pub const helper_command = "__git-helper";
+
+/// Entry point of `hola __git-helper`: read the request from stdin, run it
+/// and write the outcome to stdout. This process was just exec'd and has no
+/// other threads, so it can drop privileges and set its environment.
+pub fn runHelper(allocator: std.mem.Allocator) !void {
+    // Only the outcome goes to stdout; whatever else gets printed lands on
+    // stderr with the parent's output
+    const out = std.fs.File{ .handle = try std.posix.dup(std.posix.STDOUT_FILENO) };
+    defer out.close();
+    try std.posix.dup2(std.posix.STDERR_FILENO, std.posix.STDOUT_FILENO);
+
+    const input = try std.fs.File.stdin().readToEndAlloc(allocator, 1024 * 1024);
+    defer allocator.free(input);
+    const parsed = try std.json.parseFromSlice(Resource.HelperRequest, allocator, input, .{});
+    defer parsed.deinit();
+
+    var outcome = Resource.ChildOutcome{};
+    if (Resource.runHelperRequest(allocator, parsed.value, &outcome.detail)) |updated| {
+        outcome.updated = updated;
+    } else |err| {
+        outcome.error_code = @intFromError(err);
+    }
+    try out.writeAll(std.mem.asBytes(&outcome));
+}
+
 /// Zig function called from Ruby to add git resource
 pub fn zigAddResource(
     mrb: *mruby.mrb_state,
@@ -1010,6 +1271,7 @@ pub fn zigAddResource(
     var user_val: mruby.mrb_value = undefined;
     var group_val: mruby.mrb_value = undefined;
     var environment_val: mruby.mrb_value = undefined;
+    var sparse_paths_val: mruby.mrb_value = undefined;
     var action_val: mruby.mrb_value = undefined;
     var only_if_block: mruby.mrb_value = undefined;
     var not_if_block: mruby.mrb_value = undefined;
@@ -1017,22 +1279,22 @@ pub fn zigAddResource(
     var notifications_array: mruby.mrb_value = undefined;
     var subscriptions_array: mruby.mrb_value = undefined;
 
-    // Get arguments: 14 required + 5 optional
+    // Get arguments: 15 required + 5 optional
     // S=string, o=object (bool), i=integer, A=array, |=optional separator
-    _ = mruby.mrb_get_args(mrb, "SSSSSiooSoSSAS|oooAA", &repository_val, &destination_val, &revision_val, &checkout_branch_val, &remote_val, &depth_val, &enable_checkout_val, &enable_submodules_val, &ssh_key_val, &enable_strict_host_key_checking_val, &user_val, &group_val, &environment_val, &action_val, &only_if_block, &not_if_block, &ignore_failure_val, &notifications_array, &subscriptions_array);
+    _ = mruby.mrb_get_args(mrb, "SSSSSiooSoSSAAS|oooAA", &repository_val, &destination_val, &revision_val, &checkout_branch_val, &remote_val, &depth_val, &enable_checkout_val, &enable_submodules_val, &ssh_key_val, &enable_strict_host_key_checking_val, &user_val, &group_val, &environment_val, &sparse_paths_val, &action_val, &only_if_block, &not_if_block, &ignore_failure_val, &notifications_array, &subscriptions_array);
 
     // Extract required arguments
-    const repository = std.mem.span(mruby.mrb_str_to_cstr(mrb, repository_val));
-    const destination = std.mem.span(mruby.mrb_str_to_cstr(mrb, destination_val));
-    const revision = std.mem.span(mruby.mrb_str_to_cstr(mrb, revision_val));
-    const remote = std.mem.span(mruby.mrb_str_to_cstr(mrb, remote_val));
+    const repository = mruby.borrowStr(mrb, repository_val);
+    const destination = mruby.borrowStr(mrb, destination_val);
+    const revision = mruby.borrowStr(mrb, revision_val);
+    const remote = mruby.borrowStr(mrb, remote_val);
     const enable_checkout = mruby.mrb_test(enable_checkout_val);
     const enable_submodules = mruby.mrb_test(enable_submodules_val);
     const enable_strict_host_key_checking = mruby.mrb_test(enable_strict_host_key_checking_val);
-    const action_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, action_val));
+    const action_str = mruby.borrowStr(mrb, action_val);
 
     // Parse optional string fields with proper cleanup on failure
-    const checkout_branch_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, checkout_branch_val));
+    const checkout_branch_str = mruby.borrowStr(mrb, checkout_branch_val);
     const checkout_branch: ?[]const u8 = if (checkout_branch_str.len > 0)
         allocator.dupe(u8, checkout_branch_str) catch return mruby.mrb_nil_value()
     else
@@ -1044,21 +1306,21 @@ pub fn zigAddResource(
     const depth_int = mruby.zig_mrb_fixnum(mrb, depth_val);
     const depth: ?u32 = if (depth_int > 0) @intCast(depth_int) else null;
 
-    const ssh_key_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, ssh_key_val));
+    const ssh_key_str = mruby.borrowStr(mrb, ssh_key_val);
     const ssh_key: ?[]const u8 = if (ssh_key_str.len > 0)
         allocator.dupe(u8, ssh_key_str) catch return mruby.mrb_nil_value()
     else
         null;
     errdefer if (ssh_key) |key| allocator.free(key);
 
-    const user_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, user_val));
+    const user_str = mruby.borrowStr(mrb, user_val);
     const user: ?[]const u8 = if (user_str.len > 0)
         allocator.dupe(u8, user_str) catch return mruby.mrb_nil_value()
     else
         null;
     errdefer if (user) |u| allocator.free(u);
 
-    const group_str = std.mem.span(mruby.mrb_str_to_cstr(mrb, group_val));
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
@@ -1075,35 +1337,29 @@ pub fn zigAddResource(
     };
 
     // Parse environment array [[key, value], ...]
-    var environment: ?[]const u8 = null;
-    const env_len = mruby.mrb_ary_len(mrb, environment_val);
-    if (env_len > 0) {
-        var env_list = std.ArrayList(u8).initCapacity(allocator, @intCast(env_len * 32)) catch std.ArrayList(u8).empty;
-        defer env_list.deinit(allocator);
-
-        var i: mruby.mrb_int = 0;
-        while (i < env_len) : (i += 1) {
-            const pair = mruby.mrb_ary_ref(mrb, environment_val, i);
-            if (mruby.mrb_ary_len(mrb, pair) != 2) continue;
-
-            const key_val = mruby.mrb_ary_ref(mrb, pair, 0);
-            const val_val = mruby.mrb_ary_ref(mrb, pair, 1);
-            const key_cstr = mruby.mrb_str_to_cstr(mrb, key_val);
-            const val_cstr = mruby.mrb_str_to_cstr(mrb, val_val);
-            const key_span = std.mem.span(key_cstr);
-            const val_span = std.mem.span(val_cstr);
-
-            env_list.appendSlice(allocator, key_span) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, '=') catch return mruby.mrb_nil_value();
-            env_list.appendSlice(allocator, val_span) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, 0) catch return mruby.mrb_nil_value();
+    const environment = base.environmentFromRuby(allocator, mrb, environment_val) catch return mruby.mrb_nil_value();
+    errdefer if (environment) |env| allocator.free(env);
+
+    // Parse sparse paths array into "dir\0dir2\0", normalized to repo-relative
+    var sparse_paths: ?[]const u8 = null;
+    const sparse_views = mruby.aryStrViews(allocator, mrb, sparse_paths_val) catch return mruby.mrb_nil_value();
+    defer allocator.free(sparse_views);
+    if (sparse_views.len > 0) {
+        var sparse_list = std.ArrayList(u8).empty;
+        defer sparse_list.deinit(allocator);
+
+        for (sparse_views) |view| {
+            const path = std.mem.trim(u8, view.slice(), "/");
+            if (path.len == 0) continue;
+            sparse_list.appendSlice(allocator, path) catch return mruby.mrb_nil_value();
+            sparse_list.append(allocator, 0) catch return mruby.mrb_nil_value();
         }
 
-        if (env_list.items.len > 0) {
-            environment = allocator.dupe(u8, env_list.items) catch return mruby.mrb_nil_value();
+        if (sparse_list.items.len > 0) {
+            sparse_paths = allocator.dupe(u8, sparse_list.items) catch return mruby.mrb_nil_value();
         }
     }
-    errdefer if (environment) |env| allocator.free(env);
+    errdefer if (sparse_paths) |paths| allocator.free(paths);
 
     // Duplicate required strings with cleanup on failure
     const repository_dup = allocator.dupe(u8, repository) catch return mruby.mrb_nil_value();
@@ -1137,6 +1393,7 @@ pub fn zigAddResource(
         .user = user,
         .group = group,
         .environment = environment,
+        .sparse_paths = sparse_paths,
         .action = action,
         .common = common,
     };
@@ -1153,9 +1410,187 @@ pub fn zigAddResource(
         if (user) |u| allocator.free(u);
         if (group) |g| allocator.free(g);
         if (environment) |env| allocator.free(env);
+        if (sparse_paths) |paths| allocator.free(paths);
         common.deinit(allocator);
         return mruby.mrb_nil_value();
     };
 
     return mruby.mrb_nil_value();
 }
+
+test "proxy selection follows scheme and no_proxy" {
+    const t = std.testing;
+    const env = Resource.ProxyEnv{
+        .https = "http://proxy:3128",
+        .all = "socks5://fallback:1080",
+        .no_proxy = "localhost, .internal.example.com",
+    };
+    try t.expectEqualStrings("http://proxy:3128", env.forUrl("https://github.com/ratazzi/hola.git").?);
+    try t.expectEqualStrings("socks5://fallback:1080", env.forUrl("http://github.com/ratazzi/hola.git").?);
+    try t.expect(env.forUrl("git@github.com:ratazzi/hola.git") == null);
+    try t.expect(env.forUrl("ssh://git@github.com/ratazzi/hola.git") == null);
+    try t.expect(env.forUrl("https://git.internal.example.com/app.git") == null);
+    try t.expect(env.forUrl("https://internal.example.com/app.git") == null);
+    try t.expect(env.forUrl("https://localhost/app.git") == null);
+}
+
+test "helper requests survive the trip to the helper process" {
+    const t = std.testing;
+    var identity = Resource.Identity{ .uid = 1000, .gid = 100, .ngroups = 2 };
+    identity.groups[0] = 100;
+    identity.groups[1] = 27;
+    var common = base.CommonProps.init(t.allocator);
+    defer common.deinit(t.allocator);
+    const res = Resource{
+        .repository = "https://github.com/ratazzi/hola.git",
+        .destination = "/srv/app",
+        .revision = "HEAD",
+        .checkout_branch = null,
+        .remote = "origin",
+        .depth = null,
+        .enable_checkout = true,
+        .enable_submodules = false,
+        .ssh_key = null,
+        .ssh_wrapper = null,
+        .enable_strict_host_key_checking = true,
+        .user = "deploy",
+        .group = null,
+        .environment = "SSH_AUTH_SOCK=/tmp/agent\x00HOME=/home/deploy\x00",
+        .sparse_paths = null,
+        .action = .sync,
+        .common = common,
+    };
+
+    const payload = try std.fmt.allocPrint(t.allocator, "{f}", .{std.json.fmt(Resource.HelperRequest.init(res, .clone, &identity), .{})});
+    defer t.allocator.free(payload);
+    const parsed = try std.json.parseFromSlice(Resource.HelperRequest, t.allocator, payload, .{});
+    defer parsed.deinit();
+
+    const back = parsed.value.resource(common);
+    try t.expectEqual(Resource.Work.clone, parsed.value.work);
+    try t.expectEqual(Resource.Action.checkout, back.action);
+    try t.expectEqualStrings(res.environment.?, back.environment.?);
+    try t.expectEqualStrings("deploy", back.user.?);
+    try t.expect(back.group == null);
+    const id = try parsed.value.identity();
+    try t.expectEqual(@as(?Resource.posix_c.uid_t, 1000), id.uid);
+    try t.expectEqualSlices(Resource.posix_c.gid_t, identity.groups[0..2], id.groups[0..id.ngroups]);
+}
+
+/// Test helper: commit `files` (path, content) on top of `index` and move
+/// refs/heads/deploy of the bare repository to the new commit
+fn commitTestFiles(repo: *c.git_repository, index: *c.git_index, files: []const [2][]const u8, parent: ?*c.git_commit) !*c.git_commit {
+    var path_buf: [256]u8 = undefined;
+    for (files) |file| {
+        var entry = std.mem.zeroes(c.git_index_entry);
+        if (c.git_blob_create_from_buffer(&entry.id, repo, file[1].ptr, file[1].len) != 0) return error.BlobCreateFailed;
+        entry.mode = c.GIT_FILEMODE_BLOB;
+        entry.path = (try std.fmt.bufPrintZ(&path_buf, "{s}", .{file[0]})).ptr;
+        if (c.git_index_add(index, &entry) != 0) return error.IndexAddFailed;
+    }
+
+    var tree_id: c.git_oid = undefined;
+    if (c.git_index_write_tree_to(&tree_id, index, repo) != 0) return error.WriteTreeFailed;
+    var tree: ?*c.git_tree = null;
+    if (c.git_tree_lookup(&tree, repo, &tree_id) != 0) return error.TreeLookupFailed;
+    defer c.git_tree_free(tree);
+
+    var sig: ?*c.git_signature = null;
+    if (c.git_signature_new(&sig, "hola", "hola@example.com", 0, 0) != 0) return error.SignatureFailed;
+    defer c.git_signature_free(sig);
+
+    var commit_id: c.git_oid = undefined;
+    var parents = [_]?*const c.git_commit{parent};
+    const parent_count: usize = if (parent != null) 1 else 0;
+    if (c.git_commit_create(&commit_id, repo, "refs/heads/deploy", sig, sig, null, "test", tree, parent_count, &parents) != 0) return error.CommitFailed;
+
+    var commit: ?*c.git_commit = null;
+    if (c.git_commit_lookup(&commit, repo, &commit_id) != 0) return error.CommitLookupFailed;
+    return commit.?;
+}
+
+test "sparse_paths checks out and updates only the selected directories" {
+    const testing = std.testing;
+    const alloc = testing.allocator;
+    var tmp = testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(alloc, ".");
+    defer alloc.free(root);
+    const origin = try std.fs.path.joinZ(alloc, &.{ root, "origin.git" });
+    defer alloc.free(origin);
+    const dest = try std.fs.path.join(alloc, &.{ root, "app" });
+    defer alloc.free(dest);
+
+    var git = try git_client.Client.init();
+    defer git.deinit();
+
+    // 100 directories x 200 files
+    var bare: ?*c.git_repository = null;
+    try testing.expectEqual(@as(c_int, 0), c.git_repository_init(&bare, origin.ptr, 1));
+    defer c.git_repository_free(bare);
+    _ = c.git_repository_set_head(bare, "refs/heads/deploy");
+    var index: ?*c.git_index = null;
+    try testing.expectEqual(@as(c_int, 0), c.git_index_new(&index));
+    defer c.git_index_free(index);
+
+    var arena = std.heap.ArenaAllocator.init(alloc);
+    defer arena.deinit();
+    var files = std.ArrayList([2][]const u8).empty;
+    for (0..100) |d| {
+        for (0..200) |f| {
+            const path = try std.fmt.allocPrint(arena.allocator(), "svc{d}/file{d}.txt", .{ d, f });
+            try files.append(arena.allocator(), .{ path, path });
+        }
+    }
+    const first = try commitTestFiles(bare.?, index.?, files.items, null);
+    defer c.git_commit_free(first);
+
+    var res = Resource{
+        .repository = origin,
+        .destination = dest,
+        .revision = "HEAD",
+        .checkout_branch = null,
+        .remote = "origin",
+        .depth = null,
+        .enable_checkout = true,
+        .enable_submodules = false,
+        .ssh_key = null,
+        .ssh_wrapper = null,
+        .enable_strict_host_key_checking = true,
+        .user = null,
+        .group = null,
+        .environment = null,
+        .sparse_paths = "svc1\x00svc2\x00",
+        .action = .sync,
+        .common = base.CommonProps.init(alloc),
+    };
+    defer res.common.deinit(alloc);
+
+    try testing.expect((try res.apply()).was_updated);
+    var app = try std.fs.openDirAbsolute(dest, .{});
+    defer app.close();
+    try app.access("svc2/file199.txt", .{});
+    try testing.expectError(error.FileNotFound, app.access("svc50", .{}));
+    const untouched = try app.statFile("svc1/file1.txt");
+
+    // Change one file inside the sparse set and one outside it
+    const second = try commitTestFiles(bare.?, index.?, &.{
+        .{ "svc1/file0.txt", "changed" },
+        .{ "svc50/file0.txt", "changed" },
+    }, first);
+    defer c.git_commit_free(second);
+
+    try testing.expect((try res.apply()).was_updated);
+    var buf: [16]u8 = undefined;
+    try testing.expectEqualStrings("changed", try app.readFile("svc1/file0.txt", &buf));
+    try testing.expectError(error.FileNotFound, app.access("svc50", .{}));
+    const after = try app.statFile("svc1/file1.txt");
+    try testing.expectEqual(untouched.inode, after.inode);
+    try testing.expectEqual(untouched.mtime, after.mtime);
+
+    // Growing the set materializes the new directory without a new commit
+    res.sparse_paths = "svc1\x00svc2\x00svc3\x00";
+    try testing.expect((try res.apply()).was_updated);
+    try app.access("svc3/file0.txt", .{});
+    try testing.expect(!(try res.apply()).was_updated);
+}
@@ -12,6 +12,7 @@ class GitResource
     @enable_checkout = true
     @enable_submodules = false
     @environment = {}
+    @sparse_paths = []
     @ssh_key = nil
     @enable_strict_host_key_checking = true
     @user = nil
@@ -54,6 +55,7 @@ class GitResource
         @user || "",
         @group || "",
         environment_arg,
+        @sparse_paths,
         @action,
         only_if_arg,
         not_if_arg,
@@ -96,6 +98,12 @@ class GitResource
     @environment = value
   end
 
+  # Check out only these directories (repository-relative); updates then
+  # touch only changed files inside them
+  def sparse_paths(*paths)
+    @sparse_paths = paths.flatten.map(&:to_s)
+  end
+
   def ssh_key(value)
     @ssh_key = value.to_s
   end
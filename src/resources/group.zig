@@ -76,6 +76,7 @@ pub const Resource = struct {
         const allocator = arena.allocator();
 
         const args = [_][]const u8{ "getent", "group", group_name };
+        base.noteSubprocess();
         const result = std.process.Child.run(.{
             .allocator = allocator,
             .argv = &args,
@@ -130,6 +131,7 @@ pub const Resource = struct {
         logger.debug("Executing: {s}", .{cmd});
 
         const args = [_][]const u8{ "/bin/sh", "-c", cmd };
+        base.noteSubprocess();
         const result = try std.process.Child.run(.{
             .allocator = allocator,
             .argv = &args,
@@ -300,28 +302,24 @@ pub fn zigAddResource(
     );
 
     // Extract group name
-    const group_name_cstr = mruby.mrb_str_to_cstr(mrb, group_name_val);
-    const group_name = allocator.dupe(u8, std.mem.span(group_name_cstr)) catch return mruby.mrb_nil_value();
+    const group_name = allocator.dupe(u8, mruby.borrowStr(mrb, group_name_val)) catch return mruby.mrb_nil_value();
 
     // Parse GID (optional)
-    const gid_cstr = mruby.mrb_str_to_cstr(mrb, gid_val);
-    const gid_str = std.mem.span(gid_cstr);
+    const gid_str = mruby.borrowStr(mrb, gid_val);
     const gid: ?u32 = if (gid_str.len > 0)
         std.fmt.parseInt(u32, gid_str, 10) catch null
     else
         null;
 
     // Parse members (optional)
-    const members_cstr = mruby.mrb_str_to_cstr(mrb, members_val);
-    const members_str = std.mem.span(members_cstr);
+    const members_str = mruby.borrowStr(mrb, members_val);
     const members: ?[]const u8 = if (members_str.len > 0)
         allocator.dupe(u8, members_str) catch return mruby.mrb_nil_value()
     else
         null;
 
     // Parse excluded_members (optional)
-    const excluded_members_cstr = mruby.mrb_str_to_cstr(mrb, excluded_members_val);
-    const excluded_members_str = std.mem.span(excluded_members_cstr);
+    const excluded_members_str = mruby.borrowStr(mrb, excluded_members_val);
     const excluded_members: ?[]const u8 = if (excluded_members_str.len > 0)
         allocator.dupe(u8, excluded_members_str) catch return mruby.mrb_nil_value()
     else
@@ -331,8 +329,7 @@ pub fn zigAddResource(
     const append = mruby.mrb_test(append_val);
 
     // Parse comment (optional)
-    const comment_cstr = mruby.mrb_str_to_cstr(mrb, comment_val);
-    const comment_str = std.mem.span(comment_cstr);
+    const comment_str = mruby.borrowStr(mrb, comment_val);
     const comment: ?[]const u8 = if (comment_str.len > 0)
         allocator.dupe(u8, comment_str) catch return mruby.mrb_nil_value()
     else
@@ -343,8 +340,7 @@ pub fn zigAddResource(
     const non_unique = mruby.mrb_test(non_unique_val);
 
     // Parse action
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "modify"))
         .modify
     else if (std.mem.eql(u8, action_str, "remove"))
@@ -258,6 +258,7 @@ fn isInstalled(allocator: std.mem.Allocator, name: []const u8) !bool {
     child.stdout_behavior = .Pipe;
     child.stderr_behavior = .Pipe;
 
+    base.noteSubprocess();
     try child.spawn();
     const stdout = try child.stdout.?.readToEndAlloc(allocator, 1024 * 1024);
     defer allocator.free(stdout);
@@ -283,6 +284,7 @@ fn runCommand(allocator: std.mem.Allocator, cmd: []const u8, action: common.Acti
     // Set stdin to /dev/null to prevent any interactive prompts
     child.stdin_behavior = .Ignore;
 
+    base.noteSubprocess();
     try child.spawn();
 
     const stdout = try child.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
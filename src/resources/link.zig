@@ -7,6 +7,9 @@ pub const Resource = struct {
     // Resource-specific properties
     path: []const u8,
     target: []const u8,
+    /// Bulk mode (`links` in the DSL): every entry is managed by this
+    /// resource and `path` is only its name
+    links: []const Link = &.{},
     owner: ?[]const u8,
     group: ?[]const u8,
     action: Action,
@@ -19,9 +22,19 @@ pub const Resource = struct {
         delete,
     };
 
+    pub const Link = struct {
+        path: []const u8,
+        target: []const u8,
+    };
+
     pub fn deinit(self: Resource, allocator: std.mem.Allocator) void {
         allocator.free(self.path);
         allocator.free(self.target);
+        for (self.links) |entry| {
+            allocator.free(entry.path);
+            allocator.free(entry.target);
+        }
+        allocator.free(self.links);
         if (self.owner) |owner| allocator.free(owner);
         if (self.group) |group| allocator.free(group);
 
@@ -51,7 +64,7 @@ pub const Resource = struct {
 
         switch (self.action) {
             .create => {
-                const was_created = try applyCreate(self);
+                const was_created = try self.sync();
                 return base.ApplyResult{
                     .was_updated = was_created,
                     .action = action_name,
@@ -59,7 +72,7 @@ pub const Resource = struct {
                 };
             },
             .delete => {
-                try applyDelete(self);
+                _ = try self.sync();
                 return base.ApplyResult{
                     .was_updated = false,
                     .action = action_name,
@@ -69,121 +82,239 @@ pub const Resource = struct {
         }
     }
 
-    fn applyCreate(self: Resource) !bool {
-        const is_abs = std.fs.path.isAbsolute(self.path);
+    /// Bring every link of this resource in line with `action`; true when
+    /// any link was created, replaced or removed
+    fn sync(self: Resource) !bool {
+        const single = [_]Link{.{ .path = self.path, .target = self.target }};
+        const links: []const Link = if (self.links.len > 0) self.links else &single;
+
+        // Resolved once up front: getpwnam is not safe to call from the
+        // batch workers
+        const ownership = Ownership{
+            .uid = if (self.owner) |o| try base.getUserId(o) else Ownership.unchanged,
+            .gid = if (self.group) |g| try base.getGroupId(g) else Ownership.unchanged,
+        };
 
-        // Check if link already exists
-        var link_buf: [std.fs.max_path_bytes]u8 = undefined;
-        const link_exists = blk: {
-            if (is_abs) {
-                _ = std.fs.readLinkAbsolute(self.path, &link_buf) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
+        var batch = try Batch.init(std.heap.c_allocator, links, self.action, ownership);
+        defer batch.deinit();
+        batch.run();
+
+        if (batch.failure) |failure| {
+            base.recordProvisionErrorDetail("{s}: {s}", .{ links[failure.index].path, @errorName(failure.err) });
+            return failure.err;
+        }
+        return batch.changed.load(.monotonic) > 0;
+    }
+
+    const Ownership = struct {
+        uid: std.posix.uid_t,
+        gid: std.posix.gid_t,
+
+        /// fchownat leaves an id as is when passed (id_t)-1
+        const unchanged = std.math.maxInt(std.posix.uid_t);
+
+        fn wanted(self: Ownership) bool {
+            return self.uid != unchanged or self.gid != unchanged;
+        }
+    };
+
+    /// Links grouped by parent directory. Each group is handled through one
+    /// open directory fd: one readlinkat per link, and changes are made with
+    /// symlinkat/renameat relative to it. Large sets spread the groups over
+    /// a few threads; no two threads ever work in the same directory.
+    const Batch = struct {
+        allocator: std.mem.Allocator,
+        links: []const Link,
+        action: Action,
+        ownership: Ownership,
+        /// Link indices sorted by (parent, name)
+        order: []usize,
+        /// End offsets into `order`, one per parent directory
+        group_ends: std.ArrayList(usize) = .empty,
+        next_group: std.atomic.Value(usize) = .init(0),
+        changed: std.atomic.Value(usize) = .init(0),
+        mutex: std.Thread.Mutex = .{},
+        failure: ?struct { index: usize, err: anyerror } = null,
+
+        /// Below this many links the batch runs on the calling thread
+        const parallel_threshold = 256;
+        const max_workers = 8;
+
+        fn init(allocator: std.mem.Allocator, links: []const Link, action: Action, ownership: Ownership) !Batch {
+            const order = try allocator.alloc(usize, links.len);
+            errdefer allocator.free(order);
+            for (order, 0..) |*slot, i| slot.* = i;
+            std.mem.sort(usize, order, links, lessThan);
+
+            var batch = Batch{ .allocator = allocator, .links = links, .action = action, .ownership = ownership, .order = order };
+            errdefer batch.group_ends.deinit(allocator);
+            for (order, 0..) |index, pos| {
+                const is_last = pos + 1 == order.len or
+                    !std.mem.eql(u8, parentOf(links[index].path), parentOf(links[order[pos + 1]].path));
+                if (is_last) try batch.group_ends.append(allocator, pos + 1);
+            }
+            return batch;
+        }
+
+        fn deinit(self: *Batch) void {
+            self.group_ends.deinit(self.allocator);
+            self.allocator.free(self.order);
+        }
+
+        fn lessThan(links: []const Link, a: usize, b: usize) bool {
+            return switch (std.mem.order(u8, parentOf(links[a].path), parentOf(links[b].path))) {
+                .lt => true,
+                .gt => false,
+                .eq => std.mem.lessThan(u8, std.fs.path.basename(links[a].path), std.fs.path.basename(links[b].path)),
+            };
+        }
+
+        fn run(self: *Batch) void {
+            const groups = self.group_ends.items.len;
+            if (self.links.len < parallel_threshold or groups < 2) return self.work();
+
+            const cpus = std.Thread.getCpuCount() catch 1;
+            const workers = @min(groups, cpus, max_workers);
+            var threads: [max_workers]std.Thread = undefined;
+            var spawned: usize = 0;
+            while (spawned + 1 < workers) : (spawned += 1) {
+                threads[spawned] = std.Thread.spawn(.{}, work, .{self}) catch break;
+            }
+            self.work();
+            for (threads[0..spawned]) |thread| thread.join();
+        }
+
+        fn work(self: *Batch) void {
+            while (true) {
+                const group = self.next_group.fetchAdd(1, .monotonic);
+                if (group >= self.group_ends.items.len) return;
+                if (self.hasFailed()) return;
+
+                const start = if (group == 0) 0 else self.group_ends.items[group - 1];
+                const indices = self.order[start..self.group_ends.items[group]];
+                var failed_index = indices[0];
+                const changed = self.syncDir(indices, &failed_index) catch |err| {
+                    self.fail(failed_index, err);
+                    return;
                 };
-            } else {
-                _ = std.fs.cwd().readLink(self.path, &link_buf) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
+                _ = self.changed.fetchAdd(changed, .monotonic);
+            }
+        }
+
+        fn hasFailed(self: *Batch) bool {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+            return self.failure != null;
+        }
+
+        fn fail(self: *Batch, index: usize, err: anyerror) void {
+            self.mutex.lock();
+            defer self.mutex.unlock();
+            if (self.failure == null) self.failure = .{ .index = index, .err = err };
+        }
+
+        /// Sync the links in `indices`, which share a parent directory
+        fn syncDir(self: *Batch, indices: []const usize, failed_index: *usize) !usize {
+            const parent_path = parentOf(self.links[indices[0]].path);
+            if (self.action == .create) try base.ensurePath(parent_path);
+
+            var dir = std.fs.cwd().openDir(parent_path, .{}) catch |err| switch (err) {
+                error.FileNotFound => if (self.action == .delete) return 0 else return err,
+                else => return err,
+            };
+            defer dir.close();
+
+            var changed: usize = 0;
+            var link_buf: [std.fs.max_path_bytes]u8 = undefined;
+            for (indices) |index| {
+                failed_index.* = index;
+                const entry = self.links[index];
+                const name = std.fs.path.basename(entry.path);
+
+                const current: ?[]const u8 = dir.readLink(name, &link_buf) catch |err| switch (err) {
+                    error.FileNotFound => null,
                     else => return err,
                 };
-            }
-            break :blk true;
-        };
 
-        if (link_exists) {
-            // Check if link points to correct target
-            var target_buf: [std.fs.max_path_bytes]u8 = undefined;
-            const current_target = if (is_abs)
-                try std.fs.readLinkAbsolute(self.path, &target_buf)
-            else
-                try std.fs.cwd().readLink(self.path, &target_buf);
-
-            // Normalize paths for comparison
-            const normalized_current = try normalizePath(std.heap.page_allocator, current_target);
-            defer std.heap.page_allocator.free(normalized_current);
-            const normalized_target = try normalizePath(std.heap.page_allocator, self.target);
-            defer std.heap.page_allocator.free(normalized_target);
-
-            if (std.mem.eql(u8, normalized_current, normalized_target)) {
-                return false; // Link already points to correct target
-            } else {
-                // Delete existing link and create new one
-                if (is_abs) {
-                    try std.fs.deleteFileAbsolute(self.path);
-                } else {
-                    try std.fs.cwd().deleteFile(self.path);
+                switch (self.action) {
+                    .create => {
+                        if (current) |current_target| {
+                            if (try targetsMatch(current_target, entry.target)) continue;
+                        }
+                        try self.swapIn(dir, name, entry.target);
+                    },
+                    .delete => {
+                        if (current == null) continue; // Already deleted
+                        try dir.deleteFile(name);
+                    },
                 }
+                changed += 1;
             }
+            return changed;
         }
 
-        // Create parent directory if it doesn't exist
-        if (std.fs.path.dirname(self.path)) |dir| {
-            try std.fs.cwd().makePath(dir);
-        }
+        /// Create the link under a temporary name next to `name`, then rename
+        /// it over `name`: readers see the old link or the new one, never a
+        /// missing path
+        fn swapIn(self: *Batch, dir: std.fs.Dir, name: []const u8, target: []const u8) !void {
+            var tmp_buf: [64]u8 = undefined;
+            const tmp = try std.fmt.bufPrint(&tmp_buf, ".hola-link-{d}-{d}", .{ std.c.getpid(), tmp_counter.fetchAdd(1, .monotonic) });
+
+            dir.symLink(target, tmp, .{}) catch |err| switch (err) {
+                // Left behind by an interrupted run
+                error.PathAlreadyExists => {
+                    try dir.deleteFile(tmp);
+                    try dir.symLink(target, tmp, .{});
+                },
+                else => return err,
+            };
+            errdefer dir.deleteFile(tmp) catch {};
 
-        // Create symbolic link
-        if (is_abs) {
-            try std.fs.symLinkAbsolute(self.target, self.path, .{});
-        } else {
-            try std.fs.cwd().symLink(self.target, self.path, .{});
+            // Owned correctly before it becomes visible under its real name
+            if (self.ownership.wanted()) try setLinkOwnership(dir, tmp, self.ownership);
+            try dir.rename(tmp, name);
         }
+    };
 
-        // Set ownership if specified (use lchown for symlinks)
-        if (self.owner != null or self.group != null) {
-            try setLinkOwnership(self.path, self.owner, self.group);
-        }
+    var tmp_counter = std.atomic.Value(u64).init(0);
 
-        return true; // Link was created
+    fn parentOf(path: []const u8) []const u8 {
+        return std.fs.path.dirname(path) orelse ".";
     }
 
     /// Set ownership for a symbolic link (does not follow the link)
-    fn setLinkOwnership(link_path: []const u8, owner: ?[]const u8, group: ?[]const u8) !void {
+    fn setLinkOwnership(dir: std.fs.Dir, name: []const u8, ownership: Ownership) !void {
         const c = @cImport({
             @cInclude("unistd.h");
+            @cInclude("fcntl.h");
         });
 
-        // Get current ownership using lstat (doesn't follow symlinks)
-        const stat = try std.posix.fstatat(std.posix.AT.FDCWD, link_path, std.posix.AT.SYMLINK_NOFOLLOW);
-
-        const uid = if (owner) |o| try base.getUserId(o) else stat.uid;
-        const gid = if (group) |g| try base.getGroupId(g) else stat.gid;
-
-        // Use lchown to change ownership without following the link
-        const path_z = try std.posix.toPosixPath(link_path);
-        if (c.lchown(&path_z, uid, gid) != 0) {
+        const name_z = try std.posix.toPosixPath(name);
+        if (c.fchownat(dir.fd, &name_z, ownership.uid, ownership.gid, c.AT_SYMLINK_NOFOLLOW) != 0) {
             return error.ChownFailed;
         }
     }
 
-    fn applyDelete(self: Resource) !void {
-        const is_abs = std.fs.path.isAbsolute(self.path);
-
-        // Check if link exists
-        var link_buf: [std.fs.max_path_bytes]u8 = undefined;
-        const link_exists = blk: {
-            if (is_abs) {
-                _ = std.fs.readLinkAbsolute(self.path, &link_buf) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            } else {
-                _ = std.fs.cwd().readLink(self.path, &link_buf) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            }
-            break :blk true;
-        };
-
-        if (!link_exists) {
-            return; // Already deleted
+    /// Whether an existing link's target already matches the wanted one.
+    /// Relative targets are compared as if resolved against the cwd.
+    fn targetsMatch(current: []const u8, wanted: []const u8) !bool {
+        if (std.fs.path.isAbsolute(current) == std.fs.path.isAbsolute(wanted)) {
+            return std.mem.eql(u8, trimTrailingSlashes(current), trimTrailingSlashes(wanted));
         }
 
-        // Delete link
-        if (is_abs) {
-            try std.fs.deleteFileAbsolute(self.path);
-        } else {
-            try std.fs.cwd().deleteFile(self.path);
+        const normalized_current = try normalizePath(std.heap.c_allocator, current);
+        defer std.heap.c_allocator.free(normalized_current);
+        const normalized_wanted = try normalizePath(std.heap.c_allocator, wanted);
+        defer std.heap.c_allocator.free(normalized_wanted);
+        return std.mem.eql(u8, normalized_current, normalized_wanted);
+    }
+
+    fn trimTrailingSlashes(path: []const u8) []const u8 {
+        var trimmed = path;
+        while (trimmed.len > 1 and trimmed[trimmed.len - 1] == '/') {
+            trimmed = trimmed[0 .. trimmed.len - 1];
         }
+        return trimmed;
     }
 
     fn normalizePath(allocator: std.mem.Allocator, path: []const u8) ![]const u8 {
@@ -199,12 +330,10 @@ pub const Resource = struct {
         };
 
         // Remove trailing slashes
-        var normalized = resolved;
-        while (normalized.len > 1 and normalized[normalized.len - 1] == '/') {
-            normalized = normalized[0 .. normalized.len - 1];
-        }
-
-        return normalized;
+        const trimmed = trimTrailingSlashes(resolved);
+        if (trimmed.len == resolved.len) return resolved;
+        defer allocator.free(resolved);
+        return allocator.dupe(u8, trimmed);
     }
 };
 
@@ -218,7 +347,7 @@ pub fn zigAddResource(
     resources: *std.ArrayList(Resource),
     allocator: std.mem.Allocator,
 ) mruby.mrb_value {
-    // Parse arguments: path, target, owner, group, action, only_if_block, not_if_block, ignore_failure, notifications, subscriptions
+    // Parse arguments: path, target, owner, group, action, only_if_block, not_if_block, ignore_failure, notifications, subscriptions, links
     var path_val: mruby.mrb_value = undefined;
     var target_val: mruby.mrb_value = undefined;
     var owner_val: mruby.mrb_value = undefined;
@@ -229,42 +358,54 @@ pub fn zigAddResource(
     var ignore_failure_val: mruby.mrb_value = undefined;
     var notifications_val: mruby.mrb_value = undefined;
     var subscriptions_val: mruby.mrb_value = undefined;
+    var links_val: mruby.mrb_value = mruby.mrb_nil_value();
 
-    // Format: SSSS|ooooAA
+    // Format: SSSS|ooooAAA
     // S: required string (path, target, owner, group)
     // |: optional arguments start
     // o: optional object (action, only_if, not_if, ignore_failure)
-    // A: optional array (notifications, subscriptions)
-    _ = mruby.mrb_get_args(mrb, "SSSS|ooooAA", &path_val, &target_val, &owner_val, &group_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
+    // A: optional array (notifications, subscriptions, links)
+    _ = mruby.mrb_get_args(mrb, "SSSS|ooooAAA", &path_val, &target_val, &owner_val, &group_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val, &links_val);
 
     // Extract path
-    const path_cstr = mruby.mrb_str_to_cstr(mrb, path_val);
-    const path = allocator.dupe(u8, std.mem.span(path_cstr)) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
 
     // Extract target (required)
-    const target_cstr = mruby.mrb_str_to_cstr(mrb, target_val);
-    const target = allocator.dupe(u8, std.mem.span(target_cstr)) catch return mruby.mrb_nil_value();
+    const target = allocator.dupe(u8, mruby.borrowStr(mrb, target_val)) catch return mruby.mrb_nil_value();
 
     // Extract owner (optional)
-    const owner_cstr = mruby.mrb_str_to_cstr(mrb, owner_val);
-    const owner_str = std.mem.span(owner_cstr);
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
     // Extract group (optional)
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
         null;
 
+    // Extract bulk links: [[path, target], ...]
+    var links = std.ArrayList(Resource.Link).empty;
+    if (mruby.mrb_test(links_val)) {
+        const rows = mruby.aryRowViews(2, allocator, mrb, links_val) catch return mruby.mrb_nil_value();
+        defer allocator.free(rows);
+        links.ensureTotalCapacity(allocator, rows.len) catch return mruby.mrb_nil_value();
+        for (rows) |row| {
+            const link_path = allocator.dupe(u8, row[0].slice()) catch return mruby.mrb_nil_value();
+            const link_target = allocator.dupe(u8, row[1].slice()) catch {
+                allocator.free(link_path);
+                return mruby.mrb_nil_value();
+            };
+            links.appendAssumeCapacity(.{ .path = link_path, .target = link_target });
+        }
+    }
+
     // Parse action (optional, default create)
     const action: Resource.Action = if (mruby.mrb_test(action_val)) blk: {
-        const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-        const action_str = std.mem.span(action_cstr);
+        const action_str = mruby.borrowStr(mrb, action_val);
         if (std.mem.eql(u8, action_str, "delete")) {
             break :blk .delete;
         }
@@ -278,6 +419,7 @@ pub fn zigAddResource(
     resources.append(allocator, .{
         .path = path,
         .target = target,
+        .links = links.toOwnedSlice(allocator) catch return mruby.mrb_nil_value(),
         .owner = owner,
         .group = group,
         .action = action,
@@ -286,3 +428,59 @@ pub fn zigAddResource(
 
     return mruby.mrb_nil_value();
 }
+
+test "bulk links are created, swapped and removed per directory" {
+    var arena_state = std.heap.ArenaAllocator.init(std.testing.allocator);
+    defer arena_state.deinit();
+    const arena = arena_state.allocator();
+
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+    const root = try tmp.dir.realpathAlloc(arena, ".");
+
+    // Enough links across enough directories to take the threaded path
+    var links = std.ArrayList(Resource.Link).empty;
+    for (0..300) |i| {
+        try links.append(arena, .{
+            .path = try std.fmt.allocPrint(arena, "{s}/d{d}/l{d}", .{ root, i % 6, i }),
+            .target = try std.fmt.allocPrint(arena, "/releases/{d}", .{i}),
+        });
+    }
+
+    var resource = Resource{
+        .path = "bulk",
+        .target = "",
+        .links = links.items,
+        .owner = null,
+        .group = null,
+        .action = .create,
+        .common = base.CommonProps.init(arena),
+    };
+    try std.testing.expect((try resource.apply()).was_updated);
+    try std.testing.expect(!(try resource.apply()).was_updated);
+
+    // Repoint one link: swapped in place, no temporary names left behind
+    links.items[7].target = "/releases/next";
+    try std.testing.expect((try resource.apply()).was_updated);
+    var buf: [std.fs.max_path_bytes]u8 = undefined;
+    try std.testing.expectEqualStrings("/releases/next", try tmp.dir.readLink("d1/l7", &buf));
+    var dir = try tmp.dir.openDir("d1", .{ .iterate = true });
+    defer dir.close();
+    var it = dir.iterate();
+    var count: usize = 0;
+    while (try it.next()) |entry| {
+        try std.testing.expect(!std.mem.startsWith(u8, entry.name, ".hola-link-"));
+        count += 1;
+    }
+    try std.testing.expectEqual(@as(usize, 50), count);
+
+    // A regular file in the way is an error, not overwritten
+    try tmp.dir.deleteFile("d2/l2");
+    try tmp.dir.writeFile(.{ .sub_path = "d2/l2", .data = "keep" });
+    try std.testing.expectError(error.NotLink, resource.apply());
+    try tmp.dir.deleteFile("d2/l2");
+
+    resource.action = .delete;
+    _ = try resource.apply();
+    try std.testing.expectError(error.FileNotFound, tmp.dir.readLink("d0/l0", &buf));
+}
@@ -3,8 +3,9 @@ end
 
 class LinkResource
   def initialize(path, &block)
-    @path = File.expand_path(path)
+    @path = path.to_s
     @target = ""
+    @links = {}
     @owner = ""
     @group = ""
     @action = "create"
@@ -15,17 +16,28 @@ class LinkResource
     @subscriptions = []
     instance_eval(&block) if block
 
+    # With `links` the name is only a label
+    @path = File.expand_path(@path) if @links.empty?
+    links_arg = @links.to_a
     only_if_arg = @only_if_proc || nil
     not_if_arg = @not_if_proc || nil
     notifications_arg = @notifications.map { |n| [n[:target], n[:action], n[:timing]] }
     subscriptions_arg = @subscriptions.map { |s| [s[:target], s[:action], s[:timing]] }
-    ZigBackend.add_link(@path, @target, @owner, @group, @action, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg)
+    ZigBackend.add_link(@path, @target, @owner, @group, @action, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg, links_arg)
   end
 
   def to(value)
     @target = File.expand_path(value.to_s)
   end
 
+  # Manage many links as one resource: links "~/.vimrc" => "~/dotfiles/vimrc", ...
+  # Replacements are swapped in atomically, one parent directory at a time.
+  def links(map)
+    map.each do |link_path, target|
+      @links[File.expand_path(link_path.to_s)] = File.expand_path(target.to_s)
+    end
+  end
+
   def owner(value)
     @owner = value.to_s
   end
@@ -203,6 +203,7 @@ pub const Resource = struct {
         var kill_proc = std.process.Child.init(&[_][]const u8{ "killall", "Finder" }, arena_allocator);
         kill_proc.stdout_behavior = .Ignore;
         kill_proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         _ = kill_proc.spawnAndWait() catch {};
 
         // Finder will automatically restart
@@ -218,6 +219,7 @@ pub const Resource = struct {
         var kill_proc = std.process.Child.init(&[_][]const u8{ "killall", "Dock" }, arena_allocator);
         kill_proc.stdout_behavior = .Ignore;
         kill_proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         _ = kill_proc.spawnAndWait() catch {};
 
         // Dock will automatically restart
@@ -233,6 +235,7 @@ pub const Resource = struct {
         var kill_proc = std.process.Child.init(&[_][]const u8{ "killall", "SystemUIServer" }, arena_allocator);
         kill_proc.stdout_behavior = .Ignore;
         kill_proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         _ = kill_proc.spawnAndWait() catch {};
 
         // SystemUIServer will automatically restart
@@ -321,6 +324,7 @@ pub const Resource = struct {
         var proc = std.process.Child.init(&[_][]const u8{ "/bin/sh", "-c", cmd }, arena_alloc);
         proc.stdout_behavior = .Pipe;
         proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         try proc.spawn();
         const stdout = try proc.stdout.?.readToEndAlloc(arena_alloc, 1024);
         const result = try proc.wait();
@@ -736,16 +740,13 @@ pub fn zigAddResource(
     _ = mruby.mrb_get_args(mrb, "SS|Aoo|oooAA", &domain_val, &key_val, &value_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
     // Extract domain and key
-    const domain_cstr = mruby.mrb_str_to_cstr(mrb, domain_val);
-    const domain = allocator.dupe(u8, std.mem.span(domain_cstr)) catch return mruby.mrb_nil_value();
+    const domain = allocator.dupe(u8, mruby.borrowStr(mrb, domain_val)) catch return mruby.mrb_nil_value();
 
-    const key_cstr = mruby.mrb_str_to_cstr(mrb, key_val);
-    const key = allocator.dupe(u8, std.mem.span(key_cstr)) catch return mruby.mrb_nil_value();
+    const key = allocator.dupe(u8, mruby.borrowStr(mrb, key_val)) catch return mruby.mrb_nil_value();
 
     // Parse action (optional, default write)
     const action: Resource.Action = if (mruby.mrb_test(action_val)) blk: {
-        const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-        const action_str = std.mem.span(action_cstr);
+        const action_str = mruby.borrowStr(mrb, action_val);
         if (std.mem.eql(u8, action_str, "delete")) {
             break :blk .delete;
         }
@@ -766,8 +767,7 @@ pub fn zigAddResource(
         const type_val = mruby.mrb_ary_ref(mrb, value_val, 0);
         const val_val = mruby.mrb_ary_ref(mrb, value_val, 1);
 
-        const type_cstr = mruby.mrb_str_to_cstr(mrb, type_val);
-        const type_str = std.mem.span(type_cstr);
+        const type_str = mruby.borrowStr(mrb, type_val);
 
         value = parseValueFromRuby(mrb, allocator, type_str, val_val) catch {
             allocator.free(domain);
@@ -859,8 +859,7 @@ fn parseValueFromRuby(mrb: *mruby.mrb_state, allocator: std.mem.Allocator, type_
                 try values.append(allocator, Resource.Value{ .integer = int_val });
             } else {
                 // String (default)
-                const item_cstr = mruby.mrb_str_to_cstr(mrb, item_val);
-                const item_str = std.mem.span(item_cstr);
+                const item_str = mruby.borrowStr(mrb, item_val);
                 try values.append(allocator, Resource.Value{ .string = try allocator.dupe(u8, item_str) });
             }
         }
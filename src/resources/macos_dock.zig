@@ -803,6 +803,7 @@ pub const Resource = struct {
         var proc = std.process.Child.init(&[_][]const u8{ "killall", "Dock" }, allocator);
         proc.stdout_behavior = .Ignore;
         proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         _ = try proc.spawnAndWait();
 
         // Wait a moment for Dock to restart
@@ -819,6 +820,7 @@ pub const Resource = struct {
         var proc = std.process.Child.init(&[_][]const u8{ "pgrep", "-x", "Dock" }, allocator);
         proc.stdout_behavior = .Pipe;
         proc.stderr_behavior = .Ignore;
+        base.noteSubprocess();
         try proc.spawn();
 
         const stdout = proc.stdout orelse {
@@ -840,6 +842,7 @@ pub const Resource = struct {
                 var kill_proc = std.process.Child.init(&[_][]const u8{ "kill", "-9", pid_str }, allocator);
                 kill_proc.stdout_behavior = .Ignore;
                 kill_proc.stderr_behavior = .Ignore;
+                base.noteSubprocess();
                 _ = kill_proc.spawnAndWait() catch {};
             }
         }
@@ -895,8 +898,7 @@ pub fn zigAddResource(
     const apps_len = mruby.mrb_ary_len(mrb, apps_val);
     for (0..@intCast(apps_len)) |i| {
         const app_val = mruby.mrb_ary_ref(mrb, apps_val, @intCast(i));
-        const app_cstr = mruby.mrb_str_to_cstr(mrb, app_val);
-        const app_path = allocator.dupe(u8, std.mem.span(app_cstr)) catch return mruby.mrb_nil_value();
+        const app_path = allocator.dupe(u8, mruby.borrowStr(mrb, app_val)) catch return mruby.mrb_nil_value();
         apps.append(allocator, app_path) catch return mruby.mrb_nil_value();
     }
 
@@ -908,8 +910,7 @@ pub fn zigAddResource(
 
     var orientation: ?[]const u8 = null;
     if (mruby.mrb_test(orientation_val)) {
-        const orient_cstr = mruby.mrb_str_to_cstr(mrb, orientation_val);
-        const orient_str = std.mem.span(orient_cstr);
+        const orient_str = mruby.borrowStr(mrb, orientation_val);
         if (orient_str.len > 0) {
             orientation = allocator.dupe(u8, orient_str) catch return mruby.mrb_nil_value();
         }
@@ -411,6 +411,7 @@ fn runCommand(allocator: std.mem.Allocator, argv: []const []const u8) ![]const u
     child.stdout_behavior = .Pipe;
     child.stderr_behavior = .Pipe;
 
+    base.noteSubprocess();
     try child.spawn();
 
     const stdout = try child.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
@@ -478,26 +479,19 @@ pub fn zigAddResource(
         &subscriptions_val,
     );
 
-    const mount_point_cstr = mruby.mrb_str_to_cstr(mrb, mount_point_val);
-    const mount_point_span = std.mem.span(mount_point_cstr);
+    const mount_point_span = mruby.borrowStr(mrb, mount_point_val);
 
-    const device_cstr = mruby.mrb_str_to_cstr(mrb, device_val);
-    const device_span = std.mem.span(device_cstr);
+    const device_span = mruby.borrowStr(mrb, device_val);
 
-    const device_type_cstr = mruby.mrb_str_to_cstr(mrb, device_type_val);
-    const device_type = Resource.deviceTypeFromString(std.mem.span(device_type_cstr));
+    const device_type = Resource.deviceTypeFromString(mruby.borrowStr(mrb, device_type_val));
 
-    const fstype_cstr = mruby.mrb_str_to_cstr(mrb, fstype_val);
-    const fstype_span = std.mem.span(fstype_cstr);
+    const fstype_span = mruby.borrowStr(mrb, fstype_val);
 
-    const options_cstr = mruby.mrb_str_to_cstr(mrb, options_val);
-    const options_span = std.mem.span(options_cstr);
+    const options_span = mruby.borrowStr(mrb, options_val);
 
-    const dump_cstr = mruby.mrb_str_to_cstr(mrb, dump_val);
-    const dump = std.fmt.parseInt(u8, std.mem.span(dump_cstr), 10) catch 0;
+    const dump = std.fmt.parseInt(u8, mruby.borrowStr(mrb, dump_val), 10) catch 0;
 
-    const pass_cstr = mruby.mrb_str_to_cstr(mrb, pass_val);
-    const pass_num = std.fmt.parseInt(u8, std.mem.span(pass_cstr), 10) catch 0;
+    const pass_num = std.fmt.parseInt(u8, mruby.borrowStr(mrb, pass_val), 10) catch 0;
 
     const supports_remount = mruby.mrb_test(supports_remount_val);
 
@@ -508,8 +502,7 @@ pub fn zigAddResource(
     var i: mruby.mrb_int = 0;
     while (i < actions_len) : (i += 1) {
         const action_val = mruby.mrb_ary_ref(mrb, actions_val, @intCast(i));
-        const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-        const action = Resource.actionFromString(std.mem.span(action_cstr));
+        const action = Resource.actionFromString(mruby.borrowStr(mrb, action_val));
 
         const mount_point = allocator.dupe(u8, mount_point_span) catch return mruby.mrb_nil_value();
         const device = allocator.dupe(u8, device_span) catch return mruby.mrb_nil_value();
@@ -110,8 +110,7 @@ pub fn zigAddResource(
     _ = mruby.mrb_get_args(mrb, "ASSS|SoooAA", &names_val, &version_val, &options_val, &action_val, &provider_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
     // Parse provider (optional, auto-detect if not specified)
-    const provider_cstr = mruby.mrb_str_to_cstr(mrb, provider_val);
-    const provider_str = std.mem.span(provider_cstr);
+    const provider_str = mruby.borrowStr(mrb, provider_val);
     const provider_type: common.ProviderType = if (provider_str.len > 0)
         common.ProviderType.fromString(provider_str) catch blk: {
             logger.warn("Invalid provider '{s}', using platform default", .{provider_str});
@@ -135,11 +134,11 @@ pub fn zigAddResource(
 
     // Parse names array
     var names = std.ArrayList([]const u8).empty;
-    const names_len = mruby.mrb_ary_len(mrb, names_val);
-    for (0..@intCast(names_len)) |i| {
-        const name_val = mruby.mrb_ary_ref(mrb, names_val, @intCast(i));
-        const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-        const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch {
+    const name_views = mruby.aryStrViews(allocator, mrb, names_val) catch return mruby.mrb_nil_value();
+    defer allocator.free(name_views);
+    names.ensureTotalCapacity(allocator, name_views.len) catch return mruby.mrb_nil_value();
+    for (name_views) |name_view| {
+        const name = allocator.dupe(u8, name_view.slice()) catch {
             // Clean up previously allocated names
             for (names.items) |n| allocator.free(n);
             names.deinit(allocator);
@@ -154,11 +153,7 @@ pub fn zigAddResource(
         };
     }
 
-    const version_cstr = mruby.mrb_str_to_cstr(mrb, version_val);
-    const options_cstr = mruby.mrb_str_to_cstr(mrb, options_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-
-    const version_str = std.mem.span(version_cstr);
+    const version_str = mruby.borrowStr(mrb, version_val);
     const version: ?[]const u8 = if (version_str.len > 0)
         allocator.dupe(u8, version_str) catch {
             for (names.items) |n| allocator.free(n);
@@ -168,7 +163,7 @@ pub fn zigAddResource(
     else
         null;
 
-    const options_str = std.mem.span(options_cstr);
+    const options_str = mruby.borrowStr(mrb, options_val);
     const options: ?[]const u8 = if (options_str.len > 0)
         allocator.dupe(u8, options_str) catch {
             for (names.items) |n| allocator.free(n);
@@ -179,7 +174,7 @@ pub fn zigAddResource(
     else
         null;
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action = common.Action.fromString(action_str) catch .install;
 
     // Build common properties (guards + notifications)
@@ -158,11 +158,11 @@ pub fn parsePackageArgs(
 
     // Parse names array
     var names = std.ArrayList([]const u8).empty;
-    const names_len = mruby.mrb_ary_len(mrb, names_val);
-    for (0..@intCast(names_len)) |i| {
-        const name_val = mruby.mrb_ary_ref(mrb, names_val, @intCast(i));
-        const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-        const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch {
+    const name_views = mruby.aryStrViews(allocator, mrb, names_val) catch return null;
+    defer allocator.free(name_views);
+    names.ensureTotalCapacity(allocator, name_views.len) catch return null;
+    for (name_views) |name_view| {
+        const name = allocator.dupe(u8, name_view.slice()) catch {
             // Clean up previously allocated names
             for (names.items) |n| allocator.free(n);
             names.deinit(allocator);
@@ -177,11 +177,7 @@ pub fn parsePackageArgs(
         };
     }
 
-    const version_cstr = mruby.mrb_str_to_cstr(mrb, version_val);
-    const options_cstr = mruby.mrb_str_to_cstr(mrb, options_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-
-    const version_str = std.mem.span(version_cstr);
+    const version_str = mruby.borrowStr(mrb, version_val);
     const version: ?[]const u8 = if (version_str.len > 0)
         allocator.dupe(u8, version_str) catch {
             for (names.items) |n| allocator.free(n);
@@ -191,7 +187,7 @@ pub fn parsePackageArgs(
     else
         null;
 
-    const options_str = std.mem.span(options_cstr);
+    const options_str = mruby.borrowStr(mrb, options_val);
     const options: ?[]const u8 = if (options_str.len > 0)
         allocator.dupe(u8, options_str) catch {
             for (names.items) |n| allocator.free(n);
@@ -202,7 +198,7 @@ pub fn parsePackageArgs(
     else
         null;
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action = Action.fromString(action_str) catch .install;
 
     // Build common properties (guards + notifications)
@@ -2,6 +2,8 @@ const std = @import("std");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const http = @import("../http.zig");
+const hashing = @import("../hashing.zig");
+const xattr_fingerprint = @import("../xattr_fingerprint.zig");
 const logger = @import("../logger.zig");
 const json_helpers = @import("../json.zig");
 const xdg_mod = @import("../xdg.zig");
@@ -40,7 +42,7 @@ pub const Resource = struct {
     path: []const u8, // Local file path where to save the file
     source: []const u8, // URL to download from
     attrs: base.FileAttributes, // File attributes (mode, owner, group)
-    checksum: ?[]const u8 = null, // Expected checksum (SHA256, MD5, etc.)
+    checksum: ?[]const u8 = null, // Expected checksum: "sha256:<hex>", "blake3:<hex>" or bare SHA256 hex
     backup: ?[]const u8 = null, // Backup extension before overwriting
     headers: ?[]const u8 = null, // JSON-encoded HTTP headers
     use_etag: bool = true, // Whether to use ETag for conditional downloads (Chef default: true)
@@ -168,9 +170,7 @@ pub const Resource = struct {
         defer _ = gpa.deinit();
         const allocator = gpa.allocator();
 
-        if (std.fs.path.dirname(self.path)) |dir| {
-            try std.fs.cwd().makePath(dir);
-        }
+        try base.ensureParentDir(self.path);
 
         const local_exists = blk: {
             std.fs.cwd().access(self.path, .{}) catch |err| switch (err) {
@@ -180,6 +180,12 @@ pub const Resource = struct {
             break :blk true;
         };
 
+        // A pinned checksum identifies the content; skip the download when the
+        // local copy already has it
+        if (local_exists and self.localMatchesChecksum()) {
+            return false;
+        }
+
         var previous_etag: ?[]const u8 = null;
         if (self.use_etag and local_exists) {
             previous_etag = self.loadSavedEtag(allocator) catch null;
@@ -300,14 +306,7 @@ pub const Resource = struct {
             };
 
             // Verify checksum if provided
-            if (self.checksum) |expected_checksum| {
-                const actual_checksum = try http.calculateSha256(allocator, self.path);
-                defer allocator.free(actual_checksum);
-                if (!std.mem.eql(u8, actual_checksum, expected_checksum)) {
-                    self.recordChecksumMismatch(expected_checksum, actual_checksum);
-                    return error.ChecksumMismatch;
-                }
-            }
+            try self.verifyChecksum(self.path);
 
             if (self.use_etag) {
                 if (downloaded_etag) |etag| {
@@ -321,6 +320,7 @@ pub const Resource = struct {
                 }
             }
         }
+        self.recordFingerprint();
         return true; // File was downloaded/updated
     }
 
@@ -383,9 +383,7 @@ pub const Resource = struct {
     }
 
     fn applyTouch(self: Resource) !void {
-        if (std.fs.path.dirname(self.path)) |dir| {
-            try std.fs.cwd().makePath(dir);
-        }
+        try base.ensureParentDir(self.path);
 
         const is_abs = std.fs.path.isAbsolute(self.path);
         const file = if (is_abs)
@@ -464,15 +462,10 @@ pub const Resource = struct {
         }
 
         // Verify checksum before touching destination
-        if (self.checksum) |expected_checksum| {
-            const actual_checksum = try http.calculateSha256(allocator, temp_path);
-            defer allocator.free(actual_checksum);
-            if (!std.mem.eql(u8, actual_checksum, expected_checksum)) {
-                std.fs.cwd().deleteFile(temp_path) catch {};
-                self.recordChecksumMismatch(expected_checksum, actual_checksum);
-                return error.ChecksumMismatch;
-            }
-        }
+        self.verifyChecksum(temp_path) catch |err| {
+            std.fs.cwd().deleteFile(temp_path) catch {};
+            return err;
+        };
 
         // Create backup if specified
         if (self.backup) |backup_ext| {
@@ -523,9 +516,7 @@ pub const Resource = struct {
         const etag_path = try self.getEtagPath(allocator);
         defer allocator.free(etag_path);
 
-        if (std.fs.path.dirname(etag_path)) |dir| {
-            try std.fs.cwd().makePath(dir);
-        }
+        try base.ensureParentDir(etag_path);
 
         const file = try std.fs.cwd().createFile(etag_path, .{ .truncate = true });
         defer file.close();
@@ -565,9 +556,7 @@ pub const Resource = struct {
         const lm_path = try self.getLastModifiedPath(allocator);
         defer allocator.free(lm_path);
 
-        if (std.fs.path.dirname(lm_path)) |dir| {
-            try std.fs.cwd().makePath(dir);
-        }
+        try base.ensureParentDir(lm_path);
 
         const file = try std.fs.cwd().createFile(lm_path, .{ .truncate = true });
         defer file.close();
@@ -631,10 +620,42 @@ pub const Resource = struct {
         return fallbackRemoteFileFailure(buf, self.path, operation, err);
     }
 
-    fn recordChecksumMismatch(self: Resource, expected: []const u8, actual: []const u8) void {
+    /// Check `path` against the checksum property, if set
+    fn verifyChecksum(self: Resource, path: []const u8) !void {
+        const expected_checksum = self.checksum orelse return;
+        const checksum = hashing.Checksum.parse(expected_checksum) catch |err| {
+            base.recordProvisionErrorDetail("remote_file[{s}] invalid checksum: {s}", .{ self.path, expected_checksum });
+            return err;
+        };
+        if (try hashing.verifyFile(path, checksum)) |actual| {
+            self.recordChecksumMismatch(checksum.algorithm, expected_checksum, &hashing.toHex(actual));
+            return error.ChecksumMismatch;
+        }
+    }
+
+    /// Whether the local file already has the expected checksum, in which case
+    /// there is nothing to download
+    fn localMatchesChecksum(self: Resource) bool {
+        const checksum = hashing.Checksum.parse(self.checksum orelse return false) catch return false;
+        const actual = hashing.verifyFile(self.path, checksum) catch return false;
+        return actual == null;
+    }
+
+    /// Record the verified checksum on the file, so change detection that
+    /// hashes it later (an extract archive check) can skip the content.
+    /// Checksum verification never trusts this record.
+    fn recordFingerprint(self: Resource) void {
+        const checksum = hashing.Checksum.parse(self.checksum orelse return) catch return;
+        xattr_fingerprint.storePath(self.path, .{
+            .kind = hashing.fingerprintKind(checksum.algorithm),
+            .digest = checksum.digest,
+        });
+    }
+
+    fn recordChecksumMismatch(self: Resource, algorithm: hashing.Algorithm, expected: []const u8, actual: []const u8) void {
         base.recordProvisionErrorDetail(
-            "remote_file[{s}] checksum mismatch: expected SHA256 {s}, got {s}",
-            .{ self.path, expected, actual },
+            "remote_file[{s}] checksum mismatch: expected {s} {s}, got {s}",
+            .{ self.path, hashing.algorithmLabel(algorithm), expected, actual },
         );
     }
 };
@@ -700,45 +721,36 @@ pub fn zigAddResource(
     // Get 7 strings + 1 object (hash) + 3 bools + 1 string + 3 optional (2 blocks + 1 bool + 2 arrays) + 10 auth objects (can be nil)
     _ = mruby.mrb_get_args(mrb, "SSSSSSSobbbS|oooAAoooooooooo", &path_val, &source_val, &mode_val, &owner_val, &group_val, &checksum_val, &backup_val, &headers_val, &use_etag_val, &use_last_modified_val, &force_unlink_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val, &remote_user_val, &remote_password_val, &remote_domain_val, &ssh_private_key_val, &ssh_public_key_val, &ssh_known_hosts_val, &aws_access_key_id_val, &aws_secret_access_key_val, &aws_region_val, &aws_endpoint_val);
 
-    const path_cstr = mruby.mrb_str_to_cstr(mrb, path_val);
-    const source_cstr = mruby.mrb_str_to_cstr(mrb, source_val);
-    const mode_cstr = mruby.mrb_str_to_cstr(mrb, mode_val);
-    const owner_cstr = mruby.mrb_str_to_cstr(mrb, owner_val);
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-    const checksum_cstr = mruby.mrb_str_to_cstr(mrb, checksum_val);
-    const backup_cstr = mruby.mrb_str_to_cstr(mrb, backup_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-
-    const path = allocator.dupe(u8, std.mem.span(path_cstr)) catch return mruby.mrb_nil_value();
-    const source = allocator.dupe(u8, std.mem.span(source_cstr)) catch return mruby.mrb_nil_value();
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
+    const source = allocator.dupe(u8, mruby.borrowStr(mrb, source_val)) catch return mruby.mrb_nil_value();
 
     // Parse mode as u32 (octal)
-    const mode_str = std.mem.span(mode_cstr);
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
     // Parse owner and group
-    const owner_str = std.mem.span(owner_cstr);
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const checksum_str = std.mem.span(checksum_cstr);
+    const checksum_str = mruby.borrowStr(mrb, checksum_val);
     const checksum: ?[]const u8 = if (checksum_str.len > 0)
         allocator.dupe(u8, checksum_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const backup_str = std.mem.span(backup_cstr);
+    const backup_str = mruby.borrowStr(mrb, backup_val);
     const backup: ?[]const u8 = if (backup_str.len > 0)
         allocator.dupe(u8, backup_str) catch return mruby.mrb_nil_value()
     else
@@ -750,52 +762,52 @@ pub fn zigAddResource(
 
     // Parse authentication parameters
     const remote_user = if (zig_mrb_nil_p(remote_user_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, remote_user_val));
+        const str = mruby.borrowStr(mrb, remote_user_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const remote_password = if (zig_mrb_nil_p(remote_password_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, remote_password_val));
+        const str = mruby.borrowStr(mrb, remote_password_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const remote_domain = if (zig_mrb_nil_p(remote_domain_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, remote_domain_val));
+        const str = mruby.borrowStr(mrb, remote_domain_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const ssh_private_key = if (zig_mrb_nil_p(ssh_private_key_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, ssh_private_key_val));
+        const str = mruby.borrowStr(mrb, ssh_private_key_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const ssh_public_key = if (zig_mrb_nil_p(ssh_public_key_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, ssh_public_key_val));
+        const str = mruby.borrowStr(mrb, ssh_public_key_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const ssh_known_hosts = if (zig_mrb_nil_p(ssh_known_hosts_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, ssh_known_hosts_val));
+        const str = mruby.borrowStr(mrb, ssh_known_hosts_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const aws_access_key_id = if (zig_mrb_nil_p(aws_access_key_id_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, aws_access_key_id_val));
+        const str = mruby.borrowStr(mrb, aws_access_key_id_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const aws_secret_access_key = if (zig_mrb_nil_p(aws_secret_access_key_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, aws_secret_access_key_val));
+        const str = mruby.borrowStr(mrb, aws_secret_access_key_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const aws_region = if (zig_mrb_nil_p(aws_region_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, aws_region_val));
+        const str = mruby.borrowStr(mrb, aws_region_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
     const aws_endpoint = if (zig_mrb_nil_p(aws_endpoint_val) != 0) null else blk: {
-        const str = std.mem.span(mruby.mrb_str_to_cstr(mrb, aws_endpoint_val));
+        const str = mruby.borrowStr(mrb, aws_endpoint_val);
         break :blk if (str.len > 0) allocator.dupe(u8, str) catch return mruby.mrb_nil_value() else null;
     };
 
@@ -812,7 +824,7 @@ pub fn zigAddResource(
         break :blk json_str;
     };
 
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "create_if_missing"))
         .create_if_missing
     else if (std.mem.eql(u8, action_str, "delete"))
@@ -2,6 +2,7 @@ const std = @import("std");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const logger = @import("../logger.zig");
+const rtnetlink = @import("../rtnetlink.zig");
 const builtin = @import("builtin");
 
 pub const Resource = struct {
@@ -9,14 +10,23 @@ pub const Resource = struct {
     gateway: ?[]const u8,
     netmask: ?[]const u8,
     device: ?[]const u8,
+    metric: ?u32 = null, // Route priority (Linux only)
     action: Action,
     common: base.CommonProps,
+    // Outcome filled in when the route was programmed as part of a Batch
+    batch_result: ?BatchResult = null,
 
     pub const Action = enum {
         add,
         delete,
     };
 
+    pub const BatchResult = union(enum) {
+        up_to_date,
+        updated,
+        kernel_error: std.posix.E,
+    };
+
     pub fn deinit(self: Resource, allocator: std.mem.Allocator) void {
         allocator.free(self.target);
         if (self.gateway) |g| allocator.free(g);
@@ -51,6 +61,55 @@ pub const Resource = struct {
     }
 };
 
+/// Collects a run of consecutive guard-free route resources so that, on
+/// Linux, they are diffed against one dump of the main table when the first
+/// route of the run is reached, and only the routes that differ are sent.
+/// Anything declared between two routes (a guarded route included) ends the
+/// run, so routes never get ahead of the resources before them, and the run
+/// stops at its first failing route so none get ahead of a failure either.
+pub const Batch = struct {
+    allocator: std.mem.Allocator,
+    members: std.ArrayList(*Resource),
+
+    pub fn init(allocator: std.mem.Allocator) Batch {
+        return .{
+            .allocator = allocator,
+            .members = std.ArrayList(*Resource).empty,
+        };
+    }
+
+    pub fn deinit(self: *Batch) void {
+        self.members.deinit(self.allocator);
+    }
+
+    /// Whether `res` can join a run; guarded routes apply on their own
+    pub fn accepts(res: *const Resource) bool {
+        return !res.common.hasGuards();
+    }
+
+    pub fn add(self: *Batch, res: *Resource) !void {
+        std.debug.assert(accepts(res));
+        try self.members.append(self.allocator, res);
+    }
+
+    /// Program the collected run and start a new one. Members left without
+    /// a result (after a failing route, or all of them when the exchange
+    /// itself fails) fall back to the per-resource path.
+    /// Each member's batch_result is consumed by its next apply; the runner
+    /// clears it afterwards so re-applies program the route again.
+    pub fn commit(self: *Batch) void {
+        defer self.members.clearRetainingCapacity();
+
+        if (builtin.os.tag == .linux) {
+            if (self.members.items.len == 0) return;
+            linux_impl.programRoutes(self.allocator, self.members.items, .lenient) catch |err| {
+                logger.warn("Batched route programming failed ({s}), applying routes individually", .{@errorName(err)});
+                for (self.members.items) |res| res.batch_result = null;
+            };
+        }
+    }
+};
+
 // Helper to parse IPv4 string to u32 (host byte order)
 // Automatically strips CIDR suffix if present
 fn parseIp(ip: []const u8) !u32 {
@@ -73,6 +132,54 @@ fn parseNetmask(cidr_or_mask: []const u8) !u32 {
     }
 }
 
+const Address = struct {
+    family: rtnetlink.Family,
+    addr: [16]u8,
+};
+
+const Prefix = struct {
+    family: rtnetlink.Family,
+    addr: [16]u8,
+    len: u8,
+};
+
+// Helper to parse an IPv4 or IPv6 address into network byte order
+fn parseAddress(text: []const u8) !Address {
+    var addr = [_]u8{0} ** 16;
+    if (std.mem.indexOfScalar(u8, text, ':') != null) {
+        const parsed = try std.net.Address.parseIp6(text, 0);
+        addr = parsed.in6.sa.addr;
+        return .{ .family = .ipv6, .addr = addr };
+    }
+    const parsed = try std.net.Address.parseIp4(text, 0);
+    @memcpy(addr[0..4], std.mem.asBytes(&parsed.in.sa.addr));
+    return .{ .family = .ipv4, .addr = addr };
+}
+
+// Helper to parse a target ("addr" or "addr/len") and optional netmask
+// (IPv4 dotted quad or prefix length) into a prefix with host bits cleared
+fn parsePrefix(target: []const u8, netmask: ?[]const u8) !Prefix {
+    const slash = std.mem.indexOfScalar(u8, target, '/');
+    const address = try parseAddress(if (slash) |idx| target[0..idx] else target);
+    const max_len = address.family.maxPrefix();
+
+    var len: u8 = max_len;
+    if (netmask) |nm| {
+        if (address.family == .ipv4 and std.mem.indexOfScalar(u8, nm, '.') != null) {
+            len = @popCount(try parseNetmask(nm));
+        } else {
+            len = try std.fmt.parseInt(u8, nm, 10);
+        }
+    } else if (slash) |idx| {
+        len = try std.fmt.parseInt(u8, target[idx + 1 ..], 10);
+    }
+    if (len > max_len) return error.InvalidPrefix;
+
+    var addr = address.addr;
+    rtnetlink.maskAddress(&addr, address.family, len);
+    return .{ .family = address.family, .addr = addr, .len = len };
+}
+
 const macos_impl = if (builtin.os.tag == .macos) struct {
     const c = @cImport({
         @cInclude("sys/socket.h");
@@ -298,160 +405,147 @@ const macos_impl = if (builtin.os.tag == .macos) struct {
 };
 
 const linux_impl = if (builtin.os.tag == .linux) struct {
-    const c = @cImport({
-        @cInclude("sys/socket.h");
-        @cInclude("netinet/in.h");
-        @cInclude("net/if.h");
-        @cInclude("net/route.h");
-        @cInclude("sys/ioctl.h");
-        @cInclude("arpa/inet.h");
-        @cInclude("unistd.h");
-    });
+    extern "c" fn if_nametoindex(name: [*:0]const u8) c_uint;
+
+    const Mode = enum {
+        // Propagate invalid declarations (single resource path)
+        strict,
+        // Skip invalid declarations; their own apply() reports the error
+        lenient,
+    };
 
     pub fn apply(self: Resource) !base.ApplyResult {
+        if (self.batch_result != null) return finish(self);
+
+        var single = self;
+        var members = [_]*Resource{&single};
+        try programRoutes(std.heap.c_allocator, &members, .strict);
+        return finish(single);
+    }
+
+    fn finish(self: Resource) !base.ApplyResult {
         const action_name = @tagName(self.action);
-        switch (self.action) {
-            .add => {
-                const updated = try applyAdd(self);
-                return base.ApplyResult{
-                    .was_updated = updated,
-                    .action = action_name,
-                    .skip_reason = if (!updated) "up to date" else null,
-                };
+        const outcome = self.batch_result orelse return error.RouteNotProgrammed;
+        switch (outcome) {
+            .up_to_date => return base.ApplyResult{
+                .was_updated = false,
+                .action = action_name,
+                .skip_reason = "up to date",
             },
-            .delete => {
-                const updated = try applyDelete(self);
-                return base.ApplyResult{
-                    .was_updated = updated,
-                    .action = action_name,
-                    .skip_reason = if (!updated) "up to date" else null,
+            .updated => return base.ApplyResult{
+                .was_updated = true,
+                .action = action_name,
+            },
+            .kernel_error => |err| {
+                logKernelError(self, err);
+                return switch (self.action) {
+                    .add => error.RouteAddFailed,
+                    .delete => error.RouteDeleteFailed,
                 };
             },
         }
     }
 
-    fn applyAdd(self: Resource) !bool {
-        const sockfd = c.socket(c.AF_INET, c.SOCK_DGRAM, 0);
-        if (sockfd < 0) return error.SocketFailed;
-        defer _ = c.close(sockfd);
+    /// Dump the main table once, then diff and program the members in
+    /// declaration order (see `programAgainst`).
+    pub fn programRoutes(allocator: std.mem.Allocator, members: []const *Resource, mode: Mode) !void {
+        var sock = try rtnetlink.Socket.open();
+        defer sock.close();
 
-        var rt: c.struct_rtentry = undefined;
-        @memset(@as([*]u8, @ptrCast(&rt))[0..@sizeOf(c.struct_rtentry)], 0);
+        var table = try sock.dumpRoutes(allocator);
+        defer table.deinit(allocator);
 
-        var dst_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_dst));
-        dst_sin.sin_family = c.AF_INET;
-        dst_sin.sin_addr.s_addr = try parseIp(self.target);
-
-        if (self.gateway) |gw| {
-            var gw_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_gateway));
-            gw_sin.sin_family = c.AF_INET;
-            gw_sin.sin_addr.s_addr = try parseIp(gw);
-            rt.rt_flags |= c.RTF_GATEWAY;
-        }
-
-        if (self.netmask) |nm| {
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = try parseNetmask(nm);
-        } else if (std.mem.indexOf(u8, self.target, "/")) |idx| {
-            const cidr = self.target[idx + 1 ..];
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = try parseNetmask(cidr);
-        } else {
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = 0xFFFFFFFF;
-        }
-
-        rt.rt_flags |= c.RTF_UP;
-
-        if (c.ioctl(sockfd, c.SIOCADDRT, &rt) < 0) {
-            const err = std.posix.errno(-1);
-            if (err == .EXIST) {
-                return false; // Route already exists
-            }
+        try programAgainst(allocator, &table, members, mode, &sock);
+    }
 
-            // Log detailed error information
-            logger.err("Route add failed for {s}: errno={d} ({s})", .{
-                self.target,
-                @intFromEnum(err),
-                @tagName(err),
-            });
+    /// Diff each member against `table` and send its change through
+    /// `kernel` before looking at the next one. Each member's batch_result
+    /// records whether it was already converged, changed, or rejected. The
+    /// run stops at its first failure: members after it keep no result and
+    /// apply on their own once the failing route has been reported, exactly
+    /// as they would without batching.
+    fn programAgainst(allocator: std.mem.Allocator, table: *std.ArrayList(rtnetlink.Route), members: []const *Resource, mode: Mode, kernel: anytype) !void {
+        for (members) |res| {
+            const declared = declaredRoute(res.*) catch |err| switch (mode) {
+                .strict => return err,
+                .lenient => return,
+            };
 
-            if (err == .ACCES or err == .PERM) {
-                logger.err("Permission denied. Root/sudo access required to modify routing table.", .{});
-            } else if (err == .INVAL) {
-                logger.err("Invalid argument. Check target={s}, gateway={s}, netmask={s}, device={s}", .{
-                    self.target,
-                    self.gateway orelse "none",
-                    self.netmask orelse "none",
-                    self.device orelse "none",
-                });
-            } else if (err == .NETUNREACH) {
-                logger.err("Network is unreachable. Gateway or device may be invalid.", .{});
-            }
+            const change = switch (res.action) {
+                .add => try rtnetlink.planAdd(allocator, table, declared),
+                .delete => rtnetlink.planDelete(table, declared, res.metric != null),
+            } orelse {
+                res.batch_result = Resource.BatchResult.up_to_date;
+                continue;
+            };
 
-            return error.RouteAddFailed;
+            const status = try kernel.applyChange(allocator, change);
+            const failed = Resource.BatchResult{ .kernel_error = status };
+            const result: Resource.BatchResult = switch (status) {
+                .SUCCESS => .updated,
+                // Raced with another writer; the route is in the desired state
+                .EXIST => if (res.action == .add) .up_to_date else failed,
+                .SRCH => if (res.action == .delete) .up_to_date else failed,
+                else => failed,
+            };
+            res.batch_result = result;
+            if (result == .kernel_error) return;
         }
-
-        return true;
     }
 
-    fn applyDelete(self: Resource) !bool {
-        const sockfd = c.socket(c.AF_INET, c.SOCK_DGRAM, 0);
-        if (sockfd < 0) return error.SocketFailed;
-        defer _ = c.close(sockfd);
+    /// Translate the resource attributes into the route the kernel would hold.
+    fn declaredRoute(self: Resource) !rtnetlink.Route {
+        const prefix = try parsePrefix(self.target, self.netmask);
 
-        var rt: c.struct_rtentry = undefined;
-        @memset(@as([*]u8, @ptrCast(&rt))[0..@sizeOf(c.struct_rtentry)], 0);
+        var route = rtnetlink.Route{
+            .family = prefix.family,
+            .dst = prefix.addr,
+            .dst_len = prefix.len,
+            .metric = self.metric orelse prefix.family.defaultMetric(),
+        };
 
-        var dst_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_dst));
-        dst_sin.sin_family = c.AF_INET;
-        dst_sin.sin_addr.s_addr = try parseIp(self.target);
-
-        // Need correct netmask to match for delete
-        if (self.netmask) |nm| {
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = try parseNetmask(nm);
-        } else if (std.mem.indexOf(u8, self.target, "/")) |idx| {
-            const cidr = self.target[idx + 1 ..];
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = try parseNetmask(cidr);
-        } else {
-            var mask_sin = @as(*c.struct_sockaddr_in, @ptrCast(&rt.rt_genmask));
-            mask_sin.sin_family = c.AF_INET;
-            mask_sin.sin_addr.s_addr = 0xFFFFFFFF;
+        if (self.gateway) |gw| {
+            const gw_addr = try parseAddress(gw);
+            if (gw_addr.family != prefix.family) {
+                logger.err("Route {s}: gateway {s} is not the same address family as the target", .{ self.target, gw });
+                return error.InvalidGateway;
+            }
+            route.gateway = gw_addr.addr;
         }
 
-        if (c.ioctl(sockfd, c.SIOCDELRT, &rt) < 0) {
-            const err = std.posix.errno(-1);
-            if (err == .SRCH) {
-                return false; // Route not found
+        if (self.device) |dev| {
+            const dev_z = try std.posix.toPosixPath(dev);
+            const index = if_nametoindex(&dev_z);
+            if (index == 0) {
+                logger.err("Route {s}: device {s} not found", .{ self.target, dev });
+                return error.DeviceNotFound;
             }
+            route.oif = index;
+        }
 
-            // Log detailed error information
-            logger.err("Route delete failed for {s}: errno={d} ({s})", .{
+        return route;
+    }
+
+    fn logKernelError(self: Resource, err: std.posix.E) void {
+        logger.err("Route {s} failed for {s}: errno={d} ({s})", .{
+            @tagName(self.action),
+            self.target,
+            @intFromEnum(err),
+            @tagName(err),
+        });
+
+        if (err == .ACCES or err == .PERM) {
+            logger.err("Permission denied. Root/sudo access required to modify routing table.", .{});
+        } else if (err == .INVAL) {
+            logger.err("Invalid argument. Check target={s}, gateway={s}, netmask={s}, device={s}", .{
                 self.target,
-                @intFromEnum(err),
-                @tagName(err),
+                self.gateway orelse "none",
+                self.netmask orelse "none",
+                self.device orelse "none",
             });
-
-            if (err == .ACCES or err == .PERM) {
-                logger.err("Permission denied. Root/sudo access required to modify routing table.", .{});
-            } else if (err == .INVAL) {
-                logger.err("Invalid argument. Check target={s}, netmask={s}", .{
-                    self.target,
-                    self.netmask orelse "none",
-                });
-            }
-
-            return error.RouteDeleteFailed;
+        } else if (err == .NETUNREACH) {
+            logger.err("Network is unreachable. Gateway or device may be invalid.", .{});
         }
-
-        return true;
     }
 } else struct {
     pub fn apply(_: Resource) !base.ApplyResult {
@@ -473,6 +567,7 @@ pub fn zigAddResource(
     var gateway_val: mruby.mrb_value = undefined;
     var netmask_val: mruby.mrb_value = undefined;
     var device_val: mruby.mrb_value = undefined;
+    var metric_val: mruby.mrb_value = undefined;
     var action_val: mruby.mrb_value = undefined;
     var only_if_val: mruby.mrb_value = undefined;
     var not_if_val: mruby.mrb_value = undefined;
@@ -480,26 +575,27 @@ pub fn zigAddResource(
     var notifications_val: mruby.mrb_value = undefined;
     var subscriptions_val: mruby.mrb_value = undefined;
 
-    // add_route(target, gateway, netmask, device, action, only_if, not_if, ignore_failure, notifications, subscriptions)
-    _ = mruby.mrb_get_args(mrb, "SSSSS|oooAA", &target_val, &gateway_val, &netmask_val, &device_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
+    // add_route(target, gateway, netmask, device, metric, action, only_if, not_if, ignore_failure, notifications, subscriptions)
+    _ = mruby.mrb_get_args(mrb, "SSSSSS|oooAA", &target_val, &gateway_val, &netmask_val, &device_val, &metric_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
+
+    const metric_str = mruby.borrowStr(mrb, metric_val);
+    const metric: ?u32 = if (metric_str.len > 0) std.fmt.parseInt(u32, metric_str, 10) catch {
+        logger.err("route {s}: invalid metric '{s}'", .{ mruby.borrowStr(mrb, target_val), metric_str });
+        return mruby.mrb_nil_value();
+    } else null;
 
-    const target_cstr = mruby.mrb_str_to_cstr(mrb, target_val);
-    const target = allocator.dupe(u8, std.mem.span(target_cstr)) catch return mruby.mrb_nil_value();
+    const target = allocator.dupe(u8, mruby.borrowStr(mrb, target_val)) catch return mruby.mrb_nil_value();
 
-    const gateway_cstr = mruby.mrb_str_to_cstr(mrb, gateway_val);
-    const gateway_str = std.mem.span(gateway_cstr);
+    const gateway_str = mruby.borrowStr(mrb, gateway_val);
     const gateway: ?[]const u8 = if (gateway_str.len > 0) allocator.dupe(u8, gateway_str) catch return mruby.mrb_nil_value() else null;
 
-    const netmask_cstr = mruby.mrb_str_to_cstr(mrb, netmask_val);
-    const netmask_str = std.mem.span(netmask_cstr);
+    const netmask_str = mruby.borrowStr(mrb, netmask_val);
     const netmask: ?[]const u8 = if (netmask_str.len > 0) allocator.dupe(u8, netmask_str) catch return mruby.mrb_nil_value() else null;
 
-    const device_cstr = mruby.mrb_str_to_cstr(mrb, device_val);
-    const device_str = std.mem.span(device_cstr);
+    const device_str = mruby.borrowStr(mrb, device_val);
     const device: ?[]const u8 = if (device_str.len > 0) allocator.dupe(u8, device_str) catch return mruby.mrb_nil_value() else null;
 
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "delete")) .delete else .add;
 
     var common = base.CommonProps.init(allocator);
@@ -510,9 +606,70 @@ pub fn zigAddResource(
         .gateway = gateway,
         .netmask = netmask,
         .device = device,
+        .metric = metric,
         .action = action,
         .common = common,
     }) catch return mruby.mrb_nil_value();
 
     return mruby.mrb_nil_value();
 }
+
+test "parsePrefix handles CIDR, netmask and IPv6" {
+    const testing = std.testing;
+
+    const host = try parsePrefix("10.1.2.3", null);
+    try testing.expectEqual(rtnetlink.Family.ipv4, host.family);
+    try testing.expectEqual(@as(u8, 32), host.len);
+
+    const cidr = try parsePrefix("10.1.2.3/8", null);
+    try testing.expectEqual(@as(u8, 8), cidr.len);
+    try testing.expectEqualSlices(u8, &[_]u8{ 10, 0, 0, 0 }, cidr.addr[0..4]);
+
+    const masked = try parsePrefix("172.16.0.0", "255.255.0.0");
+    try testing.expectEqual(@as(u8, 16), masked.len);
+
+    const v6 = try parsePrefix("2001:db8::/32", null);
+    try testing.expectEqual(rtnetlink.Family.ipv6, v6.family);
+    try testing.expectEqual(@as(u8, 32), v6.len);
+
+    try testing.expectError(error.InvalidPrefix, parsePrefix("10.0.0.0/33", null));
+}
+
+test "a failing route stops the rest of its batch" {
+    if (builtin.os.tag == .linux) {
+        const testing = std.testing;
+        const allocator = testing.allocator;
+
+        // Fails the second change it is asked to send
+        const Kernel = struct {
+            sent: usize = 0,
+
+            fn applyChange(self: *@This(), _: std.mem.Allocator, _: rtnetlink.Change) !std.posix.E {
+                defer self.sent += 1;
+                return if (self.sent == 1) .NETUNREACH else .SUCCESS;
+            }
+        };
+
+        var routes: [4]Resource = undefined;
+        const targets = [_][]const u8{ "10.1.0.0/16", "10.2.0.0/16", "10.3.0.0/16", "10.4.0.0/16" };
+        for (&routes, targets) |*route, target| {
+            route.* = .{ .target = target, .gateway = null, .netmask = null, .device = null, .action = .add, .common = base.CommonProps.init(allocator) };
+        }
+        var members: [4]*Resource = undefined;
+        for (&members, &routes) |*member, *route| member.* = route;
+
+        // 10.1/16 is already installed; 10.2/16 is accepted, 10.3/16 rejected
+        var table = std.ArrayList(rtnetlink.Route).empty;
+        defer table.deinit(allocator);
+        try testing.expect(try rtnetlink.planAdd(allocator, &table, try linux_impl.declaredRoute(routes[0])) != null);
+
+        var kernel = Kernel{};
+        try linux_impl.programAgainst(allocator, &table, &members, .lenient, &kernel);
+
+        try testing.expectEqual(@as(usize, 2), kernel.sent);
+        try testing.expectEqual(Resource.BatchResult.up_to_date, routes[0].batch_result.?);
+        try testing.expectEqual(Resource.BatchResult.updated, routes[1].batch_result.?);
+        try testing.expectEqual(Resource.BatchResult{ .kernel_error = .NETUNREACH }, routes[2].batch_result.?);
+        try testing.expect(routes[3].batch_result == null);
+    } else return error.SkipZigTest;
+}
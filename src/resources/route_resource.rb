@@ -7,6 +7,7 @@ class RouteResource
     @gateway = ""
     @netmask = ""
     @device = ""
+    @metric = ""
     @action = :add
     @only_if_proc = nil
     @not_if_proc = nil
@@ -21,8 +22,8 @@ class RouteResource
     notifications_arg = @notifications.map { |n| [n[:target], n[:action], n[:timing]] }
     subscriptions_arg = @subscriptions.map { |s| [s[:target], s[:action], s[:timing]] }
 
-    # Signature: add_route(target, gateway, netmask, device, action, only_if, not_if, notifications, subscriptions)
-    ZigBackend.add_route(@target, @gateway, @netmask, @device, @action.to_s, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg)
+    # Signature: add_route(target, gateway, netmask, device, metric, action, only_if, not_if, ignore_failure, notifications, subscriptions)
+    ZigBackend.add_route(@target, @gateway, @netmask, @device, @metric, @action.to_s, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg)
   end
 
   def gateway(value)
@@ -37,6 +38,11 @@ class RouteResource
     @device = value.to_s
   end
 
+  # Route priority; routes to the same prefix with different metrics coexist (Linux only)
+  def metric(value)
+    @metric = value.to_s
+  end
+
   def action(value)
     @action = value
   end
@@ -174,8 +174,7 @@ pub const Resource = struct {
                 // Get exception object and convert to string
                 const exc = mruby.mrb_get_exception(mrb);
                 const exc_str = mruby.mrb_inspect(mrb, exc);
-                const err_msg_cstr = mruby.mrb_str_to_cstr(mrb, exc_str);
-                const err_msg = std.mem.span(err_msg_cstr);
+                const err_msg = mruby.borrowStr(mrb, exc_str);
 
                 // Log the error message
                 logger.err("Ruby block execution failed: {s}", .{err_msg});
@@ -223,12 +222,9 @@ pub fn zigAddResource(
     // Get name (string), block (proc), environment (array), action (string), and 4 optional (blocks + arrays)
     _ = mruby.mrb_get_args(mrb, "SoAS|oooAA", &name_val, &block_val, &environment_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
+    const name = allocator.dupe(u8, mruby.borrowStr(mrb, name_val)) catch return mruby.mrb_nil_value();
 
-    const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch return mruby.mrb_nil_value();
-
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "nothing"))
         .nothing
     else
@@ -238,38 +234,7 @@ pub fn zigAddResource(
     const block_proc: ?mruby.mrb_value = if (zig_mrb_nil_p(block_val) == 0) block_val else null;
 
     // Parse environment array [[key, value], ...]
-    var environment: ?[]const u8 = null;
-    const env_len = mruby.mrb_ary_len(mrb, environment_val);
-    if (env_len > 0) {
-        // Build environment string in format "KEY=VALUE\0KEY2=VALUE2\0"
-        var env_list = std.ArrayList(u8).initCapacity(allocator, @intCast(env_len * 32)) catch std.ArrayList(u8).empty;
-        defer env_list.deinit(allocator);
-
-        var i: mruby.mrb_int = 0;
-        while (i < env_len) : (i += 1) {
-            const pair = mruby.mrb_ary_ref(mrb, environment_val, i);
-            if (mruby.mrb_ary_len(mrb, pair) != 2) continue;
-
-            const key_val = mruby.mrb_ary_ref(mrb, pair, 0);
-            const val_val = mruby.mrb_ary_ref(mrb, pair, 1);
-
-            const key_cstr = mruby.mrb_str_to_cstr(mrb, key_val);
-            const val_cstr = mruby.mrb_str_to_cstr(mrb, val_val);
-
-            const key_str = std.mem.span(key_cstr);
-            const val_str = std.mem.span(val_cstr);
-
-            // Append "KEY=VALUE\0"
-            env_list.appendSlice(allocator, key_str) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, '=') catch return mruby.mrb_nil_value();
-            env_list.appendSlice(allocator, val_str) catch return mruby.mrb_nil_value();
-            env_list.append(allocator, 0) catch return mruby.mrb_nil_value();
-        }
-
-        if (env_list.items.len > 0) {
-            environment = allocator.dupe(u8, env_list.items) catch return mruby.mrb_nil_value();
-        }
-    }
+    const environment = base.environmentFromRuby(allocator, mrb, environment_val) catch return mruby.mrb_nil_value();
 
     // Build common properties (guards + notifications)
     var common = base.CommonProps.init(allocator);
@@ -8,7 +8,7 @@ const logger = @import("../logger.zig");
 pub const Resource = struct {
     // Resource-specific properties
     name: []const u8, // Unit name (e.g., "nginx.service")
-    content: ?[]const u8, // Unit file content
+    content: ?[]const u8, // Unit file content, pinned in the run's mruby state (not owned)
     enabled: ?bool, // Whether to enable the unit
     active: ?bool, // Whether to start the unit
     action: Action, // Single action to perform
@@ -30,7 +30,6 @@ pub const Resource = struct {
 
     pub fn deinit(self: Resource, allocator: std.mem.Allocator) void {
         allocator.free(self.name);
-        if (self.content) |content| allocator.free(content);
 
         // Deinit common props
         var common = self.common;
@@ -218,6 +217,7 @@ pub const Resource = struct {
         child.stdout_behavior = .Pipe;
         child.stderr_behavior = .Pipe;
 
+        base.noteSubprocess();
         try child.spawn();
 
         const stdout = try child.stdout.?.readToEndAlloc(allocator, std.math.maxInt(usize));
@@ -279,12 +279,11 @@ pub fn zigAddResource(
     _ = mruby.mrb_get_args(mrb, "SSA|oooAA", &name_val, &content_val, &actions_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
     // Extract name
-    const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-    const name_span = std.mem.span(name_cstr);
+    const name_span = mruby.borrowStr(mrb, name_val);
 
-    // Extract content (optional)
-    const content_cstr = mruby.mrb_str_to_cstr(mrb, content_val);
-    const content_str = std.mem.span(content_cstr);
+    // Extract content (optional); pinned once and shared by every action's
+    // resource rather than copied per action
+    const content_str = mruby.pinStr(mrb, content_val);
 
     // Parse actions array
     const actions_len = mruby.mrb_ary_len(mrb, actions_val);
@@ -296,17 +295,13 @@ pub fn zigAddResource(
     while (i < actions_len) : (i += 1) {
         logger.debug("[systemd_unit] processing action {d}/{d}", .{ i + 1, actions_len });
         const action_val = mruby.mrb_ary_ref(mrb, actions_val, @intCast(i));
-        const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-        const action_str = std.mem.span(action_cstr);
+        const action_str = mruby.borrowStr(mrb, action_val);
 
         const action = Resource.actionFromString(action_str);
 
         // Duplicate name and content for each resource
         const name = allocator.dupe(u8, name_span) catch return mruby.mrb_nil_value();
-        const content: ?[]const u8 = if (content_str.len > 0)
-            allocator.dupe(u8, content_str) catch return mruby.mrb_nil_value()
-        else
-            null;
+        const content: ?[]const u8 = if (content_str.len > 0) content_str else null;
 
         // Build common properties (guards + notifications) for each resource
         var common = base.CommonProps.init(allocator);
@@ -2,6 +2,12 @@ const std = @import("std");
 const mruby = @import("../mruby.zig");
 const base = @import("../base_resource.zig");
 const logger = @import("../logger.zig");
+const hashing = @import("../hashing.zig");
+const xattr_fingerprint = @import("../xattr_fingerprint.zig");
+
+extern fn zig_mrb_float_value(mrb: *mruby.mrb_state, f: f64) mruby.mrb_value;
+extern fn zig_mrb_true_value() mruby.mrb_value;
+extern fn zig_mrb_false_value() mruby.mrb_value;
 
 /// Template resource data structure
 pub const Resource = struct {
@@ -10,6 +16,9 @@ pub const Resource = struct {
     source: []const u8, // Template file path
     attrs: base.FileAttributes,
     variables: std.ArrayList(Variable), // Template variables
+    // Ruby Array of the variable values, parallel to `variables`, bound
+    // as-is when rendering. Registered with the GC while the resource lives.
+    values: ?mruby.mrb_value = null,
     action: Action,
 
     // Common properties (guards, notifications, etc.)
@@ -17,8 +26,10 @@ pub const Resource = struct {
 
     pub const Variable = struct {
         name: []const u8,
-        value: []const u8, // Value as string
-        var_type: []const u8, // Type: 'string', 'integer', 'float', 'boolean', 'nil'
+        // Value as string; empty for array/hash values bound in `values`,
+        // which are never serialized
+        value: []const u8,
+        var_type: []const u8, // Type: 'string', 'integer', 'float', 'boolean', 'nil', 'array', 'hash'
 
         pub fn deinit(self: Variable, allocator: std.mem.Allocator) void {
             allocator.free(self.name);
@@ -42,6 +53,10 @@ pub const Resource = struct {
         }
         variables.deinit(allocator);
 
+        if (self.common.mrb_state) |mrb| {
+            if (self.values) |values| mruby.mrb_gc_unregister(mrb, values);
+        }
+
         // Deinit common props
         var common = self.common;
         common.deinit(allocator);
@@ -91,49 +106,68 @@ pub const Resource = struct {
         const template_content = try readTemplateFile(self.source);
         defer std.heap.c_allocator.free(template_content);
 
+        // Output of a template that only uses its variables is determined by
+        // source + variables, so a matching fingerprint skips rendering.
+        // Others are fingerprinted by the hash of what they rendered.
+        const render_key: ?[32]u8 = if (isSelfContained(template_content, self.variables.items))
+            self.renderKey(template_content)
+        else
+            null;
+
+        const is_abs = std.fs.path.isAbsolute(self.path);
+        const existing_file: ?std.fs.File = blk: {
+            const opened = if (is_abs)
+                std.fs.openFileAbsolute(self.path, .{})
+            else
+                std.fs.cwd().openFile(self.path, .{});
+            break :blk opened catch |err| switch (err) {
+                error.FileNotFound => null,
+                else => return err,
+            };
+        };
+        defer if (existing_file) |f| f.close();
+
+        var recorded: ?xattr_fingerprint.Record = null;
+        var existing_mode_matches = false;
+        if (existing_file) |f| {
+            const stat = try f.stat();
+            recorded = xattr_fingerprint.load(f, stat);
+            existing_mode_matches = self.modeMatches(stat);
+        }
+
+        if (render_key) |key| {
+            if (recorded) |record| {
+                if (record.kind == .template and std.mem.eql(u8, &record.digest, &key) and existing_mode_matches) {
+                    return false;
+                }
+            }
+        }
+
         // Render template using mruby
         const rendered_content = try renderTemplate(self, template_content, self.variables.items);
         defer std.heap.c_allocator.free(rendered_content);
 
-        // Check if file exists and content matches
-        const is_abs = std.fs.path.isAbsolute(self.path);
-        const file_exists = blk: {
-            if (is_abs) {
-                std.fs.accessAbsolute(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            } else {
-                std.fs.cwd().access(self.path, .{}) catch |err| switch (err) {
-                    error.FileNotFound => break :blk false,
-                    else => return err,
-                };
-            }
-            break :blk true;
-        };
+        const fingerprint: xattr_fingerprint.Record = if (render_key) |key|
+            .{ .kind = .template, .digest = key }
+        else
+            .{ .kind = .blake3, .digest = hashing.hashBytes(rendered_content, .blake3, 1) };
 
-        if (file_exists) {
-            // Read existing file and compare content
-            const existing_file = if (is_abs)
-                try std.fs.openFileAbsolute(self.path, .{})
+        if (existing_file) |f| {
+            var content_matches = if (recorded) |record|
+                record.kind == fingerprint.kind and std.mem.eql(u8, &record.digest, &fingerprint.digest)
             else
-                try std.fs.cwd().openFile(self.path, .{});
-            defer existing_file.close();
-
-            const existing_content = try existing_file.readToEndAlloc(std.heap.c_allocator, std.math.maxInt(usize));
-            defer std.heap.c_allocator.free(existing_content);
-
-            if (std.mem.eql(u8, existing_content, rendered_content)) {
-                // Content matches, check attributes if specified
-                if (self.attrs.mode) |m| {
-                    const stat = try existing_file.stat();
-                    const current_mode = stat.mode & 0o777;
-                    if (current_mode == m) {
-                        return false; // File exists with same content and mode
-                    }
-                } else {
-                    return false; // File exists with same content
-                }
+                false;
+            if (!content_matches) {
+                // Read existing file and compare content
+                const existing_content = try f.readToEndAlloc(std.heap.c_allocator, std.math.maxInt(usize));
+                defer std.heap.c_allocator.free(existing_content);
+                content_matches = std.mem.eql(u8, existing_content, rendered_content);
+                if (content_matches) xattr_fingerprint.store(f, fingerprint);
+            }
+
+            // Content matches, check attributes if specified
+            if (content_matches and existing_mode_matches) {
+                return false; // File exists with same content (and mode)
             }
         }
 
@@ -145,6 +179,7 @@ pub const Resource = struct {
             try std.fs.cwd().createFile(self.path, .{ .truncate = true });
 
         try file.writeAll(rendered_content);
+        xattr_fingerprint.store(file, fingerprint);
 
         // Apply file mode if specified
         if (self.attrs.mode) |m| {
@@ -164,6 +199,70 @@ pub const Resource = struct {
         return true; // File was created or updated
     }
 
+    fn modeMatches(self: Resource, stat: std.fs.File.Stat) bool {
+        const m = self.attrs.mode orelse return true;
+        return stat.mode & 0o777 == m;
+    }
+
+    /// Hash of the template source and variables. Output that depends on
+    /// anything else the template reaches at render time (globals, the
+    /// clock) is not covered, as with any cached render.
+    ///
+    /// Bound Ruby values are hashed as they are now, not as they were
+    /// declared: the script may have changed them since (`hosts << h`).
+    /// Null when a value is not plain data, so the render is compared by
+    /// its output instead.
+    fn renderKey(self: Resource, template_content: []const u8) ?[32]u8 {
+        var hasher = std.crypto.hash.Blake3.init(.{});
+        const fields = struct {
+            fn add(h: *std.crypto.hash.Blake3, bytes: []const u8) void {
+                h.update(std.mem.asBytes(&@as(u64, bytes.len)));
+                h.update(bytes);
+            }
+
+            fn feed(ctx: ?*anyopaque, bytes: [*]const u8, len: usize) callconv(.c) void {
+                const h: *std.crypto.hash.Blake3 = @ptrCast(@alignCast(ctx.?));
+                h.update(bytes[0..len]);
+            }
+        };
+        fields.add(&hasher, template_content);
+        for (self.variables.items) |var_| fields.add(&hasher, var_.name);
+
+        if (self.values) |values| {
+            const mrb = self.common.mrb_state orelse return null;
+            if (mruby.zig_mrb_value_feed(mrb, values, fields.feed, &hasher) == 0) return null;
+        } else {
+            for (self.variables.items) |var_| {
+                fields.add(&hasher, var_.var_type);
+                fields.add(&hasher, var_.value);
+            }
+        }
+
+        var digest: [32]u8 = undefined;
+        hasher.final(&digest);
+        return digest;
+    }
+
+    /// Add the bound Ruby values to a checkpoint fingerprint (the generic
+    /// fingerprint skips Ruby values, and array/hash variables have no
+    /// string form). Values that are not plain data hash as a fresh nonce,
+    /// so such a template never matches and always runs on resume.
+    pub fn fingerprintValues(self: Resource, hasher: *std.hash.Wyhash) void {
+        const values = self.values orelse return;
+        const mrb = self.common.mrb_state orelse return;
+        const feed = struct {
+            fn f(ctx: ?*anyopaque, bytes: [*]const u8, len: usize) callconv(.c) void {
+                const h: *std.hash.Wyhash = @ptrCast(@alignCast(ctx.?));
+                h.update(bytes[0..len]);
+            }
+        }.f;
+        if (mruby.zig_mrb_value_feed(mrb, values, feed, hasher) != 0) return;
+
+        var nonce: [16]u8 = undefined;
+        std.crypto.random.bytes(&nonce);
+        hasher.update(&nonce);
+    }
+
     fn applyDelete(self: Resource) !void {
         const is_abs = std.fs.path.isAbsolute(self.path);
         if (is_abs) {
@@ -179,6 +278,111 @@ pub const Resource = struct {
         }
     }
 
+    /// Whether the template's Ruby code can only see its own variables:
+    /// every bare identifier is a variable, a local it assigns or a block
+    /// parameter, or a keyword. Constants, globals, instance variables,
+    /// backticks, string interpolation and bare method calls (helpers like
+    /// `node`) all make the template depend on more than its inputs.
+    /// Conservative; a false result only costs a render.
+    fn isSelfContained(template_content: []const u8, variables: []const Variable) bool {
+        const keywords = [_][]const u8{
+            "if",   "elsif", "else",  "end",   "unless", "while", "until", "do",
+            "then", "and",   "or",    "not",   "nil",    "true",  "false", "case",
+            "when", "in",    "begin", "break", "next",
+        };
+
+        var locals: [64][]const u8 = undefined;
+        var local_count: usize = 0;
+
+        var rest = template_content;
+        while (std.mem.indexOf(u8, rest, "<%")) |open| {
+            const close = std.mem.indexOfPos(u8, rest, open + 2, "%>") orelse return false;
+            var code = rest[open + 2 .. close];
+            rest = rest[close + 2 ..];
+            if (code.len > 0 and code[0] == '=') code = code[1..];
+            if (code.len > 0 and code[0] == '#') continue; // ERB comment
+
+            var i: usize = 0;
+            while (i < code.len) {
+                const c = code[i];
+                switch (c) {
+                    '`', '$', '@' => return false,
+                    '"', '\'' => {
+                        var j = i + 1;
+                        while (j < code.len and code[j] != c) : (j += 1) {
+                            if (code[j] == '\\') {
+                                j += 1;
+                                continue;
+                            }
+                            if (c == '"' and code[j] == '#' and j + 1 < code.len and code[j + 1] == '{') return false;
+                        }
+                        i = j + 1;
+                    },
+                    ':' => {
+                        if (i + 1 < code.len and code[i + 1] == ':') return false;
+                        // Symbol
+                        i += 1;
+                        while (i < code.len and isIdentChar(code[i])) i += 1;
+                    },
+                    '.' => {
+                        // Method call on a value
+                        i += 1;
+                        while (i < code.len and (isIdentChar(code[i]) or code[i] == '?' or code[i] == '!')) i += 1;
+                    },
+                    '|' => {
+                        i += 1;
+                        if (i < code.len and code[i] == '|') {
+                            i += 1;
+                            continue;
+                        }
+                        // Block parameters
+                        var j = i;
+                        while (j < code.len and (isIdentChar(code[j]) or code[j] == ',' or code[j] == ' ')) j += 1;
+                        if (j < code.len and code[j] == '|') {
+                            var params = std.mem.tokenizeAny(u8, code[i..j], ", ");
+                            while (params.next()) |param| {
+                                if (local_count == locals.len) return false;
+                                locals[local_count] = param;
+                                local_count += 1;
+                            }
+                            i = j + 1;
+                        }
+                    },
+                    'a'...'z', 'A'...'Z', '_' => {
+                        const start = i;
+                        while (i < code.len and isIdentChar(code[i])) i += 1;
+                        const ident = code[start..i];
+                        const next = std.mem.trim(u8, code[i..], " ");
+
+                        // Hash label (`key: value`)
+                        if (next.len > 0 and next[0] == ':' and !(next.len > 1 and next[1] == ':')) continue;
+                        if (std.ascii.isUpper(ident[0])) return false;
+
+                        const assigned = next.len > 0 and next[0] == '=' and !(next.len > 1 and (next[1] == '=' or next[1] == '~'));
+                        if (assigned) {
+                            if (local_count == locals.len) return false;
+                            locals[local_count] = ident;
+                            local_count += 1;
+                            continue;
+                        }
+
+                        var known = false;
+                        for (keywords) |kw| known = known or std.mem.eql(u8, ident, kw);
+                        for (variables) |var_| known = known or std.mem.eql(u8, ident, var_.name);
+                        for (locals[0..local_count]) |local| known = known or std.mem.eql(u8, ident, local);
+                        if (!known) return false;
+                    },
+                    else => i += 1,
+                }
+            }
+        }
+        return true;
+    }
+
+    fn isIdentChar(c: u8) bool {
+        return std.ascii.isAlphanumeric(c) or c == '_';
+    }
+
     fn readTemplateFile(source: []const u8) ![]u8 {
         // Try to find template file in templates/ directory
         const templates_dir = "templates";
@@ -200,7 +404,7 @@ pub const Resource = struct {
         return content;
     }
 
-    fn renderTemplate(self: Resource, template_content: []const u8, variables: []const Variable) ![]u8 {
+    pub fn renderTemplate(self: Resource, template_content: []const u8, variables: []const Variable) ![]u8 {
         // Use mruby to render ERB template
         // Convert ERB template to Ruby code and execute it
 
@@ -213,39 +417,15 @@ pub const Resource = struct {
         var ruby_code = std.ArrayList(u8).initCapacity(std.heap.c_allocator, template_content.len * 2) catch std.ArrayList(u8).empty;
         defer ruby_code.deinit(std.heap.c_allocator);
 
-        // Set up variables in Ruby as local variables
-        try ruby_code.writer(std.heap.c_allocator).writeAll("_erb_result = ''\n");
-        for (variables) |var_| {
+        // The template compiles to a lambda that takes the variable values
+        // as one Array and binds each to a local, so only the names are
+        // parsed; the values themselves never pass through Ruby source.
+        try ruby_code.writer(std.heap.c_allocator).writeAll("lambda do |_hola_vals|\n_erb_result = ''\n");
+        for (variables, 0..) |var_, index| {
             // Convert variable name to valid Ruby identifier
             const safe_name = try sanitizeRubyIdentifier(var_.name);
             defer std.heap.c_allocator.free(safe_name);
-
-            // Generate Ruby code based on type
-            if (std.mem.eql(u8, var_.var_type, "integer")) {
-                // Integer: convert string to integer
-                try ruby_code.writer(std.heap.c_allocator).print("{s} = {s}.to_i\n", .{ safe_name, var_.value });
-            } else if (std.mem.eql(u8, var_.var_type, "float")) {
-                // Float: convert string to float
-                try ruby_code.writer(std.heap.c_allocator).print("{s} = {s}.to_f\n", .{ safe_name, var_.value });
-            } else if (std.mem.eql(u8, var_.var_type, "boolean")) {
-                // Boolean: convert string to boolean
-                if (std.mem.eql(u8, var_.value, "true")) {
-                    try ruby_code.writer(std.heap.c_allocator).print("{s} = true\n", .{safe_name});
-                } else {
-                    try ruby_code.writer(std.heap.c_allocator).print("{s} = false\n", .{safe_name});
-                }
-            } else if (std.mem.eql(u8, var_.var_type, "nil")) {
-                // Nil
-                try ruby_code.writer(std.heap.c_allocator).print("{s} = nil\n", .{safe_name});
-            } else if (std.mem.eql(u8, var_.var_type, "array")) {
-                // Array: value is already a Ruby array literal string, just assign it
-                try ruby_code.writer(std.heap.c_allocator).print("{s} = {s}\n", .{ safe_name, var_.value });
-            } else {
-                // String: escape properly
-                const escaped_value = try escapeRubyString(var_.value);
-                defer std.heap.c_allocator.free(escaped_value);
-                try ruby_code.writer(std.heap.c_allocator).print("{s} = {s}\n", .{ safe_name, escaped_value });
-            }
+            try ruby_code.writer(std.heap.c_allocator).print("{s} = _hola_vals[{d}]\n", .{ safe_name, index });
         }
 
         // Convert ERB to Ruby code
@@ -331,7 +511,7 @@ pub const Resource = struct {
         }
 
         // Get result: _erb_result
-        try ruby_code.writer(std.heap.c_allocator).writeAll("_erb_result");
+        try ruby_code.writer(std.heap.c_allocator).writeAll("_erb_result\nend");
 
         // Execute Ruby code
         const code_str = try ruby_code.toOwnedSlice(std.heap.c_allocator);
@@ -343,28 +523,57 @@ pub const Resource = struct {
         @memcpy(code_with_null[0..code_str.len], code_str);
         code_with_null[code_str.len] = 0;
 
-        const result_val = mruby.mrb_load_string(mrb, code_with_null.ptr);
-
         // Check for an exception directly instead of relying on a string-match
         // heuristic over the result. When the ERB code raised, also capture a
         // friendly "template raised: ClassName: message" summary into the
         // shared provision error-detail buffer so the top-level apply loop /
         // agent callback can surface it instead of the raw "TemplateRenderFailed".
-        const exc = mruby.mrb_get_exception(mrb);
-        if (mruby.mrb_test(exc)) {
-            base.recordProvisionException(mrb, exc, "template raised");
-            mruby.mrb_print_error(mrb);
-            return error.TemplateRenderFailed;
-        }
+        const render_proc = mruby.mrb_load_string(mrb, code_with_null.ptr);
+        if (mruby.mrb_test(mruby.mrb_get_exception(mrb))) return renderFailed(mrb);
+
+        const values = self.values orelse valuesFromStrings(mrb, variables);
+        if (mruby.mrb_test(mruby.mrb_get_exception(mrb))) return renderFailed(mrb);
+
+        const result_val = mruby.mrb_funcall_argv(mrb, render_proc, mruby.mrb_intern_cstr(mrb, "call"), 1, &values);
+        if (mruby.mrb_test(mruby.mrb_get_exception(mrb))) return renderFailed(mrb);
 
         // Convert result to string
-        const result_cstr = mruby.mrb_str_to_cstr(mrb, result_val);
-        const result_str = std.mem.span(result_cstr);
+        const result_str = mruby.borrowStr(mrb, result_val);
 
         return try std.heap.c_allocator.dupe(u8, result_str);
     }
 
-    fn renderTemplateSimple(template_content: []const u8, variables: []const Variable) ![]u8 {
+    fn renderFailed(mrb: *mruby.mrb_state) error{TemplateRenderFailed} {
+        base.recordProvisionException(mrb, mruby.mrb_get_exception(mrb), "template raised");
+        mruby.mrb_print_error(mrb);
+        return error.TemplateRenderFailed;
+    }
+
+    /// Values for variables that only have their string form (resources
+    /// built outside the Ruby DSL). Array and hash values are literals and
+    /// have to be evaluated.
+    fn valuesFromStrings(mrb: *mruby.mrb_state, variables: []const Variable) mruby.mrb_value {
+        const values = mruby.mrb_ary_new_capa(mrb, @intCast(variables.len));
+        for (variables) |var_| {
+            const value: mruby.mrb_value = if (std.mem.eql(u8, var_.var_type, "integer"))
+                mruby.mrb_int_value(mrb, std.fmt.parseInt(mruby.mrb_int, var_.value, 10) catch 0)
+            else if (std.mem.eql(u8, var_.var_type, "float"))
+                zig_mrb_float_value(mrb, std.fmt.parseFloat(f64, var_.value) catch 0.0)
+            else if (std.mem.eql(u8, var_.var_type, "boolean"))
+                if (std.mem.eql(u8, var_.value, "true")) zig_mrb_true_value() else zig_mrb_false_value()
+            else if (std.mem.eql(u8, var_.var_type, "nil"))
+                mruby.mrb_nil_value()
+            else if (std.mem.eql(u8, var_.var_type, "array") or std.mem.eql(u8, var_.var_type, "hash")) blk: {
+                const literal = std.heap.c_allocator.dupeZ(u8, var_.value) catch break :blk mruby.mrb_nil_value();
+                defer std.heap.c_allocator.free(literal);
+                break :blk mruby.mrb_load_string(mrb, literal.ptr);
+            } else mruby.mrb_str_new(mrb, var_.value.ptr, @intCast(var_.value.len));
+            mruby.mrb_ary_push(mrb, values, value);
+        }
+        return values;
+    }
+
+    pub fn renderTemplateSimple(template_content: []const u8, variables: []const Variable) ![]u8 {
         // Fallback simple substitution (original implementation)
         var result = std.ArrayList(u8).initCapacity(std.heap.c_allocator, template_content.len) catch std.ArrayList(u8).empty;
         defer result.deinit(std.heap.c_allocator);
@@ -497,7 +706,7 @@ pub const Resource = struct {
 pub const ruby_prelude = @embedFile("template_resource.rb");
 
 /// Zig callback: called from Ruby to add a template resource
-/// Format: add_template(path, source, mode, owner, group, variables_array, action, only_if_block, not_if_block, ignore_failure, notifications_array)
+/// Format: add_template(path, source, mode, owner, group, variables_array, values_array, action, only_if_block, not_if_block, ignore_failure, notifications_array)
 pub fn zigAddResource(
     mrb: *mruby.mrb_state,
     self: mruby.mrb_value,
@@ -512,6 +721,7 @@ pub fn zigAddResource(
     var owner_val: mruby.mrb_value = undefined;
     var group_val: mruby.mrb_value = undefined;
     var variables_val: mruby.mrb_value = undefined;
+    var values_val: mruby.mrb_value = undefined;
     var action_val: mruby.mrb_value = undefined;
     var only_if_val: mruby.mrb_value = undefined;
     var not_if_val: mruby.mrb_value = undefined;
@@ -519,38 +729,31 @@ pub fn zigAddResource(
     var notifications_val: mruby.mrb_value = undefined;
     var subscriptions_val: mruby.mrb_value = undefined;
 
-    // Get 5 strings + 1 array (variables) + 1 string (action) + 2 optional blocks + 1 optional boolean + 2 optional arrays
-    _ = mruby.mrb_get_args(mrb, "SSSSSAS|oooAA", &path_val, &source_val, &mode_val, &owner_val, &group_val, &variables_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
+    // Get 5 strings + 2 arrays (variables, values) + 1 string (action) + 2 optional blocks + 1 optional boolean + 2 optional arrays
+    _ = mruby.mrb_get_args(mrb, "SSSSSAAS|oooAA", &path_val, &source_val, &mode_val, &owner_val, &group_val, &variables_val, &values_val, &action_val, &only_if_val, &not_if_val, &ignore_failure_val, &notifications_val, &subscriptions_val);
 
-    const path_cstr = mruby.mrb_str_to_cstr(mrb, path_val);
-    const source_cstr = mruby.mrb_str_to_cstr(mrb, source_val);
-    const mode_cstr = mruby.mrb_str_to_cstr(mrb, mode_val);
-    const owner_cstr = mruby.mrb_str_to_cstr(mrb, owner_val);
-    const group_cstr = mruby.mrb_str_to_cstr(mrb, group_val);
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
+    const path = allocator.dupe(u8, mruby.borrowStr(mrb, path_val)) catch return mruby.mrb_nil_value();
+    const source = allocator.dupe(u8, mruby.borrowStr(mrb, source_val)) catch return mruby.mrb_nil_value();
 
-    const path = allocator.dupe(u8, std.mem.span(path_cstr)) catch return mruby.mrb_nil_value();
-    const source = allocator.dupe(u8, std.mem.span(source_cstr)) catch return mruby.mrb_nil_value();
-
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "delete"))
         .delete
     else
         .create;
 
-    const mode_str = std.mem.span(mode_cstr);
+    const mode_str = mruby.borrowStr(mrb, mode_val);
     const mode: ?u32 = if (mode_str.len > 0)
         std.fmt.parseInt(u32, mode_str, 8) catch null
     else
         null;
 
-    const owner_str = std.mem.span(owner_cstr);
+    const owner_str = mruby.borrowStr(mrb, owner_val);
     const owner: ?[]const u8 = if (owner_str.len > 0)
         allocator.dupe(u8, owner_str) catch return mruby.mrb_nil_value()
     else
         null;
 
-    const group_str = std.mem.span(group_cstr);
+    const group_str = mruby.borrowStr(mrb, group_val);
     const group: ?[]const u8 = if (group_str.len > 0)
         allocator.dupe(u8, group_str) catch return mruby.mrb_nil_value()
     else
@@ -559,29 +762,22 @@ pub fn zigAddResource(
     // Parse variables array: [[name, value, type], ...]
     var variables = std.ArrayList(Resource.Variable).initCapacity(allocator, 0) catch std.ArrayList(Resource.Variable).empty;
     if (mruby.mrb_test(variables_val)) {
-        const arr_len = mruby.mrb_ary_len(mrb, variables_val);
-        var i: mruby.mrb_int = 0;
-        while (i < arr_len) : (i += 1) {
-            const var_arr = mruby.mrb_ary_ref(mrb, variables_val, i);
-
-            // Each variable is [name, value, type]
-            const name_val = mruby.mrb_ary_ref(mrb, var_arr, 0);
-            const value_val = mruby.mrb_ary_ref(mrb, var_arr, 1);
-            const type_val = mruby.mrb_ary_ref(mrb, var_arr, 2);
-
-            const name_cstr = mruby.mrb_str_to_cstr(mrb, name_val);
-            const value_cstr = mruby.mrb_str_to_cstr(mrb, value_val);
-            const type_cstr = mruby.mrb_str_to_cstr(mrb, type_val);
-
-            const name = allocator.dupe(u8, std.mem.span(name_cstr)) catch continue;
-            const value = allocator.dupe(u8, std.mem.span(value_cstr)) catch {
+        const rows = mruby.aryRowViews(3, allocator, mrb, variables_val) catch return mruby.mrb_nil_value();
+        defer allocator.free(rows);
+        variables.ensureTotalCapacity(allocator, rows.len) catch {};
+
+        // Each variable is [name, value, type]. None may be dropped: array
+        // and hash variables are only usable through `values`, by index.
+        for (rows) |row| {
+            const name = allocator.dupe(u8, row[0].slice()) catch return mruby.mrb_nil_value();
+            const value = allocator.dupe(u8, row[1].slice()) catch {
                 allocator.free(name);
-                continue;
+                return mruby.mrb_nil_value();
             };
-            const var_type = allocator.dupe(u8, std.mem.span(type_cstr)) catch {
+            const var_type = allocator.dupe(u8, row[2].slice()) catch {
                 allocator.free(name);
                 allocator.free(value);
-                continue;
+                return mruby.mrb_nil_value();
             };
 
             variables.append(allocator, Resource.Variable{
@@ -592,7 +788,7 @@ pub fn zigAddResource(
                 allocator.free(name);
                 allocator.free(value);
                 allocator.free(var_type);
-                continue;
+                return mruby.mrb_nil_value();
             };
         }
     }
@@ -601,6 +797,13 @@ pub fn zigAddResource(
     var common = base.CommonProps.init(allocator);
     base.fillCommonFromRuby(&common, mrb, only_if_val, not_if_val, ignore_failure_val, notifications_val, subscriptions_val, allocator);
 
+    // Values stay Ruby objects until render; only scalar variables' string
+    // forms are copied out. Array/hash variables arrive with an empty
+    // string and are never serialized.
+    const values_len: usize = @intCast(mruby.mrb_ary_len(mrb, values_val));
+    const values: ?mruby.mrb_value = if (values_len == variables.items.len) values_val else null;
+    if (values) |v| mruby.mrb_gc_register(mrb, v);
+
     resources.append(allocator, .{
         .path = path,
         .source = source,
@@ -610,9 +813,28 @@ pub fn zigAddResource(
             .group = group,
         },
         .variables = variables,
+        .values = values,
         .action = action,
         .common = common,
     }) catch return mruby.mrb_nil_value();
 
     return mruby.mrb_nil_value();
 }
+
+test "isSelfContained accepts templates that only use their variables" {
+    const vars = [_]Resource.Variable{
+        .{ .name = "port", .value = "8080", .var_type = "integer" },
+        .{ .name = "hosts", .value = "[]", .var_type = "array" },
+    };
+    const t = std.testing;
+    try t.expect(Resource.isSelfContained("listen <%= port %>\n", &vars));
+    try t.expect(Resource.isSelfContained("<% if port > 8000 %>big<% else %>small<% end %>", &vars));
+    try t.expect(Resource.isSelfContained("<% hosts.each do |h| %><%= h.upcase %>\n<% end %>", &vars));
+    try t.expect(Resource.isSelfContained("<% n = port + 1 %><%= n %> <%= 'x' %> <%# note %>", &vars));
+
+    try t.expect(!Resource.isSelfContained("<%= ENV['HOME'] %>", &vars));
+    try t.expect(!Resource.isSelfContained("<%= node['hostname'] %>", &vars));
+    try t.expect(!Resource.isSelfContained("<%= \"#{Time.now}\" %>", &vars));
+    try t.expect(!Resource.isSelfContained("<%= $x %>", &vars));
+    try t.expect(!Resource.isSelfContained("<%= `hostname` %>", &vars));
+}
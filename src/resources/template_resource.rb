@@ -18,7 +18,10 @@ class TemplateResource
     instance_eval(&block) if block
 
     # Convert variables hash to array format: [[name, value, type], ...]
-    # type: 'string', 'integer', 'float', 'boolean', 'nil', 'array'
+    # type: 'string', 'integer', 'float', 'boolean', 'nil', 'array', 'hash'
+    # Templates get the values themselves (variables_values below). Arrays
+    # and hashes are not serialized here: render keys and checkpoints hash
+    # the values directly, so their string form stays empty.
     variables_arg = @variables.map do |k, v|
       type = case v
       when Integer then 'integer'
@@ -26,18 +29,13 @@ class TemplateResource
       when TrueClass, FalseClass then 'boolean'
       when NilClass then 'nil'
       when Array then 'array'
+      when Hash then 'hash'
       else 'string'
       end
-      # For arrays, convert to JSON-like string representation
-      # For other types, use to_s
-      value_str = if type == 'array'
-        # Convert array to Ruby array literal string
-        '[' + v.map { |item| item.inspect }.join(', ') + ']'
-      else
-        v.to_s
-      end
+      value_str = (type == 'array' || type == 'hash') ? '' : v.to_s
       [k.to_s, value_str, type]
     end
+    variables_values = @variables.values
 
     # Call Zig function with procs and notifications
     only_if_arg = @only_if_proc || nil
@@ -46,7 +44,7 @@ class TemplateResource
     # Convert notifications array to format: [[target, action, timing], ...]
     notifications_arg = @notifications.map { |n| [n[:target], n[:action], n[:timing]] }
     subscriptions_arg = @subscriptions.map { |s| [s[:target], s[:action], s[:timing]] }
-    ZigBackend.add_template(@path, @source, @mode, @owner, @group, variables_arg, @action, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg)
+    ZigBackend.add_template(@path, @source, @mode, @owner, @group, variables_arg, variables_values, @action, only_if_arg, not_if_arg, @ignore_failure, notifications_arg, subscriptions_arg)
   end
 
   def source(value)
@@ -88,6 +88,7 @@ pub const Resource = struct {
         const allocator = arena.allocator();
 
         const args = [_][]const u8{ "id", "-u", username };
+        base.noteSubprocess();
         const result = std.process.Child.run(.{
             .allocator = allocator,
             .argv = &args,
@@ -184,6 +185,7 @@ pub const Resource = struct {
         logger.debug("Executing: {s}", .{cmd});
 
         const args = [_][]const u8{ "/bin/sh", "-c", cmd };
+        base.noteSubprocess();
         const result = try std.process.Child.run(.{
             .allocator = allocator,
             .argv = &args,
@@ -329,52 +331,45 @@ pub fn zigAddResource(
     );
 
     // Extract username
-    const username_cstr = mruby.mrb_str_to_cstr(mrb, username_val);
-    const username = allocator.dupe(u8, std.mem.span(username_cstr)) catch return mruby.mrb_nil_value();
+    const username = allocator.dupe(u8, mruby.borrowStr(mrb, username_val)) catch return mruby.mrb_nil_value();
 
     // Parse UID (optional)
-    const uid_cstr = mruby.mrb_str_to_cstr(mrb, uid_val);
-    const uid_str = std.mem.span(uid_cstr);
+    const uid_str = mruby.borrowStr(mrb, uid_val);
     const uid: ?u32 = if (uid_str.len > 0)
         std.fmt.parseInt(u32, uid_str, 10) catch null
     else
         null;
 
     // Parse GID (optional)
-    const gid_cstr = mruby.mrb_str_to_cstr(mrb, gid_val);
-    const gid_str = std.mem.span(gid_cstr);
+    const gid_str = mruby.borrowStr(mrb, gid_val);
     const gid: ?u32 = if (gid_str.len > 0)
         std.fmt.parseInt(u32, gid_str, 10) catch null
     else
         null;
 
     // Parse comment (optional)
-    const comment_cstr = mruby.mrb_str_to_cstr(mrb, comment_val);
-    const comment_str = std.mem.span(comment_cstr);
+    const comment_str = mruby.borrowStr(mrb, comment_val);
     const comment: ?[]const u8 = if (comment_str.len > 0)
         allocator.dupe(u8, comment_str) catch return mruby.mrb_nil_value()
     else
         null;
 
     // Parse home (optional)
-    const home_cstr = mruby.mrb_str_to_cstr(mrb, home_val);
-    const home_str = std.mem.span(home_cstr);
+    const home_str = mruby.borrowStr(mrb, home_val);
     const home: ?[]const u8 = if (home_str.len > 0)
         allocator.dupe(u8, home_str) catch return mruby.mrb_nil_value()
     else
         null;
 
     // Parse shell (optional)
-    const shell_cstr = mruby.mrb_str_to_cstr(mrb, shell_val);
-    const shell_str = std.mem.span(shell_cstr);
+    const shell_str = mruby.borrowStr(mrb, shell_val);
     const shell: ?[]const u8 = if (shell_str.len > 0)
         allocator.dupe(u8, shell_str) catch return mruby.mrb_nil_value()
     else
         null;
 
     // Parse password (optional)
-    const password_cstr = mruby.mrb_str_to_cstr(mrb, password_val);
-    const password_str = std.mem.span(password_cstr);
+    const password_str = mruby.borrowStr(mrb, password_val);
     const password: ?[]const u8 = if (password_str.len > 0)
         allocator.dupe(u8, password_str) catch return mruby.mrb_nil_value()
     else
@@ -386,8 +381,7 @@ pub fn zigAddResource(
     const non_unique = mruby.mrb_test(non_unique_val);
 
     // Parse action
-    const action_cstr = mruby.mrb_str_to_cstr(mrb, action_val);
-    const action_str = std.mem.span(action_cstr);
+    const action_str = mruby.borrowStr(mrb, action_val);
     const action: Resource.Action = if (std.mem.eql(u8, action_str, "modify"))
         .modify
     else if (std.mem.eql(u8, action_str, "remove"))
@@ -0,0 +1,500 @@
+//! Minimal rtnetlink (NETLINK_ROUTE) client used by the route resource.
+//! Dumps the main routing table once, and programs route changes one request
+//! at a time, matching each ack back by sequence number.
+//!
+//! Only the pieces of the wire format the route resource needs are modelled
+//! here; structures mirror <linux/netlink.h> and <linux/rtnetlink.h>.
+
+const std = @import("std");
+
+const NETLINK_ROUTE: u32 = 0;
+
+const RTM_NEWROUTE: u16 = 24;
+const RTM_DELROUTE: u16 = 25;
+const RTM_GETROUTE: u16 = 26;
+
+const NLMSG_ERROR: u16 = 2;
+const NLMSG_DONE: u16 = 3;
+
+const NLM_F_REQUEST: u16 = 0x01;
+const NLM_F_ACK: u16 = 0x04;
+const NLM_F_DUMP: u16 = 0x300;
+const NLM_F_REPLACE: u16 = 0x100;
+const NLM_F_EXCL: u16 = 0x200;
+const NLM_F_CREATE: u16 = 0x400;
+
+pub const RT_TABLE_MAIN: u32 = 254;
+const RTPROT_STATIC: u8 = 4;
+const RT_SCOPE_UNIVERSE: u8 = 0;
+const RT_SCOPE_LINK: u8 = 253;
+const RT_SCOPE_NOWHERE: u8 = 255;
+const RTN_UNICAST: u8 = 1;
+
+const RTA_DST: u16 = 1;
+const RTA_OIF: u16 = 4;
+const RTA_GATEWAY: u16 = 5;
+const RTA_PRIORITY: u16 = 6;
+const RTA_TABLE: u16 = 15;
+
+const AF_INET: u8 = 2;
+const AF_INET6: u8 = 10;
+
+const recv_buf_size: usize = 64 * 1024;
+
+const NlMsgHdr = extern struct {
+    len: u32,
+    type: u16,
+    flags: u16,
+    seq: u32,
+    pid: u32,
+};
+
+const RtMsg = extern struct {
+    family: u8,
+    dst_len: u8,
+    src_len: u8,
+    tos: u8,
+    table: u8,
+    protocol: u8,
+    scope: u8,
+    type: u8,
+    flags: u32,
+};
+
+const RtAttr = extern struct {
+    len: u16,
+    type: u16,
+};
+
+fn alignUp(len: usize) usize {
+    return (len + 3) & ~@as(usize, 3);
+}
+
+pub const Family = enum(u8) {
+    ipv4 = AF_INET,
+    ipv6 = AF_INET6,
+
+    pub fn addrLen(self: Family) usize {
+        return switch (self) {
+            .ipv4 => 4,
+            .ipv6 => 16,
+        };
+    }
+
+    pub fn maxPrefix(self: Family) u8 {
+        return switch (self) {
+            .ipv4 => 32,
+            .ipv6 => 128,
+        };
+    }
+
+    /// Priority the kernel assigns when a route is added without one.
+    pub fn defaultMetric(self: Family) u32 {
+        return switch (self) {
+            .ipv4 => 0,
+            .ipv6 => 1024,
+        };
+    }
+};
+
+/// A unicast route in the main table. Addresses are stored in network byte
+/// order; IPv4 uses the first 4 bytes.
+pub const Route = struct {
+    family: Family,
+    dst: [16]u8 = [_]u8{0} ** 16,
+    dst_len: u8,
+    gateway: ?[16]u8 = null,
+    oif: u32 = 0,
+    metric: u32,
+
+    fn addr(self: *const Route) []const u8 {
+        return self.dst[0..self.family.addrLen()];
+    }
+
+    /// Same destination prefix, ignoring metric.
+    pub fn samePrefix(self: Route, other: Route) bool {
+        return self.family == other.family and
+            self.dst_len == other.dst_len and
+            std.mem.eql(u8, self.addr(), other.addr());
+    }
+
+    /// Same kernel identity: a route is keyed by (table, prefix, priority).
+    pub fn sameKey(self: Route, other: Route) bool {
+        return self.samePrefix(other) and self.metric == other.metric;
+    }
+
+    /// Whether `self` (installed) already forwards the way `declared` asks.
+    /// An unspecified device on the declared side matches any interface.
+    pub fn sameNextHop(self: Route, declared: Route) bool {
+        if (!gatewayEql(self.family, self.gateway, declared.gateway)) return false;
+        return declared.oif == 0 or self.oif == declared.oif;
+    }
+};
+
+fn gatewayEql(family: Family, a: ?[16]u8, b: ?[16]u8) bool {
+    if (a == null and b == null) return true;
+    if (a == null or b == null) return false;
+    const n = family.addrLen();
+    return std.mem.eql(u8, a.?[0..n], b.?[0..n]);
+}
+
+/// Zero host bits beyond `prefix_len` so the kernel accepts the prefix and
+/// comparisons against dumped routes are exact.
+pub fn maskAddress(addr: *[16]u8, family: Family, prefix_len: u8) void {
+    const n = family.addrLen();
+    var i: usize = 0;
+    while (i < n) : (i += 1) {
+        const bit_start = i * 8;
+        if (bit_start >= prefix_len) {
+            addr[i] = 0;
+        } else if (bit_start + 8 > prefix_len) {
+            const keep: u3 = @intCast(prefix_len - bit_start);
+            addr[i] &= @as(u8, 0xFF) << @as(u3, @intCast(@as(u4, 8) - keep));
+        }
+    }
+}
+
+pub const Op = enum { create, replace, delete };
+
+pub const Change = struct {
+    op: Op,
+    route: Route,
+};
+
+/// Compute the change that makes `table` contain `declared`, and update
+/// `table` in place so later declarations are diffed against the result.
+pub fn planAdd(allocator: std.mem.Allocator, table: *std.ArrayList(Route), declared: Route) !?Change {
+    for (table.items) |*installed| {
+        if (!installed.sameKey(declared)) continue;
+        if (installed.sameNextHop(declared)) return null;
+        installed.* = declared;
+        return Change{ .op = .replace, .route = declared };
+    }
+    try table.append(allocator, declared);
+    return Change{ .op = .create, .route = declared };
+}
+
+/// Compute the change that removes `declared` from `table`. Metric and
+/// gateway only narrow the match when the declaration sets them.
+pub fn planDelete(table: *std.ArrayList(Route), declared: Route, match_metric: bool) ?Change {
+    for (table.items, 0..) |installed, i| {
+        if (!installed.samePrefix(declared)) continue;
+        if (match_metric and installed.metric != declared.metric) continue;
+        if (declared.gateway != null and !gatewayEql(installed.family, installed.gateway, declared.gateway)) continue;
+        _ = table.orderedRemove(i);
+        return Change{ .op = .delete, .route = installed };
+    }
+    return null;
+}
+
+fn appendStruct(allocator: std.mem.Allocator, buf: *std.ArrayList(u8), value: anytype) !void {
+    try buf.appendSlice(allocator, std.mem.asBytes(&value));
+}
+
+fn appendAttr(allocator: std.mem.Allocator, buf: *std.ArrayList(u8), attr_type: u16, data: []const u8) !void {
+    const len = @sizeOf(RtAttr) + data.len;
+    try appendStruct(allocator, buf, RtAttr{ .len = @intCast(len), .type = attr_type });
+    try buf.appendSlice(allocator, data);
+    try buf.appendNTimes(allocator, 0, alignUp(len) - len);
+}
+
+fn finishMessage(buf: *std.ArrayList(u8), start: usize) void {
+    const len: u32 = @intCast(buf.items.len - start);
+    std.mem.writeInt(u32, buf.items[start..][0..4], len, .native);
+}
+
+/// Encode one RTM_NEWROUTE/RTM_DELROUTE request with NLM_F_ACK set.
+pub fn encodeChange(allocator: std.mem.Allocator, buf: *std.ArrayList(u8), change: Change, seq: u32) !void {
+    const route = change.route;
+    const start = buf.items.len;
+
+    var flags: u16 = NLM_F_REQUEST | NLM_F_ACK;
+    switch (change.op) {
+        .create => flags |= NLM_F_CREATE | NLM_F_EXCL,
+        .replace => flags |= NLM_F_CREATE | NLM_F_REPLACE,
+        .delete => {},
+    }
+
+    try appendStruct(allocator, buf, NlMsgHdr{
+        .len = 0,
+        .type = if (change.op == .delete) RTM_DELROUTE else RTM_NEWROUTE,
+        .flags = flags,
+        .seq = seq,
+        .pid = 0,
+    });
+
+    // Device-only routes are on-link; everything else is universe scope.
+    // Deletes match any scope and protocol, like `ip route del`.
+    const scope: u8 = if (change.op == .delete)
+        RT_SCOPE_NOWHERE
+    else if (route.gateway == null and route.family == .ipv4)
+        RT_SCOPE_LINK
+    else
+        RT_SCOPE_UNIVERSE;
+
+    try appendStruct(allocator, buf, RtMsg{
+        .family = @intFromEnum(route.family),
+        .dst_len = route.dst_len,
+        .src_len = 0,
+        .tos = 0,
+        .table = @intCast(RT_TABLE_MAIN),
+        .protocol = if (change.op == .delete) 0 else RTPROT_STATIC,
+        .scope = scope,
+        .type = RTN_UNICAST,
+        .flags = 0,
+    });
+
+    const addr_len = route.family.addrLen();
+    if (route.dst_len > 0) try appendAttr(allocator, buf, RTA_DST, route.dst[0..addr_len]);
+    if (route.gateway) |gw| try appendAttr(allocator, buf, RTA_GATEWAY, gw[0..addr_len]);
+    if (route.oif != 0) try appendAttr(allocator, buf, RTA_OIF, std.mem.asBytes(&route.oif));
+    try appendAttr(allocator, buf, RTA_PRIORITY, std.mem.asBytes(&route.metric));
+
+    finishMessage(buf, start);
+}
+
+/// Decode an RTM_NEWROUTE payload from a dump. Returns null for routes
+/// outside the main table, non-unicast entries and unknown families.
+pub fn decodeRoute(payload: []const u8) ?Route {
+    if (payload.len < @sizeOf(RtMsg)) return null;
+    const rtm = std.mem.bytesToValue(RtMsg, payload[0..@sizeOf(RtMsg)]);
+
+    const family: Family = switch (rtm.family) {
+        AF_INET => .ipv4,
+        AF_INET6 => .ipv6,
+        else => return null,
+    };
+    if (rtm.type != RTN_UNICAST) return null;
+
+    var route = Route{
+        .family = family,
+        .dst_len = rtm.dst_len,
+        .metric = 0,
+    };
+    var table: u32 = rtm.table;
+    const addr_len = family.addrLen();
+
+    var off: usize = alignUp(@sizeOf(RtMsg));
+    while (off + @sizeOf(RtAttr) <= payload.len) {
+        const attr = std.mem.bytesToValue(RtAttr, payload[off..][0..@sizeOf(RtAttr)]);
+        if (attr.len < @sizeOf(RtAttr) or off + attr.len > payload.len) break;
+        const data = payload[off + @sizeOf(RtAttr) .. off + attr.len];
+
+        switch (attr.type) {
+            RTA_DST => if (data.len == addr_len) @memcpy(route.dst[0..addr_len], data),
+            RTA_GATEWAY => if (data.len == addr_len) {
+                var gw = [_]u8{0} ** 16;
+                @memcpy(gw[0..addr_len], data);
+                route.gateway = gw;
+            },
+            RTA_OIF => if (data.len == 4) {
+                route.oif = std.mem.bytesToValue(u32, data[0..4]);
+            },
+            RTA_PRIORITY => if (data.len == 4) {
+                route.metric = std.mem.bytesToValue(u32, data[0..4]);
+            },
+            RTA_TABLE => if (data.len == 4) {
+                table = std.mem.bytesToValue(u32, data[0..4]);
+            },
+            else => {},
+        }
+        off += alignUp(attr.len);
+    }
+
+    if (table != RT_TABLE_MAIN) return null;
+    return route;
+}
+
+pub const Socket = struct {
+    fd: std.posix.socket_t,
+    seq: u32,
+
+    pub fn open() !Socket {
+        const fd = try std.posix.socket(
+            std.posix.AF.NETLINK,
+            std.posix.SOCK.RAW | std.posix.SOCK.CLOEXEC,
+            NETLINK_ROUTE,
+        );
+        return .{
+            .fd = fd,
+            .seq = @truncate(@as(u64, @bitCast(std.time.timestamp()))),
+        };
+    }
+
+    pub fn close(self: *Socket) void {
+        std.posix.close(self.fd);
+    }
+
+    fn nextSeq(self: *Socket) u32 {
+        self.seq +%= 1;
+        return self.seq;
+    }
+
+    /// Dump all IPv4 and IPv6 unicast routes of the main table.
+    pub fn dumpRoutes(self: *Socket, allocator: std.mem.Allocator) !std.ArrayList(Route) {
+        var req = std.ArrayList(u8).empty;
+        defer req.deinit(allocator);
+
+        const seq = self.nextSeq();
+        try appendStruct(allocator, &req, NlMsgHdr{
+            .len = 0,
+            .type = RTM_GETROUTE,
+            .flags = NLM_F_REQUEST | NLM_F_DUMP,
+            .seq = seq,
+            .pid = 0,
+        });
+        // AF_UNSPEC returns both IPv4 and IPv6 routes in one dump
+        try appendStruct(allocator, &req, std.mem.zeroes(RtMsg));
+        finishMessage(&req, 0);
+        _ = try std.posix.send(self.fd, req.items, 0);
+
+        var routes = std.ArrayList(Route).empty;
+        errdefer routes.deinit(allocator);
+
+        const buf = try allocator.alloc(u8, recv_buf_size);
+        defer allocator.free(buf);
+
+        while (true) {
+            const n = try std.posix.recv(self.fd, buf, 0);
+            if (n == 0) return error.NetlinkClosed;
+
+            var off: usize = 0;
+            while (off + @sizeOf(NlMsgHdr) <= n) {
+                const hdr = std.mem.bytesToValue(NlMsgHdr, buf[off..][0..@sizeOf(NlMsgHdr)]);
+                if (hdr.len < @sizeOf(NlMsgHdr) or off + hdr.len > n) return error.MalformedNetlinkMessage;
+                const payload = buf[off + @sizeOf(NlMsgHdr) .. off + hdr.len];
+                off += alignUp(hdr.len);
+
+                if (hdr.seq != seq) continue;
+                switch (hdr.type) {
+                    NLMSG_DONE => return routes,
+                    NLMSG_ERROR => {
+                        if (payload.len < 4) return error.MalformedNetlinkMessage;
+                        const code = std.mem.bytesToValue(i32, payload[0..4]);
+                        if (code != 0) return error.RouteDumpFailed;
+                    },
+                    RTM_NEWROUTE => if (decodeRoute(payload)) |route| {
+                        try routes.append(allocator, route);
+                    },
+                    else => {},
+                }
+            }
+        }
+    }
+
+    /// Send every change and collect one status per change. Changes are
+    /// processed by the kernel in order; a failure does not stop later ones.
+    /// Send one change and wait for its ack. Changes go out one at a time
+    /// so a caller can stop at the first one the kernel rejects.
+    pub fn applyChange(self: *Socket, allocator: std.mem.Allocator, change: Change) !std.posix.E {
+        var buf = std.ArrayList(u8).empty;
+        defer buf.deinit(allocator);
+
+        const seq = self.nextSeq();
+        try encodeChange(allocator, &buf, change, seq);
+        _ = try std.posix.send(self.fd, buf.items, 0);
+
+        var recv_buf: [4096]u8 = undefined;
+        var status = [_]std.posix.E{.SUCCESS};
+        try self.collectAcks(&recv_buf, seq, 0, 1, &status);
+        return status[0];
+    }
+
+    fn collectAcks(self: *Socket, buf: []u8, base_seq: u32, first: usize, end: usize, statuses: []std.posix.E) !void {
+        var pending = end - first;
+        while (pending > 0) {
+            const n = try std.posix.recv(self.fd, buf, 0);
+            if (n == 0) return error.NetlinkClosed;
+
+            var off: usize = 0;
+            while (off + @sizeOf(NlMsgHdr) <= n) {
+                const hdr = std.mem.bytesToValue(NlMsgHdr, buf[off..][0..@sizeOf(NlMsgHdr)]);
+                if (hdr.len < @sizeOf(NlMsgHdr) or off + hdr.len > n) return error.MalformedNetlinkMessage;
+                const payload = buf[off + @sizeOf(NlMsgHdr) .. off + hdr.len];
+                off += alignUp(hdr.len);
+
+                if (hdr.type != NLMSG_ERROR or payload.len < 4) continue;
+                const index: usize = hdr.seq -% base_seq;
+                if (index < first or index >= end) continue;
+
+                const code = std.mem.bytesToValue(i32, payload[0..4]);
+                if (code < 0) statuses[index] = @enumFromInt(@as(u16, @intCast(-code)));
+                pending -= 1;
+            }
+        }
+    }
+};
+
+test "maskAddress clears host bits" {
+    var addr = [_]u8{ 10, 1, 2, 3 } ++ [_]u8{0} ** 12;
+    maskAddress(&addr, .ipv4, 8);
+    try std.testing.expectEqualSlices(u8, &[_]u8{ 10, 0, 0, 0 }, addr[0..4]);
+
+    addr = [_]u8{ 192, 168, 255, 255 } ++ [_]u8{0} ** 12;
+    maskAddress(&addr, .ipv4, 20);
+    try std.testing.expectEqualSlices(u8, &[_]u8{ 192, 168, 240, 0 }, addr[0..4]);
+
+    var v6 = [_]u8{0xFF} ** 16;
+    maskAddress(&v6, .ipv6, 64);
+    try std.testing.expectEqualSlices(u8, &([_]u8{0xFF} ** 8 ++ [_]u8{0} ** 8), &v6);
+}
+
+test "planAdd detects gateway changes and planDelete narrows by gateway" {
+    const allocator = std.testing.allocator;
+    var table = std.ArrayList(Route).empty;
+    defer table.deinit(allocator);
+
+    const gw_a = [_]u8{ 192, 168, 1, 1 } ++ [_]u8{0} ** 12;
+    const gw_b = [_]u8{ 192, 168, 1, 254 } ++ [_]u8{0} ** 12;
+    const dst = [_]u8{ 10, 0, 0, 0 } ++ [_]u8{0} ** 12;
+    try table.append(allocator, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_a, .oif = 2, .metric = 0 });
+
+    // Identical next hop: nothing to do
+    const same = try planAdd(allocator, &table, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_a, .metric = 0 });
+    try std.testing.expect(same == null);
+
+    // Same prefix and metric but different gateway: replace in place
+    const moved = (try planAdd(allocator, &table, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_b, .metric = 0 })).?;
+    try std.testing.expectEqual(Op.replace, moved.op);
+    try std.testing.expectEqual(@as(usize, 1), table.items.len);
+
+    // Different metric is a distinct kernel route
+    const extra = (try planAdd(allocator, &table, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_a, .metric = 100 })).?;
+    try std.testing.expectEqual(Op.create, extra.op);
+    try std.testing.expectEqual(@as(usize, 2), table.items.len);
+
+    // Delete with gateway only removes the matching route
+    const removed = planDelete(&table, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_a, .metric = 0 }, false).?;
+    try std.testing.expectEqual(@as(u32, 100), removed.route.metric);
+    try std.testing.expectEqual(@as(usize, 1), table.items.len);
+    try std.testing.expect(planDelete(&table, .{ .family = .ipv4, .dst = dst, .dst_len = 8, .gateway = gw_a, .metric = 0 }, false) == null);
+}
+
+test "encodeChange round-trips through decodeRoute" {
+    const allocator = std.testing.allocator;
+    var buf = std.ArrayList(u8).empty;
+    defer buf.deinit(allocator);
+
+    var dst = [_]u8{0} ** 16;
+    dst[0] = 0x20;
+    dst[1] = 0x01;
+    dst[2] = 0x0d;
+    dst[3] = 0xb8;
+    var gw = [_]u8{0} ** 16;
+    gw[0] = 0xfe;
+    gw[1] = 0x80;
+    gw[15] = 1;
+
+    const route = Route{ .family = .ipv6, .dst = dst, .dst_len = 32, .gateway = gw, .oif = 3, .metric = 1024 };
+    try encodeChange(allocator, &buf, .{ .op = .create, .route = route }, 42);
+
+    const hdr = std.mem.bytesToValue(NlMsgHdr, buf.items[0..@sizeOf(NlMsgHdr)]);
+    try std.testing.expectEqual(@as(u32, @intCast(buf.items.len)), hdr.len);
+    try std.testing.expectEqual(RTM_NEWROUTE, hdr.type);
+    try std.testing.expectEqual(@as(u32, 42), hdr.seq);
+
+    const decoded = decodeRoute(buf.items[@sizeOf(NlMsgHdr)..]).?;
+    try std.testing.expect(decoded.sameKey(route));
+    try std.testing.expect(decoded.sameNextHop(route));
+    try std.testing.expectEqual(@as(u32, 3), decoded.oif);
+}
@@ -1,10 +1,14 @@
 # data_bag support for agent mode
-# $_hola_params is injected by the provision engine as a parsed Hash
+# $_hola_params is injected by the provision engine as a HolaJsonView over
+# the params document; only the values read through it become Ruby objects, and
+# nested objects come back as views that still answer is_a?(Hash)
 $_hola_params ||= {}
 
 def data_bag(*keys)
+  keys = keys.map(&:to_s)
+  return $_hola_params.dig(*keys) if $_hola_params.is_a?(HolaJsonView)
   keys.reduce($_hola_params) do |val, key|
     return nil unless val.is_a?(Hash)
-    val[key.to_s]
+    val[key]
   end
 end
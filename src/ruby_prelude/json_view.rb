@@ -0,0 +1,107 @@
+# Read-only view over a JSON document parsed on the Zig side ($_hola_params,
+# $_hola_secrets). Reading a scalar turns just that value into a Ruby object;
+# reading an object or array returns another view over it, so a script pays
+# for the keys it touches rather than for the whole subtree. Reads are
+# memoized per path.
+#
+# A view answers is_a?/kind_of? as the Hash (or Array) it stands for, and
+# compares equal to one with ==. It is still not a real Hash: `Hash === view`
+# (case/when) and `hash == view` do not match; call to_h / to_a for a copy.
+class HolaJsonView
+  def initialize(handle, path = [], kind = nil)
+    @handle = handle
+    @path = path
+    @kind = kind
+    @cache = {}
+  end
+
+  def dig(*keys)
+    return @cache[keys] if @cache.key?(keys)
+    full = @path + keys
+    kind = ZigBackend.json_view_kind(@handle, full)
+    @cache[keys] = if kind == "object" || kind == "array"
+      HolaJsonView.new(@handle, full, kind)
+    else
+      ZigBackend.json_view_dig(@handle, full)
+    end
+  end
+
+  def [](key)
+    dig(key)
+  end
+
+  def fetch(key, *default)
+    return dig(key) if key?(key)
+    return yield(key) if block_given?
+    return default[0] unless default.empty?
+    raise KeyError, "key not found: #{key.inspect}"
+  end
+
+  def key?(key)
+    ZigBackend.json_view_exists(@handle, @path + [key])
+  end
+  alias has_key? key?
+  alias include? key?
+
+  def keys
+    ZigBackend.json_view_keys(@handle, @path) || []
+  end
+
+  def size
+    array? ? to_a.size : keys.size
+  end
+  alias length size
+
+  def empty?
+    size == 0
+  end
+
+  def array?
+    (@kind ||= ZigBackend.json_view_kind(@handle, @path)) == "array"
+  end
+
+  # Everything else works on the fully materialized subtree
+  def materialize
+    @value ||= ZigBackend.json_view_dig(@handle, @path)
+  end
+
+  def to_h
+    array? ? materialize.to_h : materialize
+  end
+  alias to_hash to_h
+
+  def to_a
+    materialize.to_a
+  end
+
+  def to_ary
+    array? ? materialize : to_a
+  end
+
+  def each(&block)
+    materialize.each(&block)
+  end
+
+  def ==(other)
+    return true if equal?(other)
+    other = other.materialize if other.is_a?(HolaJsonView)
+    materialize == other
+  end
+
+  def is_a?(klass)
+    (array? ? Array : Hash).ancestors.include?(klass) || super
+  end
+  alias kind_of? is_a?
+
+  def method_missing(name, *args, &block)
+    materialize.send(name, *args, &block)
+  end
+
+  def respond_to_missing?(name, include_private = false)
+    (array? ? [] : {}).respond_to?(name, include_private) || super
+  end
+
+  def inspect
+    array? ? "#<HolaJsonView array>" : "#<HolaJsonView #{keys.size} keys>"
+  end
+end
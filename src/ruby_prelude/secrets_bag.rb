@@ -1,10 +1,14 @@
 # secrets_bag support for sensitive data (passwords, API keys, etc.)
-# $_hola_secrets is injected by the provision engine as a parsed Hash
+# $_hola_secrets is injected by the provision engine as a HolaJsonView over
+# the secrets document; only the values read through it become Ruby objects, and
+# nested objects come back as views that still answer is_a?(Hash)
 $_hola_secrets ||= {}
 
 def secrets_bag(*keys)
+  keys = keys.map(&:to_s)
+  return $_hola_secrets.dig(*keys) if $_hola_secrets.is_a?(HolaJsonView)
   keys.reduce($_hola_secrets) do |val, key|
     return nil unless val.is_a?(Hash)
-    val[key.to_s]
+    val[key]
   end
 end
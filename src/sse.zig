@@ -1,87 +1,166 @@
 const std = @import("std");
 
-/// A parsed SSE event
+/// A parsed SSE event. Fields are slices into the parser's buffers and stay
+/// valid until the next `Parser.feed`; copy anything that must outlive it.
 pub const Event = struct {
     event_type: ?[]const u8 = null,
     data: ?[]const u8 = null,
     id: ?[]const u8 = null,
+};
 
-    pub fn deinit(self: *Event, allocator: std.mem.Allocator) void {
-        if (self.event_type) |v| allocator.free(v);
-        if (self.data) |v| allocator.free(v);
-        if (self.id) |v| allocator.free(v);
-    }
+/// Location of a field value: in the raw stream buffer, or in `scratch` when
+/// several `data:` lines had to be joined
+const Span = struct {
+    off: usize,
+    len: usize,
+    joined: bool = false,
+};
+
+/// A complete event waiting in the queue
+const Pending = struct {
+    /// Lowest stream offset the event references; bytes before the oldest
+    /// pending event can be discarded
+    start: usize,
+    event_type: ?Span,
+    data: Span,
+    id: ?Span,
 };
 
 /// Incremental SSE line-protocol parser.
 /// Feed raw bytes via `feed()`, poll complete events via `next()`.
+///
+/// Chunks are appended to one stream buffer and split on newlines with
+/// `indexOfScalarPos` (vectorized in std). Field values are not copied:
+/// events refer to their bytes in the stream buffer, except that multi-line
+/// `data` is joined once into a scratch buffer. The queue is drained from a
+/// head index, and consumed bytes and events are dropped on the next feed.
 pub const Parser = struct {
     allocator: std.mem.Allocator,
-    line_buf: std.ArrayList(u8),
+    // Raw stream bytes from the start of the oldest unconsumed event
+    stream: std.ArrayList(u8) = .empty,
+    // Start of the first line not yet processed
+    line_start: usize = 0,
+    // Everything before this is known to contain no newline
+    scan_pos: usize = 0,
+    scratch: std.ArrayList(u8) = .empty,
     // Accumulated fields for the current event
-    data_buf: std.ArrayList(u8),
-    event_type: ?[]const u8 = null,
-    event_id: ?[]const u8 = null,
-    has_data: bool = false,
-    // Queue of complete events ready to be consumed
-    events: std.ArrayList(Event),
+    current_start: ?usize = null,
+    event_type: ?Span = null,
+    event_id: ?Span = null,
+    data: ?Span = null,
+    // Last event ID buffer: unlike the other fields it carries over to
+    // later events until another `id:` line replaces it
+    last_id: std.ArrayList(u8) = .empty,
+    // Queue of complete events ready to be consumed; `head` is the next one
+    events: std.ArrayList(Pending) = .empty,
+    head: usize = 0,
 
     pub fn init(allocator: std.mem.Allocator) Parser {
-        return .{
-            .allocator = allocator,
-            .line_buf = std.ArrayList(u8).empty,
-            .data_buf = std.ArrayList(u8).empty,
-            .events = std.ArrayList(Event).empty,
-        };
+        return .{ .allocator = allocator };
     }
 
     pub fn deinit(self: *Parser) void {
-        self.line_buf.deinit(self.allocator);
-        self.data_buf.deinit(self.allocator);
-        if (self.event_type) |v| self.allocator.free(v);
-        if (self.event_id) |v| self.allocator.free(v);
-        for (self.events.items) |*ev| ev.deinit(self.allocator);
+        self.stream.deinit(self.allocator);
+        self.scratch.deinit(self.allocator);
+        self.last_id.deinit(self.allocator);
         self.events.deinit(self.allocator);
     }
 
-    /// Feed a chunk of raw bytes from the HTTP stream.
+    /// Feed a chunk of raw bytes from the HTTP stream. Invalidates events
+    /// returned by `next` so far.
     pub fn feed(self: *Parser, data: []const u8) !void {
-        for (data) |byte| {
-            if (byte == '\n') {
-                try self.processLine();
-                self.line_buf.clearRetainingCapacity();
-            } else if (byte == '\r') {
-                // ignore CR, we handle LF
-            } else {
-                try self.line_buf.append(self.allocator, byte);
-            }
+        self.compact();
+        try self.stream.appendSlice(self.allocator, data);
+
+        while (std.mem.indexOfScalarPos(u8, self.stream.items, self.scan_pos, '\n')) |nl| {
+            var end = nl;
+            if (end > self.line_start and self.stream.items[end - 1] == '\r') end -= 1;
+            try self.processLine(self.line_start, end);
+            self.line_start = nl + 1;
+            self.scan_pos = nl + 1;
         }
+        self.scan_pos = self.stream.items.len;
     }
 
     /// Return the next complete event, or null.
     pub fn next(self: *Parser) ?Event {
-        if (self.events.items.len == 0) return null;
-        return self.events.orderedRemove(0);
+        if (self.head == self.events.items.len) return null;
+        const pending = self.events.items[self.head];
+        self.head += 1;
+        return .{
+            .event_type = self.slice(pending.event_type),
+            .data = self.slice(pending.data),
+            .id = self.slice(pending.id),
+        };
+    }
+
+    fn slice(self: *const Parser, span: ?Span) ?[]const u8 {
+        const s = span orelse return null;
+        const source = if (s.joined) self.scratch.items else self.stream.items;
+        return source[s.off..][0..s.len];
     }
 
-    fn processLine(self: *Parser) !void {
-        const line = self.line_buf.items;
+    /// Drop consumed events and the stream bytes only they referenced
+    fn compact(self: *Parser) void {
+        if (self.head > 0) {
+            const remaining = self.events.items.len - self.head;
+            std.mem.copyForwards(Pending, self.events.items[0..remaining], self.events.items[self.head..]);
+            self.events.shrinkRetainingCapacity(remaining);
+            self.head = 0;
+        }
+
+        const keep_from = if (self.events.items.len > 0)
+            self.events.items[0].start
+        else
+            self.current_start orelse self.line_start;
+        if (keep_from > 0) {
+            const kept = self.stream.items.len - keep_from;
+            std.mem.copyForwards(u8, self.stream.items[0..kept], self.stream.items[keep_from..]);
+            self.stream.shrinkRetainingCapacity(kept);
+
+            self.line_start -= keep_from;
+            self.scan_pos -= keep_from;
+            if (self.current_start) |*start| start.* -= keep_from;
+            if (self.event_type) |*span| shiftSpan(span, keep_from);
+            if (self.event_id) |*span| shiftSpan(span, keep_from);
+            if (self.data) |*span| shiftSpan(span, keep_from);
+            for (self.events.items) |*pending| {
+                pending.start -= keep_from;
+                if (pending.event_type) |*span| shiftSpan(span, keep_from);
+                if (pending.id) |*span| shiftSpan(span, keep_from);
+                shiftSpan(&pending.data, keep_from);
+            }
+        }
+
+        var scratch_in_use = if (self.data) |d| d.joined else false;
+        for (self.events.items) |pending| {
+            const id_joined = if (pending.id) |id| id.joined else false;
+            scratch_in_use = scratch_in_use or pending.data.joined or id_joined;
+        }
+        if (!scratch_in_use) self.scratch.clearRetainingCapacity();
+    }
+
+    fn shiftSpan(span: *Span, by: usize) void {
+        if (!span.joined) span.off -= by;
+    }
+
+    fn processLine(self: *Parser, start: usize, end: usize) !void {
+        const line = self.stream.items[start..end];
 
         // Empty line → dispatch event
         if (line.len == 0) {
-            if (self.has_data) {
-                const ev = Event{
+            if (self.data) |data| {
+                try self.events.append(self.allocator, .{
+                    .start = self.current_start.?,
                     .event_type = self.event_type,
-                    .data = try self.allocator.dupe(u8, self.data_buf.items),
-                    .id = self.event_id,
-                };
-                try self.events.append(self.allocator, ev);
-                // Reset accumulators (ownership transferred)
-                self.event_type = null;
-                self.event_id = null;
-                self.data_buf.clearRetainingCapacity();
-                self.has_data = false;
+                    .data = data,
+                    .id = try self.dispatchId(),
+                });
             }
+            self.current_start = null;
+            self.event_type = null;
+            self.event_id = null;
+            self.data = null;
             return;
         }
 
@@ -90,25 +169,53 @@ pub const Parser = struct {
 
         // Parse "field: value" or "field:value"
         var field: []const u8 = line;
-        var value: []const u8 = "";
+        var value = Span{ .off = end, .len = 0 };
         if (std.mem.indexOfScalar(u8, line, ':')) |colon| {
             field = line[0..colon];
-            const rest = line[colon + 1 ..];
-            value = if (rest.len > 0 and rest[0] == ' ') rest[1..] else rest;
+            var off = start + colon + 1;
+            if (off < end and self.stream.items[off] == ' ') off += 1;
+            value = .{ .off = off, .len = end - off };
         }
 
         if (std.mem.eql(u8, field, "data")) {
-            if (self.has_data) try self.data_buf.append(self.allocator, '\n');
-            try self.data_buf.appendSlice(self.allocator, value);
-            self.has_data = true;
+            if (self.data) |*data| {
+                // Second and later data lines are joined with '\n'
+                if (!data.joined) {
+                    const joined_off = self.scratch.items.len;
+                    try self.scratch.appendSlice(self.allocator, self.stream.items[data.off..][0..data.len]);
+                    data.* = .{ .off = joined_off, .len = data.len, .joined = true };
+                }
+                try self.scratch.append(self.allocator, '\n');
+                try self.scratch.appendSlice(self.allocator, self.stream.items[value.off..][0..value.len]);
+                data.len += 1 + value.len;
+            } else {
+                self.data = value;
+            }
         } else if (std.mem.eql(u8, field, "event")) {
-            if (self.event_type) |old| self.allocator.free(old);
-            self.event_type = try self.allocator.dupe(u8, value);
+            self.event_type = value;
         } else if (std.mem.eql(u8, field, "id")) {
-            if (self.event_id) |old| self.allocator.free(old);
-            self.event_id = try self.allocator.dupe(u8, value);
+            const id = self.stream.items[value.off..][0..value.len];
+            // Per the spec, an id containing NUL is ignored
+            if (std.mem.indexOfScalar(u8, id, 0) != null) return;
+            self.last_id.clearRetainingCapacity();
+            try self.last_id.appendSlice(self.allocator, id);
+            self.event_id = value;
+        } else {
+            // "retry" and unknown fields are ignored
+            return;
         }
-        // "retry" and unknown fields are ignored
+        if (self.current_start == null) self.current_start = start;
+    }
+
+    /// Id of the event being dispatched: its own `id:` line, else the last
+    /// event ID seen on the stream, copied to scratch since the line that
+    /// set it may already have been compacted away
+    fn dispatchId(self: *Parser) !?Span {
+        if (self.event_id) |span| return if (span.len > 0) span else null;
+        if (self.last_id.items.len == 0) return null;
+        const off = self.scratch.items.len;
+        try self.scratch.appendSlice(self.allocator, self.last_id.items);
+        return .{ .off = off, .len = self.last_id.items.len, .joined = true };
     }
 };
 
@@ -120,8 +227,7 @@ test "parse single event" {
 
     try parser.feed("event: provision\ndata: {\"url\":\"https://example.com/test.rb\"}\n\n");
 
-    var ev = parser.next() orelse return error.ExpectedEvent;
-    defer ev.deinit(allocator);
+    const ev = parser.next() orelse return error.ExpectedEvent;
 
     try std.testing.expectEqualStrings("provision", ev.event_type.?);
     try std.testing.expectEqualStrings("{\"url\":\"https://example.com/test.rb\"}", ev.data.?);
@@ -134,8 +240,7 @@ test "parse multi-line data" {
 
     try parser.feed("data: line1\ndata: line2\n\n");
 
-    var ev = parser.next() orelse return error.ExpectedEvent;
-    defer ev.deinit(allocator);
+    const ev = parser.next() orelse return error.ExpectedEvent;
 
     try std.testing.expectEqualStrings("line1\nline2", ev.data.?);
 }
@@ -157,8 +262,76 @@ test "incremental feed across chunks" {
     try parser.feed("data: hel");
     try parser.feed("lo\n\n");
 
-    var ev = parser.next() orelse return error.ExpectedEvent;
-    defer ev.deinit(allocator);
+    const ev = parser.next() orelse return error.ExpectedEvent;
 
     try std.testing.expectEqualStrings("hello", ev.data.?);
 }
+
+test "CRLF line endings and fields split across chunks" {
+    const allocator = std.testing.allocator;
+    var parser = Parser.init(allocator);
+    defer parser.deinit();
+
+    const stream = "id: 7\r\nevent: job\r\ndata: first\r\ndata: second\r\n\r\nevent: ping\ndata:\n\n";
+    // Byte at a time exercises every split point
+    for (0..stream.len) |i| try parser.feed(stream[i .. i + 1]);
+
+    const first = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("7", first.id.?);
+    try std.testing.expectEqualStrings("job", first.event_type.?);
+    try std.testing.expectEqualStrings("first\nsecond", first.data.?);
+
+    const second = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("ping", second.event_type.?);
+    try std.testing.expectEqualStrings("", second.data.?);
+    // The last event id is not reset by the blank line
+    try std.testing.expectEqualStrings("7", second.id.?);
+    try std.testing.expect(parser.next() == null);
+}
+
+test "last event id carries over to later events" {
+    const allocator = std.testing.allocator;
+    var parser = Parser.init(allocator);
+    defer parser.deinit();
+
+    try parser.feed("id: 41\ndata: a\n\n");
+    const a = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("41", a.id.?);
+
+    // The line that set the id is compacted away by the next feed
+    try parser.feed("event: ping\ndata: b\n\n");
+    const b = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("41", b.id.?);
+    try std.testing.expectEqualStrings("ping", b.event_type.?);
+
+    // An empty id clears it
+    try parser.feed("id\ndata: c\n\ndata: d\n\n");
+    const c = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expect(c.id == null);
+    const d = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expect(d.id == null);
+    try std.testing.expect(d.event_type == null);
+}
+
+test "undrained events survive later feeds" {
+    const allocator = std.testing.allocator;
+    var parser = Parser.init(allocator);
+    defer parser.deinit();
+
+    try parser.feed("data: a\n\ndata: b1\nevent: x\ndata: b2\n\n");
+    const a = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("a", a.data.?);
+
+    // The joined event and a new one queued behind it
+    try parser.feed("data: c\n\ndata: partial");
+    const b = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("b1\nb2", b.data.?);
+    try std.testing.expectEqualStrings("x", b.event_type.?);
+
+    try parser.feed("\n\n");
+    const c = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("c", c.data.?);
+    const d = parser.next() orelse return error.ExpectedEvent;
+    try std.testing.expectEqualStrings("partial", d.data.?);
+    try std.testing.expect(parser.next() == null);
+}
@@ -0,0 +1,219 @@
+//! Native Time.parse for mruby, which ships without Regexp or Time.parse.
+//!
+//! Covers the formats actually emitted by the GitHub API, RFC 3339 /
+//! ISO 8601 and plain "YYYY-MM-DD[ HH:MM:SS]". Returns a Time in UTC; add
+//! an offset yourself if you need local time. Raises ArgumentError on any
+//! unrecognized input (matches CRuby).
+
+const std = @import("std");
+const mruby = @import("mruby.zig");
+
+extern fn mrb_obj_as_string(mrb: *mruby.mrb_state, obj: mruby.mrb_value) mruby.mrb_value;
+
+pub const ParseError = error{
+    Empty,
+    TooShort,
+    BadDate,
+    BadSeparator,
+    BadTime,
+    BadFraction,
+    BadTimezone,
+    OutOfRange,
+};
+
+pub const Timestamp = struct {
+    /// Seconds since the Unix epoch
+    seconds: i64,
+    microseconds: u32 = 0,
+};
+
+/// Parse `input` (surrounding whitespace allowed) into a UTC timestamp
+pub fn parse(input: []const u8) ParseError!Timestamp {
+    const s = std.mem.trim(u8, input, " \t\r\n");
+    if (s.len == 0) return error.Empty;
+    if (s.len < 10) return error.TooShort;
+
+    const year = digits(s, 0, 4) orelse return error.BadDate;
+    if (s[4] != '-' or s[7] != '-') return error.BadDate;
+    const month = digits(s, 5, 2) orelse return error.BadDate;
+    const day = digits(s, 8, 2) orelse return error.BadDate;
+
+    var hour: i64 = 0;
+    var minute: i64 = 0;
+    var second: i64 = 0;
+    var microseconds: u32 = 0;
+    var offset: i64 = 0;
+
+    if (s.len > 10) {
+        switch (s[10]) {
+            'T', 't', ' ' => {},
+            else => return error.BadSeparator,
+        }
+        if (s.len < 19 or s[13] != ':' or s[16] != ':') return error.BadTime;
+        hour = digits(s, 11, 2) orelse return error.BadTime;
+        minute = digits(s, 14, 2) orelse return error.BadTime;
+        second = digits(s, 17, 2) orelse return error.BadTime;
+
+        var pos: usize = 19;
+        if (pos < s.len and s[pos] == '.') {
+            pos += 1;
+            const start = pos;
+            var scale: u32 = 100_000;
+            while (pos < s.len and std.ascii.isDigit(s[pos])) : (pos += 1) {
+                microseconds += (s[pos] - '0') * scale;
+                scale /= 10;
+            }
+            if (pos == start) return error.BadFraction;
+        }
+        if (pos < s.len) offset = try timezoneOffset(s[pos..]);
+    }
+
+    // Same limits as Time.utc
+    if (month < 1 or month > 12 or day < 1 or day > 31) return error.OutOfRange;
+    if (hour > 24 or (hour == 24 and (minute > 0 or second > 0)) or minute > 59 or second > 60) return error.OutOfRange;
+
+    const days = daysFromCivil(year, month, day);
+    return .{
+        .seconds = days * std.time.s_per_day + hour * 3600 + minute * 60 + second - offset,
+        .microseconds = microseconds,
+    };
+}
+
+fn digits(s: []const u8, start: usize, len: usize) ?i64 {
+    if (start + len > s.len) return null;
+    var value: i64 = 0;
+    for (s[start .. start + len]) |c| {
+        if (!std.ascii.isDigit(c)) return null;
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+/// Seconds east of UTC for "Z", "UTC", "GMT", "+HH", "+HHMM" or "+HH:MM"
+fn timezoneOffset(tz: []const u8) ParseError!i64 {
+    if (std.mem.eql(u8, tz, "Z") or std.mem.eql(u8, tz, "z") or
+        std.mem.eql(u8, tz, "UTC") or std.mem.eql(u8, tz, "GMT")) return 0;
+
+    if (tz.len < 3 or (tz[0] != '+' and tz[0] != '-')) return error.BadTimezone;
+    const sign: i64 = if (tz[0] == '-') -1 else 1;
+    const hours = digits(tz, 1, 2) orelse return error.BadTimezone;
+    const minutes: ?i64 = switch (tz.len) {
+        3 => 0,
+        5 => digits(tz, 3, 2),
+        6 => if (tz[3] == ':') digits(tz, 4, 2) else null,
+        else => null,
+    };
+    return sign * (hours * 3600 + (minutes orelse return error.BadTimezone) * 60);
+}
+
+/// Days since 1970-01-01 in the proleptic Gregorian calendar. Days past the
+/// end of a month roll over, as timegm does.
+fn daysFromCivil(year: i64, month: i64, day: i64) i64 {
+    const y = if (month <= 2) year - 1 else year;
+    const era = @divFloor(y, 400);
+    const yoe = y - era * 400;
+    const mp = @mod(month + 9, 12);
+    const doy = @divFloor(153 * mp + 2, 5) + day - 1;
+    const doe = yoe * 365 + @divFloor(yoe, 4) - @divFloor(yoe, 100) + doy;
+    return era * 146097 + doe - 719468;
+}
+
+fn describe(err: ParseError) []const u8 {
+    return switch (err) {
+        error.Empty => "empty string",
+        error.TooShort => "too short",
+        error.BadDate => "bad date",
+        error.BadSeparator => "bad date/time separator",
+        error.BadTime => "bad time portion",
+        error.BadFraction => "bad fractional seconds",
+        error.BadTimezone => "bad timezone",
+        error.OutOfRange => "argument out of range",
+    };
+}
+
+/// mruby binding: Time.parse(str)
+fn time_parse(mrb: *mruby.mrb_state, _: mruby.mrb_value) callconv(.c) mruby.mrb_value {
+    var arg: mruby.mrb_value = undefined;
+    _ = mruby.mrb_get_args(mrb, "o", &arg);
+
+    const str = if (mruby.zig_mrb_string_p(arg) != 0) arg else mrb_obj_as_string(mrb, arg);
+    const input = std.mem.span(mruby.mrb_str_to_cstr(mrb, str));
+
+    const timestamp = parse(input) catch |err| {
+        var buf: [160]u8 = undefined;
+        const msg: [:0]const u8 = std.fmt.bufPrintZ(&buf, "Time.parse: {s}: \"{s}\"", .{
+            describe(err),
+            input[0..@min(input.len, 64)],
+        }) catch "Time.parse: invalid time";
+        mruby.mrb_raise(mrb, mruby.mrb_class_get(mrb, "ArgumentError"), msg.ptr);
+    };
+
+    const time_class = mruby.mrb_obj_value(mruby.mrb_class_get(mrb, "Time"));
+    const args = [_]mruby.mrb_value{
+        mruby.mrb_int_value(mrb, timestamp.seconds),
+        mruby.mrb_int_value(mrb, timestamp.microseconds),
+    };
+    const time = mruby.mrb_funcall_argv(mrb, time_class, mruby.mrb_intern_cstr(mrb, "at"), args.len, &args);
+    return mruby.mrb_funcall_argv(mrb, time, mruby.mrb_intern_cstr(mrb, "utc"), 0, null);
+}
+
+/// Register Time.parse (replaces the former Ruby polyfill)
+pub fn setupTimeExtensions(mrb: *mruby.mrb_state) void {
+    const time_class = mruby.mrb_class_get(mrb, "Time");
+    mruby.mrb_define_class_method(mrb, time_class, "parse", time_parse, mruby.MRB_ARGS_REQ(1));
+}
+
+test "parse handles ISO 8601 / RFC 3339" {
+    // 2026-05-09T08:41:20 UTC == epoch 1778316080
+    const utc_epoch: i64 = 1778316080;
+    const t = std.testing;
+    try t.expectEqual(utc_epoch, (try parse("2026-05-09T08:41:20Z")).seconds);
+    try t.expectEqual(@as(u32, 123_000), (try parse("2026-05-09T08:41:20.123Z")).microseconds);
+    try t.expectEqual(utc_epoch, (try parse(" 2026-05-09 08:41:20 ")).seconds);
+    try t.expectEqual(utc_epoch, (try parse("2026-05-09T16:41:20+08:00")).seconds);
+    try t.expectEqual(utc_epoch, (try parse("2026-05-09T16:41:20+0800")).seconds);
+    try t.expectEqual(utc_epoch, (try parse("2026-05-09T03:41:20-05")).seconds);
+    try t.expectEqual(@as(i64, 1778284800), (try parse("2026-05-09")).seconds);
+    try t.expectEqual(@as(i64, 951782400), (try parse("2000-02-29")).seconds);
+    try t.expectEqual(@as(i64, -86400), (try parse("1969-12-31")).seconds);
+
+    try t.expectError(error.Empty, parse(""));
+    try t.expectError(error.BadDate, parse("2026/05/09"));
+    try t.expectError(error.BadTimezone, parse("2026-05-09T08:41:20+9"));
+    try t.expectError(error.OutOfRange, parse("2026-13-09"));
+}
+
+test "native Time.parse, OpenStruct and Base64 bindings from Ruby" {
+    const base64 = @import("base64.zig");
+
+    var mrb = try mruby.State.init();
+    defer mrb.deinit();
+    const mrb_ptr = mrb.mrb orelse return error.MRubyNotInitialized;
+
+    base64.setAllocator(std.testing.allocator);
+    base64.setupBase64Module(mrb_ptr);
+    mruby.zig_mrb_define_open_struct(mrb_ptr);
+    setupTimeExtensions(mrb_ptr);
+
+    try mrb.evalString(
+        \\raise "Time.parse" unless Time.parse("2026-05-09T16:41:20+08:00").to_i == 1778316080
+        \\os = OpenStruct.new({ a: { b: 1, c: [{ d: 2 }] }, "e" => 3 })
+        \\raise "to_h nested" unless os.to_h == { "a" => { "b" => 1, "c" => [{ "d" => 2 }] }, "e" => 3 }
+        \\raise "reader" unless os.a.b == 1 && os.a.c[0].d == 2 && os.a.equal?(os.a)
+        \\raise "to_h after read" unless os.to_h == { "a" => { "b" => 1, "c" => [{ "d" => 2 }] }, "e" => 3 }
+        \\h = os.to_h
+        \\h["a"]["b"] = 9
+        \\raise "to_h copies" unless os.a.b == 1 && os.to_h["a"]["b"] == 1
+        \\raise "respond_to?" unless os.respond_to?(:e) && os.respond_to?(:zz=) && !os.respond_to?(:zz)
+        \\os[:f] = { g: [1, 2] }
+        \\raise "[]=" unless os["f"].g == [1, 2] && os.f.equal?(os[:f]) && os.key?(:f)
+        \\raise "dig" unless os.dig(:a, :c, 0, :d) == 2 && os.dig("f", "g", 1) == 2 && os.dig(:zz, :y).nil?
+        \\raise "writer" unless (os.e = 4) == 4 && os.to_h["e"] == 4
+        \\raise "encode64" unless Base64.strict_encode64("hello") == "aGVsbG8="
+        \\raise "decode64" unless Base64.decode64("aGVsbG8=") == "hello"
+        \\raise "urlsafe" unless Base64.urlsafe_encode64("\xff\xfe") == "__4" && Base64.urlsafe_decode64("__4") == "\xff\xfe"
+        \\big = "x" * 5000
+        \\raise "heap round trip" unless Base64.decode64(Base64.encode64(big)) == big
+        \\raise "invalid" unless Base64.decode64("@@@").nil?
+    );
+}
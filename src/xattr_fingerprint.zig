@@ -0,0 +1,164 @@
+//! Fingerprints of files hola writes, kept in a `user.hola.fp` extended
+//! attribute so a later run can prove a target unchanged with `fstat` plus
+//! one `fgetxattr`, without reading the content.
+//!
+//! The attribute holds "1 <inode> <size> <mtime_ns> <kind> <hex>". A record
+//! is only trusted while the file's inode, size and mtime still match it.
+//! (ctime would be stricter, but writing the attribute, renaming the file
+//! into place and chmod/chown all advance ctime, so it cannot be recorded in
+//! the inode it describes.) Files on filesystems whose timestamps have whole
+//! second resolution are not fingerprinted, since a same-second rewrite of
+//! the same size would go unnoticed.
+//!
+//! A record only proves that hola (or anyone able to write the file) wrote
+//! it, so it is used to skip work, never to verify a user-pinned checksum.
+//!
+//! Everything here is best effort: on filesystems without xattr support (or
+//! without permission) `load` returns null and `store` does nothing, and
+//! callers fall back to comparing content.
+
+const std = @import("std");
+const builtin = @import("builtin");
+
+const attr_name = "user.hola.fp";
+const record_version = "1";
+
+pub const Kind = enum {
+    /// SHA-256 of the content
+    sha256,
+    /// BLAKE3 of the content
+    blake3,
+    /// Hash of the template source and variables the file was rendered from
+    template,
+};
+
+pub const Record = struct {
+    kind: Kind,
+    digest: [32]u8,
+};
+
+const sys = switch (builtin.os.tag) {
+    .linux => struct {
+        extern "c" fn fgetxattr(fd: c_int, name: [*:0]const u8, value: [*]u8, size: usize) isize;
+        extern "c" fn fsetxattr(fd: c_int, name: [*:0]const u8, value: [*]const u8, size: usize, flags: c_int) c_int;
+
+        fn get(fd: std.posix.fd_t, buf: []u8) isize {
+            return fgetxattr(fd, attr_name, buf.ptr, buf.len);
+        }
+        fn set(fd: std.posix.fd_t, value: []const u8) bool {
+            return fsetxattr(fd, attr_name, value.ptr, value.len, 0) == 0;
+        }
+    },
+    .macos => struct {
+        extern "c" fn fgetxattr(fd: c_int, name: [*:0]const u8, value: [*]u8, size: usize, position: u32, options: c_int) isize;
+        extern "c" fn fsetxattr(fd: c_int, name: [*:0]const u8, value: [*]const u8, size: usize, position: u32, options: c_int) c_int;
+
+        fn get(fd: std.posix.fd_t, buf: []u8) isize {
+            return fgetxattr(fd, attr_name, buf.ptr, buf.len, 0, 0);
+        }
+        fn set(fd: std.posix.fd_t, value: []const u8) bool {
+            return fsetxattr(fd, attr_name, value.ptr, value.len, 0, 0) == 0;
+        }
+    },
+    else => struct {
+        fn get(_: std.posix.fd_t, _: []u8) isize {
+            return -1;
+        }
+        fn set(_: std.posix.fd_t, _: []const u8) bool {
+            return false;
+        }
+    },
+};
+
+/// The record stored on `file`, if it still describes the file as `stat`
+/// shows it
+pub fn load(file: std.fs.File, stat: std.fs.File.Stat) ?Record {
+    var buf: [160]u8 = undefined;
+    const n = sys.get(file.handle, &buf);
+    if (n <= 0) return null;
+    return decode(buf[0..@intCast(n)], stat);
+}
+
+/// Attach `record` to `file`. Call after the last write, since the record
+/// captures the file's current size and mtime.
+pub fn store(file: std.fs.File, record: Record) void {
+    const stat = file.stat() catch return;
+    if (@mod(stat.mtime, std.time.ns_per_s) == 0) return;
+    var buf: [160]u8 = undefined;
+    const value = encode(&buf, record, stat) catch return;
+    _ = sys.set(file.handle, value);
+}
+
+/// `store` by path, for files written by other code (downloads, renames)
+pub fn storePath(path: []const u8, record: Record) void {
+    const file = std.fs.cwd().openFile(path, .{}) catch return;
+    defer file.close();
+    store(file, record);
+}
+
+fn encode(buf: []u8, record: Record, stat: std.fs.File.Stat) ![]const u8 {
+    return std.fmt.bufPrint(buf, record_version ++ " {d} {d} {d} {s} {s}", .{
+        stat.inode,
+        stat.size,
+        stat.mtime,
+        @tagName(record.kind),
+        &std.fmt.bytesToHex(record.digest, .lower),
+    });
+}
+
+fn decode(value: []const u8, stat: std.fs.File.Stat) ?Record {
+    var fields = std.mem.tokenizeScalar(u8, value, ' ');
+    if (!std.mem.eql(u8, fields.next() orelse return null, record_version)) return null;
+    const inode = std.fmt.parseInt(u64, fields.next() orelse return null, 10) catch return null;
+    const size = std.fmt.parseInt(u64, fields.next() orelse return null, 10) catch return null;
+    const mtime = std.fmt.parseInt(i128, fields.next() orelse return null, 10) catch return null;
+    if (inode != stat.inode or size != stat.size or mtime != stat.mtime) return null;
+
+    const kind = std.meta.stringToEnum(Kind, fields.next() orelse return null) orelse return null;
+    var record = Record{ .kind = kind, .digest = undefined };
+    _ = std.fmt.hexToBytes(&record.digest, fields.next() orelse return null) catch return null;
+    return record;
+}
+
+test "encode and decode round-trip while the stat matches" {
+    const stat = std.fs.File.Stat{
+        .inode = 1234,
+        .size = 99,
+        .mode = 0o644,
+        .kind = .file,
+        .atime = 0,
+        .mtime = 1_700_000_000_123_456_789,
+        .ctime = 0,
+    };
+    const record = Record{ .kind = .template, .digest = [_]u8{0xab} ** 32 };
+
+    var buf: [160]u8 = undefined;
+    const value = try encode(&buf, record, stat);
+    const decoded = decode(value, stat).?;
+    try std.testing.expectEqual(Kind.template, decoded.kind);
+    try std.testing.expectEqualSlices(u8, &record.digest, &decoded.digest);
+
+    var touched = stat;
+    touched.mtime += 1;
+    try std.testing.expect(decode(value, touched) == null);
+    try std.testing.expect(decode("2 1234 99 1 blake3 00", stat) == null);
+}
+
+test "store and load on a real file" {
+    var tmp = std.testing.tmpDir(.{});
+    defer tmp.cleanup();
+
+    const file = try tmp.dir.createFile("target", .{ .read = true });
+    defer file.close();
+    try file.writeAll("managed content\n");
+    // Avoid the whole-second guard on filesystems with coarse timestamps
+    try file.updateTimes(1_700_000_000_000_000_001, 1_700_000_000_000_000_001);
+
+    const record = Record{ .kind = .blake3, .digest = [_]u8{7} ** 32 };
+    store(file, record);
+    const loaded = load(file, try file.stat()) orelse return error.SkipZigTest; // no xattr support
+    try std.testing.expectEqualSlices(u8, &record.digest, &loaded.digest);
+
+    try file.writeAll("more");
+    try std.testing.expect(load(file, try file.stat()) == null);
+}